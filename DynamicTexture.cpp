@@ -0,0 +1,226 @@
+#include "DynamicTexture.h"
+#include <cstring>
+#include <QDebug>
+
+DynamicTexture::DynamicTexture()
+    : state(nullptr), texture(0), stream(QOpenGLBuffer::PixelUnpackBuffer), filter(ImageKernels::Box),
+      inFrame(false)
+{
+}
+
+DynamicTexture::~DynamicTexture()
+{
+    destroy();
+}
+
+bool DynamicTexture::create(GLStateCache &stateCache, const QSize &size, bool mipmaps, ImageKernels::Filter mipFilter)
+{
+    destroy();
+    if (size.isEmpty())
+        return false;
+    initializeOpenGLFunctions();
+    state = &stateCache;
+    filter = mipFilter;
+
+    // 各层的大小和 glTexStorage2D 的规则一样：每层宽高减半、向下取整、最小 1
+    qsizetype bytes = 0;
+    QSize levelSize = size;
+    for (;;) {
+        levels.push_back({levelSize, bytes});
+        bytes += qsizetype(levelSize.width()) * levelSize.height() * 4;
+        if (!mipmaps || (levelSize.width() == 1 && levelSize.height() == 1))
+            break;
+        levelSize = ImageKernels::mipSize(levelSize);
+    }
+    pixels.assign(size_t(bytes), 0);
+
+    // DSA 创建，不动任何绑定
+    glCreateTextures(GL_TEXTURE_2D, 1, &texture);
+    glTextureParameteri(texture, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTextureParameteri(texture, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTextureParameteri(texture, GL_TEXTURE_MIN_FILTER, mipmaps ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+    glTextureParameteri(texture, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTextureStorage2D(texture, GLsizei(levels.size()), GL_RGBA8, size.width(), size.height());
+
+    // 一个区域放得下整条 mip 链，整张更新也只用一个区域
+    if (!stream.create(bytes)) {
+        qWarning("DynamicTexture: cannot create the upload stream buffer");
+        destroy();
+        return false;
+    }
+    state->invalidate();  // StreamBuffer 创建时直接绑定过像素解包缓冲
+
+    commit(QRect(QPoint(0, 0), size));  // 先传一次全黑，纹理内容不是未定义的
+    counters = Stats();
+    return true;
+}
+
+void DynamicTexture::destroy()
+{
+    stream.destroy();
+    if (texture) {
+        glDeleteTextures(1, &texture);
+        texture = 0;
+    }
+    pixels.clear();
+    levels.clear();
+    inFrame = false;
+    if (state)
+        state->invalidate();  // 删掉的纹理/缓冲可能还记在缓存里
+}
+
+void DynamicTexture::beginFrame()
+{
+    if (!texture || inFrame)
+        return;
+    stream.beginFrame();
+    inFrame = true;
+}
+
+void DynamicTexture::endFrame()
+{
+    if (!inFrame)
+        return;
+    stream.endFrame();
+    inFrame = false;
+}
+
+QRect DynamicTexture::clip(const QRect &rect, QPoint *skip) const
+{
+    const QRect clipped = rect.intersected(QRect(QPoint(0, 0), size()));
+    *skip = QPoint(clipped.x() - rect.x(), clipped.y() - rect.y());
+    return clipped;
+}
+
+void DynamicTexture::update(const QRect &rect, const uchar *data, int stride, PixelFormat format)
+{
+    if (!texture)
+        return;
+    QPoint skip;
+    const QRect r = clip(rect, &skip);
+    if (r.isEmpty())
+        return;
+
+    const int bytesPerPixel = format == Rgb8 ? 3 : 4;
+    const int rowBytes = size().width() * 4;
+    const uchar *src = data + qsizetype(skip.y()) * stride + skip.x() * bytesPerPixel;
+    uchar *dst = levelData(0) + qsizetype(r.y()) * rowBytes + r.x() * 4;
+    for (int y = 0; y < r.height(); ++y) {
+        const uchar *in = src + qsizetype(y) * stride;
+        uchar *out = dst + qsizetype(y) * rowBytes;
+        switch (format) {
+        case Rgba8:
+            std::memcpy(out, in, size_t(r.width()) * 4);
+            break;
+        case Bgra8:
+            ImageKernels::bgraToRgba(in, out, r.width());
+            break;
+        case Rgb8:
+            ImageKernels::rgbToRgba(in, out, r.width());
+            break;
+        }
+    }
+    commit(r);
+}
+
+void DynamicTexture::update(const QImage &image, const QPoint &offset)
+{
+    const QRect rect(offset, image.size());
+    switch (image.format()) {
+    case QImage::Format_RGBA8888:
+    case QImage::Format_RGBX8888:
+        update(rect, image.constBits(), int(image.bytesPerLine()), Rgba8);
+        return;
+#if Q_BYTE_ORDER == Q_LITTLE_ENDIAN
+    case QImage::Format_ARGB32:
+    case QImage::Format_RGB32:
+        update(rect, image.constBits(), int(image.bytesPerLine()), Bgra8);
+        return;
+#endif
+    case QImage::Format_RGB888:
+        update(rect, image.constBits(), int(image.bytesPerLine()), Rgb8);
+        return;
+    default: {
+        // 其他格式（预乘 alpha、调色板、16 位……）还是交给 QImage 转换
+        const QImage converted = image.convertToFormat(QImage::Format_RGBA8888);
+        update(rect, converted.constBits(), int(converted.bytesPerLine()), Rgba8);
+    }
+    }
+}
+
+void DynamicTexture::updateYuv420(const QRect &rect, const uchar *y, int yStride, const uchar *u, const uchar *v,
+                                  int uvStride)
+{
+    if (!texture)
+        return;
+    if ((rect.x() | rect.y()) & 1) {
+        qWarning("DynamicTexture::updateYuv420: the rectangle must start at even coordinates");
+        return;
+    }
+    QPoint skip;
+    const QRect r = clip(rect, &skip);
+    if (r.isEmpty())
+        return;
+
+    // rect 的左上角是偶数、纹理的左上角是 0，所以裁掉的部分也是偶数，U/V 正好对齐
+    const int rowBytes = size().width() * 4;
+    ImageKernels::yuv420ToRgba(y + qsizetype(skip.y()) * yStride + skip.x(), yStride,
+                               u + qsizetype(skip.y() / 2) * uvStride + skip.x() / 2,
+                               v + qsizetype(skip.y() / 2) * uvStride + skip.x() / 2, uvStride,
+                               levelData(0) + qsizetype(r.y()) * rowBytes + r.x() * 4, rowBytes, r.width(), r.height());
+    commit(r);
+}
+
+void DynamicTexture::commit(const QRect &rect)
+{
+    ++counters.updates;
+    counters.convertedPixels += qint64(rect.width()) * rect.height();
+
+    // 每层只重算、只上传受影响的矩形
+    std::vector<QRect> dirty(levels.size());
+    dirty[0] = rect;
+    for (size_t level = 1; level < levels.size(); ++level) {
+        const Level &parent = levels[level - 1];
+        dirty[level] = ImageKernels::mipRect(dirty[level - 1], parent.size, filter);
+        ImageKernels::downsample(levelData(int(level) - 1), parent.size.width(), parent.size.height(),
+                                 parent.size.width() * 4, levelData(int(level)), levels[level].size.width() * 4,
+                                 filter, dirty[level]);
+    }
+
+    // 所有层的块拷进这一帧的区域，逐层 glTextureSubImage2D（偏移是缓冲里的偏移，DMA 异步进行）
+    const bool ownFrame = !inFrame;
+    if (ownFrame)
+        beginFrame();
+    state->bindBuffer(GL_PIXEL_UNPACK_BUFFER, stream.bufferId());
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    for (size_t level = 0; level < levels.size(); ++level) {
+        const QRect &r = dirty[level];
+        if (r.isEmpty())
+            continue;
+        const int levelWidth = levels[level].size.width();
+        const uchar *src = levelData(int(level)) + (qsizetype(r.y()) * levelWidth + r.x()) * 4;
+        const qsizetype rowBytes = qsizetype(r.width()) * 4;
+        qsizetype offset = 0;
+        uchar *dst = static_cast<uchar *>(stream.allocate(rowBytes * r.height(), 4, &offset));
+        if (dst) {
+            for (int y = 0; y < r.height(); ++y)
+                std::memcpy(dst + y * rowBytes, src + qsizetype(y) * levelWidth * 4, size_t(rowBytes));
+            glTextureSubImage2D(texture, GLint(level), r.x(), r.y(), r.width(), r.height(), GL_RGBA, GL_UNSIGNED_BYTE,
+                                reinterpret_cast<const void *>(offset));
+        } else {
+            // 这一帧的更新加起来超过了一个区域：这一层直接从副本上传，驱动同步拷走
+            state->bindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+            glPixelStorei(GL_UNPACK_ROW_LENGTH, levelWidth);
+            glTextureSubImage2D(texture, GLint(level), r.x(), r.y(), r.width(), r.height(), GL_RGBA, GL_UNSIGNED_BYTE,
+                                src);
+            glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+            state->bindBuffer(GL_PIXEL_UNPACK_BUFFER, stream.bufferId());
+            ++counters.directUploads;
+        }
+        counters.uploadedBytes += rowBytes * r.height();
+    }
+    // 别的代码（TextureManager 的占位纹理等）从内存上传时不能有像素解包缓冲绑着
+    state->bindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    if (ownFrame)
+        endFrame();
+}
@@ -0,0 +1,96 @@
+#ifndef DYNAMICTEXTURE_H
+#define DYNAMICTEXTURE_H
+
+#include <QImage>
+#include <QRect>
+#include <QSize>
+#include <vector>
+#include "GLTraceFunctions.h"
+#include "StreamBuffer.h"
+#include "GLStateCache.h"
+#include "ImageKernels.h"
+
+/* DynamicTexture：内容经常变的纹理（视频帧、摄像头画面、画板）
+ *
+ * 静态纹理走 TextureManager：QImage 转成 RGBA8、整张 glTexSubImage2D、glGenerateMipmap。
+ * 每帧都变的纹理照这样做，每次都是一次通用的格式转换、整张上传、整条 mip 链重算。这里改成：
+ *   - 像素格式转换用 ImageKernels 的 SIMD 内核（BGRA、RGB、I420 -> RGBA8），直接写进 CPU 这边的一份 RGBA8 副本
+ *   - update() 只给变了的矩形：只转换这一块，每层 mip 只重算受影响的那一块（ImageKernels::mipRect），
+ *     也只上传这些块（glTextureSubImage2D）
+ *   - 上传的数据经过持久映射的 StreamBuffer（像素解包缓冲）：CPU 拷进去就返回，DMA 由驱动异步做，
+ *     和 TextureManager 的 PBO 上传一个道理
+ * CPU 副本就是完整的 mip 链（多占 1/3），每层 mip 从上一层的副本算，不用把纹理读回来。
+ *
+ * 用法（每帧）：
+ *   texture.beginFrame();
+ *   texture.update(...);   // 任意多次，共用环形缓冲的同一个区域、同一个 fence
+ *   texture.endFrame();
+ * 一个区域放得下整条 mip 链；同一帧里更新的总量超过它时，放不下的层直接从 CPU 副本上传（驱动同步拷走）。
+ * 不在 beginFrame()/endFrame() 之间的 update() 自己占一个区域，一帧里这样更新超过 3 次就要等 GPU。
+ *
+ * 所有成员函数都要求上下文是当前上下文。
+ */
+class DynamicTexture : protected GLTraceFunctions
+{
+public:
+    enum PixelFormat
+    {
+        Rgba8,
+        Bgra8,   // QImage::Format_ARGB32 / RGB32 在小端机器上的内存顺序
+        Rgb8
+    };
+
+    struct Stats
+    {
+        int updates = 0;             // update() 次数（累计，下同）
+        qint64 uploadedBytes = 0;    // 所有层实际上传的字节数
+        qint64 convertedPixels = 0;  // 第 0 层转换过的像素数
+        int directUploads = 0;       // 这一帧的区域放不下，直接从副本上传的层数
+    };
+
+    DynamicTexture();
+    ~DynamicTexture();
+
+    // mipmaps 为 false 时只有一层；filter 是生成 mip 的滤波器
+    bool create(GLStateCache &state, const QSize &size, bool mipmaps = true,
+                ImageKernels::Filter filter = ImageKernels::Box);
+    void destroy();
+    bool isCreated() const { return texture != 0; }
+
+    GLuint textureId() const { return texture; }
+    QSize size() const { return levels.empty() ? QSize() : levels.front().size; }
+    int levelCount() const { return int(levels.size()); }
+
+    void beginFrame();   // 切到环形缓冲的下一个区域，必要时等 GPU 读完它
+    void endFrame();     // 这一帧的上传都发出之后调用，插入 fence
+
+    // data 指向 rect 左上角的像素，stride 是源数据一行的字节数；rect 超出纹理的部分丢掉
+    void update(const QRect &rect, const uchar *data, int stride, PixelFormat format);
+    void update(const QImage &image, const QPoint &offset = QPoint(0, 0));   // 常见格式不做 QImage 转换
+    // I420：y/u/v 指向 rect 左上角，rect 的左上角坐标必须是偶数（U/V 每 2x2 个像素一个）
+    void updateYuv420(const QRect &rect, const uchar *y, int yStride, const uchar *u, const uchar *v, int uvStride);
+
+    const Stats &stats() const { return counters; }
+
+private:
+    struct Level
+    {
+        QSize size;
+        qsizetype offset;   // 在 pixels 里的字节偏移
+    };
+
+    uchar *levelData(int level) { return pixels.data() + levels[size_t(level)].offset; }
+    QRect clip(const QRect &rect, QPoint *skip) const;   // skip 返回左上角被裁掉的像素数
+    void commit(const QRect &rect);                      // 第 0 层的 rect 已经写进副本：算 mip、上传
+
+    GLStateCache *state;
+    GLuint texture;
+    StreamBuffer stream;
+    std::vector<uchar> pixels;   // 整条 mip 链的 RGBA8 副本，各层依次存放
+    std::vector<Level> levels;
+    ImageKernels::Filter filter;
+    Stats counters;
+    bool inFrame;   // 在 beginFrame() 和 endFrame() 之间
+};
+
+#endif // DYNAMICTEXTURE_H
@@ -0,0 +1,301 @@
+#include "FrameCapture.h"
+#include <QDir>
+#include <QFileInfo>
+#include <QImage>
+#include <QMutexLocker>
+#include <QDebug>
+#include <cstring>
+
+namespace {
+
+// BT.601 有限范围（Y 16-235，U/V 16-240），整数运算，和 ffmpeg 的 yuv420p 默认约定一致
+inline uchar lumaOf(int r, int g, int b)
+{
+    return uchar(((66 * r + 129 * g + 25 * b + 128) >> 8) + 16);
+}
+
+inline uchar blueDifference(int r, int g, int b)
+{
+    return uchar(((-38 * r - 74 * g + 112 * b + 128) >> 8) + 128);
+}
+
+inline uchar redDifference(int r, int g, int b)
+{
+    return uchar(((112 * r - 94 * g - 18 * b + 128) >> 8) + 128);
+}
+
+} // namespace
+
+FrameCapture::FrameCapture()
+    : head(0), inFlight(0), capturing(false), nextIndex(0), maxFrames(0), format(Png), encoder(nullptr),
+      stopping(false)
+{
+}
+
+FrameCapture::~FrameCapture()
+{
+    // 上下文可能已经不是当前上下文了（MyOpenGLWidget 会先调用 stop()），这里只收拾编码线程
+    stopEncoder();
+}
+
+FrameCapture::Format FrameCapture::formatForPath(const QString &path)
+{
+    return QFileInfo(path).suffix().compare("yuv", Qt::CaseInsensitive) == 0 ? RawYuv : Png;
+}
+
+bool FrameCapture::start(const QString &outputPath, Format outputFormat, int frames)
+{
+    stop();
+    initializeOpenGLFunctions();
+    error.clear();
+    path = outputPath;
+    format = outputFormat;
+    maxFrames = qMax(0, frames);
+
+    if (format == RawYuv) {
+        yuvFile.setFileName(path);
+        if (!yuvFile.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+            error = QString("cannot write %1: %2").arg(path, yuvFile.errorString());
+            return false;
+        }
+        yuvSize = QSize();
+    } else if (!path.endsWith(".png", Qt::CaseInsensitive) && !QDir().mkpath(path)) {
+        error = QString("cannot create directory %1").arg(path);
+        return false;
+    }
+
+    counters = Stats();
+    nextIndex = 0;
+    stopping = false;
+    encoder = new FrameEncoderThread(this);
+    encoder->start(QThread::LowPriority);
+    capturing = true;
+    return true;
+}
+
+void FrameCapture::stop()
+{
+    capturing = false;
+    if (inFlight > 0)
+        collect(true);
+    stopEncoder();
+    releaseSlots();
+}
+
+bool FrameCapture::isActive() const
+{
+    return capturing || inFlight > 0;
+}
+
+void FrameCapture::capture(GLuint framebuffer, const QSize &size)
+{
+    if (inFlight > 0)
+        collect(false);
+    if (!capturing || size.isEmpty()) {
+        if (!capturing && inFlight == 0 && encoder) {
+            // 截图这种读够帧数自动结束的：最后一帧交出去以后让编码线程写完就退出，不在这里等它
+            QMutexLocker locker(&queueMutex);
+            stopping = true;
+            queueNotEmpty.wakeOne();
+        }
+        return;
+    }
+    if (inFlight == RingSize) {
+        ++counters.droppedGpu;  // GPU 还没把前几帧读完：宁可丢一帧也不等
+        return;
+    }
+
+    ReadbackSlot &slot = ring[(head + inFlight) % RingSize];
+    const GLsizeiptr bytes = GLsizeiptr(size.width()) * size.height() * 4;
+    if (slot.capacity < bytes) {
+        // 不可变存储，只给 CPU 读；大小变大（窗口放大）时重建
+        if (slot.pbo)
+            glDeleteBuffers(1, &slot.pbo);
+        glCreateBuffers(1, &slot.pbo);
+        glNamedBufferStorage(slot.pbo, bytes, nullptr, GL_MAP_READ_BIT);
+        slot.capacity = bytes;
+    }
+
+    // 绑着 PIXEL_PACK_BUFFER 时 glReadPixels 的最后一个参数是缓冲里的偏移，立刻返回
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, framebuffer);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.pbo);
+    glPixelStorei(GL_PACK_ALIGNMENT, 4);
+    glReadPixels(0, 0, size.width(), size.height(), GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    slot.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    slot.size = size;
+    slot.index = nextIndex++;
+    ++inFlight;
+    ++counters.captured;
+    if (maxFrames > 0 && counters.captured >= quint64(maxFrames))
+        capturing = false;
+}
+
+void FrameCapture::collect(bool wait)
+{
+    while (inFlight > 0) {
+        ReadbackSlot &slot = ring[head];
+        // 不等待地查 fence；wait 时 GL_SYNC_FLUSH_COMMANDS_BIT 保证 fence 已经提交，不会死等
+        GLenum status = glClientWaitSync(slot.fence, 0, 0);
+        while (wait && status == GL_TIMEOUT_EXPIRED)
+            status = glClientWaitSync(slot.fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000);
+        if (status == GL_TIMEOUT_EXPIRED)
+            return;  // 按顺序取：最早的还没好，后面的也不用看了
+        glDeleteSync(slot.fence);
+        slot.fence = nullptr;
+
+        Frame frame;
+        frame.size = slot.size;
+        frame.index = slot.index;
+        const qsizetype bytes = qsizetype(slot.size.width()) * slot.size.height() * 4;
+        if (status != GL_WAIT_FAILED) {
+            const void *pixels = glMapNamedBufferRange(slot.pbo, 0, GLsizeiptr(bytes), GL_MAP_READ_BIT);
+            if (pixels) {
+                frame.pixels = QByteArray(static_cast<const char *>(pixels), bytes);
+                glUnmapNamedBuffer(slot.pbo);
+            }
+        }
+        head = (head + 1) % RingSize;
+        --inFlight;
+
+        QMutexLocker locker(&queueMutex);
+        if (frame.pixels.isEmpty() || queue.size() >= MaxQueuedFrames) {
+            ++counters.droppedEncoder;
+            continue;
+        }
+        queue.append(frame);
+        queueNotEmpty.wakeOne();
+    }
+}
+
+void FrameCapture::stopEncoder()
+{
+    if (!encoder)
+        return;
+    {
+        QMutexLocker locker(&queueMutex);
+        stopping = true;
+        queueNotEmpty.wakeOne();
+    }
+    encoder->wait();  // 队列里剩下的帧写完才退出
+    delete encoder;
+    encoder = nullptr;
+    if (yuvFile.isOpen()) {
+        yuvFile.close();
+        if (yuvSize.isValid())
+            qInfo("FrameCapture: %s is %dx%d yuv420p (ffmpeg -f rawvideo -pix_fmt yuv420p -s %dx%d -i ...)",
+                  qPrintable(path), yuvSize.width(), yuvSize.height(), yuvSize.width(), yuvSize.height());
+    }
+}
+
+void FrameCapture::releaseSlots()
+{
+    for (ReadbackSlot &slot : ring) {
+        if (slot.fence)
+            glDeleteSync(slot.fence);
+        if (slot.pbo)
+            glDeleteBuffers(1, &slot.pbo);
+        slot = ReadbackSlot();
+    }
+    head = 0;
+    inFlight = 0;
+}
+
+FrameCapture::Stats FrameCapture::stats() const
+{
+    QMutexLocker locker(&queueMutex);
+    return counters;
+}
+
+QString FrameCapture::pngPath(quint64 index) const
+{
+    const QString number = QString("%1").arg(index, 6, 10, QChar('0'));
+    if (!path.endsWith(".png", Qt::CaseInsensitive))
+        return QDir(path).filePath(QString("frame-%1.png").arg(number));
+    if (maxFrames == 1)
+        return path;
+    return path.left(path.size() - 4) + "-" + number + ".png";
+}
+
+void FrameCapture::write(const Frame &frame)
+{
+    const int w = frame.size.width();
+    const int h = frame.size.height();
+    const uchar *pixels = reinterpret_cast<const uchar *>(frame.pixels.constData());
+
+    if (format == Png) {
+        // 帧缓冲的 alpha 是场景混合之后剩下的值，不一定是 1，按不透明存；行顺序上下翻转
+        const QImage image(pixels, w, h, w * 4, QImage::Format_RGBX8888);
+        const QString file = pngPath(frame.index);
+        if (!image.mirrored().save(file)) {
+            qWarning() << "FrameCapture: cannot write" << file;
+            QMutexLocker locker(&queueMutex);
+            ++counters.droppedEncoder;
+            return;
+        }
+    } else {
+        // I420 要偶数宽高：奇数时丢掉最右一列 / 最下一行（glReadPixels 的第 0 行）。原始流里没有帧头，大小变了的帧只能丢掉
+        const QSize even(w & ~1, h & ~1);
+        if (!yuvSize.isValid())
+            yuvSize = even;
+        if (even != yuvSize || even.isEmpty()) {
+            QMutexLocker locker(&queueMutex);
+            ++counters.droppedEncoder;
+            return;
+        }
+        const int cw = even.width() / 2;
+        const int ch = even.height() / 2;
+        QByteArray yuv(qsizetype(even.width()) * even.height() + 2 * qsizetype(cw) * ch, Qt::Uninitialized);
+        uchar *yPlane = reinterpret_cast<uchar *>(yuv.data());
+        uchar *uPlane = yPlane + qsizetype(even.width()) * even.height();
+        uchar *vPlane = uPlane + qsizetype(cw) * ch;
+        // 输出自上而下，glReadPixels 的第 0 行在最下面
+        auto row = [&](int y) { return pixels + qsizetype(h - 1 - y) * w * 4; };
+        for (int y = 0; y < even.height(); ++y) {
+            const uchar *src = row(y);
+            uchar *dst = yPlane + qsizetype(y) * even.width();
+            for (int x = 0; x < even.width(); ++x)
+                dst[x] = lumaOf(src[x * 4], src[x * 4 + 1], src[x * 4 + 2]);
+        }
+        for (int y = 0; y < ch; ++y) {
+            const uchar *top = row(y * 2);
+            const uchar *bottom = row(y * 2 + 1);
+            for (int x = 0; x < cw; ++x) {
+                // 2x2 取平均再转换
+                int rgb[3];
+                for (int k = 0; k < 3; ++k)
+                    rgb[k] = (top[x * 8 + k] + top[x * 8 + 4 + k] + bottom[x * 8 + k] + bottom[x * 8 + 4 + k] + 2) >> 2;
+                uPlane[qsizetype(y) * cw + x] = blueDifference(rgb[0], rgb[1], rgb[2]);
+                vPlane[qsizetype(y) * cw + x] = redDifference(rgb[0], rgb[1], rgb[2]);
+            }
+        }
+        if (yuvFile.write(yuv) != yuv.size()) {
+            QMutexLocker locker(&queueMutex);
+            ++counters.droppedEncoder;
+            return;
+        }
+    }
+    QMutexLocker locker(&queueMutex);
+    ++counters.written;
+}
+
+FrameEncoderThread::FrameEncoderThread(FrameCapture *capture)
+    : capture(capture)
+{
+}
+
+void FrameEncoderThread::run()
+{
+    for (;;) {
+        FrameCapture::Frame frame;
+        {
+            QMutexLocker locker(&capture->queueMutex);
+            while (capture->queue.isEmpty() && !capture->stopping)
+                capture->queueNotEmpty.wait(&capture->queueMutex);
+            if (capture->queue.isEmpty())
+                return;  // stopping 而且队列已经空了
+            frame = capture->queue.takeFirst();
+        }
+        capture->write(frame);
+    }
+}
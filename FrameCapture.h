@@ -0,0 +1,120 @@
+#ifndef FRAMECAPTURE_H
+#define FRAMECAPTURE_H
+
+#include <QOpenGLFunctions_4_5_Core>
+#include <QThread>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QByteArray>
+#include <QList>
+#include <QSize>
+#include <QFile>
+
+class FrameEncoderThread;
+
+/* FrameCapture：不阻塞渲染的帧读回（截图、录屏）
+ *
+ * grabFramebuffer() 是同步的 glReadPixels：CPU 要等 GPU 把这一帧画完、再把像素拷回来，整条流水线停一下。
+ * 这里分三段，渲染线程全程不等待：
+ *   1. capture()：glReadPixels 读进环形的 PBO（RingSize 个）之一，返回的只是一个 DMA 命令，后面插入 fence
+ *   2. 之后几帧的 capture() 里，fence 已经触发的 PBO 映射出来拷走，交给编码线程；
+ *      GPU 落后太多、PBO 全都在路上时这一帧直接丢掉（stats().droppedGpu），不等
+ *   3. 编码线程把帧写成 PNG 序列，或者追加到一个 I420 原始 YUV 文件里（BT.601 有限范围，
+ *      ffmpeg -f rawvideo -pix_fmt yuv420p -s 宽x高 -i 文件 就能读）。
+ *      编码跟不上时队列最多攒 MaxQueuedFrames 帧，再多的丢掉（stats().droppedEncoder）
+ *
+ * 所有成员函数都要在同一个 GL 上下文是当前上下文时调用（MyOpenGLWidget 在 paintGL() 里调用 capture()）。
+ */
+class FrameCapture : protected QOpenGLFunctions_4_5_Core
+{
+public:
+    enum Format
+    {
+        Png,      // path 是目录：frame-000000.png …；以 .png 结尾时是文件名（多帧时加上 -000000）
+        RawYuv    // path 是文件：每帧的 Y、U、V 三个平面依次追加
+    };
+
+    struct Stats
+    {
+        quint64 captured = 0;         // 发出读回的帧数
+        quint64 written = 0;          // 编码线程写完的帧数
+        quint64 droppedGpu = 0;       // PBO 都在路上，没读的帧
+        quint64 droppedEncoder = 0;   // 编码线程跟不上（或者 YUV 录制中途改了大小）丢掉的帧
+    };
+
+    FrameCapture();
+    ~FrameCapture();
+
+    static Format formatForPath(const QString &path);   // .yuv -> RawYuv，其他 -> Png
+
+    // maxFrames > 0 时读够这么多帧就自动结束（1 = 截图）
+    bool start(const QString &path, Format format, int maxFrames = 0);
+    void stop();             // 等还在 GPU 上的帧读回来、编码线程写完
+    bool isActive() const;   // 已经 start()，还有帧要读或者还在读回
+    // 每帧画完以后调用：把 framebuffer 左下角 size 大小的内容异步读回，之前读好的帧交给编码线程
+    void capture(GLuint framebuffer, const QSize &size);
+
+    Stats stats() const;
+    QString errorString() const { return error; }
+
+private:
+    friend class FrameEncoderThread;
+
+    enum { RingSize = 4, MaxQueuedFrames = 16 };
+
+    struct ReadbackSlot
+    {
+        GLuint pbo = 0;
+        GLsizeiptr capacity = 0;
+        GLsync fence = nullptr;
+        QSize size;
+        quint64 index = 0;
+    };
+
+    struct Frame
+    {
+        QByteArray pixels;   // RGBA8，自下而上（glReadPixels 的行顺序）
+        QSize size;
+        quint64 index;
+    };
+
+    void collect(bool wait);     // 按顺序取出 fence 已经触发的 PBO；wait = 一直等到全部取完
+    void stopEncoder();
+    void releaseSlots();
+    void write(const Frame &frame);   // 编码线程里执行
+    QString pngPath(quint64 index) const;
+
+    ReadbackSlot ring[RingSize];
+    int head;                    // 最早发出、还没取回的那个
+    int inFlight;
+    bool capturing;              // 还要继续读新的帧
+    quint64 nextIndex;
+    int maxFrames;
+    Format format;
+    QString path;
+    QString error;
+
+    FrameEncoderThread *encoder;
+    mutable QMutex queueMutex;   // 保护下面的队列、stopping 和编码线程那边的计数
+    QWaitCondition queueNotEmpty;
+    QList<Frame> queue;
+    bool stopping;
+    Stats counters;
+    QFile yuvFile;               // 只由编码线程使用
+    QSize yuvSize;
+};
+
+/* 编码线程：从 FrameCapture 的队列里取帧写文件，stop() 之后写完剩下的才退出 */
+class FrameEncoderThread : public QThread
+{
+public:
+    explicit FrameEncoderThread(FrameCapture *capture);
+
+protected:
+    void run() override;
+
+private:
+    FrameCapture *capture;
+};
+
+#endif // FRAMECAPTURE_H
@@ -0,0 +1,280 @@
+#include "FrameProfiler.h"
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QSaveFile>
+#include <QMap>
+#include <QDebug>
+
+double FrameProfiler::Frame::cpuMs() const
+{
+    return scopes.empty() ? 0.0 : (scopes[0].cpuEnd - scopes[0].cpuBegin) / 1e6;
+}
+
+double FrameProfiler::Frame::gpuMs() const
+{
+    return gpuValid && !scopes.empty() ? (scopes[0].gpuEnd - scopes[0].gpuBegin) / 1e6 : -1.0;
+}
+
+FrameProfiler::FrameProfiler()
+    : initialized(false), active(true), inFrame(false), gpuToCpuOffset(0), frameCounter(0), current(nullptr),
+      historyLimit(600), dropped(0)
+{
+}
+
+FrameProfiler::~FrameProfiler()
+{
+    // 查询对象随上下文一起销毁；需要提前释放时由调用方在上下文是当前上下文时调用 cleanup()
+}
+
+void FrameProfiler::initialize()
+{
+    initializeOpenGLFunctions();
+    clock.start();
+    calibrate();
+    initialized = true;
+}
+
+void FrameProfiler::cleanup()
+{
+    if (!initialized)
+        return;
+    for (Slot &slot : inFlight) {
+        if (!slot.queries.empty())
+            glDeleteQueries(GLsizei(slot.queries.size()), slot.queries.data());
+        slot.queries.clear();
+        slot.usedQueries = 0;
+        slot.pending = false;
+    }
+    frames.clear();
+    current = nullptr;
+    inFrame = false;
+    initialized = false;
+}
+
+void FrameProfiler::calibrate()
+{
+    // GL_TIMESTAMP 的 glGetInteger64v 返回 "之前的命令都到达 GL 时" 的 GPU 时钟，不等命令执行完，
+    // 用它和 CPU 时钟对齐，GPU 的作用域才能和 CPU 的画在同一条时间轴上
+    GLint64 gpuNow = 0;
+    glGetInteger64v(GL_TIMESTAMP, &gpuNow);
+    gpuToCpuOffset = now() - gpuNow;
+}
+
+void FrameProfiler::beginFrame()
+{
+    if (!active || !initialized)
+        return;
+
+    Slot &slot = inFlight[frameCounter % FramesInFlight];
+    if (slot.pending)
+        resolve(slot);  // FramesInFlight 帧之前的那一帧，GPU 早该执行完了
+    if (frameCounter % 120 == 0)
+        calibrate();    // 两个时钟会慢慢漂移，隔一段时间重新对一次
+
+    slot.frame = Frame();
+    slot.frame.index = frameCounter++;
+    slot.usedQueries = 0;
+    current = &slot;
+    inFrame = true;
+    openScopes.clear();
+    beginScope("frame");
+}
+
+void FrameProfiler::endFrame()
+{
+    if (!inFrame)
+        return;
+    while (!openScopes.empty())
+        endScope(openScopes.back());  // 没配对的作用域在帧末一起结束
+    current->pending = true;
+    inFrame = false;
+    current = nullptr;
+}
+
+int FrameProfiler::issueTimestamp()
+{
+    if (current->usedQueries == int(current->queries.size())) {
+        // 查询池按需增长，稳定以后每帧不再创建查询对象
+        const size_t grow = qMax<size_t>(16, current->queries.size());
+        current->queries.resize(current->queries.size() + grow);
+        glGenQueries(GLsizei(grow), current->queries.data() + current->queries.size() - grow);
+    }
+    const int query = current->usedQueries++;
+    glQueryCounter(current->queries[query], GL_TIMESTAMP);
+    return query;
+}
+
+int FrameProfiler::beginScope(const char *name)
+{
+    if (!inFrame)
+        return -1;
+    Scope scope;
+    scope.name = name;
+    scope.depth = int(openScopes.size());
+    scope.cpuBegin = now();
+    scope.cpuEnd = scope.cpuBegin;
+    scope.gpuBegin = scope.gpuEnd = -1;
+    scope.beginQuery = issueTimestamp();
+    scope.endQuery = -1;
+
+    const int index = int(current->frame.scopes.size());
+    current->frame.scopes.push_back(scope);
+    openScopes.push_back(index);
+    return index;
+}
+
+void FrameProfiler::endScope(int scope)
+{
+    if (!inFrame || scope < 0 || openScopes.empty() || openScopes.back() != scope)
+        return;
+    openScopes.pop_back();
+    Scope &s = current->frame.scopes[size_t(scope)];
+    s.endQuery = issueTimestamp();
+    s.cpuEnd = now();
+}
+
+void FrameProfiler::setCounter(const char *name, qint64 value)
+{
+    if (!inFrame)
+        return;
+    for (auto &counter : current->frame.counters) {
+        if (counter.first == name) {
+            counter.second = value;
+            return;
+        }
+    }
+    current->frame.counters.emplace_back(name, value);
+}
+
+void FrameProfiler::resolve(Slot &slot)
+{
+    slot.pending = false;
+    Frame &frame = slot.frame;
+
+    // 查询按发出的顺序完成，最后一个有结果了前面的也都有了
+    GLint available = 0;
+    if (slot.usedQueries > 0)
+        glGetQueryObjectiv(slot.queries[size_t(slot.usedQueries - 1)], GL_QUERY_RESULT_AVAILABLE, &available);
+
+    if (available) {
+        for (Scope &scope : frame.scopes) {
+            GLuint64 begin = 0, end = 0;
+            glGetQueryObjectui64v(slot.queries[size_t(scope.beginQuery)], GL_QUERY_RESULT, &begin);
+            glGetQueryObjectui64v(slot.queries[size_t(scope.endQuery)], GL_QUERY_RESULT, &end);
+            scope.gpuBegin = qint64(begin) + gpuToCpuOffset;
+            scope.gpuEnd = qint64(end) + gpuToCpuOffset;
+        }
+        frame.gpuValid = true;
+    } else {
+        ++dropped;  // GPU 落后超过 FramesInFlight 帧：这帧只留 CPU 数据，不为了读结果而等待
+    }
+
+    frames.push_back(std::move(frame));
+    while (int(frames.size()) > historyLimit)
+        frames.pop_front();
+}
+
+QStringList FrameProfiler::overlayLines(int averageFrames) const
+{
+    QStringList lines;
+    if (frames.empty())
+        return lines;
+
+    const int count = qMin(averageFrames, int(frames.size()));
+    double cpu = 0, gpu = 0;
+    int gpuFrames = 0;
+    // 按名字汇总各作用域，QMap 保证叠加层里的顺序稳定
+    QMap<QString, QPair<double, double>> scopes;
+    for (auto it = frames.end() - count; it != frames.end(); ++it) {
+        cpu += it->cpuMs();
+        if (it->gpuValid) {
+            gpu += it->gpuMs();
+            ++gpuFrames;
+        }
+        for (size_t i = 1; i < it->scopes.size(); ++i) {
+            const Scope &s = it->scopes[i];
+            QPair<double, double> &sum = scopes[QString(s.depth > 1 ? "  " : "") + s.name];
+            sum.first += (s.cpuEnd - s.cpuBegin) / 1e6;
+            if (it->gpuValid)
+                sum.second += (s.gpuEnd - s.gpuBegin) / 1e6;
+        }
+    }
+    cpu /= count;
+    gpu = gpuFrames ? gpu / gpuFrames : -1.0;
+
+    const char *bound = gpu < 0 ? "?" : (gpu > cpu ? "GPU-bound" : "CPU-bound");
+    lines << QString("CPU %1 ms  GPU %2 ms  %3")
+                 .arg(cpu, 0, 'f', 2)
+                 .arg(gpu < 0 ? QString("-") : QString::number(gpu, 'f', 2))
+                 .arg(bound);
+    for (auto it = scopes.constBegin(); it != scopes.constEnd(); ++it) {
+        lines << QString("%1  cpu %2  gpu %3")
+                     .arg(it.key(), -16)
+                     .arg(it.value().first / count, 0, 'f', 3)
+                     .arg(gpuFrames ? QString::number(it.value().second / gpuFrames, 'f', 3) : QString("-"));
+    }
+    for (const auto &counter : frames.back().counters)
+        lines << QString("%1  %2").arg(QString(counter.first), -16).arg(counter.second);
+    return lines;
+}
+
+std::vector<FrameProfiler::FrameTime> FrameProfiler::recentFrameTimes(int count) const
+{
+    std::vector<FrameTime> times;
+    const int n = qMin(count, int(frames.size()));
+    times.reserve(size_t(n));
+    for (auto it = frames.end() - n; it != frames.end(); ++it)
+        times.push_back({it->cpuMs(), it->gpuValid ? it->gpuMs() : -1.0});
+    return times;
+}
+
+bool FrameProfiler::writeChromeTrace(const QString &path) const
+{
+    /* Chrome trace-event 格式：
+     *   "X"（完整事件）：ts/dur 单位是微秒
+     *   "C"（计数器）：args 里的每个值画成一条曲线
+     *   "M"（元数据）：给线程起名字，CPU 和 GPU 分两行显示
+     */
+    const int pid = 1, cpuTid = 1, gpuTid = 2;
+    QJsonArray events;
+    auto threadName = [&](int tid, const char *name) {
+        events.append(QJsonObject{{"ph", "M"}, {"name", "thread_name"}, {"pid", pid}, {"tid", tid},
+                                  {"args", QJsonObject{{"name", name}}}});
+    };
+    threadName(cpuTid, "CPU");
+    threadName(gpuTid, "GPU");
+
+    auto complete = [&](const Scope &s, int tid, qint64 begin, qint64 end, quint64 frame) {
+        events.append(QJsonObject{{"ph", "X"}, {"name", s.name}, {"pid", pid}, {"tid", tid},
+                                  {"ts", begin / 1e3}, {"dur", (end - begin) / 1e3},
+                                  {"args", QJsonObject{{"frame", double(frame)}}}});
+    };
+
+    for (const Frame &frame : frames) {
+        for (const Scope &s : frame.scopes) {
+            complete(s, cpuTid, s.cpuBegin, s.cpuEnd, frame.index);
+            if (frame.gpuValid)
+                complete(s, gpuTid, s.gpuBegin, s.gpuEnd, frame.index);
+        }
+        if (!frame.scopes.empty()) {
+            for (const auto &counter : frame.counters) {
+                events.append(QJsonObject{{"ph", "C"}, {"name", counter.first}, {"pid", pid},
+                                          {"ts", frame.scopes[0].cpuBegin / 1e3},
+                                          {"args", QJsonObject{{"value", double(counter.second)}}}});
+            }
+        }
+    }
+
+    QJsonObject root;
+    root["traceEvents"] = events;
+    root["displayTimeUnit"] = "ms";
+
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly)) {
+        qWarning() << "FrameProfiler: cannot write" << path;
+        return false;
+    }
+    file.write(QJsonDocument(root).toJson(QJsonDocument::Compact));
+    return file.commit();
+}
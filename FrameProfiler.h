@@ -0,0 +1,121 @@
+#ifndef FRAMEPROFILER_H
+#define FRAMEPROFILER_H
+
+#include <QElapsedTimer>
+#include <QString>
+#include <QStringList>
+#include <deque>
+#include <vector>
+#include <utility>
+#include "GLTraceFunctions.h"
+
+/* FrameProfiler：每帧的 CPU/GPU 计时
+ *
+ * 一帧由 beginFrame()/endFrame() 包住，中间可以嵌套任意多个命名的作用域（ProfileScope）。
+ *   - CPU 时间：QElapsedTimer，纳秒
+ *   - GPU 时间：作用域的开始和结束各插一个 GL_TIMESTAMP 查询（glQueryCounter，可以嵌套，
+ *     GL_TIME_ELAPSED 不行）。结果要等 GPU 执行到那里才有，所以查询按帧分成 FramesInFlight 组，
+ *     FramesInFlight 帧之后再读；到时还没出结果的帧只丢掉 GPU 数据，绝不等待。
+ *
+ * 读回来的帧放进 history()（默认最近 600 帧），窗口用它画叠加层，writeChromeTrace() 把它写成
+ * Chrome trace-event JSON（chrome://tracing 或 https://ui.perfetto.dev 打开）。
+ * 另外每帧可以记录任意个计数器（绘制调用数、省掉的状态切换数……），一起进 history 和 trace。
+ */
+class FrameProfiler : protected GLTraceFunctions
+{
+public:
+    struct Scope
+    {
+        const char *name;      // 必须是字符串字面量（只存指针）
+        int depth;             // 0 = 整帧
+        qint64 cpuBegin;       // 纳秒，相对 profiler 初始化时刻
+        qint64 cpuEnd;
+        qint64 gpuBegin;       // 换算到 CPU 时间轴上的纳秒，-1 = 没有 GPU 数据
+        qint64 gpuEnd;
+        int beginQuery;        // 在这一帧查询池里的下标
+        int endQuery;
+    };
+
+    struct Frame
+    {
+        quint64 index = 0;
+        std::vector<Scope> scopes;                            // scopes[0] 是整帧
+        std::vector<std::pair<const char *, qint64>> counters;
+        bool gpuValid = false;
+
+        double cpuMs() const;
+        double gpuMs() const;   // 没有 GPU 数据时返回 -1
+    };
+
+    // 叠加层曲线用的帧时间，gpuMs < 0 表示没有 GPU 数据
+    struct FrameTime
+    {
+        double cpuMs;
+        double gpuMs;
+    };
+
+    static const int FramesInFlight = 4;
+
+    FrameProfiler();
+    ~FrameProfiler();
+
+    void initialize();   // 上下文必须是当前上下文
+    void cleanup();
+    void setEnabled(bool enabled) { active = enabled; }
+    bool isEnabled() const { return active; }
+    void setHistorySize(int frames) { historyLimit = qMax(1, frames); }
+
+    void beginFrame();
+    void endFrame();
+    int beginScope(const char *name);   // 返回作用域编号，交给 endScope()；未启用时返回 -1
+    void endScope(int scope);
+    void setCounter(const char *name, qint64 value);  // 记录到当前帧
+
+    const std::deque<Frame> &history() const { return frames; }
+    QStringList overlayLines(int averageFrames = 60) const;   // 叠加层的文字：平均帧时间、各作用域、计数器
+    std::vector<FrameTime> recentFrameTimes(int count) const; // 最近 count 帧，从旧到新
+    bool writeChromeTrace(const QString &path) const;
+    int droppedGpuFrames() const { return dropped; }
+
+private:
+    struct Slot
+    {
+        Frame frame;
+        std::vector<GLuint> queries;
+        int usedQueries = 0;
+        bool pending = false;
+    };
+
+    qint64 now() const { return clock.nsecsElapsed(); }
+    int issueTimestamp();
+    void resolve(Slot &slot);
+    void calibrate();
+
+    bool initialized;
+    bool active;
+    bool inFrame;
+    QElapsedTimer clock;
+    qint64 gpuToCpuOffset;   // cpu 纳秒 - gpu 纳秒
+    quint64 frameCounter;
+    Slot inFlight[FramesInFlight];
+    Slot *current;
+    std::vector<int> openScopes;
+    std::deque<Frame> frames;
+    int historyLimit;
+    int dropped;
+};
+
+// RAII：作用域开始时 beginScope，离开时 endScope
+class ProfileScope
+{
+public:
+    ProfileScope(FrameProfiler &profiler, const char *name)
+        : profiler(profiler), scope(profiler.beginScope(name)) {}
+    ~ProfileScope() { profiler.endScope(scope); }
+
+private:
+    FrameProfiler &profiler;
+    int scope;
+};
+
+#endif // FRAMEPROFILER_H
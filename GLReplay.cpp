@@ -0,0 +1,1188 @@
+#include "GLReplay.h"
+#include <QDebug>
+#include <QElapsedTimer>
+#include <QFile>
+#include <algorithm>
+#include <cstring>
+
+namespace {
+
+const int HeaderSize = int(sizeof(GLTrace::Magic) + sizeof(quint32));
+
+// 快照里的纹理用 glTextureStorage2D 重建，不带大小的格式换成对应的 8 位格式
+GLenum sizedFormat(GLenum internalFormat)
+{
+    switch (internalFormat) {
+    case GL_RGBA: return GL_RGBA8;
+    case GL_RGB: return GL_RGB8;
+    case GL_RG: return GL_RG8;
+    case GL_RED: return GL_R8;
+    default: return internalFormat;
+    }
+}
+
+} // namespace
+
+// 按录制时的顺序读出参数；读过头时 failed，之后读到的都是 0
+struct GLReplay::Reader
+{
+    const char *pos;
+    const char *end;
+    bool failed = false;
+
+    template <typename T>
+    T get()
+    {
+        T value = T();
+        if (end - pos < qint64(sizeof(T))) {
+            failed = true;
+            pos = end;
+            return value;
+        }
+        std::memcpy(&value, pos, sizeof(T));
+        pos += sizeof(T);
+        return value;
+    }
+    quint8 u8() { return get<quint8>(); }
+    qint32 i32() { return get<qint32>(); }
+    quint32 u32() { return get<quint32>(); }
+    float f32() { return get<float>(); }
+    qint64 i64() { return get<qint64>(); }
+    quint64 u64() { return get<quint64>(); }
+
+    GLTrace::Blob blob()
+    {
+        const quint32 size = u32();
+        if (quint64(end - pos) < size) {
+            failed = true;
+            pos = end;
+            return GLTrace::Blob{nullptr, 0};
+        }
+        const GLTrace::Blob b{pos, qint64(size)};
+        pos += size;
+        return b;
+    }
+
+    std::vector<GLuint> names()
+    {
+        const qint32 count = i32();
+        std::vector<GLuint> result;
+        if (count < 0 || end - pos < qint64(count) * 4) {
+            failed = true;
+            pos = end;
+            return result;
+        }
+        result.resize(size_t(count));
+        for (GLuint &name : result)
+            name = u32();
+        return result;
+    }
+};
+
+GLReplay::GLReplay()
+    : target(0), targetColor(0), targetDepth(0), targetWidth(0), targetHeight(0), unpackState{4, 0, 0, 0}
+{
+}
+
+bool GLReplay::load(const QString &path)
+{
+    data.clear();
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        error = QString("cannot open %1: %2").arg(path, file.errorString());
+        return false;
+    }
+    data = file.readAll();
+    if (data.size() < HeaderSize || std::memcmp(data.constData(), GLTrace::Magic, sizeof(GLTrace::Magic)) != 0) {
+        error = QString("%1 is not a GL trace").arg(path);
+        data.clear();
+        return false;
+    }
+    quint32 version = 0;
+    std::memcpy(&version, data.constData() + sizeof(GLTrace::Magic), sizeof(version));
+    if (version != GLTrace::Version) {
+        error = QString("%1 has trace version %2, expected %3").arg(path).arg(version).arg(GLTrace::Version);
+        data.clear();
+        return false;
+    }
+    return true;
+}
+
+bool GLReplay::run(bool finishFrames, bool timeCalls, Stats *stats)
+{
+    *stats = Stats();
+    if (data.size() < HeaderSize) {
+        error = "no trace loaded";
+        return false;
+    }
+    initializeOpenGLFunctions();
+    glCreateFramebuffers(1, &target);
+    resizeTarget(1, 1);
+    resetState();
+    glFinish();
+
+    Reader in{data.constData() + HeaderSize, data.constData() + data.size()};
+    QElapsedTimer total, frame, call;
+    bool inFrame = false, seenFrame = false, ok = true;
+    total.start();
+    while (in.pos < in.end) {
+        const qint64 offset = in.pos - data.constData();
+        const quint8 code = in.u8();
+        if (code >= GLTrace::OpCount) {
+            error = QString("corrupt trace: unknown record %1 at offset %2").arg(code).arg(offset);
+            ok = false;
+            break;
+        }
+        const GLTrace::Op op = GLTrace::Op(code);
+        ++stats->calls[op];
+        if (op == GLTrace::BeginFrame) {
+            const qint32 width = in.i32();
+            const qint32 height = in.i32();
+            if (!seenFrame)
+                stats->initMs = total.nsecsElapsed() / 1.0e6;
+            seenFrame = true;
+            resizeTarget(width, height);
+            inFrame = true;
+            frame.start();
+        } else if (op == GLTrace::EndFrame) {
+            if (finishFrames)
+                glFinish();
+            if (inFrame)
+                stats->frameMs.push_back(frame.nsecsElapsed() / 1.0e6);
+            inFrame = false;
+            ++stats->frames;
+            for (int i = 0; i < 32 && glGetError() != GL_NO_ERROR; ++i)
+                ++stats->glErrors;
+        } else {
+            if (timeCalls)
+                call.start();
+            execute(op, in, stats);
+            if (timeCalls)
+                stats->nsecs[op] += call.nsecsElapsed();
+        }
+        if (in.failed) {
+            error = QString("corrupt trace: record %1 at offset %2 is truncated").arg(GLTrace::opName(op)).arg(offset);
+            ok = false;
+            break;
+        }
+    }
+    glFinish();
+    stats->totalMs = total.nsecsElapsed() / 1.0e6;
+    if (!seenFrame)
+        stats->initMs = stats->totalMs;
+    destroyObjects();
+    return ok;
+}
+
+bool GLReplay::execute(GLTrace::Op op, Reader &in, Stats *stats)
+{
+    // 参数先读进局部变量：函数实参的求值顺序是不确定的
+    switch (op) {
+    case GLTrace::SnapshotBuffer:
+        snapshotBuffer(in, stats);
+        break;
+    case GLTrace::SnapshotTexture:
+        snapshotTexture(in, stats);
+        break;
+    case GLTrace::SnapshotVertexArray:
+        snapshotVertexArray(in, stats);
+        break;
+    case GLTrace::SnapshotProgram:
+        snapshotProgram(in, stats);
+        break;
+    case GLTrace::Release: {
+        const quint8 kind = in.u8();
+        const GLuint name = in.u32();
+        release(GLTrace::Kind(kind), name);
+        break;
+    }
+    case GLTrace::Uniform: {
+        const GLuint name = in.u32();
+        const quint32 index = in.u32();
+        const quint32 element = in.u32();
+        const GLTrace::Blob value = in.blob();
+        auto it = programs.find(name);
+        if (it == programs.end() || index >= it->second.uniforms.size()
+            || element >= it->second.uniforms[index].locations.size()) {
+            ++stats->unresolved;
+            break;
+        }
+        const UniformInfo &uniform = it->second.uniforms[index];
+        int baseType = 0;
+        if (value.size >= GLTrace::uniformComponents(uniform.type, &baseType) * 4)
+            setUniform(it->second.program, uniform.type, uniform.locations[element], value.data);
+        break;
+    }
+    case GLTrace::MappedWrite: {
+        const GLuint name = buffer(in.u32(), stats);
+        const qint64 offset = in.i64();
+        const GLTrace::Blob bytes = in.blob();
+        if (name)
+            mappedWrite(name, offset, static_cast<const char *>(bytes.data), bytes.size);
+        stats->uploadedBytes += bytes.size;
+        break;
+    }
+    case GLTrace::ActiveTexture:
+        glActiveTexture(in.u32());
+        break;
+    case GLTrace::BindBuffer: {
+        const GLenum bufferTarget = in.u32();
+        const GLuint name = buffer(in.u32(), stats);
+        glBindBuffer(bufferTarget, name);
+        break;
+    }
+    case GLTrace::BindBufferRange: {
+        const GLenum bufferTarget = in.u32();
+        const GLuint index = in.u32();
+        const GLuint name = buffer(in.u32(), stats);
+        const qint64 offset = in.i64();
+        const qint64 size = in.i64();
+        glBindBufferRange(bufferTarget, index, name, GLintptr(offset), GLsizeiptr(size));
+        break;
+    }
+    case GLTrace::BindFramebuffer: {
+        const GLenum framebufferTarget = in.u32();
+        const GLuint name = framebuffer(in.u32(), stats);
+        glBindFramebuffer(framebufferTarget, name);
+        break;
+    }
+    case GLTrace::BindTexture: {
+        const GLenum textureTarget = in.u32();
+        const GLuint name = texture(in.u32(), stats);
+        glBindTexture(textureTarget, name);
+        break;
+    }
+    case GLTrace::BindTextureUnit: {
+        const GLuint unit = in.u32();
+        const GLuint name = texture(in.u32(), stats);
+        glBindTextureUnit(unit, name);
+        break;
+    }
+    case GLTrace::BindVertexArray:
+        glBindVertexArray(vertexArray(in.u32(), stats));
+        break;
+    case GLTrace::BlendFunc: {
+        const GLenum source = in.u32();
+        const GLenum destination = in.u32();
+        glBlendFunc(source, destination);
+        break;
+    }
+    case GLTrace::BlendFuncSeparate: {
+        const GLenum sourceRgb = in.u32();
+        const GLenum destinationRgb = in.u32();
+        const GLenum sourceAlpha = in.u32();
+        const GLenum destinationAlpha = in.u32();
+        glBlendFuncSeparate(sourceRgb, destinationRgb, sourceAlpha, destinationAlpha);
+        break;
+    }
+    case GLTrace::BufferStorage: {
+        const GLenum bufferTarget = in.u32();
+        const qint64 size = in.i64();
+        const GLTrace::Blob content = in.blob();
+        const GLbitfield flags = in.u32();
+        // 和快照一样：数据正好是整个缓冲才传，否则驱动会读过 trace 的末尾
+        if (content.size && content.size != size)
+            ++stats->unresolved;
+        glBufferStorage(bufferTarget, GLsizeiptr(size), content.size == size ? content.data : nullptr, flags);
+        stats->uploadedBytes += content.size;
+        break;
+    }
+    case GLTrace::CheckNamedFramebufferStatus: {
+        const GLuint name = framebuffer(in.u32(), stats);
+        const GLenum framebufferTarget = in.u32();
+        glCheckNamedFramebufferStatus(name, framebufferTarget);
+        break;
+    }
+    case GLTrace::Clear:
+        glClear(in.u32());
+        break;
+    case GLTrace::ClearColor: {
+        const float r = in.f32(), g = in.f32(), b = in.f32(), a = in.f32();
+        glClearColor(r, g, b, a);
+        break;
+    }
+    case GLTrace::ClearNamedFramebufferfv: {
+        const GLuint name = framebuffer(in.u32(), stats);
+        const GLenum attachment = in.u32();
+        const GLint drawBuffer = in.i32();
+        const GLTrace::Blob value = in.blob();
+        GLfloat clear[4] = {};
+        std::memcpy(clear, value.data, size_t(std::min<qint64>(value.size, sizeof(clear))));
+        glClearNamedFramebufferfv(name, attachment, drawBuffer, clear);
+        break;
+    }
+    case GLTrace::ClientWaitSync: {
+        const quint64 id = in.u64();
+        const GLbitfield flags = in.u32();
+        const quint64 timeout = in.u64();
+        auto it = syncs.find(id);
+        if (it != syncs.end())
+            glClientWaitSync(it->second, flags, timeout);
+        else
+            ++stats->unresolved;
+        break;
+    }
+    case GLTrace::ColorMask: {
+        const GLboolean r = in.u8(), g = in.u8(), b = in.u8(), a = in.u8();
+        glColorMask(r, g, b, a);
+        break;
+    }
+    case GLTrace::CopyImageSubData: {
+        GLint source[6], destination[6], size[3];
+        const GLuint sourceName = texture(in.u32(), stats);
+        const GLenum sourceTarget = in.u32();
+        for (GLint &v : source)
+            v = in.i32();
+        const GLuint destinationName = texture(in.u32(), stats);
+        const GLenum destinationTarget = in.u32();
+        for (GLint &v : destination)
+            v = in.i32();
+        for (GLint &v : size)
+            v = in.i32();
+        glCopyImageSubData(sourceName, sourceTarget, source[0], source[1], source[2], source[3], destinationName,
+                           destinationTarget, destination[0], destination[1], destination[2], destination[3],
+                           size[0], size[1], size[2]);
+        break;
+    }
+    case GLTrace::CopyNamedBufferSubData: {
+        const GLuint readBuffer = buffer(in.u32(), stats);
+        const GLuint writeBuffer = buffer(in.u32(), stats);
+        const qint64 readOffset = in.i64();
+        const qint64 writeOffset = in.i64();
+        const qint64 size = in.i64();
+        glCopyNamedBufferSubData(readBuffer, writeBuffer, GLintptr(readOffset), GLintptr(writeOffset),
+                                 GLsizeiptr(size));
+        break;
+    }
+    case GLTrace::CreateFramebuffers:
+    case GLTrace::CreateRenderbuffers:
+    case GLTrace::CreateTextures:
+    case GLTrace::GenQueries:
+    case GLTrace::GenTextures: {
+        const GLenum textureTarget = op == GLTrace::CreateTextures ? in.u32() : 0;
+        const std::vector<GLuint> traced = in.names();
+        std::vector<GLuint> created(traced.size());
+        const GLsizei count = GLsizei(created.size());
+        std::unordered_map<GLuint, GLuint> *names = &textures;
+        if (op == GLTrace::CreateFramebuffers) {
+            glCreateFramebuffers(count, created.data());
+            names = &framebuffers;
+        } else if (op == GLTrace::CreateRenderbuffers) {
+            glCreateRenderbuffers(count, created.data());
+            names = &renderbuffers;
+        } else if (op == GLTrace::CreateTextures) {
+            glCreateTextures(textureTarget, count, created.data());
+        } else if (op == GLTrace::GenQueries) {
+            glGenQueries(count, created.data());
+            names = &queries;
+        } else {
+            glGenTextures(count, created.data());
+        }
+        for (size_t i = 0; i < traced.size(); ++i)
+            (*names)[traced[i]] = created[i];
+        break;
+    }
+    case GLTrace::DeleteFramebuffers:
+    case GLTrace::DeleteQueries:
+    case GLTrace::DeleteRenderbuffers:
+    case GLTrace::DeleteTextures: {
+        std::unordered_map<GLuint, GLuint> &names = op == GLTrace::DeleteFramebuffers    ? framebuffers
+                                                    : op == GLTrace::DeleteQueries       ? queries
+                                                    : op == GLTrace::DeleteRenderbuffers ? renderbuffers
+                                                                                         : textures;
+        // trace 里没有的（录制期间没用到的外来对象）不用删
+        std::vector<GLuint> victims;
+        for (GLuint name : in.names()) {
+            auto it = names.find(name);
+            if (it == names.end())
+                continue;
+            victims.push_back(it->second);
+            names.erase(it);
+        }
+        if (victims.empty())
+            break;
+        const GLsizei count = GLsizei(victims.size());
+        if (op == GLTrace::DeleteFramebuffers)
+            glDeleteFramebuffers(count, victims.data());
+        else if (op == GLTrace::DeleteQueries)
+            glDeleteQueries(count, victims.data());
+        else if (op == GLTrace::DeleteRenderbuffers)
+            glDeleteRenderbuffers(count, victims.data());
+        else
+            glDeleteTextures(count, victims.data());
+        break;
+    }
+    case GLTrace::DeleteSync: {
+        auto it = syncs.find(in.u64());
+        if (it != syncs.end()) {
+            glDeleteSync(it->second);
+            syncs.erase(it);
+        }
+        break;
+    }
+    case GLTrace::DepthFunc:
+        glDepthFunc(in.u32());
+        break;
+    case GLTrace::DepthMask:
+        glDepthMask(in.u8());
+        break;
+    case GLTrace::Disable:
+        glDisable(in.u32());
+        break;
+    case GLTrace::DrawArraysInstancedBaseInstance: {
+        const GLenum mode = in.u32();
+        const GLint first = in.i32();
+        const GLsizei count = in.i32();
+        const GLsizei instances = in.i32();
+        const GLuint baseInstance = in.u32();
+        glDrawArraysInstancedBaseInstance(mode, first, count, instances, baseInstance);
+        break;
+    }
+    case GLTrace::DrawElementsBaseVertex: {
+        const GLenum mode = in.u32();
+        const GLsizei count = in.i32();
+        const GLenum type = in.u32();
+        const qint64 offset = in.i64();
+        const GLint baseVertex = in.i32();
+        glDrawElementsBaseVertex(mode, count, type, reinterpret_cast<const void *>(quintptr(offset)), baseVertex);
+        break;
+    }
+    case GLTrace::DrawElementsInstancedBaseInstance: {
+        const GLenum mode = in.u32();
+        const GLsizei count = in.i32();
+        const GLenum type = in.u32();
+        const qint64 offset = in.i64();
+        const GLsizei instances = in.i32();
+        const GLuint baseInstance = in.u32();
+        glDrawElementsInstancedBaseInstance(mode, count, type, reinterpret_cast<const void *>(quintptr(offset)),
+                                            instances, baseInstance);
+        break;
+    }
+    case GLTrace::Enable:
+        glEnable(in.u32());
+        break;
+    case GLTrace::EnableVertexAttribArray:
+        glEnableVertexAttribArray(in.u32());
+        break;
+    case GLTrace::FenceSync: {
+        const quint64 id = in.u64();
+        const GLenum condition = in.u32();
+        const GLbitfield flags = in.u32();
+        GLsync &sync = syncs[id];
+        if (sync)
+            glDeleteSync(sync);
+        sync = glFenceSync(condition, flags);
+        break;
+    }
+    case GLTrace::Finish:
+        glFinish();
+        break;
+    case GLTrace::GenerateTextureMipmap:
+        glGenerateTextureMipmap(texture(in.u32(), stats));
+        break;
+    case GLTrace::GetInteger64v: {
+        GLint64 values[64];
+        glGetInteger64v(in.u32(), values);
+        break;
+    }
+    case GLTrace::GetIntegerv: {
+        GLint values[64];
+        glGetIntegerv(in.u32(), values);
+        break;
+    }
+    case GLTrace::GetQueryObjectiv:
+    case GLTrace::GetQueryObjectui64v: {
+        const GLuint name = query(in.u32(), stats);
+        const GLenum pname = in.u32();
+        GLuint64 value = 0;
+        if (!name)
+            break;
+        if (op == GLTrace::GetQueryObjectiv)
+            glGetQueryObjectiv(name, pname, reinterpret_cast<GLint *>(&value));
+        else
+            glGetQueryObjectui64v(name, pname, &value);
+        break;
+    }
+    case GLTrace::GetTextureLevelParameteriv: {
+        const GLuint name = texture(in.u32(), stats);
+        const GLint level = in.i32();
+        const GLenum pname = in.u32();
+        GLint value = 0;
+        if (name)
+            glGetTextureLevelParameteriv(name, level, pname, &value);
+        break;
+    }
+    case GLTrace::MapBufferRange: {
+        const GLenum bufferTarget = in.u32();
+        const qint64 offset = in.i64();
+        const qint64 length = in.i64();
+        const GLbitfield access = in.u32();
+        void *pointer = glMapBufferRange(bufferTarget, GLintptr(offset), GLsizeiptr(length), access);
+        if (!pointer || !(access & GL_MAP_WRITE_BIT))
+            break;
+        // 录制时映射的内容从 0 算起，后面的 MappedWrite 都是相对 0 的变化
+        std::memset(pointer, 0, size_t(length));
+        GLint bound = 0;
+        glGetIntegerv(GLTrace::bindingQuery(bufferTarget), &bound);
+        Mapping mapping;
+        mapping.buffer = GLuint(bound);
+        mapping.offset = offset;
+        mapping.length = length;
+        mapping.pointer = static_cast<char *>(pointer);
+        mappings.push_back(mapping);
+        break;
+    }
+    case GLTrace::MultiDrawElementsIndirect: {
+        const GLenum mode = in.u32();
+        const GLenum type = in.u32();
+        const qint64 offset = in.i64();
+        const GLsizei drawCount = in.i32();
+        const GLsizei stride = in.i32();
+        glMultiDrawElementsIndirect(mode, type, reinterpret_cast<const void *>(quintptr(offset)), drawCount, stride);
+        break;
+    }
+    case GLTrace::NamedBufferSubData: {
+        const GLuint name = buffer(in.u32(), stats);
+        const qint64 offset = in.i64();
+        const GLTrace::Blob content = in.blob();
+        if (name)
+            glNamedBufferSubData(name, GLintptr(offset), GLsizeiptr(content.size), content.data);
+        stats->uploadedBytes += content.size;
+        break;
+    }
+    case GLTrace::NamedFramebufferRenderbuffer:
+    case GLTrace::NamedFramebufferTexture: {
+        const GLuint traced = in.u32();
+        const GLuint name = traced ? framebuffer(traced, stats) : 0;
+        const GLenum attachment = in.u32();
+        if (op == GLTrace::NamedFramebufferRenderbuffer) {
+            const GLenum renderbufferTarget = in.u32();
+            const GLuint attached = renderbuffer(in.u32(), stats);
+            if (name)
+                glNamedFramebufferRenderbuffer(name, attachment, renderbufferTarget, attached);
+        } else {
+            const GLuint attached = texture(in.u32(), stats);
+            const GLint level = in.i32();
+            if (name)
+                glNamedFramebufferTexture(name, attachment, attached, level);
+        }
+        if (!name)
+            ++stats->unresolved;   // 不动目标帧缓冲的附件
+        break;
+    }
+    case GLTrace::NamedRenderbufferStorage: {
+        const GLuint name = renderbuffer(in.u32(), stats);
+        const GLenum internalFormat = in.u32();
+        const GLsizei width = in.i32();
+        const GLsizei height = in.i32();
+        if (name)
+            glNamedRenderbufferStorage(name, internalFormat, width, height);
+        break;
+    }
+    case GLTrace::PixelStorei: {
+        const GLenum pname = in.u32();
+        const GLint param = in.i32();
+        const GLenum unpackNames[4] = {GL_UNPACK_ALIGNMENT, GL_UNPACK_ROW_LENGTH, GL_UNPACK_SKIP_ROWS,
+                                       GL_UNPACK_SKIP_PIXELS};
+        // 和 GL 一样不接受非法的值（GL_INVALID_VALUE，状态不变）
+        const bool valid = pname == GL_UNPACK_ALIGNMENT ? param == 1 || param == 2 || param == 4 || param == 8
+                                                        : param >= 0;
+        for (int i = 0; i < 4; ++i) {
+            if (pname == unpackNames[i] && valid)
+                unpackState[i] = param;
+        }
+        glPixelStorei(pname, param);
+        break;
+    }
+    case GLTrace::QueryCounter: {
+        const GLuint name = query(in.u32(), stats);
+        const GLenum queryTarget = in.u32();
+        if (name)
+            glQueryCounter(name, queryTarget);
+        break;
+    }
+    case GLTrace::Scissor:
+    case GLTrace::Viewport: {
+        const GLint x = in.i32(), y = in.i32(), width = in.i32(), height = in.i32();
+        if (op == GLTrace::Scissor)
+            glScissor(x, y, width, height);
+        else
+            glViewport(x, y, width, height);
+        break;
+    }
+    case GLTrace::TexImage2D: {
+        const GLenum textureTarget = in.u32();
+        const GLint level = in.i32();
+        const GLint internalFormat = in.i32();
+        const GLsizei width = in.i32();
+        const GLsizei height = in.i32();
+        const GLint border = in.i32();
+        const GLenum format = in.u32();
+        const GLenum type = in.u32();
+        const void *data = nullptr;
+        pixels(in, width, height, format, type, &data, stats);   // 数据不够时只分配，不上传
+        glTexImage2D(textureTarget, level, internalFormat, width, height, border, format, type, data);
+        break;
+    }
+    case GLTrace::TexParameteri: {
+        const GLenum textureTarget = in.u32();
+        const GLenum pname = in.u32();
+        const GLint param = in.i32();
+        glTexParameteri(textureTarget, pname, param);
+        break;
+    }
+    case GLTrace::TextureParameteri: {
+        const GLuint name = texture(in.u32(), stats);
+        const GLenum pname = in.u32();
+        const GLint param = in.i32();
+        if (name)
+            glTextureParameteri(name, pname, param);
+        break;
+    }
+    case GLTrace::TextureStorage2D: {
+        const GLuint name = texture(in.u32(), stats);
+        const GLsizei levels = in.i32();
+        const GLenum internalFormat = in.u32();
+        const GLsizei width = in.i32();
+        const GLsizei height = in.i32();
+        if (name)
+            glTextureStorage2D(name, levels, internalFormat, width, height);
+        break;
+    }
+    case GLTrace::TextureSubImage2D: {
+        const GLuint name = texture(in.u32(), stats);
+        const GLint level = in.i32();
+        const GLint x = in.i32();
+        const GLint y = in.i32();
+        const GLsizei width = in.i32();
+        const GLsizei height = in.i32();
+        const GLenum format = in.u32();
+        const GLenum type = in.u32();
+        const void *data = nullptr;
+        if (pixels(in, width, height, format, type, &data, stats) && name)
+            glTextureSubImage2D(name, level, x, y, width, height, format, type, data);
+        break;
+    }
+    case GLTrace::UnmapBuffer: {
+        const GLenum bufferTarget = in.u32();
+        unmapped(bufferTarget);
+        glUnmapBuffer(bufferTarget);
+        break;
+    }
+    case GLTrace::UseProgram:
+        glUseProgram(program(in.u32(), stats));
+        break;
+    case GLTrace::VertexAttribDivisor: {
+        const GLuint index = in.u32();
+        const GLuint divisor = in.u32();
+        glVertexAttribDivisor(index, divisor);
+        break;
+    }
+    case GLTrace::VertexAttribPointer: {
+        const GLuint index = in.u32();
+        const GLint size = in.i32();
+        const GLenum type = in.u32();
+        const GLboolean normalized = in.u8();
+        const GLsizei stride = in.i32();
+        const qint64 offset = in.i64();
+        glVertexAttribPointer(index, size, type, normalized, stride, reinterpret_cast<const void *>(quintptr(offset)));
+        break;
+    }
+    default:
+        return false;
+    }
+    return true;
+}
+
+// ---- 快照 ----
+
+void GLReplay::snapshotBuffer(Reader &in, Stats *stats)
+{
+    const GLuint name = in.u32();
+    const qint64 size = in.i64();
+    const GLenum usage = in.u32();
+    const bool immutable = in.u8() != 0;
+    const GLbitfield flags = in.u32();
+    const GLTrace::Blob content = in.blob();
+
+    release(GLTrace::BufferKind, name);
+    GLuint created = 0;
+    glCreateBuffers(1, &created);
+    const void *initial = content.size == size ? content.data : nullptr;
+    if (size > 0) {
+        if (immutable)
+            glNamedBufferStorage(created, GLsizeiptr(size), initial, flags);
+        else
+            glNamedBufferData(created, GLsizeiptr(size), initial, usage);
+    }
+    buffers[name] = created;
+    stats->snapshotBytes += content.size;
+}
+
+void GLReplay::snapshotTexture(Reader &in, Stats *stats)
+{
+    const GLuint name = in.u32();
+    const GLenum internalFormat = in.u32();
+    const GLsizei width = in.i32();
+    const GLsizei height = in.i32();
+    const GLsizei levels = std::max(0, in.i32());
+    const bool compressed = in.u8() != 0;
+    const GLenum format = in.u32();
+    const GLenum type = in.u32();
+    const GLenum parameterNames[6] = {GL_TEXTURE_MIN_FILTER, GL_TEXTURE_MAG_FILTER, GL_TEXTURE_WRAP_S,
+                                      GL_TEXTURE_WRAP_T, GL_TEXTURE_BASE_LEVEL, GL_TEXTURE_MAX_LEVEL};
+    GLint parameters[6];
+    for (GLint &parameter : parameters)
+        parameter = in.i32();
+    std::vector<GLTrace::Blob> images;
+    for (GLsizei level = 0; level < levels && !in.failed; ++level)
+        images.push_back(in.blob());
+
+    release(GLTrace::TextureKind, name);
+    GLuint created = 0;
+    glCreateTextures(GL_TEXTURE_2D, 1, &created);
+    textures[name] = created;
+    if (levels > 0 && width > 0 && height > 0 && !in.failed) {
+        glTextureStorage2D(created, levels, sizedFormat(internalFormat), width, height);
+        // 快照里的图像是紧凑排列的，临时换掉 trace 里当前的解包状态
+        const GLenum unpackNames[4] = {GL_UNPACK_ALIGNMENT, GL_UNPACK_ROW_LENGTH, GL_UNPACK_SKIP_ROWS,
+                                       GL_UNPACK_SKIP_PIXELS};
+        GLint unpack[4] = {}, unpackBuffer = 0;
+        for (int i = 0; i < 4; ++i) {
+            glGetIntegerv(unpackNames[i], &unpack[i]);
+            glPixelStorei(unpackNames[i], i == 0 ? 1 : 0);
+        }
+        glGetIntegerv(GL_PIXEL_UNPACK_BUFFER_BINDING, &unpackBuffer);
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        for (GLsizei level = 0; level < levels; ++level) {
+            const GLTrace::Blob &image = images[size_t(level)];
+            if (!image.size)
+                continue;
+            const GLsizei levelWidth = std::max(1, width >> level);
+            const GLsizei levelHeight = std::max(1, height >> level);
+            // 压缩格式的大小交给驱动检查（不对时是 GL 错误）；非压缩的按紧凑排列算出 GL 会读多少
+            const qint64 expected = qint64(levelWidth) * levelHeight * GLTrace::pixelSize(format, type);
+            if (compressed) {
+                glCompressedTextureSubImage2D(created, level, 0, 0, levelWidth, levelHeight, internalFormat,
+                                              GLsizei(image.size), image.data);
+            } else if (expected > 0 && image.size >= expected) {
+                glTextureSubImage2D(created, level, 0, 0, levelWidth, levelHeight, format, type, image.data);
+            } else {
+                ++stats->unresolved;
+            }
+            stats->snapshotBytes += image.size;
+        }
+        for (int i = 0; i < 4; ++i)
+            glPixelStorei(unpackNames[i], unpack[i]);
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, GLuint(unpackBuffer));
+    }
+    for (int i = 0; i < 6; ++i)
+        glTextureParameteri(created, parameterNames[i], parameters[i]);
+}
+
+void GLReplay::snapshotVertexArray(Reader &in, Stats *stats)
+{
+    struct Attribute
+    {
+        GLuint index;
+        bool enabled;
+        GLint size;
+        GLenum type;
+        GLboolean normalized;
+        bool integer;
+        GLsizei stride;
+        qint64 offset;
+        GLuint divisor;
+        GLuint buffer;
+    };
+    const GLuint name = in.u32();
+    const GLuint element = in.u32();
+    const quint32 count = in.u32();
+    std::vector<Attribute> attributes;
+    for (quint32 i = 0; i < count && !in.failed; ++i) {
+        Attribute a;
+        a.index = in.u32();
+        a.enabled = in.u8() != 0;
+        a.size = in.i32();
+        a.type = in.u32();
+        a.normalized = in.u8();
+        a.integer = in.u8() != 0;
+        a.stride = in.i32();
+        a.offset = in.i64();
+        a.divisor = in.u32();
+        a.buffer = in.u32();
+        attributes.push_back(a);
+    }
+
+    release(GLTrace::VertexArrayKind, name);
+    GLuint created = 0;
+    glCreateVertexArrays(1, &created);
+    vertexArrays[name] = created;
+    glVertexArrayElementBuffer(created, buffer(element, stats));
+
+    // 属性用 glVertexAttribPointer 原样设置（偏移、步长 0 的语义都不变），之后恢复 trace 里当前的绑定
+    GLint previousArray = 0, previousBuffer = 0;
+    glGetIntegerv(GL_VERTEX_ARRAY_BINDING, &previousArray);
+    glGetIntegerv(GL_ARRAY_BUFFER_BINDING, &previousBuffer);
+    glBindVertexArray(created);
+    for (const Attribute &a : attributes) {
+        const GLuint source = buffer(a.buffer, stats);
+        if (source) {
+            glBindBuffer(GL_ARRAY_BUFFER, source);
+            const void *pointer = reinterpret_cast<const void *>(quintptr(a.offset));
+            if (a.integer)
+                glVertexAttribIPointer(a.index, a.size, a.type, a.stride, pointer);
+            else
+                glVertexAttribPointer(a.index, a.size, a.type, a.normalized, a.stride, pointer);
+        }
+        glVertexAttribDivisor(a.index, a.divisor);
+        if (a.enabled)
+            glEnableVertexAttribArray(a.index);
+    }
+    glBindBuffer(GL_ARRAY_BUFFER, GLuint(previousBuffer));
+    glBindVertexArray(GLuint(previousArray));
+}
+
+void GLReplay::snapshotProgram(Reader &in, Stats *stats)
+{
+    const GLuint name = in.u32();
+    std::vector<std::pair<GLenum, GLTrace::Blob>> stages;
+    const quint32 stageCount = in.u32();
+    for (quint32 i = 0; i < stageCount && !in.failed; ++i) {
+        const GLenum type = in.u32();
+        stages.emplace_back(type, in.blob());
+    }
+    std::vector<std::pair<QByteArray, GLint>> attributes;
+    const quint32 attributeCount = in.u32();
+    for (quint32 i = 0; i < attributeCount && !in.failed; ++i) {
+        const GLTrace::Blob attribute = in.blob();
+        attributes.emplace_back(QByteArray(static_cast<const char *>(attribute.data), attribute.size), in.i32());
+    }
+    const GLenum binaryFormat = in.u32();
+    const GLTrace::Blob binary = in.blob();
+    std::vector<std::pair<QByteArray, UniformInfo>> uniforms;
+    const quint32 uniformCount = in.u32();
+    for (quint32 i = 0; i < uniformCount && !in.failed; ++i) {
+        const GLTrace::Blob uniform = in.blob();
+        UniformInfo info;
+        info.type = in.u32();
+        info.locations.resize(size_t(std::max(0, in.i32())));
+        uniforms.emplace_back(QByteArray(static_cast<const char *>(uniform.data), uniform.size), info);
+    }
+    if (in.failed)
+        return;
+
+    release(GLTrace::ProgramKind, name);
+    ProgramInfo &info = programs[name];
+    info.program = glCreateProgram();
+    std::vector<GLuint> shaders;
+    for (const auto &stage : stages) {
+        const GLuint shader = glCreateShader(stage.first);
+        const GLchar *source = static_cast<const GLchar *>(stage.second.data);
+        const GLint length = GLint(stage.second.size);
+        glShaderSource(shader, 1, &source, &length);
+        glCompileShader(shader);
+        glAttachShader(info.program, shader);
+        shaders.push_back(shader);
+        stats->snapshotBytes += stage.second.size;
+    }
+    for (const auto &attribute : attributes)
+        glBindAttribLocation(info.program, GLuint(attribute.second), attribute.first.constData());
+    if (stages.empty())
+        glProgramBinary(info.program, binaryFormat, binary.data, GLsizei(binary.size));
+    else
+        glLinkProgram(info.program);
+    stats->snapshotBytes += binary.size;
+
+    GLint linked = 0;
+    glGetProgramiv(info.program, GL_LINK_STATUS, &linked);
+    if (!linked) {
+        GLint length = 0;
+        glGetProgramiv(info.program, GL_INFO_LOG_LENGTH, &length);
+        QByteArray log(std::max(length, 1), '\0');
+        glGetProgramInfoLog(info.program, log.size(), nullptr, log.data());
+        qWarning("GLReplay: program %u failed to link: %s", name, log.constData());
+        ++stats->failedPrograms;
+    }
+    for (GLuint shader : shaders) {
+        glDetachShader(info.program, shader);
+        glDeleteShader(shader);
+    }
+
+    // uniform 的编号和录制时一样按快照里的顺序，数组每个元素单独取位置
+    for (auto &uniform : uniforms) {
+        const bool array = uniform.first.endsWith("[0]");
+        const QByteArray base = array ? uniform.first.left(uniform.first.size() - 3) : uniform.first;
+        std::vector<GLint> &locations = uniform.second.locations;
+        for (size_t element = 0; element < locations.size(); ++element) {
+            const QByteArray elementName = array ? base + '[' + QByteArray::number(qint64(element)) + ']' : base;
+            locations[element] = glGetUniformLocation(info.program, elementName.constData());
+        }
+        info.uniforms.push_back(uniform.second);
+    }
+}
+
+void GLReplay::release(GLTrace::Kind kind, GLuint name)
+{
+    if (kind == GLTrace::BufferKind) {
+        auto it = buffers.find(name);
+        if (it == buffers.end())
+            return;
+        const GLuint released = it->second;
+        mappings.erase(std::remove_if(mappings.begin(), mappings.end(),
+                                      [released](const Mapping &m) { return m.buffer == released; }),
+                       mappings.end());
+        glDeleteBuffers(1, &released);
+        buffers.erase(it);
+    } else if (kind == GLTrace::TextureKind) {
+        auto it = textures.find(name);
+        if (it == textures.end())
+            return;
+        glDeleteTextures(1, &it->second);
+        textures.erase(it);
+    } else if (kind == GLTrace::VertexArrayKind) {
+        auto it = vertexArrays.find(name);
+        if (it == vertexArrays.end())
+            return;
+        glDeleteVertexArrays(1, &it->second);
+        vertexArrays.erase(it);
+    } else if (kind == GLTrace::ProgramKind) {
+        auto it = programs.find(name);
+        if (it == programs.end())
+            return;
+        glDeleteProgram(it->second.program);
+        programs.erase(it);
+    }
+}
+
+void GLReplay::setUniform(GLuint name, GLenum type, GLint location, const void *value)
+{
+    // 文件里的数据不一定对齐，先拷出来
+    union { GLfloat f[16]; GLint i[16]; GLuint u[16]; } v;
+    int baseType = 0;
+    const int components = GLTrace::uniformComponents(type, &baseType);
+    if (location < 0 || components <= 0)
+        return;
+    std::memcpy(&v, value, size_t(components) * 4);
+    switch (type) {
+    case GL_FLOAT: glProgramUniform1fv(name, location, 1, v.f); break;
+    case GL_FLOAT_VEC2: glProgramUniform2fv(name, location, 1, v.f); break;
+    case GL_FLOAT_VEC3: glProgramUniform3fv(name, location, 1, v.f); break;
+    case GL_FLOAT_VEC4: glProgramUniform4fv(name, location, 1, v.f); break;
+    case GL_FLOAT_MAT2: glProgramUniformMatrix2fv(name, location, 1, GL_FALSE, v.f); break;
+    case GL_FLOAT_MAT3: glProgramUniformMatrix3fv(name, location, 1, GL_FALSE, v.f); break;
+    case GL_FLOAT_MAT4: glProgramUniformMatrix4fv(name, location, 1, GL_FALSE, v.f); break;
+    case GL_FLOAT_MAT2x3: glProgramUniformMatrix2x3fv(name, location, 1, GL_FALSE, v.f); break;
+    case GL_FLOAT_MAT2x4: glProgramUniformMatrix2x4fv(name, location, 1, GL_FALSE, v.f); break;
+    case GL_FLOAT_MAT3x2: glProgramUniformMatrix3x2fv(name, location, 1, GL_FALSE, v.f); break;
+    case GL_FLOAT_MAT3x4: glProgramUniformMatrix3x4fv(name, location, 1, GL_FALSE, v.f); break;
+    case GL_FLOAT_MAT4x2: glProgramUniformMatrix4x2fv(name, location, 1, GL_FALSE, v.f); break;
+    case GL_FLOAT_MAT4x3: glProgramUniformMatrix4x3fv(name, location, 1, GL_FALSE, v.f); break;
+    case GL_UNSIGNED_INT: glProgramUniform1uiv(name, location, 1, v.u); break;
+    case GL_UNSIGNED_INT_VEC2: glProgramUniform2uiv(name, location, 1, v.u); break;
+    case GL_UNSIGNED_INT_VEC3: glProgramUniform3uiv(name, location, 1, v.u); break;
+    case GL_UNSIGNED_INT_VEC4: glProgramUniform4uiv(name, location, 1, v.u); break;
+    case GL_INT_VEC2: case GL_BOOL_VEC2: glProgramUniform2iv(name, location, 1, v.i); break;
+    case GL_INT_VEC3: case GL_BOOL_VEC3: glProgramUniform3iv(name, location, 1, v.i); break;
+    case GL_INT_VEC4: case GL_BOOL_VEC4: glProgramUniform4iv(name, location, 1, v.i); break;
+    default: glProgramUniform1iv(name, location, 1, v.i); break;   // int、bool、sampler
+    }
+}
+
+bool GLReplay::pixels(Reader &in, GLsizei width, GLsizei height, GLenum format, GLenum type, const void **data,
+                      Stats *stats)
+{
+    *data = nullptr;
+    const quint8 source = in.u8();
+    if (source == GLTrace::UnpackBufferPixels) {
+        *data = reinterpret_cast<const void *>(quintptr(in.i64()));
+        return true;
+    }
+    if (source != GLTrace::ClientPixels)
+        return false;   // NoPixels：只分配（glTexImage2D），没有可以上传的数据
+
+    const GLTrace::Blob image = in.blob();
+    stats->uploadedBytes += image.size;
+    // 按回放时的解包参数算 GL 会读的字节数（和录制时 GLTrace::putPixels 的算法一样），blob 不够就不传
+    const int bpp = GLTrace::pixelSize(format, type);
+    if (width <= 0 || height <= 0 || !bpp) {
+        ++stats->unresolved;
+        return false;
+    }
+    const qint64 rowLength = unpackState[1] > 0 ? unpackState[1] : width;
+    const qint64 alignment = std::max(unpackState[0], 1);
+    const qint64 stride = (rowLength * bpp + alignment - 1) / alignment * alignment;
+    const qint64 bytes = (qint64(unpackState[2]) + height - 1) * stride + (qint64(unpackState[3]) + width) * bpp;
+    if (image.size < bytes) {
+        ++stats->unresolved;
+        return false;
+    }
+    *data = image.data;
+    return true;
+}
+
+void GLReplay::mappedWrite(GLuint name, qint64 offset, const char *source, qint64 size)
+{
+    for (const Mapping &m : mappings) {
+        if (m.buffer == name && offset >= m.offset && offset + size <= m.offset + m.length) {
+            std::memcpy(m.pointer + (offset - m.offset), source, size_t(size));
+            return;
+        }
+    }
+    // 录制时映射着、回放时没映射上（映射失败）：直接写进缓冲
+    glNamedBufferSubData(name, GLintptr(offset), GLsizeiptr(size), source);
+}
+
+void GLReplay::unmapped(GLenum bufferTarget)
+{
+    GLint bound = 0;
+    glGetIntegerv(GLTrace::bindingQuery(bufferTarget), &bound);
+    mappings.erase(std::remove_if(mappings.begin(), mappings.end(),
+                                  [bound](const Mapping &m) { return m.buffer == GLuint(bound); }),
+                   mappings.end());
+}
+
+// ---- 目标帧缓冲和状态 ----
+
+void GLReplay::resizeTarget(int width, int height)
+{
+    if (width <= targetWidth && height <= targetHeight)
+        return;
+    targetWidth = std::max(targetWidth, width);
+    targetHeight = std::max(targetHeight, height);
+    const GLuint old[2] = {targetColor, targetDepth};
+    glDeleteRenderbuffers(2, old);
+    glCreateRenderbuffers(1, &targetColor);
+    glCreateRenderbuffers(1, &targetDepth);
+    glNamedRenderbufferStorage(targetColor, GL_RGBA8, targetWidth, targetHeight);
+    glNamedRenderbufferStorage(targetDepth, GL_DEPTH24_STENCIL8, targetWidth, targetHeight);
+    glNamedFramebufferRenderbuffer(target, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, targetColor);
+    glNamedFramebufferRenderbuffer(target, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, targetDepth);
+    if (glCheckNamedFramebufferStatus(target, GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+        qWarning("GLReplay: target framebuffer %dx%d is incomplete", targetWidth, targetHeight);
+}
+
+void GLReplay::resetState()
+{
+    // 录制开始时 trace 假定的状态：GL 的默认值，画到目标帧缓冲
+    glBindFramebuffer(GL_FRAMEBUFFER, target);
+    glBindVertexArray(0);
+    glUseProgram(0);
+    const GLenum bufferTargets[] = {GL_ARRAY_BUFFER, GL_PIXEL_PACK_BUFFER, GL_PIXEL_UNPACK_BUFFER,
+                                    GL_DRAW_INDIRECT_BUFFER, GL_SHADER_STORAGE_BUFFER, GL_UNIFORM_BUFFER,
+                                    GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER};
+    for (GLenum bufferTarget : bufferTargets)
+        glBindBuffer(bufferTarget, 0);
+    GLint units = 16;
+    glGetIntegerv(GL_MAX_COMBINED_TEXTURE_IMAGE_UNITS, &units);
+    glBindTextures(0, units, nullptr);
+    glActiveTexture(GL_TEXTURE0);
+    const GLenum caps[] = {GL_BLEND, GL_DEPTH_TEST, GL_SCISSOR_TEST, GL_CULL_FACE, GL_STENCIL_TEST};
+    for (GLenum cap : caps)
+        glDisable(cap);
+    glBlendFunc(GL_ONE, GL_ZERO);
+    glDepthFunc(GL_LESS);
+    glDepthMask(GL_TRUE);
+    glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+    glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+    glPixelStorei(GL_UNPACK_SKIP_ROWS, 0);
+    glPixelStorei(GL_UNPACK_SKIP_PIXELS, 0);
+    unpackState[0] = 4;
+    unpackState[1] = unpackState[2] = unpackState[3] = 0;
+}
+
+void GLReplay::destroyObjects()
+{
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glBindVertexArray(0);
+    glUseProgram(0);
+    mappings.clear();   // 删缓冲时自动解除映射
+    for (const auto &b : buffers)
+        glDeleteBuffers(1, &b.second);
+    for (const auto &t : textures)
+        glDeleteTextures(1, &t.second);
+    for (const auto &v : vertexArrays)
+        glDeleteVertexArrays(1, &v.second);
+    for (const auto &p : programs)
+        glDeleteProgram(p.second.program);
+    for (const auto &f : framebuffers)
+        glDeleteFramebuffers(1, &f.second);
+    for (const auto &r : renderbuffers)
+        glDeleteRenderbuffers(1, &r.second);
+    for (const auto &q : queries)
+        glDeleteQueries(1, &q.second);
+    for (const auto &s : syncs)
+        glDeleteSync(s.second);
+    buffers.clear();
+    textures.clear();
+    vertexArrays.clear();
+    programs.clear();
+    framebuffers.clear();
+    renderbuffers.clear();
+    queries.clear();
+    syncs.clear();
+
+    const GLuint renderbuffersToDelete[2] = {targetColor, targetDepth};
+    glDeleteRenderbuffers(2, renderbuffersToDelete);
+    glDeleteFramebuffers(1, &target);
+    target = targetColor = targetDepth = 0;
+    targetWidth = targetHeight = 0;
+}
+
+// ---- 名字 ----
+
+GLuint GLReplay::lookup(const std::unordered_map<GLuint, GLuint> &names, GLuint name, Stats *stats)
+{
+    if (!name)
+        return 0;
+    auto it = names.find(name);
+    if (it == names.end()) {
+        ++stats->unresolved;
+        return 0;
+    }
+    return it->second;
+}
+
+GLuint GLReplay::buffer(GLuint name, Stats *stats)
+{
+    return lookup(buffers, name, stats);
+}
+
+GLuint GLReplay::texture(GLuint name, Stats *stats)
+{
+    return lookup(textures, name, stats);
+}
+
+GLuint GLReplay::vertexArray(GLuint name, Stats *stats)
+{
+    return lookup(vertexArrays, name, stats);
+}
+
+GLuint GLReplay::program(GLuint name, Stats *stats)
+{
+    if (!name)
+        return 0;
+    auto it = programs.find(name);
+    if (it == programs.end()) {
+        ++stats->unresolved;
+        return 0;
+    }
+    return it->second.program;
+}
+
+GLuint GLReplay::framebuffer(GLuint name, Stats *stats)
+{
+    return name ? lookup(framebuffers, name, stats) : target;
+}
+
+GLuint GLReplay::renderbuffer(GLuint name, Stats *stats)
+{
+    return lookup(renderbuffers, name, stats);
+}
+
+GLuint GLReplay::query(GLuint name, Stats *stats)
+{
+    return lookup(queries, name, stats);
+}
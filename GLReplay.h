@@ -0,0 +1,115 @@
+#ifndef GLREPLAY_H
+#define GLREPLAY_H
+
+#include <QOpenGLFunctions_4_5_Core>
+#include <QByteArray>
+#include <QString>
+#include <unordered_map>
+#include <vector>
+#include "GLTrace.h"
+
+/* GLReplay：在当前上下文里把 GLTrace 录的文件原样重放一遍，越快越好（benchmark/glreplay 用）
+ *
+ * 整个文件先读进内存，重放时只解码、换名字、调 GL，没有别的活：测到的是这串 GL 调用本身在这个驱动上的开销，
+ * 和录制时的 Renderer（剔除、合批、排序……）无关，适合比较驱动版本、GPU，或者同一个场景改动前后的 trace。
+ *
+ * trace 里的对象名在回放时换成新建的对象（快照也在这时建），"目标" 帧缓冲（窗口的、QOpenGLFramebufferObject）
+ * 换成 GLReplay 自己的帧缓冲：RGBA8 + 24 位深度 8 位模板，大小跟着 BeginFrame 里最大的视口。
+ * 每次 run() 从 GL 的默认状态开始，结束时删掉建过的所有对象，可以在同一个上下文里重复跑。
+ */
+class GLReplay : protected QOpenGLFunctions_4_5_Core
+{
+public:
+    struct Stats
+    {
+        qint64 calls[GLTrace::OpCount] = {};   // 每种记录的条数
+        qint64 nsecs[GLTrace::OpCount] = {};   // timeCalls 时每种记录的 CPU 时间
+        qint64 uploadedBytes = 0;              // 缓冲/纹理上传和映射内存写入的数据
+        qint64 snapshotBytes = 0;              // 外来对象快照里的数据（初始化时建对象用的）
+        int unresolved = 0;                    // 引用了 trace 里没有的对象、跳过的调用
+        int failedPrograms = 0;                // 编译/链接失败的程序
+        int glErrors = 0;                      // 每帧结束时 glGetError 读到的错误
+        int frames = 0;
+        double initMs = 0.0;                   // 第一个 BeginFrame 之前（对象创建、快照）
+        double totalMs = 0.0;
+        std::vector<double> frameMs;           // 每帧 BeginFrame 到 EndFrame（finishFrames 时包括 glFinish）
+    };
+
+    GLReplay();
+
+    bool load(const QString &path);
+    QString errorString() const { return error; }
+    qint64 size() const { return data.size(); }
+
+    // 上下文必须是当前上下文。finishFrames 时每帧最后 glFinish()，测到的是完整的帧时间（和 glbench 一样）；
+    // timeCalls 时每条记录单独计时，会多一些开销
+    bool run(bool finishFrames, bool timeCalls, Stats *stats);
+
+private:
+    struct Reader;
+    struct UniformInfo
+    {
+        GLenum type = 0;
+        std::vector<GLint> locations;
+    };
+    struct ProgramInfo
+    {
+        GLuint program = 0;
+        std::vector<UniformInfo> uniforms;
+    };
+    struct Mapping
+    {
+        GLuint buffer = 0;
+        qint64 offset = 0;
+        qint64 length = 0;
+        char *pointer = nullptr;
+    };
+
+    bool execute(GLTrace::Op op, Reader &in, Stats *stats);
+    void snapshotBuffer(Reader &in, Stats *stats);
+    void snapshotTexture(Reader &in, Stats *stats);
+    void snapshotVertexArray(Reader &in, Stats *stats);
+    void snapshotProgram(Reader &in, Stats *stats);
+    void release(GLTrace::Kind kind, GLuint name);
+    void setUniform(GLuint program, GLenum type, GLint location, const void *value);
+    // 读出像素来源放进 *data；客户端数据比 GL 按当前解包参数要读的少时返回 false（算一次 unresolved）
+    bool pixels(Reader &in, GLsizei width, GLsizei height, GLenum format, GLenum type, const void **data,
+                Stats *stats);
+    void mappedWrite(GLuint buffer, qint64 offset, const char *source, qint64 size);
+    void unmapped(GLenum target);
+    void resizeTarget(int width, int height);
+    void resetState();
+    void destroyObjects();
+
+    // trace 里的名字 -> 回放时的名字，0 还是 0；找不到时算一次 unresolved
+    GLuint buffer(GLuint name, Stats *stats);
+    GLuint texture(GLuint name, Stats *stats);
+    GLuint vertexArray(GLuint name, Stats *stats);
+    GLuint program(GLuint name, Stats *stats);
+    GLuint framebuffer(GLuint name, Stats *stats);   // 0 = 目标帧缓冲
+    GLuint renderbuffer(GLuint name, Stats *stats);
+    GLuint query(GLuint name, Stats *stats);
+    static GLuint lookup(const std::unordered_map<GLuint, GLuint> &names, GLuint name, Stats *stats);
+
+    QByteArray data;
+    QString error;
+
+    std::unordered_map<GLuint, GLuint> buffers;
+    std::unordered_map<GLuint, GLuint> textures;
+    std::unordered_map<GLuint, GLuint> vertexArrays;
+    std::unordered_map<GLuint, ProgramInfo> programs;
+    std::unordered_map<GLuint, GLuint> framebuffers;
+    std::unordered_map<GLuint, GLuint> renderbuffers;
+    std::unordered_map<GLuint, GLuint> queries;
+    std::unordered_map<quint64, GLsync> syncs;
+    std::vector<Mapping> mappings;
+
+    GLuint target;              // 目标帧缓冲
+    GLuint targetColor;
+    GLuint targetDepth;
+    int targetWidth;
+    int targetHeight;
+    GLint unpackState[4];       // trace 里当前的 UNPACK_ALIGNMENT、ROW_LENGTH、SKIP_ROWS、SKIP_PIXELS
+};
+
+#endif // GLREPLAY_H
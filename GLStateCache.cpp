@@ -0,0 +1,126 @@
+#include "GLStateCache.h"
+
+GLStateCache::GLStateCache()
+{
+    invalidate();
+}
+
+void GLStateCache::initialize()
+{
+    initializeOpenGLFunctions();
+    invalidate();
+}
+
+void GLStateCache::invalidate()
+{
+    program = Unknown;
+    for (GLuint &texture : textures)
+        texture = Unknown;
+    vertexArray = Unknown;
+    for (GLuint &buffer : buffers)
+        buffer = Unknown;
+    blend = Unknown;
+    blendSource = Unknown;
+    blendDestination = Unknown;
+    depthTest = Unknown;
+    depthMask = Unknown;
+    depthFunc = Unknown;
+}
+
+int GLStateCache::bufferSlot(GLenum target)
+{
+    switch (target) {
+    case GL_ARRAY_BUFFER: return ArrayBuffer;
+    case GL_ELEMENT_ARRAY_BUFFER: return ElementArrayBuffer;
+    case GL_PIXEL_PACK_BUFFER: return PixelPackBuffer;
+    case GL_PIXEL_UNPACK_BUFFER: return PixelUnpackBuffer;
+    case GL_DRAW_INDIRECT_BUFFER: return DrawIndirectBuffer;
+    case GL_SHADER_STORAGE_BUFFER: return ShaderStorageBuffer;
+    case GL_UNIFORM_BUFFER: return UniformBuffer;
+    case GL_COPY_READ_BUFFER: return CopyReadBuffer;
+    case GL_COPY_WRITE_BUFFER: return CopyWriteBuffer;
+    default: return -1;
+    }
+}
+
+void GLStateCache::useProgram(GLuint id)
+{
+    if (change(program, id))
+        glUseProgram(id);
+}
+
+void GLStateCache::bindTexture(int unit, GLuint texture)
+{
+    if (unit < 0 || unit >= TextureUnits) {
+        ++counters.issued;
+        glBindTextureUnit(GLuint(unit), texture);
+        return;
+    }
+    if (change(textures[unit], texture))
+        glBindTextureUnit(GLuint(unit), texture);
+}
+
+void GLStateCache::bindVertexArray(GLuint vao)
+{
+    if (change(vertexArray, vao)) {
+        glBindVertexArray(vao);
+        buffers[ElementArrayBuffer] = Unknown;  // 索引缓冲的绑定是 VAO 自己记的，换了 VAO 就不知道了
+    }
+}
+
+void GLStateCache::bindBuffer(GLenum target, GLuint buffer)
+{
+    const int slot = bufferSlot(target);
+    if (slot < 0) {
+        ++counters.issued;
+        glBindBuffer(target, buffer);
+        return;
+    }
+    if (change(buffers[slot], buffer))
+        glBindBuffer(target, buffer);
+}
+
+void GLStateCache::setBlend(bool enabled)
+{
+    if (change(blend, GLuint(enabled))) {
+        if (enabled)
+            glEnable(GL_BLEND);
+        else
+            glDisable(GL_BLEND);
+    }
+}
+
+void GLStateCache::setBlendFunc(GLenum source, GLenum destination)
+{
+    // 两个因子是一次调用设置的，任何一个变了都要下发；只算一次调用
+    if (blendSource == source && blendDestination == destination) {
+        ++counters.skipped;
+        return;
+    }
+    blendSource = source;
+    blendDestination = destination;
+    ++counters.issued;
+    glBlendFunc(source, destination);
+}
+
+void GLStateCache::setDepthTest(bool enabled)
+{
+    if (change(depthTest, GLuint(enabled))) {
+        if (enabled)
+            glEnable(GL_DEPTH_TEST);
+        else
+            glDisable(GL_DEPTH_TEST);
+    }
+}
+
+void GLStateCache::setDepthMask(bool enabled)
+{
+    if (change(depthMask, GLuint(enabled)))
+        glDepthMask(enabled ? GL_TRUE : GL_FALSE);
+}
+
+void GLStateCache::setDepthFunc(GLenum func)
+{
+    if (change(depthFunc, func))
+        glDepthFunc(func);
+}
@@ -0,0 +1,90 @@
+#ifndef GLSTATECACHE_H
+#define GLSTATECACHE_H
+
+#include "GLTraceFunctions.h"
+
+/* GLStateCache：记住上下文里当前的绑定和开关，值没变的设置直接跳过
+ *
+ * 覆盖着色器程序、各纹理单元上的纹理、VAO、各种目标上的缓冲、混合和深度状态。
+ * 每帧绑定同一个程序/纹理/VAO 再全部解绑这种写法，经过它以后只有第一帧真的调用到驱动。
+ *
+ * 前提是所有改这些状态的代码都经过它。以下情况之后必须调用 invalidate()，
+ * 否则缓存里记的和上下文里真实的状态对不上，该发的调用会被错误地跳过：
+ *   - 别的代码直接改了 GL 状态（QPainter 叠加层、QOpenGLFramebufferObject 的创建、Qt 内部）
+ *   - 删除了缓存里可能记着的对象（glDelete* 会把绑定恢复成 0，新对象又可能拿到同一个名字）
+ *
+ * stats() 记录真正下发的和省掉的调用次数，Renderer 每帧把它交给 FrameProfiler。
+ */
+class GLStateCache : protected GLTraceFunctions
+{
+public:
+    struct Stats
+    {
+        int issued = 0;    // 真正调用到驱动的次数
+        int skipped = 0;   // 值没变、省掉的次数
+    };
+
+    static const int TextureUnits = 16;
+
+    GLStateCache();
+
+    void initialize();   // 上下文必须是当前上下文
+    void invalidate();   // 忘掉所有记住的状态，之后的每个设置都会真正下发一次
+
+    void useProgram(GLuint program);
+    void bindTexture(int unit, GLuint texture);   // glBindTextureUnit：纹理按它自己的目标绑定，不改当前活动单元
+    void bindVertexArray(GLuint vao);
+    void bindBuffer(GLenum target, GLuint buffer);
+    void setBlend(bool enabled);
+    void setBlendFunc(GLenum source, GLenum destination);
+    void setDepthTest(bool enabled);
+    void setDepthMask(bool enabled);
+    void setDepthFunc(GLenum func);
+
+    const Stats &stats() const { return counters; }
+    void resetStats() { counters = Stats(); }
+
+private:
+    enum BufferSlot
+    {
+        ArrayBuffer,
+        ElementArrayBuffer,   // 属于 VAO 的状态，换 VAO 时跟着失效
+        PixelPackBuffer,
+        PixelUnpackBuffer,
+        DrawIndirectBuffer,
+        ShaderStorageBuffer,
+        UniformBuffer,
+        CopyReadBuffer,
+        CopyWriteBuffer,
+        BufferSlotCount
+    };
+    static int bufferSlot(GLenum target);   // 不认识的目标返回 -1（总是下发）
+
+    // 值相同返回 false 并计入 skipped，否则更新缓存、计入 issued 并返回 true。
+    // 所有状态都存成 GLuint，Unknown 表示 "不知道"，和任何真实的值都不相等
+    static const GLuint Unknown = ~0u;
+    bool change(GLuint &cached, GLuint value)
+    {
+        if (cached == value) {
+            ++counters.skipped;
+            return false;
+        }
+        cached = value;
+        ++counters.issued;
+        return true;
+    }
+
+    GLuint program;
+    GLuint textures[TextureUnits];
+    GLuint vertexArray;
+    GLuint buffers[BufferSlotCount];
+    GLuint blend;              // 0/1
+    GLuint blendSource;
+    GLuint blendDestination;
+    GLuint depthTest;          // 0/1
+    GLuint depthMask;          // 0/1
+    GLuint depthFunc;
+    Stats counters;
+};
+
+#endif // GLSTATECACHE_H
@@ -0,0 +1,1181 @@
+#include "GLTrace.h"
+#include <QDebug>
+#include <algorithm>
+#include <cstring>
+
+namespace {
+
+// 每帧开始对一遍的开关，FixedState::enabled 的顺序
+const GLenum TrackedCaps[5] = {GL_BLEND, GL_DEPTH_TEST, GL_SCISSOR_TEST, GL_CULL_FACE, GL_STENCIL_TEST};
+// 影响纹理上传的解包参数和它们的默认值，GLTrace::unpack 的顺序
+const GLenum UnpackParameters[4] = {GL_UNPACK_ALIGNMENT, GL_UNPACK_ROW_LENGTH, GL_UNPACK_SKIP_ROWS,
+                                    GL_UNPACK_SKIP_PIXELS};
+const GLint UnpackDefaults[4] = {4, 0, 0, 0};
+
+const qint64 FlushSize = 1 << 20;    // pending 超过 1 MB 就写文件
+const qint64 MappedBlock = 256;      // 映射内存按 256 字节一块比较
+
+const char *const OpNames[] = {
+    "BeginFrame", "EndFrame", "SnapshotBuffer", "SnapshotTexture", "SnapshotVertexArray", "SnapshotProgram",
+    "Release", "Uniform", "MappedWrite",
+    "glActiveTexture", "glBindBuffer", "glBindBufferRange", "glBindFramebuffer", "glBindTexture",
+    "glBindTextureUnit", "glBindVertexArray", "glBlendFunc", "glBlendFuncSeparate", "glBufferStorage",
+    "glCheckNamedFramebufferStatus", "glClear", "glClearColor", "glClearNamedFramebufferfv", "glClientWaitSync",
+    "glColorMask", "glCopyImageSubData", "glCopyNamedBufferSubData", "glCreateFramebuffers",
+    "glCreateRenderbuffers", "glCreateTextures", "glDeleteFramebuffers", "glDeleteQueries",
+    "glDeleteRenderbuffers", "glDeleteSync", "glDeleteTextures", "glDepthFunc", "glDepthMask", "glDisable",
+    "glDrawArraysInstancedBaseInstance", "glDrawElementsBaseVertex", "glDrawElementsInstancedBaseInstance",
+    "glEnable", "glEnableVertexAttribArray", "glFenceSync", "glFinish", "glGenQueries", "glGenTextures",
+    "glGenerateTextureMipmap", "glGetInteger64v", "glGetIntegerv", "glGetQueryObjectiv", "glGetQueryObjectui64v",
+    "glGetTextureLevelParameteriv", "glMapBufferRange", "glMultiDrawElementsIndirect", "glNamedBufferSubData",
+    "glNamedFramebufferRenderbuffer", "glNamedFramebufferTexture", "glNamedRenderbufferStorage", "glPixelStorei",
+    "glQueryCounter", "glScissor", "glTexImage2D", "glTexParameteri", "glTextureParameteri", "glTextureStorage2D",
+    "glTextureSubImage2D", "glUnmapBuffer", "glUseProgram", "glVertexAttribDivisor", "glVertexAttribPointer",
+    "glViewport",
+};
+static_assert(sizeof(OpNames) / sizeof(OpNames[0]) == GLTrace::OpCount, "OpNames out of sync with GLTrace::Op");
+
+// 快照时读回纹理内容用的格式，只支持程序里用到的这几种
+bool readbackFormat(GLint internalFormat, GLenum *format, GLenum *type)
+{
+    *type = GL_UNSIGNED_BYTE;
+    switch (internalFormat) {
+    case GL_RGBA8: case GL_SRGB8_ALPHA8: case GL_RGBA: *format = GL_RGBA; return true;
+    case GL_RGB8: case GL_SRGB8: case GL_RGB: *format = GL_RGB; return true;
+    case GL_RG8: *format = GL_RG; return true;
+    case GL_R8: *format = GL_RED; return true;
+    case GL_RGBA16F: *format = GL_RGBA; *type = GL_HALF_FLOAT; return true;
+    case GL_RGBA32F: *format = GL_RGBA; *type = GL_FLOAT; return true;
+    case GL_R16F: *format = GL_RED; *type = GL_HALF_FLOAT; return true;
+    case GL_R32F: *format = GL_RED; *type = GL_FLOAT; return true;
+    case GL_RGB10_A2: *format = GL_RGBA; *type = GL_UNSIGNED_INT_2_10_10_10_REV; return true;
+    default: return false;
+    }
+}
+
+quint64 syncId(GLsync sync)
+{
+    return quint64(reinterpret_cast<quintptr>(sync));
+}
+
+} // namespace
+
+const char GLTrace::Magic[8] = {'G', 'L', 'T', 'R', 'A', 'C', 'E', '\0'};
+std::atomic<GLTrace *> GLTrace::recorder{nullptr};
+
+GLTrace::GLTrace()
+    : context(nullptr), vertexArray(0), program(0), drawFramebuffer(0), readFramebuffer(0), activeTexture(GL_TEXTURE0)
+{
+    std::copy(UnpackDefaults, UnpackDefaults + 4, unpack);
+}
+
+GLTrace::~GLTrace()
+{
+    stop();
+}
+
+bool GLTrace::start(const QString &path)
+{
+    stop();
+    context = QOpenGLContext::currentContext();
+    if (!context) {
+        qWarning("GLTrace: no current OpenGL context");
+        return false;
+    }
+    GLTrace *expected = nullptr;
+    if (!recorder.compare_exchange_strong(expected, this)) {
+        qWarning("GLTrace: another trace is already recording");
+        return false;
+    }
+    file.setFileName(path);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        qWarning("GLTrace: cannot write %s", qPrintable(path));
+        recorder.store(nullptr);
+        return false;
+    }
+    initializeOpenGLFunctions();
+
+    // trace 从回放时的初始状态开始：GL 的默认状态，所有对象都还不认识
+    counters = Stats();
+    pending.clear();
+    buffers.clear();
+    textures.clear();
+    vertexArrays.clear();
+    programs.clear();
+    framebuffers.clear();
+    syncs.clear();
+    mappings.clear();
+    bufferBindings.clear();
+    elementBindings.clear();
+    vertexArray = 0;
+    program = 0;
+    drawFramebuffer = 0;
+    readFramebuffer = 0;
+    activeTexture = GL_TEXTURE0;
+    texture2D.clear();
+    std::copy(UnpackDefaults, UnpackDefaults + 4, unpack);
+    fixed = FixedState();
+
+    append(Magic, sizeof(Magic));
+    const quint32 version = Version;
+    append(&version, sizeof(version));
+    reconcileFixedState();
+    return true;
+}
+
+void GLTrace::stop()
+{
+    if (!isRecording())
+        return;
+    if (QOpenGLContext::currentContext() == context)
+        flushMapped();
+    flushFile(true);
+    file.close();
+    mappings.clear();
+    GLTrace *self = this;
+    recorder.compare_exchange_strong(self, nullptr);
+}
+
+void GLTrace::beginFrame()
+{
+    if (!isRecording())
+        return;
+    GLint view[4] = {};
+    glGetIntegerv(GL_VIEWPORT, view);
+    beginRecord(BeginFrame);
+    put(qint32(view[2]));
+    put(qint32(view[3]));
+    // 上一帧之后（QPainter、Qt 自己）改过的状态
+    reconcileFixedState();
+    reconcileFramebuffers();
+}
+
+void GLTrace::endFrame()
+{
+    if (!isRecording())
+        return;
+    flushMapped();
+    beginRecord(EndFrame);
+    ++counters.frames;
+    flushFile(false);
+}
+
+const char *GLTrace::opName(int op)
+{
+    return op >= 0 && op < OpCount ? OpNames[op] : "?";
+}
+
+void GLTrace::beginRecord(Op op)
+{
+    flushFile(false);
+    put(quint8(op));
+    ++counters.records;
+}
+
+void GLTrace::append(const void *data, qint64 size)
+{
+    pending.append(static_cast<const char *>(data), size);
+    counters.bytes += size;
+}
+
+void GLTrace::flushFile(bool force)
+{
+    if (pending.isEmpty() || (!force && pending.size() < FlushSize))
+        return;
+    if (file.write(pending) != pending.size())
+        qWarning("GLTrace: write to %s failed: %s", qPrintable(file.fileName()), qPrintable(file.errorString()));
+    pending.clear();
+}
+
+void GLTrace::put(Names n)
+{
+    put(qint32(n.count));
+    for (GLsizei i = 0; i < n.count; ++i)
+        put(quint32(n.names[i]));
+}
+
+void GLTrace::put(Blob b)
+{
+    put(quint32(b.size));
+    if (b.size > 0)
+        append(b.data, b.size);
+}
+
+void GLTrace::putPixels(GLsizei width, GLsizei height, GLenum format, GLenum type, const void *pixels)
+{
+    if (bufferBinding(GL_PIXEL_UNPACK_BUFFER)) {
+        // 从 PBO 上传，pixels 是缓冲里的偏移，数据已经在缓冲里（MappedWrite/快照）
+        put(quint8(UnpackBufferPixels));
+        put(qint64(reinterpret_cast<quintptr>(pixels)));
+        return;
+    }
+    const int bpp = pixelSize(format, type);
+    if (!pixels || width <= 0 || height <= 0 || !bpp) {
+        if (pixels && !bpp)
+            ++counters.dropped;
+        put(quint8(NoPixels));
+        return;
+    }
+    // 按当前的解包参数算出 GL 会读的字节数
+    const qint64 rowLength = unpack[1] > 0 ? unpack[1] : width;
+    const qint64 alignment = std::max(unpack[0], 1);
+    const qint64 stride = (rowLength * bpp + alignment - 1) / alignment * alignment;
+    const qint64 bytes = (unpack[2] + height - 1) * stride + (unpack[3] + width) * qint64(bpp);
+    put(quint8(ClientPixels));
+    put(Blob{pixels, bytes});
+}
+
+// ---- 外来对象 ----
+
+void GLTrace::ensureBuffer(GLuint name)
+{
+    if (!name)
+        return;
+    auto it = buffers.find(name);
+    if (it != buffers.end()) {
+        GLint64 size = 0;
+        glGetNamedBufferParameteri64v(name, GL_BUFFER_SIZE, &size);
+        if (size == it->second.size)
+            return;
+        // 大小变了：Qt 删掉以后同一个名字又建了一个新的缓冲
+        beginRecord(Release);
+        put(quint8(BufferKind));
+        put(quint32(name));
+        buffers.erase(it);
+        forgetBuffer(name);
+    }
+    snapshotBuffer(name);
+}
+
+void GLTrace::forgetBuffer(GLuint name)
+{
+    for (auto &binding : bufferBindings) {
+        if (binding.second == name)
+            binding.second = ~0u;
+    }
+    GLuint &element = elementBindings[vertexArray];
+    if (element == name)
+        element = ~0u;
+    mappings.erase(std::remove_if(mappings.begin(), mappings.end(),
+                                  [name](const Mapping &m) { return m.buffer == name; }),
+                   mappings.end());
+}
+
+void GLTrace::snapshotBuffer(GLuint name)
+{
+    GLint64 size = 0;
+    GLint usage = GL_STATIC_DRAW, immutable = 0, flags = 0, mapped = 0;
+    glGetNamedBufferParameteri64v(name, GL_BUFFER_SIZE, &size);
+    glGetNamedBufferParameteriv(name, GL_BUFFER_USAGE, &usage);
+    glGetNamedBufferParameteriv(name, GL_BUFFER_IMMUTABLE_STORAGE, &immutable);
+    glGetNamedBufferParameteriv(name, GL_BUFFER_STORAGE_FLAGS, &flags);
+    glGetNamedBufferParameteriv(name, GL_BUFFER_MAPPED, &mapped);
+
+    // 非持久映射中的缓冲读不了，只记大小
+    QByteArray data;
+    if (size > 0 && (!mapped || (flags & GL_MAP_PERSISTENT_BIT))) {
+        data.resize(size);
+        glGetNamedBufferSubData(name, 0, size, data.data());
+    }
+    beginRecord(SnapshotBuffer);
+    put(quint32(name));
+    put(qint64(size));
+    put(quint32(usage));
+    put(quint8(immutable ? 1 : 0));
+    put(quint32(flags));
+    put(Blob{data.constData(), data.size()});
+    buffers[name].size = size;
+    ++counters.snapshots;
+}
+
+void GLTrace::ensureTexture(GLuint name)
+{
+    if (!name)
+        return;
+    auto it = textures.find(name);
+    if (it != textures.end()) {
+        if (!it->second.foreign)
+            return;
+        GLint width = 0, height = 0, internalFormat = 0;
+        glGetTextureLevelParameteriv(name, 0, GL_TEXTURE_WIDTH, &width);
+        glGetTextureLevelParameteriv(name, 0, GL_TEXTURE_HEIGHT, &height);
+        glGetTextureLevelParameteriv(name, 0, GL_TEXTURE_INTERNAL_FORMAT, &internalFormat);
+        const TextureInfo &info = it->second;
+        if (width == info.width && height == info.height && internalFormat == info.internalFormat)
+            return;
+        beginRecord(Release);
+        put(quint8(TextureKind));
+        put(quint32(name));
+        textures.erase(it);
+        for (auto &binding : texture2D) {
+            if (binding.second == name)
+                binding.second = ~0u;
+        }
+    }
+    snapshotTexture(name);
+}
+
+void GLTrace::snapshotTexture(GLuint name)
+{
+    TextureInfo &info = textures[name];
+    info.foreign = true;
+
+    GLint target = 0;
+    glGetTextureParameteriv(name, GL_TEXTURE_TARGET, &target);
+    if (target != GL_TEXTURE_2D) {
+        qWarning("GLTrace: texture %u is not a 2D texture (0x%x), not recorded", name, target);
+        ++counters.dropped;
+        return;
+    }
+    GLint width = 0, height = 0, internalFormat = 0, compressed = 0;
+    glGetTextureLevelParameteriv(name, 0, GL_TEXTURE_WIDTH, &width);
+    glGetTextureLevelParameteriv(name, 0, GL_TEXTURE_HEIGHT, &height);
+    glGetTextureLevelParameteriv(name, 0, GL_TEXTURE_INTERNAL_FORMAT, &internalFormat);
+    glGetTextureLevelParameteriv(name, 0, GL_TEXTURE_COMPRESSED, &compressed);
+    info.width = width;
+    info.height = height;
+    info.internalFormat = internalFormat;
+
+    GLint immutable = 0, levels = 0;
+    glGetTextureParameteriv(name, GL_TEXTURE_IMMUTABLE_FORMAT, &immutable);
+    if (immutable) {
+        glGetTextureParameteriv(name, GL_TEXTURE_IMMUTABLE_LEVELS, &levels);
+    } else {
+        while (levels < 32) {
+            GLint levelWidth = 0;
+            glGetTextureLevelParameteriv(name, levels, GL_TEXTURE_WIDTH, &levelWidth);
+            if (levelWidth <= 0)
+                break;
+            ++levels;
+        }
+    }
+    if (width <= 0 || height <= 0)
+        levels = 0;
+
+    GLenum format = 0, type = 0;
+    if (levels > 0 && !compressed && !readbackFormat(internalFormat, &format, &type)) {
+        qWarning("GLTrace: texture %u has unsupported format 0x%x, contents not recorded", name, internalFormat);
+        ++counters.dropped;
+        format = 0;
+    }
+
+    const GLenum parameterNames[6] = {GL_TEXTURE_MIN_FILTER, GL_TEXTURE_MAG_FILTER, GL_TEXTURE_WRAP_S,
+                                      GL_TEXTURE_WRAP_T, GL_TEXTURE_BASE_LEVEL, GL_TEXTURE_MAX_LEVEL};
+    GLint parameters[6] = {};
+    for (int i = 0; i < 6; ++i)
+        glGetTextureParameteriv(name, parameterNames[i], &parameters[i]);
+
+    std::vector<QByteArray> images(static_cast<size_t>(levels));
+    if (levels > 0 && (compressed || format)) {
+        // 读回时用紧凑的打包参数，读完恢复
+        const GLenum packNames[4] = {GL_PACK_ALIGNMENT, GL_PACK_ROW_LENGTH, GL_PACK_SKIP_ROWS, GL_PACK_SKIP_PIXELS};
+        GLint pack[4] = {}, packBuffer = 0;
+        for (int i = 0; i < 4; ++i) {
+            glGetIntegerv(packNames[i], &pack[i]);
+            glPixelStorei(packNames[i], i == 0 ? 1 : 0);
+        }
+        glGetIntegerv(GL_PIXEL_PACK_BUFFER_BINDING, &packBuffer);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+        for (GLint level = 0; level < levels; ++level) {
+            QByteArray &image = images[size_t(level)];
+            if (compressed) {
+                GLint bytes = 0;
+                glGetTextureLevelParameteriv(name, level, GL_TEXTURE_COMPRESSED_IMAGE_SIZE, &bytes);
+                image.resize(bytes);
+                glGetCompressedTextureImage(name, level, bytes, image.data());
+            } else {
+                const qint64 levelWidth = std::max(1, width >> level);
+                const qint64 levelHeight = std::max(1, height >> level);
+                image.resize(levelWidth * levelHeight * pixelSize(format, type));
+                glGetTextureImage(name, level, format, type, image.size(), image.data());
+            }
+        }
+        for (int i = 0; i < 4; ++i)
+            glPixelStorei(packNames[i], pack[i]);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, GLuint(packBuffer));
+    }
+
+    beginRecord(SnapshotTexture);
+    put(quint32(name));
+    put(quint32(internalFormat));
+    put(qint32(width));
+    put(qint32(height));
+    put(qint32(levels));
+    put(quint8(compressed ? 1 : 0));
+    put(quint32(format));
+    put(quint32(type));
+    for (GLint parameter : parameters)
+        put(qint32(parameter));
+    for (const QByteArray &image : images)
+        put(Blob{image.constData(), image.size()});
+    ++counters.snapshots;
+}
+
+void GLTrace::ensureVertexArray(GLuint name)
+{
+    if (name && !vertexArrays.count(name))
+        snapshotVertexArray(name);
+}
+
+void GLTrace::snapshotVertexArray(GLuint name)
+{
+    struct Attribute
+    {
+        GLuint index;
+        GLint enabled, size, type, normalized, integer, stride, divisor, buffer;
+        qint64 offset;
+    };
+    GLint previous = 0, maxAttributes = 16;
+    glGetIntegerv(GL_VERTEX_ARRAY_BINDING, &previous);
+    glGetIntegerv(GL_MAX_VERTEX_ATTRIBS, &maxAttributes);
+    glBindVertexArray(name);
+
+    std::vector<Attribute> attributes;
+    for (GLint i = 0; i < std::min(maxAttributes, 32); ++i) {
+        Attribute a = {};
+        a.index = GLuint(i);
+        glGetVertexAttribiv(a.index, GL_VERTEX_ATTRIB_ARRAY_BUFFER_BINDING, &a.buffer);
+        glGetVertexAttribiv(a.index, GL_VERTEX_ATTRIB_ARRAY_ENABLED, &a.enabled);
+        if (!a.buffer && !a.enabled)
+            continue;
+        glGetVertexAttribiv(a.index, GL_VERTEX_ATTRIB_ARRAY_SIZE, &a.size);
+        glGetVertexAttribiv(a.index, GL_VERTEX_ATTRIB_ARRAY_TYPE, &a.type);
+        glGetVertexAttribiv(a.index, GL_VERTEX_ATTRIB_ARRAY_NORMALIZED, &a.normalized);
+        glGetVertexAttribiv(a.index, GL_VERTEX_ATTRIB_ARRAY_INTEGER, &a.integer);
+        glGetVertexAttribiv(a.index, GL_VERTEX_ATTRIB_ARRAY_STRIDE, &a.stride);
+        glGetVertexAttribiv(a.index, GL_VERTEX_ATTRIB_ARRAY_DIVISOR, &a.divisor);
+        void *pointer = nullptr;
+        glGetVertexAttribPointerv(a.index, GL_VERTEX_ATTRIB_ARRAY_POINTER, &pointer);
+        a.offset = qint64(reinterpret_cast<quintptr>(pointer));
+        attributes.push_back(a);
+    }
+    GLint element = 0;
+    glGetIntegerv(GL_ELEMENT_ARRAY_BUFFER_BINDING, &element);
+    glBindVertexArray(GLuint(previous));
+
+    vertexArrays.insert(name);
+    for (const Attribute &a : attributes)
+        ensureBuffer(GLuint(a.buffer));
+    ensureBuffer(GLuint(element));
+
+    beginRecord(SnapshotVertexArray);
+    put(quint32(name));
+    put(quint32(element));
+    put(quint32(attributes.size()));
+    for (const Attribute &a : attributes) {
+        put(quint32(a.index));
+        put(quint8(a.enabled ? 1 : 0));
+        put(qint32(a.size));
+        put(quint32(a.type));
+        put(quint8(a.normalized ? 1 : 0));
+        put(quint8(a.integer ? 1 : 0));
+        put(qint32(a.stride));
+        put(qint64(a.offset));
+        put(quint32(a.divisor));
+        put(quint32(a.buffer));
+    }
+    elementBindings[name] = GLuint(element);
+    ++counters.snapshots;
+}
+
+void GLTrace::ensureProgram(GLuint name)
+{
+    if (name && !programs.count(name))
+        snapshotProgram(name);
+}
+
+void GLTrace::snapshotProgram(GLuint name)
+{
+    ProgramInfo &info = programs[name];
+
+    GLint shaderCount = 0;
+    glGetProgramiv(name, GL_ATTACHED_SHADERS, &shaderCount);
+    std::vector<GLuint> shaders(static_cast<size_t>(std::max(shaderCount, 0)));
+    if (shaderCount > 0)
+        glGetAttachedShaders(name, shaderCount, nullptr, shaders.data());
+    std::vector<std::pair<GLenum, QByteArray>> stages;
+    for (GLuint shader : shaders) {
+        GLint type = 0, length = 0;
+        glGetShaderiv(shader, GL_SHADER_TYPE, &type);
+        glGetShaderiv(shader, GL_SHADER_SOURCE_LENGTH, &length);
+        QByteArray source(std::max(length, 1), '\0');
+        glGetShaderSource(shader, source.size(), nullptr, source.data());
+        source.truncate(int(qstrlen(source.constData())));
+        stages.emplace_back(GLenum(type), source);
+    }
+
+    // 属性的位置：Qt 链接前用 bindAttributeLocation 指定的，回放时照样指定
+    GLint attributeCount = 0, attributeLength = 0;
+    glGetProgramiv(name, GL_ACTIVE_ATTRIBUTES, &attributeCount);
+    glGetProgramiv(name, GL_ACTIVE_ATTRIBUTE_MAX_LENGTH, &attributeLength);
+    std::vector<std::pair<QByteArray, GLint>> attributes;
+    for (GLint i = 0; i < attributeCount; ++i) {
+        QByteArray attribute(std::max(attributeLength, 1), '\0');
+        GLsizei length = 0;
+        GLint size = 0;
+        GLenum type = 0;
+        glGetActiveAttrib(name, GLuint(i), attribute.size(), &length, &size, &type, attribute.data());
+        attribute.truncate(length);
+        const GLint location = glGetAttribLocation(name, attribute.constData());
+        if (location >= 0 && !attribute.startsWith("gl_"))
+            attributes.emplace_back(attribute, location);
+    }
+
+    // 没有着色器（从二进制缓存加载的）时只能记驱动的二进制，换了驱动回放不了
+    GLenum binaryFormat = 0;
+    QByteArray binary;
+    if (stages.empty()) {
+        GLint binaryLength = 0;
+        glGetProgramiv(name, GL_PROGRAM_BINARY_LENGTH, &binaryLength);
+        if (binaryLength > 0) {
+            binary.resize(binaryLength);
+            GLsizei written = 0;
+            glGetProgramBinary(name, binaryLength, &written, &binaryFormat, binary.data());
+            binary.truncate(written);
+        }
+        if (binary.isEmpty()) {
+            qWarning("GLTrace: program %u has neither shader sources nor a binary", name);
+            ++counters.dropped;
+        }
+    }
+
+    // 默认块里的 uniform，值在每次绘制前和 trace 里的对一下
+    GLint uniformCount = 0, uniformLength = 0;
+    glGetProgramiv(name, GL_ACTIVE_UNIFORMS, &uniformCount);
+    glGetProgramiv(name, GL_ACTIVE_UNIFORM_MAX_LENGTH, &uniformLength);
+    std::vector<QByteArray> uniformNames;
+    for (GLint i = 0; i < uniformCount; ++i) {
+        QByteArray uniform(std::max(uniformLength, 1), '\0');
+        GLsizei length = 0;
+        GLint size = 0;
+        GLenum type = 0;
+        glGetActiveUniform(name, GLuint(i), uniform.size(), &length, &size, &type, uniform.data());
+        uniform.truncate(length);
+        UniformInfo u;
+        u.type = type;
+        u.components = uniformComponents(type, &u.baseType);
+        if (!u.components || glGetUniformLocation(name, uniform.constData()) < 0)
+            continue;   // double 类型、uniform block 里的成员
+        // 数组报的是 "name[0]"，每个元素单独取位置
+        const bool array = uniform.endsWith("[0]");
+        const QByteArray base = array ? uniform.left(uniform.size() - 3) : uniform;
+        for (GLint element = 0; element < (array ? size : 1); ++element) {
+            const QByteArray elementName = array ? base + '[' + QByteArray::number(element) + ']' : base;
+            u.locations.push_back(glGetUniformLocation(name, elementName.constData()));
+        }
+        u.values.resize(u.locations.size());
+        info.uniforms.push_back(u);
+        uniformNames.push_back(uniform);
+    }
+
+    beginRecord(SnapshotProgram);
+    put(quint32(name));
+    put(quint32(stages.size()));
+    for (const auto &stage : stages) {
+        put(quint32(stage.first));
+        put(Blob{stage.second.constData(), stage.second.size()});
+    }
+    put(quint32(attributes.size()));
+    for (const auto &attribute : attributes) {
+        put(Blob{attribute.first.constData(), attribute.first.size()});
+        put(qint32(attribute.second));
+    }
+    put(quint32(binaryFormat));
+    put(Blob{binary.constData(), binary.size()});
+    put(quint32(info.uniforms.size()));
+    for (size_t i = 0; i < info.uniforms.size(); ++i) {
+        put(Blob{uniformNames[i].constData(), uniformNames[i].size()});
+        put(quint32(info.uniforms[i].type));
+        put(qint32(info.uniforms[i].locations.size()));
+    }
+    ++counters.snapshots;
+}
+
+// ---- 隐式状态 ----
+
+void GLTrace::reconcileFramebuffers()
+{
+    GLint draw = 0, read = 0;
+    glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &draw);
+    glGetIntegerv(GL_READ_FRAMEBUFFER_BINDING, &read);
+    const GLuint mappedDraw = framebuffers.count(GLuint(draw)) ? GLuint(draw) : 0;
+    const GLuint mappedRead = framebuffers.count(GLuint(read)) ? GLuint(read) : 0;
+    if (mappedDraw == mappedRead && mappedDraw != drawFramebuffer && mappedRead != readFramebuffer) {
+        beginRecord(BindFramebuffer);
+        put(quint32(GL_FRAMEBUFFER));
+        put(quint32(mappedDraw));
+    } else {
+        if (mappedDraw != drawFramebuffer) {
+            beginRecord(BindFramebuffer);
+            put(quint32(GL_DRAW_FRAMEBUFFER));
+            put(quint32(mappedDraw));
+        }
+        if (mappedRead != readFramebuffer) {
+            beginRecord(BindFramebuffer);
+            put(quint32(GL_READ_FRAMEBUFFER));
+            put(quint32(mappedRead));
+        }
+    }
+    drawFramebuffer = mappedDraw;
+    readFramebuffer = mappedRead;
+}
+
+void GLTrace::reconcileViewport()
+{
+    GLint view[4] = {};
+    glGetIntegerv(GL_VIEWPORT, view);
+    if (std::equal(view, view + 4, fixed.viewport))
+        return;
+    record(Viewport, qint32(view[0]), qint32(view[1]), qint32(view[2]), qint32(view[3]));
+    std::copy(view, view + 4, fixed.viewport);
+}
+
+void GLTrace::reconcileProgram()
+{
+    GLint current = 0;
+    glGetIntegerv(GL_CURRENT_PROGRAM, &current);
+    ensureProgram(GLuint(current));
+    if (GLuint(current) != program) {
+        record(UseProgram, quint32(current));
+        program = GLuint(current);
+    }
+    if (current)
+        reconcileUniforms(GLuint(current));
+}
+
+void GLTrace::reconcileUniforms(GLuint name)
+{
+    auto it = programs.find(name);
+    if (it == programs.end())
+        return;
+    std::vector<UniformInfo> &uniforms = it->second.uniforms;
+    for (size_t i = 0; i < uniforms.size(); ++i) {
+        UniformInfo &u = uniforms[i];
+        for (size_t element = 0; element < u.locations.size(); ++element) {
+            const GLint location = u.locations[element];
+            if (location < 0)
+                continue;
+            union { GLfloat f[16]; GLint i[16]; GLuint u[16]; } value;
+            if (u.baseType == 0)
+                glGetUniformfv(name, location, value.f);
+            else if (u.baseType == 1)
+                glGetUniformiv(name, location, value.i);
+            else
+                glGetUniformuiv(name, location, value.u);
+            const int bytes = u.components * 4;
+            QByteArray &shadow = u.values[element];
+            if (shadow.size() == bytes && std::memcmp(shadow.constData(), &value, size_t(bytes)) == 0)
+                continue;
+            shadow = QByteArray(reinterpret_cast<const char *>(&value), bytes);
+            beginRecord(Uniform);
+            put(quint32(name));
+            put(quint32(i));
+            put(quint32(element));
+            put(Blob{shadow.constData(), bytes});
+        }
+    }
+}
+
+void GLTrace::reconcileVertexArray()
+{
+    GLint current = 0;
+    glGetIntegerv(GL_VERTEX_ARRAY_BINDING, &current);
+    if (GLuint(current) == vertexArray)
+        return;
+    ensureVertexArray(GLuint(current));
+    record(BindVertexArray, quint32(current));
+    vertexArray = GLuint(current);
+}
+
+void GLTrace::reconcileBuffer(GLenum target)
+{
+    const GLenum query = bindingQuery(target);
+    if (!query)
+        return;
+    GLint actual = 0;
+    glGetIntegerv(query, &actual);
+    ensureBuffer(GLuint(actual));
+    GLuint &bound = bufferBinding(target);
+    if (bound == GLuint(actual))
+        return;
+    record(BindBuffer, quint32(target), quint32(actual));
+    bound = GLuint(actual);
+}
+
+void GLTrace::reconcileUnpack()
+{
+    for (int i = 0; i < 4; ++i) {
+        GLint value = 0;
+        glGetIntegerv(UnpackParameters[i], &value);
+        if (value == unpack[i])
+            continue;
+        record(PixelStorei, quint32(UnpackParameters[i]), qint32(value));
+        unpack[i] = value;
+    }
+    reconcileBuffer(GL_PIXEL_UNPACK_BUFFER);
+}
+
+void GLTrace::reconcileActiveTexture()
+{
+    GLint unit = GL_TEXTURE0;
+    glGetIntegerv(GL_ACTIVE_TEXTURE, &unit);
+    if (GLenum(unit) == activeTexture)
+        return;
+    record(ActiveTexture, quint32(unit));
+    activeTexture = GLenum(unit);
+}
+
+void GLTrace::reconcileFixedState()
+{
+    for (int i = 0; i < 5; ++i) {
+        const GLboolean on = glIsEnabled(TrackedCaps[i]);
+        if (on != fixed.enabled[i])
+            enable(TrackedCaps[i], on);
+    }
+
+    GLint blend[4] = {};
+    glGetIntegerv(GL_BLEND_SRC_RGB, &blend[0]);
+    glGetIntegerv(GL_BLEND_DST_RGB, &blend[1]);
+    glGetIntegerv(GL_BLEND_SRC_ALPHA, &blend[2]);
+    glGetIntegerv(GL_BLEND_DST_ALPHA, &blend[3]);
+    if (!std::equal(blend, blend + 4, fixed.blend)) {
+        if (blend[0] == blend[2] && blend[1] == blend[3])
+            record(BlendFunc, quint32(blend[0]), quint32(blend[1]));
+        else
+            record(BlendFuncSeparate, quint32(blend[0]), quint32(blend[1]), quint32(blend[2]), quint32(blend[3]));
+        std::copy(blend, blend + 4, fixed.blend);
+    }
+
+    GLint func = GL_LESS;
+    glGetIntegerv(GL_DEPTH_FUNC, &func);
+    if (func != fixed.depthFunc)
+        depthFunc(GLenum(func));
+
+    GLboolean mask = GL_TRUE;
+    glGetBooleanv(GL_DEPTH_WRITEMASK, &mask);
+    if (mask != fixed.depthMask)
+        depthMask(mask);
+
+    GLboolean colors[4] = {};
+    glGetBooleanv(GL_COLOR_WRITEMASK, colors);
+    if (!std::equal(colors, colors + 4, fixed.colorMask)) {
+        record(ColorMask, quint8(colors[0]), quint8(colors[1]), quint8(colors[2]), quint8(colors[3]));
+        std::copy(colors, colors + 4, fixed.colorMask);
+    }
+
+    GLfloat clear[4] = {};
+    glGetFloatv(GL_COLOR_CLEAR_VALUE, clear);
+    if (!std::equal(clear, clear + 4, fixed.clearColor))
+        clearColor(clear[0], clear[1], clear[2], clear[3]);
+
+    GLint box[4] = {};
+    glGetIntegerv(GL_SCISSOR_BOX, box);
+    if (!std::equal(box, box + 4, fixed.scissor))
+        scissor(box[0], box[1], box[2], box[3]);
+
+    reconcileViewport();
+}
+
+GLuint &GLTrace::bufferBinding(GLenum target)
+{
+    if (target == GL_ELEMENT_ARRAY_BUFFER)
+        return elementBindings[vertexArray];
+    return bufferBindings[target];
+}
+
+GLenum GLTrace::bindingQuery(GLenum target)
+{
+    switch (target) {
+    case GL_ARRAY_BUFFER: return GL_ARRAY_BUFFER_BINDING;
+    case GL_ELEMENT_ARRAY_BUFFER: return GL_ELEMENT_ARRAY_BUFFER_BINDING;
+    case GL_PIXEL_PACK_BUFFER: return GL_PIXEL_PACK_BUFFER_BINDING;
+    case GL_PIXEL_UNPACK_BUFFER: return GL_PIXEL_UNPACK_BUFFER_BINDING;
+    case GL_DRAW_INDIRECT_BUFFER: return GL_DRAW_INDIRECT_BUFFER_BINDING;
+    case GL_SHADER_STORAGE_BUFFER: return GL_SHADER_STORAGE_BUFFER_BINDING;
+    case GL_UNIFORM_BUFFER: return GL_UNIFORM_BUFFER_BINDING;
+    case GL_COPY_READ_BUFFER: return GL_COPY_READ_BUFFER_BINDING;
+    case GL_COPY_WRITE_BUFFER: return GL_COPY_WRITE_BUFFER_BINDING;
+    default: return 0;
+    }
+}
+
+// ---- 给 GLTraceFunctions 的钩子 ----
+
+void GLTrace::prepareDraw(bool indexed, bool indirect)
+{
+    flushMapped();
+    reconcileFramebuffers();
+    reconcileViewport();
+    reconcileProgram();
+    reconcileVertexArray();
+    if (indexed)
+        reconcileBuffer(GL_ELEMENT_ARRAY_BUFFER);
+    if (indirect)
+        reconcileBuffer(GL_DRAW_INDIRECT_BUFFER);
+}
+
+void GLTrace::prepareClear()
+{
+    reconcileFramebuffers();
+}
+
+void GLTrace::prepareVertexArray()
+{
+    reconcileVertexArray();
+}
+
+void GLTrace::prepareAttributes()
+{
+    reconcileVertexArray();
+    reconcileBuffer(GL_ARRAY_BUFFER);
+}
+
+void GLTrace::prepareBuffer(GLenum target)
+{
+    if (target == GL_ELEMENT_ARRAY_BUFFER)
+        reconcileVertexArray();
+    reconcileBuffer(target);
+}
+
+void GLTrace::prepareTexture2D()
+{
+    reconcileActiveTexture();
+    GLint current = 0;
+    glGetIntegerv(GL_TEXTURE_BINDING_2D, &current);
+    ensureTexture(GLuint(current));
+    GLuint &bound = texture2D[activeTexture];
+    if (bound == GLuint(current))
+        return;
+    record(BindTexture, quint32(GL_TEXTURE_2D), quint32(current));
+    bound = GLuint(current);
+}
+
+void GLTrace::flushMapped()
+{
+    for (Mapping &mapping : mappings)
+        diffMapping(mapping);
+}
+
+void GLTrace::diffMapping(Mapping &mapping)
+{
+    // 按块比较，连续的变了的块合成一条 MappedWrite
+    const qint64 size = qint64(mapping.shadow.size());
+    const char *live = mapping.pointer;
+    char *shadow = mapping.shadow.data();
+    qint64 runStart = -1;
+    for (qint64 block = 0; block < size + MappedBlock; block += MappedBlock) {
+        const qint64 bytes = std::min(MappedBlock, size - block);
+        const bool dirty = bytes > 0 && std::memcmp(live + block, shadow + block, size_t(bytes)) != 0;
+        if (dirty && runStart < 0)
+            runStart = block;
+        if (!dirty && runStart >= 0) {
+            const qint64 end = std::min(block, size);
+            beginRecord(MappedWrite);
+            put(quint32(mapping.buffer));
+            put(qint64(mapping.offset + runStart));
+            put(Blob{live + runStart, end - runStart});
+            std::memcpy(shadow + runStart, live + runStart, size_t(end - runStart));
+            runStart = -1;
+        }
+    }
+}
+
+void GLTrace::bindBuffer(GLenum target, GLuint buffer)
+{
+    if (target == GL_ELEMENT_ARRAY_BUFFER)
+        reconcileVertexArray();
+    record(BindBuffer, quint32(target), Buffer{buffer});
+    bufferBinding(target) = buffer;
+}
+
+void GLTrace::bindBufferRange(GLenum target, GLuint index, GLuint buffer, GLintptr offset, GLsizeiptr size)
+{
+    record(BindBufferRange, quint32(target), quint32(index), Buffer{buffer}, qint64(offset), qint64(size));
+    bufferBinding(target) = buffer;   // 同时改通用绑定点
+}
+
+void GLTrace::bindVertexArray(GLuint vao)
+{
+    record(BindVertexArray, VertexArray{vao});
+    vertexArray = vao;
+}
+
+void GLTrace::useProgram(GLuint name)
+{
+    record(UseProgram, Program{name});
+    program = name;
+}
+
+void GLTrace::bindFramebuffer(GLenum target, GLuint framebuffer)
+{
+    record(BindFramebuffer, quint32(target), Framebuffer{framebuffer});
+    const GLuint mapped = framebuffers.count(framebuffer) ? framebuffer : 0;
+    if (target == GL_FRAMEBUFFER || target == GL_DRAW_FRAMEBUFFER)
+        drawFramebuffer = mapped;
+    if (target == GL_FRAMEBUFFER || target == GL_READ_FRAMEBUFFER)
+        readFramebuffer = mapped;
+}
+
+void GLTrace::bindTexture(GLenum target, GLuint texture)
+{
+    reconcileActiveTexture();
+    record(BindTexture, quint32(target), Texture{texture});
+    if (target == GL_TEXTURE_2D)
+        texture2D[activeTexture] = texture;
+}
+
+void GLTrace::bindTextureUnit(GLuint unit, GLuint texture)
+{
+    record(BindTextureUnit, quint32(unit), Texture{texture});
+    texture2D[GL_TEXTURE0 + unit] = texture;   // 程序里只有 2D 纹理
+}
+
+void GLTrace::enable(GLenum cap, bool enabled)
+{
+    record(enabled ? Enable : Disable, quint32(cap));
+    for (int i = 0; i < 5; ++i) {
+        if (TrackedCaps[i] == cap)
+            fixed.enabled[i] = enabled ? GL_TRUE : GL_FALSE;
+    }
+}
+
+void GLTrace::blendFunc(GLenum source, GLenum destination)
+{
+    record(BlendFunc, quint32(source), quint32(destination));
+    fixed.blend[0] = fixed.blend[2] = GLint(source);
+    fixed.blend[1] = fixed.blend[3] = GLint(destination);
+}
+
+void GLTrace::depthFunc(GLenum func)
+{
+    record(DepthFunc, quint32(func));
+    fixed.depthFunc = GLint(func);
+}
+
+void GLTrace::depthMask(GLboolean flag)
+{
+    record(DepthMask, quint8(flag));
+    fixed.depthMask = flag;
+}
+
+void GLTrace::clearColor(GLfloat r, GLfloat g, GLfloat b, GLfloat a)
+{
+    record(ClearColor, r, g, b, a);
+    const GLfloat color[4] = {r, g, b, a};
+    std::copy(color, color + 4, fixed.clearColor);
+}
+
+void GLTrace::viewport(GLint x, GLint y, GLsizei w, GLsizei h)
+{
+    record(Viewport, qint32(x), qint32(y), qint32(w), qint32(h));
+    const GLint view[4] = {x, y, w, h};
+    std::copy(view, view + 4, fixed.viewport);
+}
+
+void GLTrace::scissor(GLint x, GLint y, GLsizei w, GLsizei h)
+{
+    record(Scissor, qint32(x), qint32(y), qint32(w), qint32(h));
+    const GLint box[4] = {x, y, w, h};
+    std::copy(box, box + 4, fixed.scissor);
+}
+
+void GLTrace::pixelStore(GLenum pname, GLint param)
+{
+    record(PixelStorei, quint32(pname), qint32(param));
+    for (int i = 0; i < 4; ++i) {
+        if (UnpackParameters[i] == pname)
+            unpack[i] = param;
+    }
+}
+
+void GLTrace::created(Op op, GLenum target, GLsizei n, const GLuint *names)
+{
+    beginRecord(op);
+    if (op == CreateTextures)
+        put(quint32(target));
+    put(Names{n, names});
+    for (GLsizei i = 0; i < n; ++i) {
+        if (op == CreateTextures || op == GenTextures)
+            textures[names[i]] = TextureInfo();
+        else if (op == CreateFramebuffers)
+            framebuffers.insert(names[i]);
+    }
+}
+
+void GLTrace::deleted(Op op, GLsizei n, const GLuint *names)
+{
+    beginRecord(op);
+    put(Names{n, names});
+    for (GLsizei i = 0; i < n; ++i) {
+        const GLuint name = names[i];
+        if (op == DeleteTextures) {
+            textures.erase(name);
+            for (auto &binding : texture2D) {
+                if (binding.second == name)
+                    binding.second = 0;   // 删掉的纹理从所有单元上解绑，回放时也一样
+            }
+        } else if (op == DeleteFramebuffers && framebuffers.erase(name)) {
+            // 回放时绑定回到 0，不是目标帧缓冲
+            if (drawFramebuffer == name)
+                drawFramebuffer = ~0u;
+            if (readFramebuffer == name)
+                readFramebuffer = ~0u;
+        }
+    }
+}
+
+void GLTrace::bufferStorage(GLenum target, GLsizeiptr size, const void *data, GLbitfield flags)
+{
+    prepareBuffer(target);
+    beginRecord(BufferStorage);
+    put(quint32(target));
+    put(qint64(size));
+    put(Blob{data, data ? qint64(size) : 0});
+    put(quint32(flags));
+    const GLuint name = bufferBinding(target);
+    if (name && name != ~0u)
+        buffers[name].size = size;
+}
+
+void GLTrace::mapBufferRange(GLenum target, GLintptr offset, GLsizeiptr length, GLbitfield access, void *pointer)
+{
+    const GLuint name = bufferBinding(target);
+    if (!pointer || !name || name == ~0u)
+        return;
+    beginRecord(MapBufferRange);
+    put(quint32(target));
+    put(qint64(offset));
+    put(qint64(length));
+    put(quint32(access));
+    if (!(access & GL_MAP_WRITE_BIT))
+        return;
+    // 回放时映射以后清零，影子副本从 0 开始：映射时里面已有的非零内容马上记一次
+    Mapping mapping;
+    mapping.buffer = name;
+    mapping.offset = offset;
+    mapping.pointer = static_cast<char *>(pointer);
+    mapping.shadow.assign(size_t(length), 0);
+    mappings.push_back(std::move(mapping));
+    diffMapping(mappings.back());
+}
+
+void GLTrace::unmapBuffer(GLenum target)
+{
+    prepareBuffer(target);
+    const GLuint name = bufferBinding(target);
+    for (auto it = mappings.begin(); it != mappings.end();) {
+        if (it->buffer == name) {
+            diffMapping(*it);
+            it = mappings.erase(it);
+        } else {
+            ++it;
+        }
+    }
+    record(UnmapBuffer, quint32(target));
+}
+
+void GLTrace::fenceSync(GLsync sync, GLenum condition, GLbitfield flags)
+{
+    if (!sync)
+        return;
+    record(FenceSync, syncId(sync), quint32(condition), quint32(flags));
+    syncs.insert(syncId(sync));
+}
+
+void GLTrace::clientWaitSync(GLsync sync, GLbitfield flags, GLuint64 timeout)
+{
+    if (!syncs.count(syncId(sync))) {
+        ++counters.dropped;   // 别的上下文（上传线程）创建的 fence
+        return;
+    }
+    record(ClientWaitSync, syncId(sync), quint32(flags), quint64(timeout));
+}
+
+void GLTrace::deleteSync(GLsync sync)
+{
+    if (!syncs.erase(syncId(sync)))
+        return;
+    record(DeleteSync, syncId(sync));
+}
+
+void GLTrace::texImage2D(GLenum target, GLint level, GLint internalFormat, GLsizei width, GLsizei height,
+                         GLint border, GLenum format, GLenum type, const void *pixels)
+{
+    flushMapped();
+    prepareTexture2D();
+    reconcileUnpack();
+    record(TexImage2D, quint32(target), qint32(level), qint32(internalFormat), qint32(width), qint32(height),
+           qint32(border), quint32(format), quint32(type));
+    putPixels(width, height, format, type, pixels);
+}
+
+void GLTrace::textureSubImage2D(GLuint texture, GLint level, GLint x, GLint y, GLsizei width, GLsizei height,
+                                GLenum format, GLenum type, const void *pixels)
+{
+    flushMapped();
+    reconcileUnpack();
+    record(TextureSubImage2D, Texture{texture}, qint32(level), qint32(x), qint32(y), qint32(width),
+           qint32(height), quint32(format), quint32(type));
+    putPixels(width, height, format, type, pixels);
+}
+
+// ---- 格式 ----
+
+int GLTrace::pixelSize(GLenum format, GLenum type)
+{
+    switch (type) {
+    case GL_UNSIGNED_INT_8_8_8_8: case GL_UNSIGNED_INT_8_8_8_8_REV:
+    case GL_UNSIGNED_INT_2_10_10_10_REV: case GL_UNSIGNED_INT_24_8:
+        return 4;
+    case GL_UNSIGNED_SHORT_5_6_5: case GL_UNSIGNED_SHORT_4_4_4_4: case GL_UNSIGNED_SHORT_5_5_5_1:
+        return 2;
+    default:
+        break;
+    }
+    int components = 0;
+    switch (format) {
+    case GL_RED: case GL_RED_INTEGER: case GL_DEPTH_COMPONENT: case GL_STENCIL_INDEX: components = 1; break;
+    case GL_RG: case GL_RG_INTEGER: components = 2; break;
+    case GL_RGB: case GL_BGR: case GL_RGB_INTEGER: components = 3; break;
+    case GL_RGBA: case GL_BGRA: case GL_RGBA_INTEGER: components = 4; break;
+    default: return 0;
+    }
+    switch (type) {
+    case GL_UNSIGNED_BYTE: case GL_BYTE: return components;
+    case GL_UNSIGNED_SHORT: case GL_SHORT: case GL_HALF_FLOAT: return components * 2;
+    case GL_UNSIGNED_INT: case GL_INT: case GL_FLOAT: return components * 4;
+    default: return 0;
+    }
+}
+
+int GLTrace::uniformComponents(GLenum type, int *baseType)
+{
+    *baseType = 0;
+    switch (type) {
+    case GL_FLOAT: return 1;
+    case GL_FLOAT_VEC2: return 2;
+    case GL_FLOAT_VEC3: return 3;
+    case GL_FLOAT_VEC4: case GL_FLOAT_MAT2: return 4;
+    case GL_FLOAT_MAT2x3: case GL_FLOAT_MAT3x2: return 6;
+    case GL_FLOAT_MAT2x4: case GL_FLOAT_MAT4x2: return 8;
+    case GL_FLOAT_MAT3: return 9;
+    case GL_FLOAT_MAT3x4: case GL_FLOAT_MAT4x3: return 12;
+    case GL_FLOAT_MAT4: return 16;
+    case GL_DOUBLE: case GL_DOUBLE_VEC2: case GL_DOUBLE_VEC3: case GL_DOUBLE_VEC4:
+    case GL_DOUBLE_MAT2: case GL_DOUBLE_MAT3: case GL_DOUBLE_MAT4:
+    case GL_DOUBLE_MAT2x3: case GL_DOUBLE_MAT2x4: case GL_DOUBLE_MAT3x2:
+    case GL_DOUBLE_MAT3x4: case GL_DOUBLE_MAT4x2: case GL_DOUBLE_MAT4x3:
+        return 0;
+    case GL_UNSIGNED_INT: *baseType = 2; return 1;
+    case GL_UNSIGNED_INT_VEC2: *baseType = 2; return 2;
+    case GL_UNSIGNED_INT_VEC3: *baseType = 2; return 3;
+    case GL_UNSIGNED_INT_VEC4: *baseType = 2; return 4;
+    case GL_INT_VEC2: case GL_BOOL_VEC2: *baseType = 1; return 2;
+    case GL_INT_VEC3: case GL_BOOL_VEC3: *baseType = 1; return 3;
+    case GL_INT_VEC4: case GL_BOOL_VEC4: *baseType = 1; return 4;
+    default:
+        // int、bool、各种 sampler/image：一个 int
+        *baseType = 1;
+        return 1;
+    }
+}
@@ -0,0 +1,349 @@
+#ifndef GLTRACE_H
+#define GLTRACE_H
+
+#include <QOpenGLFunctions_4_5_Core>
+#include <QOpenGLContext>
+#include <QByteArray>
+#include <QFile>
+#include <QString>
+#include <atomic>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+/* GLTrace：把 Renderer 发出的 GL 调用录成一个紧凑的二进制文件，用 benchmark/glreplay（GLReplay）离线原样重放
+ *
+ * 录的是经过 GLTraceFunctions 的调用（Renderer 和它用到的各个类都从它派生）：每个调用记下参数和它用到的数据
+ * （glNamedBufferSubData、glTextureSubImage2D 的内容），持久映射的缓冲在每次绘制/拷贝/上传之前和影子副本比较，
+ * 只记 CPU 写过、变了的字节。
+ *
+ * 不经过 GLTraceFunctions 的调用（QOpenGLBuffer/QOpenGLShaderProgram/QOpenGLVertexArrayObject 内部、
+ * 后台上传线程、QPainter、调用方自己的代码）录不到，用两个办法补上：
+ *   - 外来对象：录到的调用第一次用到一个不是在录制期间创建的缓冲/纹理/VAO/程序时，从 GL 读出它当时的状态和内容，
+ *     记一条快照（程序记源码，没有源码时记驱动的二进制）。Qt 悄悄删掉再建、名字被重用的缓冲和纹理按大小认出来
+ *   - 隐式状态：依赖当前绑定的调用（绘制、glVertexAttribPointer、glBufferStorage、纹理上传……）之前查一下真实的绑定、
+ *     当前程序的 uniform 和视口，和 trace 里的对不上时补一条对应的调用；混合、深度等开关每帧开始时对一次
+ * 所以 trace 里的调用比程序发出的多一些（快照、补上的绑定、glProgramUniform*），GLReplay 分开统计。
+ *
+ * 不是录制期间创建的帧缓冲（窗口的、QOpenGLFramebufferObject）都当成 "目标"，回放时换成 GLReplay 自己的帧缓冲。
+ * 只录开始录制的那个上下文里的调用。录制时每个调用多几次 glGet*，快照还要读回整个对象，录制时的帧时间没有参考价值。
+ *
+ * 文件格式：8 字节 "GLTRACE\0"、4 字节版本号，然后一条接一条的记录：1 字节 Op + 这个 Op 固定的参数（本机字节序，
+ * 都是小端的机器），数据块是 4 字节长度 + 内容。Op 只能往后加，改了任何一条的参数要加 Version。
+ */
+class GLTrace : protected QOpenGLFunctions_4_5_Core
+{
+public:
+    enum Op : quint8
+    {
+        // trace 自己的记录
+        BeginFrame,            // 视口宽、高
+        EndFrame,
+        SnapshotBuffer,        // 外来对象的快照
+        SnapshotTexture,
+        SnapshotVertexArray,
+        SnapshotProgram,
+        Release,               // 外来对象已经不在了（名字被重用），回放时删掉
+        Uniform,               // 程序的一个 uniform 变了，回放时 glProgramUniform*
+        MappedWrite,           // CPU 往映射的缓冲里写的一段
+        // GL 调用，按名字排序
+        ActiveTexture,
+        BindBuffer,
+        BindBufferRange,
+        BindFramebuffer,
+        BindTexture,
+        BindTextureUnit,
+        BindVertexArray,
+        BlendFunc,
+        BlendFuncSeparate,
+        BufferStorage,
+        CheckNamedFramebufferStatus,
+        Clear,
+        ClearColor,
+        ClearNamedFramebufferfv,
+        ClientWaitSync,
+        ColorMask,
+        CopyImageSubData,
+        CopyNamedBufferSubData,
+        CreateFramebuffers,
+        CreateRenderbuffers,
+        CreateTextures,
+        DeleteFramebuffers,
+        DeleteQueries,
+        DeleteRenderbuffers,
+        DeleteSync,
+        DeleteTextures,
+        DepthFunc,
+        DepthMask,
+        Disable,
+        DrawArraysInstancedBaseInstance,
+        DrawElementsBaseVertex,
+        DrawElementsInstancedBaseInstance,
+        Enable,
+        EnableVertexAttribArray,
+        FenceSync,
+        Finish,
+        GenQueries,
+        GenTextures,
+        GenerateTextureMipmap,
+        GetInteger64v,
+        GetIntegerv,
+        GetQueryObjectiv,
+        GetQueryObjectui64v,
+        GetTextureLevelParameteriv,
+        MapBufferRange,
+        MultiDrawElementsIndirect,
+        NamedBufferSubData,
+        NamedFramebufferRenderbuffer,
+        NamedFramebufferTexture,
+        NamedRenderbufferStorage,
+        PixelStorei,
+        QueryCounter,
+        Scissor,
+        TexImage2D,
+        TexParameteri,
+        TextureParameteri,
+        TextureStorage2D,
+        TextureSubImage2D,
+        UnmapBuffer,
+        UseProgram,
+        VertexAttribDivisor,
+        VertexAttribPointer,
+        Viewport,
+        OpCount
+    };
+
+    // Release 的对象种类
+    enum Kind : quint8 { BufferKind, TextureKind, VertexArrayKind, ProgramKind };
+
+    // 纹理上传的数据从哪来
+    enum PixelSource : quint8 { NoPixels, ClientPixels, UnpackBufferPixels };
+
+    static const char Magic[8];
+    static const quint32 Version = 1;
+
+    // 参数里的对象名按类型包一层：录制时据此检查外来对象，回放时换成回放里的名字
+    struct Buffer { GLuint name; };
+    struct Texture { GLuint name; };
+    struct VertexArray { GLuint name; };
+    struct Program { GLuint name; };
+    struct Framebuffer { GLuint name; };   // 不是录制期间创建的写成 0（目标）
+    struct Renderbuffer { GLuint name; };
+    struct Query { GLuint name; };
+    struct Names { GLsizei count; const GLuint *names; };
+    struct Blob { const void *data; qint64 size; };
+
+    struct Stats
+    {
+        int frames = 0;
+        qint64 records = 0;
+        qint64 bytes = 0;      // 写进文件的字节数
+        int snapshots = 0;     // 外来对象的快照
+        int dropped = 0;       // 回放不了、没录的调用（别的上下文的 fence、不支持的纹理类型）
+    };
+
+    GLTrace();
+    ~GLTrace();
+
+    bool start(const QString &path);   // 上下文必须是当前上下文，同一时间只能有一个在录
+    void stop();                       // 写完文件，上下文必须还是录制的那个
+    bool isRecording() const { return file.isOpen(); }
+    QString fileName() const { return file.fileName(); }
+    void beginFrame();
+    void endFrame();
+    const Stats &stats() const { return counters; }
+
+    static const char *opName(int op);
+
+    // 正在录、而且当前上下文就是录制的上下文时返回录制器，GLTraceFunctions 的每个调用先问它
+    static GLTrace *active()
+    {
+        GLTrace *trace = recorder.load(std::memory_order_relaxed);
+        return trace && QOpenGLContext::currentContext() == trace->context ? trace : nullptr;
+    }
+
+    // ---- 以下给 GLTraceFunctions 用 ----
+
+    // 一条普通的调用记录：先处理参数里的外来对象（可能先插进快照），再写 Op 和参数
+    template <typename... Args>
+    void record(Op op, const Args &...args)
+    {
+        (prepare(args), ...);
+        beginRecord(op);
+        (put(args), ...);
+    }
+
+    // 调用之前把它依赖的隐式状态对上
+    void prepareDraw(bool indexed, bool indirect);
+    void prepareClear();
+    void prepareVertexArray();            // glEnableVertexAttribArray/glVertexAttribDivisor：当前 VAO
+    void prepareAttributes();             // glVertexAttribPointer：当前 VAO 和 GL_ARRAY_BUFFER
+    void prepareBuffer(GLenum target);    // glBufferStorage/glMapBufferRange/glUnmapBuffer：target 上绑的缓冲
+    void prepareTexture2D();              // glTexParameteri/glTexImage2D：当前纹理单元上的 GL_TEXTURE_2D
+    void flushMapped();                   // 映射内存里变了的部分记成 MappedWrite
+
+    // 改状态的调用：记录的同时更新 trace 里的状态
+    void bindBuffer(GLenum target, GLuint buffer);
+    void bindBufferRange(GLenum target, GLuint index, GLuint buffer, GLintptr offset, GLsizeiptr size);
+    void bindVertexArray(GLuint vao);
+    void useProgram(GLuint program);
+    void bindFramebuffer(GLenum target, GLuint framebuffer);
+    void bindTexture(GLenum target, GLuint texture);
+    void bindTextureUnit(GLuint unit, GLuint texture);
+    void enable(GLenum cap, bool enabled);
+    void blendFunc(GLenum source, GLenum destination);
+    void depthFunc(GLenum func);
+    void depthMask(GLboolean flag);
+    void clearColor(GLfloat r, GLfloat g, GLfloat b, GLfloat a);
+    void viewport(GLint x, GLint y, GLsizei w, GLsizei h);
+    void scissor(GLint x, GLint y, GLsizei w, GLsizei h);
+    void pixelStore(GLenum pname, GLint param);
+
+    // 创建/删除对象（创建在真正调用之后）
+    void created(Op op, GLenum target, GLsizei n, const GLuint *names);
+    void deleted(Op op, GLsizei n, const GLuint *names);
+
+    void bufferStorage(GLenum target, GLsizeiptr size, const void *data, GLbitfield flags);
+    void mapBufferRange(GLenum target, GLintptr offset, GLsizeiptr length, GLbitfield access, void *pointer);
+    void unmapBuffer(GLenum target);
+    void fenceSync(GLsync sync, GLenum condition, GLbitfield flags);
+    void clientWaitSync(GLsync sync, GLbitfield flags, GLuint64 timeout);
+    void deleteSync(GLsync sync);
+    void texImage2D(GLenum target, GLint level, GLint internalFormat, GLsizei width, GLsizei height, GLint border,
+                    GLenum format, GLenum type, const void *pixels);
+    void textureSubImage2D(GLuint texture, GLint level, GLint x, GLint y, GLsizei width, GLsizei height,
+                           GLenum format, GLenum type, const void *pixels);
+
+    // 每个像素的字节数，不认识的格式/类型返回 0
+    static int pixelSize(GLenum format, GLenum type);
+    // uniform 类型的分量个数和基本类型（0 = float，1 = int，2 = uint），不支持的（double）返回 0 个分量
+    static int uniformComponents(GLenum type, int *baseType);
+    // 缓冲 target 对应的 glGetIntegerv 绑定查询（GL_ARRAY_BUFFER -> GL_ARRAY_BUFFER_BINDING），不认识的返回 0
+    static GLenum bindingQuery(GLenum target);
+
+private:
+    struct BufferInfo
+    {
+        qint64 size = 0;
+    };
+    struct TextureInfo
+    {
+        bool foreign = false;
+        GLint width = 0;
+        GLint height = 0;
+        GLint internalFormat = 0;
+    };
+    struct UniformInfo
+    {
+        GLenum type = 0;
+        int components = 0;
+        int baseType = 0;
+        std::vector<GLint> locations;             // 每个数组元素一个
+        std::vector<QByteArray> values;           // trace 里现在的值，空 = 还没记过
+    };
+    struct ProgramInfo
+    {
+        std::vector<UniformInfo> uniforms;
+    };
+    struct Mapping
+    {
+        GLuint buffer = 0;
+        qint64 offset = 0;
+        char *pointer = nullptr;
+        std::vector<char> shadow;                 // 上次记下来的内容
+    };
+    // trace 里的固定功能状态（回放时的状态），每帧开始和真实的状态对一遍
+    struct FixedState
+    {
+        GLboolean enabled[5] = {};                // TrackedCaps 的顺序
+        GLint blend[4] = {GL_ONE, GL_ZERO, GL_ONE, GL_ZERO};   // src rgb, dst rgb, src alpha, dst alpha
+        GLint depthFunc = GL_LESS;
+        GLboolean depthMask = GL_TRUE;
+        GLboolean colorMask[4] = {GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE};
+        GLfloat clearColor[4] = {};
+        GLint scissor[4] = {-1, -1, -1, -1};     // -1 = 不知道，第一次对的时候一定补上
+        GLint viewport[4] = {-1, -1, -1, -1};
+    };
+
+    static std::atomic<GLTrace *> recorder;
+
+    void beginRecord(Op op);
+    void append(const void *data, qint64 size);
+    void flushFile(bool force);
+
+    void put(quint8 v) { append(&v, sizeof(v)); }
+    void put(qint32 v) { append(&v, sizeof(v)); }
+    void put(quint32 v) { append(&v, sizeof(v)); }
+    void put(float v) { append(&v, sizeof(v)); }
+    void put(qint64 v) { append(&v, sizeof(v)); }
+    void put(quint64 v) { append(&v, sizeof(v)); }
+    void put(Buffer b) { put(quint32(b.name)); }
+    void put(Texture t) { put(quint32(t.name)); }
+    void put(VertexArray v) { put(quint32(v.name)); }
+    void put(Program p) { put(quint32(p.name)); }
+    void put(Framebuffer f) { put(quint32(framebuffers.count(f.name) ? f.name : 0)); }
+    void put(Renderbuffer r) { put(quint32(r.name)); }
+    void put(Query q) { put(quint32(q.name)); }
+    void put(Names n);
+    void put(Blob b);
+    void putPixels(GLsizei width, GLsizei height, GLenum format, GLenum type, const void *pixels);
+
+    template <typename T>
+    void prepare(const T &) {}
+    void prepare(Buffer b) { ensureBuffer(b.name); }
+    void prepare(Texture t) { ensureTexture(t.name); }
+    void prepare(VertexArray v) { ensureVertexArray(v.name); }
+    void prepare(Program p) { ensureProgram(p.name); }
+
+    // 外来对象：不认识就记快照
+    void ensureBuffer(GLuint name);
+    void ensureTexture(GLuint name);
+    void ensureVertexArray(GLuint name);
+    void ensureProgram(GLuint name);
+    void snapshotBuffer(GLuint name);
+    void snapshotTexture(GLuint name);
+    void snapshotVertexArray(GLuint name);
+    void snapshotProgram(GLuint name);
+
+    // 隐式状态：和真实的对一下，不一样就补一条调用
+    void reconcileFramebuffers();
+    void reconcileViewport();
+    void reconcileProgram();
+    void reconcileUniforms(GLuint program);
+    void reconcileVertexArray();
+    void reconcileBuffer(GLenum target);
+    void reconcileUnpack();
+    void reconcileActiveTexture();
+    void reconcileFixedState();
+    GLuint &bufferBinding(GLenum target);   // trace 里 target 上绑的缓冲，GL_ELEMENT_ARRAY_BUFFER 是当前 VAO 的
+    void forgetBuffer(GLuint name);         // Release 之后，trace 里绑着它的地方都变成不知道
+    void diffMapping(Mapping &mapping);
+
+    QOpenGLContext *context;
+    QFile file;
+    QByteArray pending;                     // 攒够了再写文件
+    Stats counters;
+
+    // 已经在 trace 里的对象
+    std::unordered_map<GLuint, BufferInfo> buffers;     // 缓冲都是 Qt 创建的外来对象
+    std::unordered_map<GLuint, TextureInfo> textures;
+    std::unordered_set<GLuint> vertexArrays;
+    std::unordered_map<GLuint, ProgramInfo> programs;
+    std::unordered_set<GLuint> framebuffers;            // 录制期间创建的，其余的都是目标
+    std::unordered_set<quint64> syncs;                  // 录到的 glFenceSync
+    std::vector<Mapping> mappings;
+
+    // trace 里现在的绑定（回放时的绑定）。~0u = 不知道，下次用到时一定补一条
+    std::unordered_map<GLenum, GLuint> bufferBindings;
+    std::unordered_map<GLuint, GLuint> elementBindings; // 每个 VAO 自己的 GL_ELEMENT_ARRAY_BUFFER
+    GLuint vertexArray;
+    GLuint program;
+    GLuint drawFramebuffer;
+    GLuint readFramebuffer;
+    GLenum activeTexture;
+    std::unordered_map<GLenum, GLuint> texture2D;       // 每个纹理单元上的 GL_TEXTURE_2D
+    GLint unpack[4];                                    // UnpackParameters 的顺序
+    FixedState fixed;
+};
+
+#endif // GLTRACE_H
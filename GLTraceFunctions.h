@@ -0,0 +1,502 @@
+#ifndef GLTRACEFUNCTIONS_H
+#define GLTRACEFUNCTIONS_H
+
+#include <QOpenGLFunctions_4_5_Core>
+#include "GLTrace.h"
+
+/* GLTraceFunctions：QOpenGLFunctions_4_5_Core 加上 GL 调用录制
+ *
+ * Renderer 和它用到的类（GLStateCache、StreamBuffer、IndirectBatch……）从它派生，下面这些调用遮住基类的同名函数：
+ * 有 GLTrace 在录、当前上下文又是录制的那个时先记一条（GLTrace::active()），再调真正的函数；没在录时只多一次
+ * 原子读。创建对象、有返回值的调用在真正调用之后记。没列出来的函数照样直接用基类的，不进 trace。
+ *
+ * 只在类自己里面、或者通过 GLTraceFunctions 指针调用才会被录（VertexFormat::setupAttributes 就是这样），
+ * 转成 QOpenGLFunctions_4_5_Core * 以后调用的就是基类的版本了。新用到一个 GL 调用时要在这里和 GLTrace::Op 里都加上。
+ */
+class GLTraceFunctions : public QOpenGLFunctions_4_5_Core
+{
+public:
+    void glBindBuffer(GLenum target, GLuint buffer)
+    {
+        if (GLTrace *trace = GLTrace::active())
+            trace->bindBuffer(target, buffer);
+        QOpenGLFunctions_4_5_Core::glBindBuffer(target, buffer);
+    }
+
+    void glBindBufferRange(GLenum target, GLuint index, GLuint buffer, GLintptr offset, GLsizeiptr size)
+    {
+        if (GLTrace *trace = GLTrace::active())
+            trace->bindBufferRange(target, index, buffer, offset, size);
+        QOpenGLFunctions_4_5_Core::glBindBufferRange(target, index, buffer, offset, size);
+    }
+
+    void glBindFramebuffer(GLenum target, GLuint framebuffer)
+    {
+        if (GLTrace *trace = GLTrace::active())
+            trace->bindFramebuffer(target, framebuffer);
+        QOpenGLFunctions_4_5_Core::glBindFramebuffer(target, framebuffer);
+    }
+
+    void glBindTexture(GLenum target, GLuint texture)
+    {
+        if (GLTrace *trace = GLTrace::active())
+            trace->bindTexture(target, texture);
+        QOpenGLFunctions_4_5_Core::glBindTexture(target, texture);
+    }
+
+    void glBindTextureUnit(GLuint unit, GLuint texture)
+    {
+        if (GLTrace *trace = GLTrace::active())
+            trace->bindTextureUnit(unit, texture);
+        QOpenGLFunctions_4_5_Core::glBindTextureUnit(unit, texture);
+    }
+
+    void glBindVertexArray(GLuint array)
+    {
+        if (GLTrace *trace = GLTrace::active())
+            trace->bindVertexArray(array);
+        QOpenGLFunctions_4_5_Core::glBindVertexArray(array);
+    }
+
+    void glBlendFunc(GLenum sfactor, GLenum dfactor)
+    {
+        if (GLTrace *trace = GLTrace::active())
+            trace->blendFunc(sfactor, dfactor);
+        QOpenGLFunctions_4_5_Core::glBlendFunc(sfactor, dfactor);
+    }
+
+    void glBufferStorage(GLenum target, GLsizeiptr size, const void *data, GLbitfield flags)
+    {
+        if (GLTrace *trace = GLTrace::active())
+            trace->bufferStorage(target, size, data, flags);
+        QOpenGLFunctions_4_5_Core::glBufferStorage(target, size, data, flags);
+    }
+
+    GLenum glCheckNamedFramebufferStatus(GLuint framebuffer, GLenum target)
+    {
+        if (GLTrace *trace = GLTrace::active())
+            trace->record(GLTrace::CheckNamedFramebufferStatus, GLTrace::Framebuffer{framebuffer}, quint32(target));
+        return QOpenGLFunctions_4_5_Core::glCheckNamedFramebufferStatus(framebuffer, target);
+    }
+
+    void glClear(GLbitfield mask)
+    {
+        if (GLTrace *trace = GLTrace::active()) {
+            trace->prepareClear();
+            trace->record(GLTrace::Clear, quint32(mask));
+        }
+        QOpenGLFunctions_4_5_Core::glClear(mask);
+    }
+
+    void glClearColor(GLfloat red, GLfloat green, GLfloat blue, GLfloat alpha)
+    {
+        if (GLTrace *trace = GLTrace::active())
+            trace->clearColor(red, green, blue, alpha);
+        QOpenGLFunctions_4_5_Core::glClearColor(red, green, blue, alpha);
+    }
+
+    void glClearNamedFramebufferfv(GLuint framebuffer, GLenum buffer, GLint drawbuffer, const GLfloat *value)
+    {
+        if (GLTrace *trace = GLTrace::active())
+            trace->record(GLTrace::ClearNamedFramebufferfv, GLTrace::Framebuffer{framebuffer},
+                          quint32(buffer), qint32(drawbuffer),
+                          GLTrace::Blob{value, qint64(sizeof(GLfloat)) * (buffer == GL_COLOR ? 4 : 1)});
+        QOpenGLFunctions_4_5_Core::glClearNamedFramebufferfv(framebuffer, buffer, drawbuffer, value);
+    }
+
+    GLenum glClientWaitSync(GLsync sync, GLbitfield flags, GLuint64 timeout)
+    {
+        if (GLTrace *trace = GLTrace::active())
+            trace->clientWaitSync(sync, flags, timeout);
+        return QOpenGLFunctions_4_5_Core::glClientWaitSync(sync, flags, timeout);
+    }
+
+    void glCopyImageSubData(GLuint srcName, GLenum srcTarget, GLint srcLevel, GLint srcX, GLint srcY, GLint srcZ,
+                            GLuint dstName, GLenum dstTarget, GLint dstLevel, GLint dstX, GLint dstY, GLint dstZ,
+                            GLsizei srcWidth, GLsizei srcHeight, GLsizei srcDepth)
+    {
+        if (GLTrace *trace = GLTrace::active()) {
+            trace->flushMapped();
+            trace->record(GLTrace::CopyImageSubData, GLTrace::Texture{srcName}, quint32(srcTarget), qint32(srcLevel),
+                          qint32(srcX), qint32(srcY), qint32(srcZ), GLTrace::Texture{dstName}, quint32(dstTarget),
+                          qint32(dstLevel), qint32(dstX), qint32(dstY), qint32(dstZ), qint32(srcWidth),
+                          qint32(srcHeight), qint32(srcDepth));
+        }
+        QOpenGLFunctions_4_5_Core::glCopyImageSubData(srcName, srcTarget, srcLevel, srcX, srcY, srcZ, dstName,
+                                                      dstTarget, dstLevel, dstX, dstY, dstZ, srcWidth, srcHeight,
+                                                      srcDepth);
+    }
+
+    void glCopyNamedBufferSubData(GLuint readBuffer, GLuint writeBuffer, GLintptr readOffset, GLintptr writeOffset,
+                                  GLsizeiptr size)
+    {
+        if (GLTrace *trace = GLTrace::active()) {
+            trace->flushMapped();
+            trace->record(GLTrace::CopyNamedBufferSubData, GLTrace::Buffer{readBuffer}, GLTrace::Buffer{writeBuffer},
+                          qint64(readOffset), qint64(writeOffset), qint64(size));
+        }
+        QOpenGLFunctions_4_5_Core::glCopyNamedBufferSubData(readBuffer, writeBuffer, readOffset, writeOffset, size);
+    }
+
+    void glCreateFramebuffers(GLsizei n, GLuint *framebuffers)
+    {
+        QOpenGLFunctions_4_5_Core::glCreateFramebuffers(n, framebuffers);
+        if (GLTrace *trace = GLTrace::active())
+            trace->created(GLTrace::CreateFramebuffers, 0, n, framebuffers);
+    }
+
+    void glCreateRenderbuffers(GLsizei n, GLuint *renderbuffers)
+    {
+        QOpenGLFunctions_4_5_Core::glCreateRenderbuffers(n, renderbuffers);
+        if (GLTrace *trace = GLTrace::active())
+            trace->created(GLTrace::CreateRenderbuffers, 0, n, renderbuffers);
+    }
+
+    void glCreateTextures(GLenum target, GLsizei n, GLuint *textures)
+    {
+        QOpenGLFunctions_4_5_Core::glCreateTextures(target, n, textures);
+        if (GLTrace *trace = GLTrace::active())
+            trace->created(GLTrace::CreateTextures, target, n, textures);
+    }
+
+    void glDeleteFramebuffers(GLsizei n, const GLuint *framebuffers)
+    {
+        if (GLTrace *trace = GLTrace::active())
+            trace->deleted(GLTrace::DeleteFramebuffers, n, framebuffers);
+        QOpenGLFunctions_4_5_Core::glDeleteFramebuffers(n, framebuffers);
+    }
+
+    void glDeleteQueries(GLsizei n, const GLuint *ids)
+    {
+        if (GLTrace *trace = GLTrace::active())
+            trace->deleted(GLTrace::DeleteQueries, n, ids);
+        QOpenGLFunctions_4_5_Core::glDeleteQueries(n, ids);
+    }
+
+    void glDeleteRenderbuffers(GLsizei n, const GLuint *renderbuffers)
+    {
+        if (GLTrace *trace = GLTrace::active())
+            trace->deleted(GLTrace::DeleteRenderbuffers, n, renderbuffers);
+        QOpenGLFunctions_4_5_Core::glDeleteRenderbuffers(n, renderbuffers);
+    }
+
+    void glDeleteSync(GLsync sync)
+    {
+        if (GLTrace *trace = GLTrace::active())
+            trace->deleteSync(sync);
+        QOpenGLFunctions_4_5_Core::glDeleteSync(sync);
+    }
+
+    void glDeleteTextures(GLsizei n, const GLuint *textures)
+    {
+        if (GLTrace *trace = GLTrace::active())
+            trace->deleted(GLTrace::DeleteTextures, n, textures);
+        QOpenGLFunctions_4_5_Core::glDeleteTextures(n, textures);
+    }
+
+    void glDepthFunc(GLenum func)
+    {
+        if (GLTrace *trace = GLTrace::active())
+            trace->depthFunc(func);
+        QOpenGLFunctions_4_5_Core::glDepthFunc(func);
+    }
+
+    void glDepthMask(GLboolean flag)
+    {
+        if (GLTrace *trace = GLTrace::active())
+            trace->depthMask(flag);
+        QOpenGLFunctions_4_5_Core::glDepthMask(flag);
+    }
+
+    void glDisable(GLenum cap)
+    {
+        if (GLTrace *trace = GLTrace::active())
+            trace->enable(cap, false);
+        QOpenGLFunctions_4_5_Core::glDisable(cap);
+    }
+
+    void glDrawArraysInstancedBaseInstance(GLenum mode, GLint first, GLsizei count, GLsizei instancecount,
+                                           GLuint baseinstance)
+    {
+        if (GLTrace *trace = GLTrace::active()) {
+            trace->prepareDraw(false, false);
+            trace->record(GLTrace::DrawArraysInstancedBaseInstance, quint32(mode), qint32(first), qint32(count),
+                          qint32(instancecount), quint32(baseinstance));
+        }
+        QOpenGLFunctions_4_5_Core::glDrawArraysInstancedBaseInstance(mode, first, count, instancecount, baseinstance);
+    }
+
+    void glDrawElementsBaseVertex(GLenum mode, GLsizei count, GLenum type, const void *indices, GLint basevertex)
+    {
+        if (GLTrace *trace = GLTrace::active()) {
+            trace->prepareDraw(true, false);
+            trace->record(GLTrace::DrawElementsBaseVertex, quint32(mode), qint32(count), quint32(type),
+                          pointerOffset(indices), qint32(basevertex));
+        }
+        QOpenGLFunctions_4_5_Core::glDrawElementsBaseVertex(mode, count, type, indices, basevertex);
+    }
+
+    void glDrawElementsInstancedBaseInstance(GLenum mode, GLsizei count, GLenum type, const void *indices,
+                                             GLsizei instancecount, GLuint baseinstance)
+    {
+        if (GLTrace *trace = GLTrace::active()) {
+            trace->prepareDraw(true, false);
+            trace->record(GLTrace::DrawElementsInstancedBaseInstance, quint32(mode), qint32(count), quint32(type),
+                          pointerOffset(indices), qint32(instancecount), quint32(baseinstance));
+        }
+        QOpenGLFunctions_4_5_Core::glDrawElementsInstancedBaseInstance(mode, count, type, indices, instancecount,
+                                                                       baseinstance);
+    }
+
+    void glEnable(GLenum cap)
+    {
+        if (GLTrace *trace = GLTrace::active())
+            trace->enable(cap, true);
+        QOpenGLFunctions_4_5_Core::glEnable(cap);
+    }
+
+    void glEnableVertexAttribArray(GLuint index)
+    {
+        if (GLTrace *trace = GLTrace::active()) {
+            trace->prepareVertexArray();
+            trace->record(GLTrace::EnableVertexAttribArray, quint32(index));
+        }
+        QOpenGLFunctions_4_5_Core::glEnableVertexAttribArray(index);
+    }
+
+    GLsync glFenceSync(GLenum condition, GLbitfield flags)
+    {
+        GLsync result = QOpenGLFunctions_4_5_Core::glFenceSync(condition, flags);
+        if (GLTrace *trace = GLTrace::active())
+            trace->fenceSync(result, condition, flags);
+        return result;
+    }
+
+    void glFinish()
+    {
+        if (GLTrace *trace = GLTrace::active())
+            trace->record(GLTrace::Finish);
+        QOpenGLFunctions_4_5_Core::glFinish();
+    }
+
+    void glGenQueries(GLsizei n, GLuint *ids)
+    {
+        QOpenGLFunctions_4_5_Core::glGenQueries(n, ids);
+        if (GLTrace *trace = GLTrace::active())
+            trace->created(GLTrace::GenQueries, 0, n, ids);
+    }
+
+    void glGenTextures(GLsizei n, GLuint *textures)
+    {
+        QOpenGLFunctions_4_5_Core::glGenTextures(n, textures);
+        if (GLTrace *trace = GLTrace::active())
+            trace->created(GLTrace::GenTextures, 0, n, textures);
+    }
+
+    void glGenerateTextureMipmap(GLuint texture)
+    {
+        if (GLTrace *trace = GLTrace::active())
+            trace->record(GLTrace::GenerateTextureMipmap, GLTrace::Texture{texture});
+        QOpenGLFunctions_4_5_Core::glGenerateTextureMipmap(texture);
+    }
+
+    void glGetInteger64v(GLenum pname, GLint64 *data)
+    {
+        if (GLTrace *trace = GLTrace::active())
+            trace->record(GLTrace::GetInteger64v, quint32(pname));
+        QOpenGLFunctions_4_5_Core::glGetInteger64v(pname, data);
+    }
+
+    void glGetIntegerv(GLenum pname, GLint *data)
+    {
+        if (GLTrace *trace = GLTrace::active())
+            trace->record(GLTrace::GetIntegerv, quint32(pname));
+        QOpenGLFunctions_4_5_Core::glGetIntegerv(pname, data);
+    }
+
+    void glGetQueryObjectiv(GLuint id, GLenum pname, GLint *params)
+    {
+        if (GLTrace *trace = GLTrace::active())
+            trace->record(GLTrace::GetQueryObjectiv, GLTrace::Query{id}, quint32(pname));
+        QOpenGLFunctions_4_5_Core::glGetQueryObjectiv(id, pname, params);
+    }
+
+    void glGetQueryObjectui64v(GLuint id, GLenum pname, GLuint64 *params)
+    {
+        if (GLTrace *trace = GLTrace::active())
+            trace->record(GLTrace::GetQueryObjectui64v, GLTrace::Query{id}, quint32(pname));
+        QOpenGLFunctions_4_5_Core::glGetQueryObjectui64v(id, pname, params);
+    }
+
+    void glGetTextureLevelParameteriv(GLuint texture, GLint level, GLenum pname, GLint *params)
+    {
+        if (GLTrace *trace = GLTrace::active())
+            trace->record(GLTrace::GetTextureLevelParameteriv, GLTrace::Texture{texture}, qint32(level),
+                          quint32(pname));
+        QOpenGLFunctions_4_5_Core::glGetTextureLevelParameteriv(texture, level, pname, params);
+    }
+
+    void *glMapBufferRange(GLenum target, GLintptr offset, GLsizeiptr length, GLbitfield access)
+    {
+        if (GLTrace *trace = GLTrace::active())
+            trace->prepareBuffer(target);
+        void *result = QOpenGLFunctions_4_5_Core::glMapBufferRange(target, offset, length, access);
+        if (GLTrace *trace = GLTrace::active())
+            trace->mapBufferRange(target, offset, length, access, result);
+        return result;
+    }
+
+    void glMultiDrawElementsIndirect(GLenum mode, GLenum type, const void *indirect, GLsizei drawcount, GLsizei stride)
+    {
+        if (GLTrace *trace = GLTrace::active()) {
+            trace->prepareDraw(true, true);
+            trace->record(GLTrace::MultiDrawElementsIndirect, quint32(mode), quint32(type), pointerOffset(indirect),
+                          qint32(drawcount), qint32(stride));
+        }
+        QOpenGLFunctions_4_5_Core::glMultiDrawElementsIndirect(mode, type, indirect, drawcount, stride);
+    }
+
+    void glNamedBufferSubData(GLuint buffer, GLintptr offset, GLsizeiptr size, const void *data)
+    {
+        if (GLTrace *trace = GLTrace::active())
+            trace->record(GLTrace::NamedBufferSubData, GLTrace::Buffer{buffer}, qint64(offset),
+                          GLTrace::Blob{data, qint64(size)});
+        QOpenGLFunctions_4_5_Core::glNamedBufferSubData(buffer, offset, size, data);
+    }
+
+    void glNamedFramebufferRenderbuffer(GLuint framebuffer, GLenum attachment, GLenum renderbuffertarget,
+                                        GLuint renderbuffer)
+    {
+        if (GLTrace *trace = GLTrace::active())
+            trace->record(GLTrace::NamedFramebufferRenderbuffer, GLTrace::Framebuffer{framebuffer}, quint32(attachment),
+                          quint32(renderbuffertarget), GLTrace::Renderbuffer{renderbuffer});
+        QOpenGLFunctions_4_5_Core::glNamedFramebufferRenderbuffer(framebuffer, attachment, renderbuffertarget,
+                                                                  renderbuffer);
+    }
+
+    void glNamedFramebufferTexture(GLuint framebuffer, GLenum attachment, GLuint texture, GLint level)
+    {
+        if (GLTrace *trace = GLTrace::active())
+            trace->record(GLTrace::NamedFramebufferTexture, GLTrace::Framebuffer{framebuffer}, quint32(attachment),
+                          GLTrace::Texture{texture}, qint32(level));
+        QOpenGLFunctions_4_5_Core::glNamedFramebufferTexture(framebuffer, attachment, texture, level);
+    }
+
+    void glNamedRenderbufferStorage(GLuint renderbuffer, GLenum internalformat, GLsizei width, GLsizei height)
+    {
+        if (GLTrace *trace = GLTrace::active())
+            trace->record(GLTrace::NamedRenderbufferStorage, GLTrace::Renderbuffer{renderbuffer},
+                          quint32(internalformat), qint32(width), qint32(height));
+        QOpenGLFunctions_4_5_Core::glNamedRenderbufferStorage(renderbuffer, internalformat, width, height);
+    }
+
+    void glPixelStorei(GLenum pname, GLint param)
+    {
+        if (GLTrace *trace = GLTrace::active())
+            trace->pixelStore(pname, param);
+        QOpenGLFunctions_4_5_Core::glPixelStorei(pname, param);
+    }
+
+    void glQueryCounter(GLuint id, GLenum target)
+    {
+        if (GLTrace *trace = GLTrace::active())
+            trace->record(GLTrace::QueryCounter, GLTrace::Query{id}, quint32(target));
+        QOpenGLFunctions_4_5_Core::glQueryCounter(id, target);
+    }
+
+    void glScissor(GLint x, GLint y, GLsizei width, GLsizei height)
+    {
+        if (GLTrace *trace = GLTrace::active())
+            trace->scissor(x, y, width, height);
+        QOpenGLFunctions_4_5_Core::glScissor(x, y, width, height);
+    }
+
+    void glTexImage2D(GLenum target, GLint level, GLint internalformat, GLsizei width, GLsizei height, GLint border,
+                      GLenum format, GLenum type, const void *pixels)
+    {
+        if (GLTrace *trace = GLTrace::active())
+            trace->texImage2D(target, level, internalformat, width, height, border, format, type, pixels);
+        QOpenGLFunctions_4_5_Core::glTexImage2D(target, level, internalformat, width, height, border, format, type,
+                                                pixels);
+    }
+
+    void glTexParameteri(GLenum target, GLenum pname, GLint param)
+    {
+        if (GLTrace *trace = GLTrace::active()) {
+            trace->prepareTexture2D();
+            trace->record(GLTrace::TexParameteri, quint32(target), quint32(pname), qint32(param));
+        }
+        QOpenGLFunctions_4_5_Core::glTexParameteri(target, pname, param);
+    }
+
+    void glTextureParameteri(GLuint texture, GLenum pname, GLint param)
+    {
+        if (GLTrace *trace = GLTrace::active())
+            trace->record(GLTrace::TextureParameteri, GLTrace::Texture{texture}, quint32(pname), qint32(param));
+        QOpenGLFunctions_4_5_Core::glTextureParameteri(texture, pname, param);
+    }
+
+    void glTextureStorage2D(GLuint texture, GLsizei levels, GLenum internalformat, GLsizei width, GLsizei height)
+    {
+        if (GLTrace *trace = GLTrace::active())
+            trace->record(GLTrace::TextureStorage2D, GLTrace::Texture{texture}, qint32(levels), quint32(internalformat),
+                          qint32(width), qint32(height));
+        QOpenGLFunctions_4_5_Core::glTextureStorage2D(texture, levels, internalformat, width, height);
+    }
+
+    void glTextureSubImage2D(GLuint texture, GLint level, GLint xoffset, GLint yoffset, GLsizei width, GLsizei height,
+                             GLenum format, GLenum type, const void *pixels)
+    {
+        if (GLTrace *trace = GLTrace::active())
+            trace->textureSubImage2D(texture, level, xoffset, yoffset, width, height, format, type, pixels);
+        QOpenGLFunctions_4_5_Core::glTextureSubImage2D(texture, level, xoffset, yoffset, width, height, format, type,
+                                                       pixels);
+    }
+
+    GLboolean glUnmapBuffer(GLenum target)
+    {
+        if (GLTrace *trace = GLTrace::active())
+            trace->unmapBuffer(target);
+        return QOpenGLFunctions_4_5_Core::glUnmapBuffer(target);
+    }
+
+    void glUseProgram(GLuint program)
+    {
+        if (GLTrace *trace = GLTrace::active())
+            trace->useProgram(program);
+        QOpenGLFunctions_4_5_Core::glUseProgram(program);
+    }
+
+    void glVertexAttribDivisor(GLuint index, GLuint divisor)
+    {
+        if (GLTrace *trace = GLTrace::active()) {
+            trace->prepareVertexArray();
+            trace->record(GLTrace::VertexAttribDivisor, quint32(index), quint32(divisor));
+        }
+        QOpenGLFunctions_4_5_Core::glVertexAttribDivisor(index, divisor);
+    }
+
+    void glVertexAttribPointer(GLuint index, GLint size, GLenum type, GLboolean normalized, GLsizei stride,
+                               const void *pointer)
+    {
+        if (GLTrace *trace = GLTrace::active()) {
+            trace->prepareAttributes();
+            trace->record(GLTrace::VertexAttribPointer, quint32(index), qint32(size), quint32(type), quint8(normalized),
+                          qint32(stride), pointerOffset(pointer));
+        }
+        QOpenGLFunctions_4_5_Core::glVertexAttribPointer(index, size, type, normalized, stride, pointer);
+    }
+
+    void glViewport(GLint x, GLint y, GLsizei width, GLsizei height)
+    {
+        if (GLTrace *trace = GLTrace::active())
+            trace->viewport(x, y, width, height);
+        QOpenGLFunctions_4_5_Core::glViewport(x, y, width, height);
+    }
+
+private:
+    // 绑了缓冲时指针参数是缓冲里的偏移
+    static qint64 pointerOffset(const void *pointer) { return qint64(reinterpret_cast<quintptr>(pointer)); }
+};
+
+#endif // GLTRACEFUNCTIONS_H
@@ -0,0 +1,789 @@
+#include "ImageKernels.h"
+#include <QAtomicInt>
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#define IMAGE_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#elif defined(__ARM_NEON) || defined(__aarch64__) || defined(_M_ARM64)
+#define IMAGE_NEON 1
+#include <arm_neon.h>
+#endif
+
+// GCC/Clang：只给 AVX2 内核打开 AVX2 指令，其余代码照常按基础指令集编译，运行时再判断能不能调用（和 Scene.cpp 一样）
+#if defined(IMAGE_X86) && (defined(__GNUC__) || defined(__clang__))
+#define IMAGE_TARGET(isa) __attribute__((target(isa)))
+#else
+#define IMAGE_TARGET(isa)
+#endif
+
+namespace {
+
+inline uchar clampByte(int v)
+{
+    return uchar(v < 0 ? 0 : v > 255 ? 255 : v);
+}
+
+// BT.601 有限范围 -> RGB，8 位定点系数（和 FrameCapture 写 YUV 用的是同一套约定的反变换）
+inline void yuvToRgba(int y, int u, int v, uchar *dst)
+{
+    const int c = 298 * (y - 16) + 128;
+    const int d = u - 128;
+    const int e = v - 128;
+    dst[0] = clampByte((c + 409 * e) >> 8);
+    dst[1] = clampByte((c - 100 * d - 208 * e) >> 8);
+    dst[2] = clampByte((c + 516 * d) >> 8);
+    dst[3] = 255;
+}
+
+/* Kaiser 窗 sinc，2 倍缩小：目标像素 x 的中心在源图 2x + 1 处（像素边缘坐标），
+ * 6 个抽头是源像素 2x - 2 … 2x + 3，到中心的距离 ±0.5、±1.5、±2.5。
+ * 截止频率是源图的一半（sinc(d / 2)），窗口半宽 3，beta = 4。权重归一化到和为 1 */
+struct KaiserWeights
+{
+    float w[6];
+
+    KaiserWeights()
+    {
+        const double pi = 3.14159265358979323846;
+        const double beta = 4.0;
+        auto besselI0 = [](double x) {
+            double sum = 1.0, term = 1.0;
+            for (int k = 1; k < 20; ++k) {
+                term *= (x / (2.0 * k)) * (x / (2.0 * k));
+                sum += term;
+            }
+            return sum;
+        };
+        double weights[6];
+        double total = 0.0;
+        for (int k = 0; k < 6; ++k) {
+            const double d = k - 2.5;
+            const double x = pi * d / 2.0;
+            const double sinc = std::sin(x) / x;
+            const double r = d / 3.0;
+            weights[k] = sinc * besselI0(beta * std::sqrt(1.0 - r * r)) / besselI0(beta);
+            total += weights[k];
+        }
+        for (int k = 0; k < 6; ++k)
+            w[k] = float(weights[k] / total);
+    }
+};
+
+const KaiserWeights kaiser;
+
+inline int clampIndex(int i, int size)
+{
+    return i < 0 ? 0 : i >= size ? size - 1 : i;
+}
+
+inline uchar roundFloat(float v)
+{
+    v = v < 0.0f ? 0.0f : v > 255.0f ? 255.0f : v;
+    return uchar(int(v + 0.5f));
+}
+
+// ---- 标量内核 ----
+
+void bgraScalar(const uchar *src, uchar *dst, int first, int pixels)
+{
+    for (int i = first; i < pixels; ++i) {
+        const uchar b = src[i * 4], g = src[i * 4 + 1], r = src[i * 4 + 2], a = src[i * 4 + 3];
+        dst[i * 4] = r;
+        dst[i * 4 + 1] = g;
+        dst[i * 4 + 2] = b;
+        dst[i * 4 + 3] = a;
+    }
+}
+
+void rgbScalar(const uchar *src, uchar *dst, int first, int pixels)
+{
+    for (int i = first; i < pixels; ++i) {
+        dst[i * 4] = src[i * 3];
+        dst[i * 4 + 1] = src[i * 3 + 1];
+        dst[i * 4 + 2] = src[i * 3 + 2];
+        dst[i * 4 + 3] = 255;
+    }
+}
+
+void yuvRowScalar(const uchar *y, const uchar *u, const uchar *v, uchar *dst, int first, int width)
+{
+    for (int x = first; x < width; ++x)
+        yuvToRgba(y[x], u[x / 2], v[x / 2], dst + x * 4);
+}
+
+// 目标第 first … last - 1 个像素，row0/row1 是源图的两行（只有一行时是同一行）
+void boxRowScalar(const uchar *row0, const uchar *row1, int srcWidth, uchar *dst, int first, int last)
+{
+    for (int x = first; x < last; ++x) {
+        const int a = 2 * x * 4;
+        const int b = qMin(2 * x + 1, srcWidth - 1) * 4;
+        for (int c = 0; c < 4; ++c)
+            dst[x * 4 + c] = uchar((row0[a + c] + row0[b + c] + row1[a + c] + row1[b + c] + 2) >> 2);
+    }
+}
+
+// Kaiser 横向一趟：目标列 first … last - 1，每个像素 4 个 float 写进 out（从 out[0] 开始）
+void kaiserRowScalar(const uchar *row, int srcWidth, float *out, int first, int last)
+{
+    for (int x = first; x < last; ++x) {
+        float sum[4] = {0.0f, 0.0f, 0.0f, 0.0f};
+        for (int k = 0; k < 6; ++k) {
+            const uchar *p = row + clampIndex(2 * x - 2 + k, srcWidth) * 4;
+            for (int c = 0; c < 4; ++c)
+                sum[c] += kaiser.w[k] * float(p[c]);
+        }
+        std::memcpy(out + (x - first) * 4, sum, sizeof(sum));
+    }
+}
+
+// Kaiser 纵向一趟：rows 是 6 行横向结果（都从目标列 first 开始），写目标行的 first … last - 1
+void kaiserColumnScalar(const float *const rows[6], uchar *dst, int first, int last)
+{
+    for (int x = first; x < last; ++x) {
+        const int i = (x - first) * 4;
+        for (int c = 0; c < 4; ++c) {
+            float sum = 0.0f;
+            for (int k = 0; k < 6; ++k)
+                sum += kaiser.w[k] * rows[k][i + c];
+            dst[x * 4 + c] = roundFloat(sum);
+        }
+    }
+}
+
+// ---- SSE2（x86-64 的基础指令集，不需要 target 属性） ----
+#ifdef IMAGE_X86
+
+void bgraSse2(const uchar *src, uchar *dst, int pixels)
+{
+    const __m128i agMask = _mm_set1_epi32(int(0xff00ff00u));
+    const __m128i rbMask = _mm_set1_epi32(0x00ff00ff);
+    int i = 0;
+    for (; i + 4 <= pixels; i += 4) {
+        const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i * 4));
+        const __m128i rb = _mm_and_si128(v, rbMask);
+        // 每个 32 位像素里 B（第 0 字节）和 R（第 2 字节）对调
+        const __m128i swapped = _mm_or_si128(_mm_slli_epi32(rb, 16), _mm_srli_epi32(rb, 16));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i * 4), _mm_or_si128(swapped, _mm_and_si128(v, agMask)));
+    }
+    bgraScalar(src, dst, i, pixels);
+}
+
+void rgbSse2(const uchar *src, uchar *dst, int pixels)
+{
+    // SSE2 没有字节重排指令：每个像素读 4 个字节（多读的那个是下一个像素的 R），alpha 用或运算补上
+    const __m128i alpha = _mm_set1_epi32(int(0xff000000u));
+    int i = 0;
+    for (; i + 5 <= pixels; i += 4) {
+        int p[4];
+        for (int k = 0; k < 4; ++k)
+            std::memcpy(&p[k], src + (i + k) * 3, 4);
+        const __m128i v = _mm_setr_epi32(p[0], p[1], p[2], p[3]);
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i * 4), _mm_or_si128(v, alpha));
+    }
+    rgbScalar(src, dst, i, pixels);
+}
+
+inline __m128i pair16(short a, short b)
+{
+    return _mm_setr_epi16(a, b, a, b, a, b, a, b);
+}
+
+void yuvRowSse2(const uchar *y, const uchar *u, const uchar *v, uchar *dst, int width)
+{
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i bias16 = _mm_set1_epi16(16);
+    const __m128i bias128 = _mm_set1_epi16(128);
+    const __m128i one = _mm_set1_epi16(1);
+    const __m128i round = _mm_set1_epi32(128);
+    const __m128i maxByte = _mm_set1_epi16(255);
+    const __m128i alpha = _mm_set1_epi16(short(0xff00));
+    int x = 0;
+    for (; x + 8 <= width; x += 8) {
+        // 8 个像素：Y 各一个，U/V 每两个像素共用一个
+        const __m128i c = _mm_sub_epi16(
+            _mm_unpacklo_epi8(_mm_loadl_epi64(reinterpret_cast<const __m128i *>(y + x)), zero), bias16);
+        int u4, v4;
+        std::memcpy(&u4, u + x / 2, 4);
+        std::memcpy(&v4, v + x / 2, 4);
+        __m128i uu = _mm_cvtsi32_si128(u4);
+        __m128i vv = _mm_cvtsi32_si128(v4);
+        const __m128i d = _mm_sub_epi16(_mm_unpacklo_epi8(_mm_unpacklo_epi8(uu, uu), zero), bias128);
+        const __m128i e = _mm_sub_epi16(_mm_unpacklo_epi8(_mm_unpacklo_epi8(vv, vv), zero), bias128);
+
+        // _mm_madd_epi16 把相邻两个 16 位乘积加成 32 位：(c, e)·(298, 409) 就是一个像素的 R，不会溢出
+        __m128i rgb[3];
+        for (int half = 0; half < 2; ++half) {
+            const __m128i ce = half ? _mm_unpackhi_epi16(c, e) : _mm_unpacklo_epi16(c, e);
+            const __m128i cd = half ? _mm_unpackhi_epi16(c, d) : _mm_unpacklo_epi16(c, d);
+            const __m128i e1 = half ? _mm_unpackhi_epi16(e, one) : _mm_unpacklo_epi16(e, one);
+            const __m128i r = _mm_srai_epi32(_mm_add_epi32(_mm_madd_epi16(ce, pair16(298, 409)), round), 8);
+            const __m128i g = _mm_srai_epi32(
+                _mm_add_epi32(_mm_madd_epi16(cd, pair16(298, -100)), _mm_madd_epi16(e1, pair16(-208, 128))), 8);
+            const __m128i b = _mm_srai_epi32(_mm_add_epi32(_mm_madd_epi16(cd, pair16(298, 516)), round), 8);
+            if (half) {
+                rgb[0] = _mm_packs_epi32(rgb[0], r);
+                rgb[1] = _mm_packs_epi32(rgb[1], g);
+                rgb[2] = _mm_packs_epi32(rgb[2], b);
+            } else {
+                rgb[0] = r;
+                rgb[1] = g;
+                rgb[2] = b;
+            }
+        }
+        for (__m128i &channel : rgb)
+            channel = _mm_min_epi16(_mm_max_epi16(channel, zero), maxByte);
+
+        const __m128i rg = _mm_or_si128(rgb[0], _mm_slli_epi16(rgb[1], 8));
+        const __m128i ba = _mm_or_si128(rgb[2], alpha);
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + x * 4), _mm_unpacklo_epi16(rg, ba));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + x * 4 + 16), _mm_unpackhi_epi16(rg, ba));
+    }
+    yuvRowScalar(y, u, v, dst, x, width);
+}
+
+void boxRowSse2(const uchar *row0, const uchar *row1, int srcWidth, uchar *dst, int first, int last)
+{
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i two = _mm_set1_epi16(2);
+    int x = first;
+    if (srcWidth >= 2) {
+        for (; x + 2 <= last; x += 2) {
+            // 源图 4 个像素（两行）-> 目标 2 个像素，16 位累加，(和 + 2) >> 2 和标量版本一样舍入
+            const __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i *>(row0 + x * 8));
+            const __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i *>(row1 + x * 8));
+            __m128i lo = _mm_add_epi16(_mm_unpacklo_epi8(a, zero), _mm_unpacklo_epi8(b, zero));
+            __m128i hi = _mm_add_epi16(_mm_unpackhi_epi8(a, zero), _mm_unpackhi_epi8(b, zero));
+            lo = _mm_add_epi16(lo, _mm_srli_si128(lo, 8));
+            hi = _mm_add_epi16(hi, _mm_srli_si128(hi, 8));
+            const __m128i sum = _mm_srli_epi16(_mm_add_epi16(_mm_unpacklo_epi64(lo, hi), two), 2);
+            _mm_storel_epi64(reinterpret_cast<__m128i *>(dst + x * 4), _mm_packus_epi16(sum, sum));
+        }
+    }
+    boxRowScalar(row0, row1, srcWidth, dst, x, last);
+}
+
+inline __m128 loadPixel(const uchar *p)
+{
+    int v;
+    std::memcpy(&v, p, 4);
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i bytes = _mm_cvtsi32_si128(v);
+    return _mm_cvtepi32_ps(_mm_unpacklo_epi16(_mm_unpacklo_epi8(bytes, zero), zero));
+}
+
+// Kaiser 一个像素正好是一个 __m128（RGBA 四个 float），乘加顺序和标量版本相同
+void kaiserRowSse2(const uchar *row, int srcWidth, float *out, int first, int last)
+{
+    for (int x = first; x < last; ++x) {
+        __m128 sum = _mm_setzero_ps();
+        for (int k = 0; k < 6; ++k)
+            sum = _mm_add_ps(sum, _mm_mul_ps(_mm_set1_ps(kaiser.w[k]), loadPixel(row + clampIndex(2 * x - 2 + k, srcWidth) * 4)));
+        _mm_storeu_ps(out + (x - first) * 4, sum);
+    }
+}
+
+void kaiserColumnSse2(const float *const rows[6], uchar *dst, int first, int last)
+{
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 maxByte = _mm_set1_ps(255.0f);
+    const __m128 half = _mm_set1_ps(0.5f);
+    for (int x = first; x < last; ++x) {
+        const int i = (x - first) * 4;
+        __m128 sum = _mm_setzero_ps();
+        for (int k = 0; k < 6; ++k)
+            sum = _mm_add_ps(sum, _mm_mul_ps(_mm_set1_ps(kaiser.w[k]), _mm_loadu_ps(rows[k] + i)));
+        // 先夹到 [0, 255] 再 +0.5 截断，和 roundFloat() 一样
+        sum = _mm_add_ps(_mm_min_ps(_mm_max_ps(sum, zero), maxByte), half);
+        const __m128i v = _mm_cvttps_epi32(sum);
+        const __m128i bytes = _mm_packus_epi16(_mm_packs_epi32(v, v), _mm_setzero_si128());
+        const int pixel = _mm_cvtsi128_si32(bytes);
+        std::memcpy(dst + x * 4, &pixel, 4);
+    }
+}
+
+// ---- AVX2 ----
+
+IMAGE_TARGET("avx2")
+void bgraAvx2(const uchar *src, uchar *dst, int pixels)
+{
+    const __m256i shuffle = _mm256_setr_epi8(2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15,
+                                             2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15);
+    int i = 0;
+    for (; i + 8 <= pixels; i += 8) {
+        const __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(src + i * 4));
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + i * 4), _mm256_shuffle_epi8(v, shuffle));
+    }
+    bgraScalar(src, dst, i, pixels);
+}
+
+IMAGE_TARGET("avx2")
+void rgbAvx2(const uchar *src, uchar *dst, int pixels)
+{
+    // 每个 128 位通道读 16 个字节、取前 12 个（4 个像素）：第二个通道从第 12 个字节开始，整体多读 4 个字节
+    const __m256i shuffle = _mm256_setr_epi8(0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1,
+                                             0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1);
+    const __m256i alpha = _mm256_set1_epi32(int(0xff000000u));
+    int i = 0;
+    for (; i + 10 <= pixels; i += 8) {
+        const __m128i lo = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i * 3));
+        const __m128i hi = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i * 3 + 12));
+        const __m256i v = _mm256_inserti128_si256(_mm256_castsi128_si256(lo), hi, 1);
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + i * 4),
+                            _mm256_or_si256(_mm256_shuffle_epi8(v, shuffle), alpha));
+    }
+    rgbScalar(src, dst, i, pixels);
+}
+
+IMAGE_TARGET("avx2")
+inline __m256i pair16x16(short a, short b)
+{
+    return _mm256_setr_epi16(a, b, a, b, a, b, a, b, a, b, a, b, a, b, a, b);
+}
+
+IMAGE_TARGET("avx2")
+void yuvRowAvx2(const uchar *y, const uchar *u, const uchar *v, uchar *dst, int width)
+{
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i bias16 = _mm256_set1_epi16(16);
+    const __m256i bias128 = _mm256_set1_epi16(128);
+    const __m256i one = _mm256_set1_epi16(1);
+    const __m256i round = _mm256_set1_epi32(128);
+    const __m256i maxByte = _mm256_set1_epi16(255);
+    const __m256i alpha = _mm256_set1_epi16(short(0xff00));
+    int x = 0;
+    for (; x + 16 <= width; x += 16) {
+        const __m256i c = _mm256_sub_epi16(
+            _mm256_cvtepu8_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i *>(y + x))), bias16);
+        const __m128i u8 = _mm_loadl_epi64(reinterpret_cast<const __m128i *>(u + x / 2));
+        const __m128i v8 = _mm_loadl_epi64(reinterpret_cast<const __m128i *>(v + x / 2));
+        const __m256i d = _mm256_sub_epi16(_mm256_cvtepu8_epi16(_mm_unpacklo_epi8(u8, u8)), bias128);
+        const __m256i e = _mm256_sub_epi16(_mm256_cvtepu8_epi16(_mm_unpacklo_epi8(v8, v8)), bias128);
+
+        // unpack 在每个 128 位通道里各自进行：lo 是像素 0-3 和 8-11，hi 是 4-7 和 12-15，
+        // packs 以后每个通道里又是按顺序的 0-7 / 8-15
+        const __m256i rLo = _mm256_srai_epi32(_mm256_add_epi32(_mm256_madd_epi16(_mm256_unpacklo_epi16(c, e), pair16x16(298, 409)), round), 8);
+        const __m256i rHi = _mm256_srai_epi32(_mm256_add_epi32(_mm256_madd_epi16(_mm256_unpackhi_epi16(c, e), pair16x16(298, 409)), round), 8);
+        const __m256i gLo = _mm256_srai_epi32(_mm256_add_epi32(_mm256_madd_epi16(_mm256_unpacklo_epi16(c, d), pair16x16(298, -100)),
+                                                               _mm256_madd_epi16(_mm256_unpacklo_epi16(e, one), pair16x16(-208, 128))), 8);
+        const __m256i gHi = _mm256_srai_epi32(_mm256_add_epi32(_mm256_madd_epi16(_mm256_unpackhi_epi16(c, d), pair16x16(298, -100)),
+                                                               _mm256_madd_epi16(_mm256_unpackhi_epi16(e, one), pair16x16(-208, 128))), 8);
+        const __m256i bLo = _mm256_srai_epi32(_mm256_add_epi32(_mm256_madd_epi16(_mm256_unpacklo_epi16(c, d), pair16x16(298, 516)), round), 8);
+        const __m256i bHi = _mm256_srai_epi32(_mm256_add_epi32(_mm256_madd_epi16(_mm256_unpackhi_epi16(c, d), pair16x16(298, 516)), round), 8);
+        const __m256i r = _mm256_min_epi16(_mm256_max_epi16(_mm256_packs_epi32(rLo, rHi), zero), maxByte);
+        const __m256i g = _mm256_min_epi16(_mm256_max_epi16(_mm256_packs_epi32(gLo, gHi), zero), maxByte);
+        const __m256i b = _mm256_min_epi16(_mm256_max_epi16(_mm256_packs_epi32(bLo, bHi), zero), maxByte);
+
+        const __m256i rg = _mm256_or_si256(r, _mm256_slli_epi16(g, 8));
+        const __m256i ba = _mm256_or_si256(b, alpha);
+        const __m256i lo = _mm256_unpacklo_epi16(rg, ba);   // 像素 0-3 | 8-11
+        const __m256i hi = _mm256_unpackhi_epi16(rg, ba);   // 像素 4-7 | 12-15
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + x * 4), _mm256_permute2x128_si256(lo, hi, 0x20));
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + x * 4 + 32), _mm256_permute2x128_si256(lo, hi, 0x31));
+    }
+    yuvRowSse2(y + x, u + x / 2, v + x / 2, dst + x * 4, width - x);
+}
+
+IMAGE_TARGET("avx2")
+void boxRowAvx2(const uchar *row0, const uchar *row1, int srcWidth, uchar *dst, int first, int last)
+{
+    const __m256i two = _mm256_set1_epi16(2);
+    const __m256i order = _mm256_setr_epi32(0, 4, 1, 5, 0, 0, 0, 0);
+    int x = first;
+    if (srcWidth >= 2) {
+        for (; x + 4 <= last; x += 4) {
+            // 源图 8 个像素 -> 目标 4 个：每个 128 位通道里是相邻的两个源像素，通道内错开 8 字节相加
+            const __m128i *p0 = reinterpret_cast<const __m128i *>(row0 + x * 8);
+            const __m128i *p1 = reinterpret_cast<const __m128i *>(row1 + x * 8);
+            __m256i s0 = _mm256_add_epi16(_mm256_cvtepu8_epi16(_mm_loadu_si128(p0)), _mm256_cvtepu8_epi16(_mm_loadu_si128(p1)));
+            __m256i s1 = _mm256_add_epi16(_mm256_cvtepu8_epi16(_mm_loadu_si128(p0 + 1)), _mm256_cvtepu8_epi16(_mm_loadu_si128(p1 + 1)));
+            s0 = _mm256_add_epi16(s0, _mm256_srli_si256(s0, 8));   // 目标 x | x + 1
+            s1 = _mm256_add_epi16(s1, _mm256_srli_si256(s1, 8));   // 目标 x + 2 | x + 3
+            const __m256i sum = _mm256_srli_epi16(_mm256_add_epi16(_mm256_unpacklo_epi64(s0, s1), two), 2);
+            const __m256i bytes = _mm256_permutevar8x32_epi32(_mm256_packus_epi16(sum, sum), order);
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + x * 4), _mm256_castsi256_si128(bytes));
+        }
+    }
+    boxRowSse2(row0, row1, srcWidth, dst, x, last);
+}
+
+bool cpuHasAvx2()
+{
+#if defined(__GNUC__) || defined(__clang__)
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2");
+#elif defined(_MSC_VER)
+    int info[4];
+    __cpuid(info, 1);
+    const bool osAvx = (info[2] & (1 << 27)) && (info[2] & (1 << 28)) && (_xgetbv(0) & 6) == 6;
+    __cpuidex(info, 7, 0);
+    return osAvx && (info[1] & (1 << 5)) != 0;
+#else
+    return false;
+#endif
+}
+
+#endif // IMAGE_X86
+
+// ---- NEON（ARM64 总是有） ----
+#ifdef IMAGE_NEON
+
+void bgraNeon(const uchar *src, uchar *dst, int pixels)
+{
+    int i = 0;
+    for (; i + 16 <= pixels; i += 16) {
+        uint8x16x4_t v = vld4q_u8(src + i * 4);   // 按通道拆开
+        const uint8x16_t b = v.val[0];
+        v.val[0] = v.val[2];
+        v.val[2] = b;
+        vst4q_u8(dst + i * 4, v);
+    }
+    bgraScalar(src, dst, i, pixels);
+}
+
+void rgbNeon(const uchar *src, uchar *dst, int pixels)
+{
+    int i = 0;
+    for (; i + 16 <= pixels; i += 16) {
+        const uint8x16x3_t rgb = vld3q_u8(src + i * 3);
+        uint8x16x4_t rgba;
+        rgba.val[0] = rgb.val[0];
+        rgba.val[1] = rgb.val[1];
+        rgba.val[2] = rgb.val[2];
+        rgba.val[3] = vdupq_n_u8(255);
+        vst4q_u8(dst + i * 4, rgba);
+    }
+    rgbScalar(src, dst, i, pixels);
+}
+
+inline uint8x8_t neonChannel(int32x4_t lo, int32x4_t hi)
+{
+    return vqmovun_s16(vcombine_s16(vshrn_n_s32(lo, 8), vshrn_n_s32(hi, 8)));
+}
+
+void yuvRowNeon(const uchar *y, const uchar *u, const uchar *v, uchar *dst, int width)
+{
+    int x = 0;
+    for (; x + 8 <= width; x += 8) {
+        const int16x8_t c = vsubq_s16(vreinterpretq_s16_u16(vmovl_u8(vld1_u8(y + x))), vdupq_n_s16(16));
+        uint32_t u4, v4;
+        std::memcpy(&u4, u + x / 2, 4);
+        std::memcpy(&v4, v + x / 2, 4);
+        const uint8x8_t uu = vreinterpret_u8_u32(vdup_n_u32(u4));
+        const uint8x8_t vv = vreinterpret_u8_u32(vdup_n_u32(v4));
+        const int16x8_t d = vsubq_s16(vreinterpretq_s16_u16(vmovl_u8(vzip_u8(uu, uu).val[0])), vdupq_n_s16(128));
+        const int16x8_t e = vsubq_s16(vreinterpretq_s16_u16(vmovl_u8(vzip_u8(vv, vv).val[0])), vdupq_n_s16(128));
+
+        int32x4_t base[2], r[2], g[2], b[2];
+        const int16x4_t cs[2] = {vget_low_s16(c), vget_high_s16(c)};
+        const int16x4_t ds[2] = {vget_low_s16(d), vget_high_s16(d)};
+        const int16x4_t es[2] = {vget_low_s16(e), vget_high_s16(e)};
+        for (int h = 0; h < 2; ++h) {
+            base[h] = vmlal_n_s16(vdupq_n_s32(128), cs[h], 298);
+            r[h] = vmlal_n_s16(base[h], es[h], 409);
+            g[h] = vmlal_n_s16(vmlal_n_s16(base[h], ds[h], -100), es[h], -208);
+            b[h] = vmlal_n_s16(base[h], ds[h], 516);
+        }
+        uint8x8x4_t rgba;
+        rgba.val[0] = neonChannel(r[0], r[1]);
+        rgba.val[1] = neonChannel(g[0], g[1]);
+        rgba.val[2] = neonChannel(b[0], b[1]);
+        rgba.val[3] = vdup_n_u8(255);
+        vst4_u8(dst + x * 4, rgba);
+    }
+    yuvRowScalar(y, u, v, dst, x, width);
+}
+
+void boxRowNeon(const uchar *row0, const uchar *row1, int srcWidth, uchar *dst, int first, int last)
+{
+    int x = first;
+    if (srcWidth >= 2) {
+        for (; x + 4 <= last; x += 4) {
+            // vld2 按 32 位拆成偶数、奇数像素，左右两个相加就是横向的一对
+            const uint32x4x2_t a = vld2q_u32(reinterpret_cast<const uint32_t *>(row0 + x * 8));
+            const uint32x4x2_t b = vld2q_u32(reinterpret_cast<const uint32_t *>(row1 + x * 8));
+            const uint8x16_t a0 = vreinterpretq_u8_u32(a.val[0]), a1 = vreinterpretq_u8_u32(a.val[1]);
+            const uint8x16_t b0 = vreinterpretq_u8_u32(b.val[0]), b1 = vreinterpretq_u8_u32(b.val[1]);
+            uint16x8_t lo = vaddl_u8(vget_low_u8(a0), vget_low_u8(a1));
+            lo = vaddw_u8(vaddw_u8(lo, vget_low_u8(b0)), vget_low_u8(b1));
+            uint16x8_t hi = vaddl_u8(vget_high_u8(a0), vget_high_u8(a1));
+            hi = vaddw_u8(vaddw_u8(hi, vget_high_u8(b0)), vget_high_u8(b1));
+            vst1q_u8(dst + x * 4, vcombine_u8(vrshrn_n_u16(lo, 2), vrshrn_n_u16(hi, 2)));   // (和 + 2) >> 2
+        }
+    }
+    boxRowScalar(row0, row1, srcWidth, dst, x, last);
+}
+
+inline float32x4_t loadPixelNeon(const uchar *p)
+{
+    uint32_t v;
+    std::memcpy(&v, p, 4);
+    const uint16x4_t wide = vget_low_u16(vmovl_u8(vreinterpret_u8_u32(vdup_n_u32(v))));
+    return vcvtq_f32_u32(vmovl_u16(wide));
+}
+
+void kaiserRowNeon(const uchar *row, int srcWidth, float *out, int first, int last)
+{
+    for (int x = first; x < last; ++x) {
+        float32x4_t sum = vdupq_n_f32(0.0f);
+        for (int k = 0; k < 6; ++k)   // 乘、加分开，不用融合乘加，和标量版本的舍入一样
+            sum = vaddq_f32(sum, vmulq_n_f32(loadPixelNeon(row + clampIndex(2 * x - 2 + k, srcWidth) * 4), kaiser.w[k]));
+        vst1q_f32(out + (x - first) * 4, sum);
+    }
+}
+
+void kaiserColumnNeon(const float *const rows[6], uchar *dst, int first, int last)
+{
+    for (int x = first; x < last; ++x) {
+        const int i = (x - first) * 4;
+        float32x4_t sum = vdupq_n_f32(0.0f);
+        for (int k = 0; k < 6; ++k)
+            sum = vaddq_f32(sum, vmulq_n_f32(vld1q_f32(rows[k] + i), kaiser.w[k]));
+        sum = vaddq_f32(vminq_f32(vmaxq_f32(sum, vdupq_n_f32(0.0f)), vdupq_n_f32(255.0f)), vdupq_n_f32(0.5f));
+        const uint16x4_t narrow = vmovn_u32(vcvtq_u32_f32(sum));   // 截断
+        const uint8x8_t bytes = vmovn_u16(vcombine_u16(narrow, narrow));
+        vst1_lane_u32(reinterpret_cast<uint32_t *>(dst + x * 4), vreinterpret_u32_u8(bytes), 0);
+    }
+}
+
+#endif // IMAGE_NEON
+
+ImageKernels::Kernel bestKernel()
+{
+#ifdef IMAGE_X86
+    return ImageKernels::isSupported(ImageKernels::Avx2) ? ImageKernels::Avx2 : ImageKernels::Sse2;
+#elif defined(IMAGE_NEON)
+    return ImageKernels::Neon;
+#else
+    return ImageKernels::Scalar;
+#endif
+}
+
+QAtomicInt &selectedKernel()
+{
+    static QAtomicInt selected(static_cast<int>(bestKernel()));
+    return selected;
+}
+
+} // namespace
+
+void ImageKernels::setKernel(Kernel kernel)
+{
+    selectedKernel().storeRelaxed(int(kernel != Auto && isSupported(kernel) ? kernel : bestKernel()));
+}
+
+ImageKernels::Kernel ImageKernels::kernel()
+{
+    return Kernel(selectedKernel().loadRelaxed());
+}
+
+bool ImageKernels::isSupported(Kernel kernel)
+{
+    switch (kernel) {
+    case Auto:
+    case Scalar:
+        return true;
+#ifdef IMAGE_X86
+    case Sse2:
+        return true;
+    case Avx2: {
+        static const bool avx2 = cpuHasAvx2();
+        return avx2;
+    }
+#endif
+#ifdef IMAGE_NEON
+    case Neon:
+        return true;
+#endif
+    default:
+        return false;
+    }
+}
+
+const char *ImageKernels::kernelName(Kernel kernel)
+{
+    switch (kernel) {
+    case Scalar:
+        return "scalar";
+    case Sse2:
+        return "sse2";
+    case Avx2:
+        return "avx2";
+    case Neon:
+        return "neon";
+    default:
+        return "auto";
+    }
+}
+
+void ImageKernels::bgraToRgba(const uchar *src, uchar *dst, int pixels)
+{
+    switch (kernel()) {
+#ifdef IMAGE_X86
+    case Avx2:
+        bgraAvx2(src, dst, pixels);
+        return;
+    case Sse2:
+        bgraSse2(src, dst, pixels);
+        return;
+#endif
+#ifdef IMAGE_NEON
+    case Neon:
+        bgraNeon(src, dst, pixels);
+        return;
+#endif
+    default:
+        bgraScalar(src, dst, 0, pixels);
+    }
+}
+
+void ImageKernels::rgbToRgba(const uchar *src, uchar *dst, int pixels)
+{
+    switch (kernel()) {
+#ifdef IMAGE_X86
+    case Avx2:
+        rgbAvx2(src, dst, pixels);
+        return;
+    case Sse2:
+        rgbSse2(src, dst, pixels);
+        return;
+#endif
+#ifdef IMAGE_NEON
+    case Neon:
+        rgbNeon(src, dst, pixels);
+        return;
+#endif
+    default:
+        rgbScalar(src, dst, 0, pixels);
+    }
+}
+
+void ImageKernels::yuv420ToRgba(const uchar *y, int yStride, const uchar *u, const uchar *v, int uvStride,
+                                uchar *dst, int dstStride, int width, int height)
+{
+    const Kernel k = kernel();
+    for (int row = 0; row < height; ++row) {
+        const uchar *yRow = y + qsizetype(row) * yStride;
+        const uchar *uRow = u + qsizetype(row / 2) * uvStride;
+        const uchar *vRow = v + qsizetype(row / 2) * uvStride;
+        uchar *out = dst + qsizetype(row) * dstStride;
+        switch (k) {
+#ifdef IMAGE_X86
+        case Avx2:
+            yuvRowAvx2(yRow, uRow, vRow, out, width);
+            break;
+        case Sse2:
+            yuvRowSse2(yRow, uRow, vRow, out, width);
+            break;
+#endif
+#ifdef IMAGE_NEON
+        case Neon:
+            yuvRowNeon(yRow, uRow, vRow, out, width);
+            break;
+#endif
+        default:
+            yuvRowScalar(yRow, uRow, vRow, out, 0, width);
+        }
+    }
+}
+
+QRect ImageKernels::mipRect(const QRect &srcRect, const QSize &srcSize, Filter filter)
+{
+    const QSize size = mipSize(srcSize);
+    const int a = srcRect.left(), b = srcRect.right() + 1;    // 源图变了的列 [a, b)
+    const int c = srcRect.top(), d = srcRect.bottom() + 1;
+    // Box：目标 x 读源图 2x、2x + 1；Kaiser：读 2x - 2 … 2x + 3
+    int x0, x1, y0, y1;
+    if (filter == Kaiser) {
+        x0 = (a - 2) / 2;
+        x1 = (b + 3) / 2;
+        y0 = (c - 2) / 2;
+        y1 = (d + 3) / 2;
+    } else {
+        x0 = a / 2;
+        x1 = (b + 1) / 2;
+        y0 = c / 2;
+        y1 = (d + 1) / 2;
+    }
+    x0 = qBound(0, x0, size.width());
+    x1 = qBound(0, x1, size.width());
+    y0 = qBound(0, y0, size.height());
+    y1 = qBound(0, y1, size.height());
+    return QRect(x0, y0, x1 - x0, y1 - y0);
+}
+
+void ImageKernels::downsample(const uchar *src, int srcWidth, int srcHeight, int srcStride, uchar *dst, int dstStride,
+                              Filter filter, const QRect &dstRect)
+{
+    const QSize size = mipSize(QSize(srcWidth, srcHeight));
+    const QRect rect = dstRect.isNull() ? QRect(QPoint(0, 0), size) : dstRect.intersected(QRect(QPoint(0, 0), size));
+    if (rect.isEmpty())
+        return;
+    const Kernel k = kernel();
+    const int first = rect.left();
+    const int last = rect.right() + 1;
+
+    if (filter == Box) {
+        for (int y = rect.top(); y <= rect.bottom(); ++y) {
+            const uchar *row0 = src + qsizetype(2 * y) * srcStride;
+            const uchar *row1 = src + qsizetype(qMin(2 * y + 1, srcHeight - 1)) * srcStride;
+            uchar *out = dst + qsizetype(y) * dstStride;
+            switch (k) {
+#ifdef IMAGE_X86
+            case Avx2:
+                boxRowAvx2(row0, row1, srcWidth, out, first, last);
+                break;
+            case Sse2:
+                boxRowSse2(row0, row1, srcWidth, out, first, last);
+                break;
+#endif
+#ifdef IMAGE_NEON
+            case Neon:
+                boxRowNeon(row0, row1, srcWidth, out, first, last);
+                break;
+#endif
+            default:
+                boxRowScalar(row0, row1, srcWidth, out, first, last);
+            }
+        }
+        return;
+    }
+
+    // Kaiser 可分离：先横向、再纵向。横向结果按源图行号缓存 6 行（目标每往下一行，源图往下两行，只算新的两行）
+    auto horizontal = kaiserRowScalar;
+    auto vertical = kaiserColumnScalar;
+#ifdef IMAGE_X86
+    if (k != Scalar) {   // 一个像素就是 4 个 float，AVX2 也用 SSE2 的版本
+        horizontal = kaiserRowSse2;
+        vertical = kaiserColumnSse2;
+    }
+#endif
+#ifdef IMAGE_NEON
+    if (k == Neon) {
+        horizontal = kaiserRowNeon;
+        vertical = kaiserColumnNeon;
+    }
+#endif
+    const int width = last - first;
+    std::vector<float> cache(size_t(width) * 4 * 6);
+    int cachedRow[6] = {-1, -1, -1, -1, -1, -1};
+    for (int y = rect.top(); y <= rect.bottom(); ++y) {
+        const float *rows[6];
+        for (int t = 0; t < 6; ++t) {
+            const int r = clampIndex(2 * y - 2 + t, srcHeight);
+            const int slot = r % 6;   // 连续 6 行落在不同的槽里
+            float *row = cache.data() + size_t(slot) * width * 4;
+            if (cachedRow[slot] != r) {
+                horizontal(src + qsizetype(r) * srcStride, srcWidth, row, first, last);
+                cachedRow[slot] = r;
+            }
+            rows[t] = row;
+        }
+        vertical(rows, dst + qsizetype(y) * dstStride, first, last);
+    }
+}
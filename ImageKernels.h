@@ -0,0 +1,58 @@
+#ifndef IMAGEKERNELS_H
+#define IMAGEKERNELS_H
+
+#include <QtGlobal>
+#include <QRect>
+
+/* ImageKernels：动态纹理（视频帧、摄像头）每次更新都要跑的像素内核
+ *
+ * QImage::convertToFormat(Format_RGBA8888) 是逐像素的通用转换，glGenerateMipmap 每次把整条 mip 链重新算一遍。
+ * 这里是专门的版本，输出都是 RGBA8（和 TextureManager 上传的格式一样）：
+ *   - bgraToRgba：QImage::Format_ARGB32/RGB32 在小端机器上的内存顺序（B G R A），交换 R、B
+ *   - rgbToRgba：RGB888 补上 alpha = 255
+ *   - yuv420ToRgba：I420（Y、U、V 三个平面，U/V 宽高各一半），BT.601 有限范围，整数系数（和 ffmpeg 默认一致）
+ *   - downsample：RGBA8 缩小一半生成下一层 mip。Box 是 2x2 平均；Kaiser 是 6 抽头的 Kaiser 窗 sinc，
+ *     比 Box 锐利、摩尔纹少，负瓣在边缘会有一点点振铃。可以只算目标里的一个矩形（子矩形更新时用）
+ *
+ * 内核在运行时按 CPU 选择：x86 上 AVX2 > SSE2（x86-64 的基础指令集，总是有），ARM64 上 NEON，其他平台只有标量版本。
+ * 颜色转换和 Box 的 SIMD 版本和标量版本逐字节相同；Kaiser 是浮点运算，编译器把标量版本的乘加合成 FMA 时
+ * （ARM64 默认会）最多差 1。基准测试 benchmark/imagebench 会逐个比较。
+ * setKernel() 可以强制指定，对所有调用生效。
+ */
+class ImageKernels
+{
+public:
+    enum Kernel
+    {
+        Auto,
+        Scalar,
+        Sse2,
+        Avx2,
+        Neon
+    };
+
+    enum Filter
+    {
+        Box,
+        Kaiser
+    };
+
+    static void setKernel(Kernel kernel);   // 不支持的内核退回 Auto
+    static Kernel kernel();                 // 实际使用的内核（不会是 Auto）
+    static bool isSupported(Kernel kernel);
+    static const char *kernelName(Kernel kernel);
+
+    static void bgraToRgba(const uchar *src, uchar *dst, int pixels);   // src 和 dst 可以是同一块内存
+    static void rgbToRgba(const uchar *src, uchar *dst, int pixels);
+    static void yuv420ToRgba(const uchar *y, int yStride, const uchar *u, const uchar *v, int uvStride,
+                             uchar *dst, int dstStride, int width, int height);
+
+    static QSize mipSize(const QSize &size) { return QSize(qMax(1, size.width() / 2), qMax(1, size.height() / 2)); }
+    // src 是 srcWidth x srcHeight 的 RGBA8，dst 是 mipSize() 大小，只写 dstRect（空 = 整个）以内的像素
+    static void downsample(const uchar *src, int srcWidth, int srcHeight, int srcStride, uchar *dst, int dstStride,
+                           Filter filter, const QRect &dstRect = QRect());
+    // 源图里 srcRect 变了以后，下一层里要重算的矩形（Kaiser 的抽头伸到相邻像素，比 Box 大一圈）
+    static QRect mipRect(const QRect &srcRect, const QSize &srcSize, Filter filter);
+};
+
+#endif // IMAGEKERNELS_H
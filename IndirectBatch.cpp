@@ -0,0 +1,333 @@
+#include "IndirectBatch.h"
+#include <cstring>
+#include <QDebug>
+
+namespace {
+
+/* 顶点着色器：绘制数据按 float 数组读，每条命令 21 个 float，和 MeshInstance 的内存布局一一对应
+ * （16 个变换 + 4 个纹理坐标范围 + 1 个 RGBA8 色调），CPU 这边整块拷贝，不用为 std430 的对齐重新排。
+ * gl_DrawID 是这条命令在本次 glMultiDrawElementsIndirect 里的序号，SSBO 按本帧的区间绑定，从 0 开始 */
+const char *vertexShaderVersion = "#version 460 core\n";
+const char *vertexShaderBody = R"(
+    layout(std430, binding = 0) readonly buffer DrawData {
+        float drawData[];
+    };
+
+    uniform mat4 viewProjection;
+
+    out vec2 TexCoord;
+    out vec4 Color;
+
+    void main() {
+        loadVertex();
+        const int base = gl_DrawID * 21;
+        mat4 transform;
+        for (int column = 0; column < 4; ++column)
+            transform[column] = vec4(drawData[base + column * 4], drawData[base + column * 4 + 1],
+                                     drawData[base + column * 4 + 2], drawData[base + column * 4 + 3]);
+        const vec4 uvRect = vec4(drawData[base + 16], drawData[base + 17], drawData[base + 18], drawData[base + 19]);
+        const vec4 tint = unpackUnorm4x8(floatBitsToUint(drawData[base + 20]));
+
+        gl_Position = viewProjection * transform * vec4(position, 1.0);
+        TexCoord = uvRect.xy + texCoord * uvRect.zw;
+        Color = color * tint;
+    }
+)";
+
+// 片段着色器和 InstancedMesh 的一样
+const char *fragmentShaderSource = R"(
+    #version 460 core
+    in vec2 TexCoord;
+    in vec4 Color;
+
+    out vec4 fragColor;
+
+    uniform sampler2D texture1;
+
+    void main() {
+        fragColor = texture(texture1, TexCoord) * Color;
+    }
+)";
+
+} // namespace
+
+IndirectBatch::IndirectBatch()
+    : program(nullptr), state(nullptr), vertexBuffer(QOpenGLBuffer::VertexBuffer),
+      indexBuffer(QOpenGLBuffer::IndexBuffer), vertexCapacity(0), indexCapacity(0), vertexCount(0), indexCount(0),
+      drawCapacity(4096), storageAlignment(16)
+{
+}
+
+IndirectBatch::~IndirectBatch()
+{
+    destroy();
+}
+
+void IndirectBatch::destroy()
+{
+    delete program;
+    program = nullptr;
+    stream.destroy();
+    indexBuffer.destroy();
+    vertexBuffer.destroy();
+    vao.destroy();
+    meshes.clear();
+    vertexCount = 0;
+    indexCount = 0;
+    if (state)
+        state->invalidate();  // 删掉的 VAO/程序/缓冲可能还记在缓存里
+}
+
+bool IndirectBatch::create(ShaderCache &shaderCache, GLStateCache &stateCache, const VertexFormat &format,
+                           int vertices, int indices)
+{
+    destroy();
+    initializeOpenGLFunctions();
+    state = &stateCache;
+
+    vertexFormat = format;
+    const QByteArray vertexShaderSource = vertexShaderVersion + vertexFormat.shaderInputs() + vertexShaderBody;
+    program = shaderCache.program(vertexShaderSource.constData(), fragmentShaderSource);
+    if (!program) {
+        qWarning("IndirectBatch: shader program failed to build");
+        return false;
+    }
+    glGetIntegerv(GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT, &storageAlignment);
+    storageAlignment = qMax(storageAlignment, GLint(4));
+
+    // 仓库：静态缓冲，addMesh() 往后追加，装不下时 reserve() 扩容
+    vertexCapacity = qMax(vertices, 3);
+    indexCapacity = qMax(indices, 3);
+    vertexBuffer.create();
+    vertexBuffer.setUsagePattern(QOpenGLBuffer::StaticDraw);
+    vertexBuffer.bind();
+    vertexBuffer.allocate(vertexCapacity * vertexFormat.stride());
+    indexBuffer.create();
+    indexBuffer.setUsagePattern(QOpenGLBuffer::StaticDraw);
+
+    vao.create();
+    vao.bind();
+    indexBuffer.bind();  // VAO 绑定着，VAO 会记住这个索引缓冲
+    indexBuffer.allocate(indexCapacity * int(sizeof(GLuint)));
+    vertexFormat.setupAttributes(this);
+    vao.release();
+    vertexBuffer.release();
+
+    if (!createStream()) {
+        destroy();
+        return false;
+    }
+    state->invalidate();  // 上面直接绑定过 VAO 和缓冲
+    return true;
+}
+
+bool IndirectBatch::createStream()
+{
+    // 一个区域里先放命令，再放（按 SSBO 偏移要求对齐的）绘制数据
+    const qsizetype bytes = drawCapacity * qsizetype(sizeof(DrawCommand) + sizeof(MeshInstance)) + storageAlignment;
+    return stream.create(bytes);
+}
+
+bool IndirectBatch::reserve(int vertices, int indices)
+{
+    if (vertexCount + vertices <= vertexCapacity && indexCount + indices <= indexCapacity)
+        return true;
+
+    // 新建两倍大的缓冲，已有的内容在 GPU 上拷过去（glCopyNamedBufferSubData），再把 VAO 指向新缓冲
+    int newVertexCapacity = vertexCapacity;
+    while (vertexCount + vertices > newVertexCapacity)
+        newVertexCapacity *= 2;
+    int newIndexCapacity = indexCapacity;
+    while (indexCount + indices > newIndexCapacity)
+        newIndexCapacity *= 2;
+
+    const int stride = vertexFormat.stride();
+    QOpenGLBuffer grownVertices(QOpenGLBuffer::VertexBuffer);
+    QOpenGLBuffer grownIndices(QOpenGLBuffer::IndexBuffer);
+    if (!grownVertices.create() || !grownIndices.create()) {
+        qWarning("IndirectBatch: cannot grow the mesh arena");
+        return false;
+    }
+    grownVertices.setUsagePattern(QOpenGLBuffer::StaticDraw);
+    grownVertices.bind();
+    grownVertices.allocate(newVertexCapacity * stride);
+    glCopyNamedBufferSubData(vertexBuffer.bufferId(), grownVertices.bufferId(), 0, 0,
+                             GLsizeiptr(vertexCount) * stride);
+
+    // 索引缓冲是 VAO 的状态：在自己的 VAO 绑定着的时候换，不会改到别的 VAO
+    vao.bind();
+    grownIndices.setUsagePattern(QOpenGLBuffer::StaticDraw);
+    grownIndices.bind();
+    grownIndices.allocate(newIndexCapacity * int(sizeof(GLuint)));
+    glCopyNamedBufferSubData(indexBuffer.bufferId(), grownIndices.bufferId(), 0, 0,
+                             GLsizeiptr(indexCount) * GLsizeiptr(sizeof(GLuint)));
+    vertexFormat.setupAttributes(this);
+    vao.release();
+    grownVertices.release();
+
+    vertexBuffer.destroy();
+    indexBuffer.destroy();
+    vertexBuffer = grownVertices;
+    indexBuffer = grownIndices;
+    vertexCapacity = newVertexCapacity;
+    indexCapacity = newIndexCapacity;
+    state->invalidate();  // 上面直接绑定过 VAO 和缓冲，删掉的缓冲也可能还记在缓存里
+    return true;
+}
+
+int IndirectBatch::addMesh(const SpriteVertex *vertices, int count, const GLuint *indices, int indicesCount)
+{
+    // 和 InstancedMesh::create 一样：SpriteVertex 没有法线，都朝 +z
+    std::vector<MeshVertex> meshVertices(static_cast<size_t>(count));
+    for (int i = 0; i < count; ++i) {
+        MeshVertex &v = meshVertices[size_t(i)];
+        std::memcpy(v.position, vertices[i].position, sizeof(v.position));
+        v.normal[0] = 0.0f;
+        v.normal[1] = 0.0f;
+        v.normal[2] = 1.0f;
+        std::memcpy(v.texCoord, vertices[i].texCoord, sizeof(v.texCoord));
+        std::memcpy(v.color, vertices[i].color, sizeof(v.color));
+    }
+    return addMesh(meshVertices.data(), count, indices, indicesCount);
+}
+
+int IndirectBatch::addMesh(const MeshVertex *vertices, int count, const GLuint *indices, int indicesCount)
+{
+    if (!program || count <= 0)
+        return -1;
+    std::vector<GLuint> sequential;
+    if (!indices) {
+        sequential.resize(size_t(count));
+        for (int i = 0; i < count; ++i)
+            sequential[size_t(i)] = GLuint(i);
+        indices = sequential.data();
+        indicesCount = count;
+    }
+    if (!reserve(count, indicesCount))
+        return -1;
+
+    // 索引保持相对网格自己的第一个顶点，绘制命令的 baseVertex 加上偏移。
+    // 用 DSA 直接写，不用绑定（索引缓冲一绑就会改到当前 VAO）
+    const QByteArray encoded = vertexFormat.encode(vertices, count);
+    glNamedBufferSubData(vertexBuffer.bufferId(), GLintptr(vertexCount) * vertexFormat.stride(),
+                         GLsizeiptr(encoded.size()), encoded.constData());
+    glNamedBufferSubData(indexBuffer.bufferId(), GLintptr(indexCount) * GLintptr(sizeof(GLuint)),
+                         GLsizeiptr(indicesCount) * GLsizeiptr(sizeof(GLuint)), indices);
+
+    ArenaMesh mesh;
+    mesh.firstIndex = GLuint(indexCount);
+    mesh.indexCount = GLuint(indicesCount);
+    mesh.baseVertex = vertexCount;
+    mesh.dequantize.translate(vertexFormat.positionOffset());
+    mesh.dequantize.scale(vertexFormat.positionScale());
+    mesh.identity = mesh.dequantize.isIdentity();
+    meshes.push_back(mesh);
+    vertexCount += count;
+    indexCount += indicesCount;
+    return int(meshes.size()) - 1;
+}
+
+void IndirectBatch::begin()
+{
+    commands.clear();
+    draws.clear();
+}
+
+void IndirectBatch::add(int mesh, const QMatrix4x4 &transform, const QRectF &uvRect, const QColor &tint)
+{
+    if (mesh < 0 || mesh >= int(meshes.size()))
+        return;
+    const ArenaMesh &m = meshes[size_t(mesh)];
+    commands.push_back({m.indexCount, 1, m.firstIndex, m.baseVertex, 0});
+    draws.push_back(MeshInstance::make(m.identity ? transform : transform * m.dequantize, uvRect, tint));
+}
+
+void IndirectBatch::addDraws(int mesh, const MeshInstance *data, int count)
+{
+    if (mesh < 0 || mesh >= int(meshes.size()) || count <= 0)
+        return;
+    const ArenaMesh &m = meshes[size_t(mesh)];
+    commands.insert(commands.end(), size_t(count), DrawCommand{m.indexCount, 1, m.firstIndex, m.baseVertex, 0});
+    const size_t first = draws.size();
+    draws.insert(draws.end(), data, data + count);
+    if (m.identity)
+        return;
+    for (size_t i = first; i < draws.size(); ++i) {
+        // MeshInstance 的变换是列主序，和 QMatrix4x4 的内存布局相同
+        const QMatrix4x4 transform = QMatrix4x4(draws[i].transform).transposed() * m.dequantize;
+        std::memcpy(draws[i].transform, transform.constData(), sizeof(draws[i].transform));
+    }
+}
+
+int IndirectBatch::addMeshLevel(int mesh, const GLuint *indices, int indicesCount)
+{
+    if (!program || mesh < 0 || mesh >= meshCount() || indicesCount <= 0)
+        return -1;
+    if (!reserve(0, indicesCount))
+        return -1;
+    glNamedBufferSubData(indexBuffer.bufferId(), GLintptr(indexCount) * GLintptr(sizeof(GLuint)),
+                         GLsizeiptr(indicesCount) * GLsizeiptr(sizeof(GLuint)), indices);
+
+    // baseVertex 和还原变换都和原来的网格一样，索引同样相对它的第一个顶点
+    ArenaMesh level = meshes[size_t(mesh)];
+    level.firstIndex = GLuint(indexCount);
+    level.indexCount = GLuint(indicesCount);
+    meshes.push_back(level);
+    indexCount += indicesCount;
+    return int(meshes.size()) - 1;
+}
+
+void IndirectBatch::draw(const QMatrix4x4 &viewProjection, GLuint texture)
+{
+    frameStats.draws = int(commands.size());
+    frameStats.triangles = 0;
+    for (const DrawCommand &command : commands)
+        frameStats.triangles += int(command.count / 3);
+    frameStats.drawCalls = 0;
+    if (!program || commands.empty())
+        return;
+
+    // 容量不够时等 GPU 空闲，把环形缓冲换成够大的（只在物体数变多后的第一帧出现）
+    if (qsizetype(commands.size()) > drawCapacity) {
+        while (drawCapacity < qsizetype(commands.size()))
+            drawCapacity *= 2;
+        glFinish();
+        createStream();
+    }
+
+    stream.beginFrame();
+    qsizetype commandOffset = 0, drawOffset = 0;
+    const qsizetype commandBytes = qsizetype(commands.size() * sizeof(DrawCommand));
+    const qsizetype drawBytes = qsizetype(draws.size() * sizeof(MeshInstance));
+    void *commandData = stream.allocate(commandBytes, sizeof(GLuint), &commandOffset);
+    void *drawData = commandData ? stream.allocate(drawBytes, storageAlignment, &drawOffset) : nullptr;
+    if (!drawData) {
+        qWarning("IndirectBatch: stream buffer unavailable, dropping %d draws", frameStats.draws);
+        stream.endFrame();
+        return;
+    }
+    std::memcpy(commandData, commands.data(), size_t(commandBytes));
+    std::memcpy(drawData, draws.data(), size_t(drawBytes));
+    frameStats.streamStalls = stream.stats().stalls;
+
+    state->bindVertexArray(vao.objectId());
+    state->useProgram(program->programId());
+    program->setUniformValue("viewProjection", viewProjection);
+    if (const VertexFormat::Attribute *position = vertexFormat.find(VertexFormat::Position)) {
+        if (position->encoding == VertexFormat::Snorm16) {
+            // 每个网格的还原变换已经乘进了命令的变换里
+            program->setUniformValue("positionScale", QVector3D(1.0f, 1.0f, 1.0f));
+            program->setUniformValue("positionOffset", QVector3D(0.0f, 0.0f, 0.0f));
+        }
+    }
+    state->bindTexture(0, texture);
+    state->bindBuffer(GL_DRAW_INDIRECT_BUFFER, stream.bufferId());
+    // glBindBufferRange 同时改通用绑定点，先经过缓存绑同一个缓冲，缓存里记的才和上下文一致
+    state->bindBuffer(GL_SHADER_STORAGE_BUFFER, stream.bufferId());
+    glBindBufferRange(GL_SHADER_STORAGE_BUFFER, 0, stream.bufferId(), GLintptr(drawOffset), GLsizeiptr(drawBytes));
+    glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, reinterpret_cast<const void *>(commandOffset),
+                                GLsizei(commands.size()), 0);
+    ++frameStats.drawCalls;
+
+    stream.endFrame();
+}
@@ -0,0 +1,110 @@
+#ifndef INDIRECTBATCH_H
+#define INDIRECTBATCH_H
+
+#include <QOpenGLShaderProgram>
+#include <QOpenGLVertexArrayObject>
+#include <QOpenGLBuffer>
+#include <QMatrix4x4>
+#include <vector>
+#include "GLTraceFunctions.h"
+#include "InstancedMesh.h"
+#include "StreamBuffer.h"
+#include "ShaderCache.h"
+#include "GLStateCache.h"
+#include "VertexFormat.h"
+
+/* IndirectBatch：很多个不同的网格、每个物体一条绘制命令，整帧只有一次 glMultiDrawElementsIndirect
+ *
+ * 网格都放在同一块 "顶点/索引仓库" 里（一个 VBO + 一个 EBO，一个 VAO），addMesh() 把网格追加到末尾，
+ * 返回的编号对应 (firstIndex, indexCount, baseVertex)；装不下时两块缓冲都按两倍扩容（GPU 上拷贝）。
+ *
+ * 每帧：
+ *   - add()/addDraws() 每个物体记一条 DrawElementsIndirectCommand 和一份绘制数据
+ *     （布局和 MeshInstance 相同：变换、纹理坐标范围、色调，84 字节）
+ *   - draw() 把命令和绘制数据一起写进持久映射的 StreamBuffer，命令所在的区间绑成 GL_DRAW_INDIRECT_BUFFER，
+ *     绘制数据绑成 SSBO（binding 0），顶点着色器用 gl_DrawID 找到自己那条命令的数据
+ * 不管多少个物体，CPU 这边都是几次绑定 + 一次绘制调用；写命令只是顺序拷贝。
+ *
+ * 和 InstancedMesh 一样，网格顶点按 VertexFormat 编码。Snorm16 位置每个网格的量化范围不一样，
+ * 这里把还原用的缩放/平移乘进每条命令的变换里，着色器里的 positionScale/positionOffset 固定为 1/0。
+ */
+class IndirectBatch : protected GLTraceFunctions
+{
+public:
+    struct Stats
+    {
+        int draws = 0;          // 本帧的绘制命令数（物体数）
+        int triangles = 0;      // 本帧所有命令的三角形数之和
+        int drawCalls = 0;
+        int streamStalls = 0;   // 命令/绘制数据缓冲等 GPU 的累计次数
+    };
+
+    IndirectBatch();
+    ~IndirectBatch();
+
+    // 上下文必须是当前上下文。容量只是初始大小，不够时自动扩容
+    bool create(ShaderCache &shaderCache, GLStateCache &state, const VertexFormat &format = VertexFormat::full(false),
+                int vertexCapacity = 65536, int indexCapacity = 196608);
+    void destroy();
+    bool isCreated() const { return program != nullptr; }
+
+    // 返回网格编号，失败时返回 -1。indices 为空时按 0, 1, 2 … 画顶点
+    int addMesh(const MeshVertex *vertices, int vertexCount, const GLuint *indices = nullptr, int indexCount = 0);
+    int addMesh(const SpriteVertex *vertices, int vertexCount, const GLuint *indices = nullptr, int indexCount = 0);
+    // 同一组顶点的另一套索引（LOD 的各层，见 Mesh::buildLods()）：只追加索引，返回新的网格编号，失败时返回 -1
+    int addMeshLevel(int mesh, const GLuint *indices, int indexCount);
+    int meshCount() const { return int(meshes.size()); }
+    int triangleCount(int mesh) const { return int(meshes[size_t(mesh)].indexCount / 3); }
+
+    void begin();
+    void add(int mesh, const QMatrix4x4 &transform, const QRectF &uvRect = QRectF(0, 0, 1, 1),
+             const QColor &tint = Qt::white);
+    void addDraws(int mesh, const MeshInstance *data, int count);   // count 个物体都画同一个网格
+    void draw(const QMatrix4x4 &viewProjection, GLuint texture);    // 一次绘制调用画完本帧所有命令
+
+    const Stats &stats() const { return frameStats; }
+    const VertexFormat &format() const { return vertexFormat; }
+
+private:
+    // GL 规定的间接绘制命令布局
+    struct DrawCommand
+    {
+        GLuint count;
+        GLuint instanceCount;
+        GLuint firstIndex;
+        GLint baseVertex;
+        GLuint baseInstance;
+    };
+
+    struct ArenaMesh
+    {
+        GLuint firstIndex;
+        GLuint indexCount;
+        GLint baseVertex;
+        QMatrix4x4 dequantize;   // Snorm16 位置的还原变换，其他格式是单位矩阵
+        bool identity;
+    };
+
+    bool reserve(int vertices, int indices);   // 仓库至少还能再装这么多，必要时扩容
+    bool createStream();                       // 按 drawCapacity 创建命令/绘制数据的环形缓冲
+
+    QOpenGLShaderProgram *program;
+    GLStateCache *state;
+    QOpenGLVertexArrayObject vao;
+    QOpenGLBuffer vertexBuffer;
+    QOpenGLBuffer indexBuffer;
+    StreamBuffer stream;               // 每帧的命令和绘制数据，同一块缓冲按不同目标绑定
+    VertexFormat vertexFormat;
+    std::vector<ArenaMesh> meshes;
+    int vertexCapacity;
+    int indexCapacity;
+    int vertexCount;                   // 仓库里已经用掉的顶点/索引个数
+    int indexCount;
+    qsizetype drawCapacity;            // 环形缓冲每个区域能装下的命令条数
+    GLint storageAlignment;            // GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT
+    std::vector<DrawCommand> commands;
+    std::vector<MeshInstance> draws;   // 第 i 条命令的绘制数据
+    Stats frameStats;
+};
+
+#endif // INDIRECTBATCH_H
@@ -0,0 +1,250 @@
+#include "InstancedMesh.h"
+#include <cstddef>
+#include <cstring>
+#include <QDebug>
+
+namespace {
+
+/* 顶点着色器：先乘实例自己的变换，再乘整批共用的 viewProjection；纹理坐标映射到实例的 uvRect。
+ * 网格顶点的 in 声明和 loadVertex() 由 VertexFormat::shaderInputs() 按顶点格式生成，插在 #version 后面 */
+const char *vertexShaderVersion = "#version 460 core\n";
+const char *vertexShaderBody = R"(
+    layout(location = 3) in mat4 instanceTransform;  // 实例数据（每个实例前进一次），mat4 占 3、4、5、6 四个位置
+    layout(location = 7) in vec4 instanceUvRect;
+    layout(location = 8) in vec4 instanceTint;
+
+    uniform mat4 viewProjection;
+
+    out vec2 TexCoord;
+    out vec4 Color;
+
+    void main() {
+        loadVertex();   // 网格顶点（每个顶点前进一次）解码成 position/texCoord/color
+        gl_Position = viewProjection * instanceTransform * vec4(position, 1.0);
+        TexCoord = instanceUvRect.xy + texCoord * instanceUvRect.zw;
+        Color = color * instanceTint;
+    }
+)";
+
+// 片段着色器和 SpriteBatch 的一样
+const char *fragmentShaderSource = R"(
+    #version 460 core
+    in vec2 TexCoord;
+    in vec4 Color;
+
+    out vec4 fragColor;
+
+    uniform sampler2D texture1;
+
+    void main() {
+        fragColor = texture(texture1, TexCoord) * Color;
+    }
+)";
+
+} // namespace
+
+MeshInstance MeshInstance::make(const QMatrix4x4 &transform, const QRectF &uvRect, const QColor &tint)
+{
+    MeshInstance instance;
+    std::memcpy(instance.transform, transform.constData(), sizeof(instance.transform));
+    instance.uvRect[0] = GLfloat(uvRect.x());
+    instance.uvRect[1] = GLfloat(uvRect.y());
+    instance.uvRect[2] = GLfloat(uvRect.width());
+    instance.uvRect[3] = GLfloat(uvRect.height());
+    instance.tint[0] = GLubyte(tint.red());
+    instance.tint[1] = GLubyte(tint.green());
+    instance.tint[2] = GLubyte(tint.blue());
+    instance.tint[3] = GLubyte(tint.alpha());
+    return instance;
+}
+
+InstancedMesh::InstancedMesh()
+    : program(nullptr), state(nullptr), vertexBuffer(QOpenGLBuffer::VertexBuffer),
+      indexBuffer(QOpenGLBuffer::IndexBuffer), vertexCount(0), indexCount(0), instanceCapacity(4096)
+{
+}
+
+InstancedMesh::~InstancedMesh()
+{
+    destroy();
+}
+
+void InstancedMesh::destroy()
+{
+    delete program;
+    program = nullptr;
+    instanceStream.destroy();
+    indexBuffer.destroy();
+    vertexBuffer.destroy();
+    vao.destroy();
+    if (state)
+        state->invalidate();  // 删掉的 VAO/程序可能还记在缓存里
+}
+
+bool InstancedMesh::createQuad(ShaderCache &shaderCache, GLStateCache &stateCache)
+{
+    // 单位正方形的四个角，逆时针：左下、右下、右上、左上（和 SpriteBatch::submitQuad 相同）
+    static const SpriteVertex corners[4] = {
+        { {-0.5f, -0.5f, 0.0f}, {0.0f, 0.0f}, {255, 255, 255, 255} },
+        { {0.5f, -0.5f, 0.0f},  {1.0f, 0.0f}, {255, 255, 255, 255} },
+        { {0.5f, 0.5f, 0.0f},   {1.0f, 1.0f}, {255, 255, 255, 255} },
+        { {-0.5f, 0.5f, 0.0f},  {0.0f, 1.0f}, {255, 255, 255, 255} }
+    };
+    static const GLuint indices[6] = {0, 1, 2, 0, 2, 3};
+    return create(shaderCache, stateCache, corners, 4, indices, 6);
+}
+
+bool InstancedMesh::create(ShaderCache &shaderCache, GLStateCache &stateCache, const SpriteVertex *vertices,
+                           int count, const GLuint *indices, int indicesCount, const VertexFormat &format)
+{
+    // SpriteVertex 没有法线，都朝 +z；默认格式也不带法线，和原来的 SpriteVertex 布局一样是 24 字节
+    std::vector<MeshVertex> meshVertices(static_cast<size_t>(count));
+    for (int i = 0; i < count; ++i) {
+        MeshVertex &v = meshVertices[size_t(i)];
+        std::memcpy(v.position, vertices[i].position, sizeof(v.position));
+        v.normal[0] = 0.0f;
+        v.normal[1] = 0.0f;
+        v.normal[2] = 1.0f;
+        std::memcpy(v.texCoord, vertices[i].texCoord, sizeof(v.texCoord));
+        std::memcpy(v.color, vertices[i].color, sizeof(v.color));
+    }
+    return create(shaderCache, stateCache, meshVertices.data(), count, format, indices, indicesCount);
+}
+
+bool InstancedMesh::create(ShaderCache &shaderCache, GLStateCache &stateCache, const MeshVertex *vertices,
+                           int count, const VertexFormat &format, const GLuint *indices, int indicesCount)
+{
+    destroy();
+    initializeOpenGLFunctions();
+    state = &stateCache;
+
+    vertexFormat = format;
+    const QByteArray encoded = vertexFormat.encode(vertices, count);  // Snorm16 位置的量化范围在这里确定
+    const QByteArray vertexShaderSource = vertexShaderVersion + vertexFormat.shaderInputs() + vertexShaderBody;
+    program = shaderCache.program(vertexShaderSource.constData(), fragmentShaderSource);
+    if (!program) {
+        qWarning("InstancedMesh: shader program failed to build");
+        return false;
+    }
+
+    vertexCount = count;
+    indexCount = indices ? indicesCount : 0;
+
+    // 实例缓冲要在绑定 VAO 之前创建（同 SpriteBatch::createBuffers）
+    instanceStream.create(instanceCapacity * qsizetype(sizeof(MeshInstance)));
+
+    vao.create();
+    vao.bind();
+
+    // 网格本身不会变，普通的静态 VBO/EBO 上传一次就够了
+    vertexBuffer.create();
+    vertexBuffer.setUsagePattern(QOpenGLBuffer::StaticDraw);
+    vertexBuffer.bind();
+    vertexBuffer.allocate(encoded.constData(), int(encoded.size()));
+    if (indexCount > 0) {
+        indexBuffer.create();
+        indexBuffer.setUsagePattern(QOpenGLBuffer::StaticDraw);
+        indexBuffer.bind();  // VAO 绑定着，VAO 会记住这个索引缓冲
+        indexBuffer.allocate(indices, indexCount * int(sizeof(GLuint)));
+    }
+
+    // 每个顶点的属性：类型、归一化、偏移、步长都来自顶点格式，和上面生成的着色器输入一致
+    vertexFormat.setupAttributes(this);
+
+    setupInstanceAttributes();
+
+    vao.release();
+    vertexBuffer.release();
+    state->invalidate();  // 上面直接绑定过 VAO 和缓冲
+    return true;
+}
+
+void InstancedMesh::setupInstanceAttributes()
+{
+    // VAO 必须已经绑定。glVertexAttribDivisor(index, 1)：这个属性每画完一个实例才前进一格
+    instanceStream.bind();
+    const GLsizei stride = sizeof(MeshInstance);
+    for (int column = 0; column < 4; ++column) {
+        // mat4 属性占 4 个连续的位置，每个位置是矩阵的一列
+        const GLuint location = GLuint(3 + column);
+        glVertexAttribPointer(location, 4, GL_FLOAT, GL_FALSE, stride,
+                              (void*)(offsetof(MeshInstance, transform) + column * 4 * sizeof(GLfloat)));
+        glEnableVertexAttribArray(location);
+        glVertexAttribDivisor(location, 1);
+    }
+    glVertexAttribPointer(7, 4, GL_FLOAT, GL_FALSE, stride, (void*)offsetof(MeshInstance, uvRect));
+    glEnableVertexAttribArray(7);
+    glVertexAttribDivisor(7, 1);
+    glVertexAttribPointer(8, 4, GL_UNSIGNED_BYTE, GL_TRUE, stride, (void*)offsetof(MeshInstance, tint));
+    glEnableVertexAttribArray(8);
+    glVertexAttribDivisor(8, 1);
+    instanceStream.release();
+}
+
+void InstancedMesh::createInstanceStream()
+{
+    instanceStream.create(instanceCapacity * qsizetype(sizeof(MeshInstance)));
+    vao.bind();
+    setupInstanceAttributes();
+    vao.release();
+    state->invalidate();
+}
+
+void InstancedMesh::begin()
+{
+    instances.clear();
+}
+
+void InstancedMesh::add(const QMatrix4x4 &transform, const QRectF &uvRect, const QColor &tint)
+{
+    instances.push_back(MeshInstance::make(transform, uvRect, tint));
+}
+
+void InstancedMesh::addInstances(const MeshInstance *data, int count)
+{
+    instances.insert(instances.end(), data, data + count);
+}
+
+void InstancedMesh::draw(const QMatrix4x4 &viewProjection, GLuint texture)
+{
+    frameStats.instances = int(instances.size());
+    frameStats.triangles = frameStats.instances * (indexCount > 0 ? indexCount : vertexCount) / 3;
+    frameStats.drawCalls = 0;
+    if (!program || instances.empty())
+        return;
+
+    // 容量不够时等 GPU 空闲，把实例缓冲换成够大的（只在实例数变多后的第一帧出现）
+    if (qsizetype(instances.size()) > instanceCapacity) {
+        while (instanceCapacity < qsizetype(instances.size()))
+            instanceCapacity *= 2;
+        glFinish();
+        createInstanceStream();
+    }
+
+    instanceStream.beginFrame();
+    qsizetype offset = 0;
+    const qsizetype bytes = qsizetype(instances.size() * sizeof(MeshInstance));
+    void *dst = instanceStream.allocate(bytes, sizeof(MeshInstance), &offset);
+    if (!dst) {
+        qWarning("InstancedMesh: stream buffer unavailable, dropping %d instances", frameStats.instances);
+        return;
+    }
+    std::memcpy(dst, instances.data(), size_t(bytes));
+    frameStats.streamStalls = instanceStream.stats().stalls;
+
+    // 区域大小是 MeshInstance 的整数倍，offset 一定能整除
+    const GLuint baseInstance = GLuint(offset / qsizetype(sizeof(MeshInstance)));
+    state->bindVertexArray(vao.objectId());
+    state->useProgram(program->programId());
+    program->setUniformValue("viewProjection", viewProjection);
+    vertexFormat.setUniforms(program);
+    state->bindTexture(0, texture);
+    if (indexCount > 0)
+        glDrawElementsInstancedBaseInstance(GL_TRIANGLES, indexCount, GL_UNSIGNED_INT, nullptr,
+                                            GLsizei(instances.size()), baseInstance);
+    else
+        glDrawArraysInstancedBaseInstance(GL_TRIANGLES, 0, vertexCount, GLsizei(instances.size()), baseInstance);
+    ++frameStats.drawCalls;
+
+    instanceStream.endFrame();
+}
@@ -0,0 +1,97 @@
+#ifndef INSTANCEDMESH_H
+#define INSTANCEDMESH_H
+
+#include <QOpenGLShaderProgram>
+#include <QOpenGLVertexArrayObject>
+#include <QOpenGLBuffer>
+#include <QMatrix4x4>
+#include <QRectF>
+#include <QColor>
+#include <vector>
+#include "GLTraceFunctions.h"
+#include "SpriteBatch.h"
+#include "StreamBuffer.h"
+#include "ShaderCache.h"
+#include "GLStateCache.h"
+#include "VertexFormat.h"
+
+// 每个实例的数据：变换矩阵 + 纹理坐标范围 + 色调，共 84 字节
+struct MeshInstance
+{
+    GLfloat transform[16];  // 列主序，和 QMatrix4x4::constData() 相同
+    GLfloat uvRect[4];      // x, y, 宽, 高：网格的纹理坐标 (u, v) 映射到 (x + u * 宽, y + v * 高)
+    GLubyte tint[4];        // RGBA8，和顶点颜色相乘
+
+    static MeshInstance make(const QMatrix4x4 &transform, const QRectF &uvRect = QRectF(0, 0, 1, 1),
+                             const QColor &tint = Qt::white);
+};
+
+/* InstancedMesh：同一个网格画很多次，只用一次绘制调用（硬件实例化）
+ *
+ * 两个 VBO：
+ *   - 网格本身，按 VertexFormat 编码（默认和 SpriteVertex 一样全是 float，可选半精度/snorm16 位置、
+ *     unorm16 纹理坐标、10_10_10_2 法线），创建时上传一次；VAO 的属性和着色器的输入都由格式生成
+ *   - 实例数据（MeshInstance，属性位置 3-6 是矩阵的四列、7 纹理坐标范围、8 色调），
+ *     glVertexAttribDivisor(…, 1) 让它们每个实例前进一次而不是每个顶点。
+ *     实例数据每帧重写，放在持久映射的 StreamBuffer 里
+ *
+ * 实例数据写在环形缓冲当前区域的某个偏移处，用 glDraw*InstancedBaseInstance 的 baseInstance
+ * 偏移过去（对应 SpriteBatch 里的 baseVertex），VAO 里的属性指针不用每帧重设。
+ *
+ * 用法（每帧）：
+ *   mesh.begin();
+ *   mesh.add(transform, uvRect, tint);   // 或者 addInstances() 整块拷贝
+ *   mesh.draw(viewProjection, texture);
+ */
+class InstancedMesh : protected GLTraceFunctions
+{
+public:
+    struct Stats
+    {
+        int instances = 0;
+        int triangles = 0;      // 实例数 * 网格的三角形数
+        int drawCalls = 0;
+        int streamStalls = 0;   // 实例缓冲等 GPU 的累计次数
+    };
+
+    InstancedMesh();
+    ~InstancedMesh();
+
+    // 上下文必须是当前上下文。indices 为空时按 GL_TRIANGLES 直接画顶点
+    bool create(ShaderCache &shaderCache, GLStateCache &state, const SpriteVertex *vertices, int vertexCount,
+                const GLuint *indices = nullptr, int indexCount = 0,
+                const VertexFormat &format = VertexFormat::full(false));
+    // 大网格用紧凑格式（VertexFormat::compact()）上传，显存和顶点带宽大约减半
+    bool create(ShaderCache &shaderCache, GLStateCache &state, const MeshVertex *vertices, int vertexCount,
+                const VertexFormat &format, const GLuint *indices = nullptr, int indexCount = 0);
+    bool createQuad(ShaderCache &shaderCache, GLStateCache &state);  // 以原点为中心的单位正方形，和 SpriteBatch::submitQuad 一致
+    void destroy();
+    bool isCreated() const { return program != nullptr; }
+
+    void begin();
+    void add(const QMatrix4x4 &transform, const QRectF &uvRect = QRectF(0, 0, 1, 1), const QColor &tint = Qt::white);
+    void addInstances(const MeshInstance *data, int count);
+    void draw(const QMatrix4x4 &viewProjection, GLuint texture);  // 一次绘制调用画完本帧所有实例
+
+    const Stats &stats() const { return frameStats; }
+    const VertexFormat &format() const { return vertexFormat; }
+
+private:
+    void createInstanceStream();      // 按 instanceCapacity 创建实例缓冲并在 VAO 里设置属性 3-8
+    void setupInstanceAttributes();
+
+    QOpenGLShaderProgram *program;
+    GLStateCache *state;
+    QOpenGLVertexArrayObject vao;
+    QOpenGLBuffer vertexBuffer;
+    QOpenGLBuffer indexBuffer;
+    StreamBuffer instanceStream;
+    VertexFormat vertexFormat;         // 网格顶点的格式（encode() 之后带着 Snorm16 位置的还原参数）
+    int vertexCount;
+    int indexCount;
+    qsizetype instanceCapacity;        // 环形缓冲每个区域能装下的实例个数
+    std::vector<MeshInstance> instances;
+    Stats frameStats;
+};
+
+#endif // INSTANCEDMESH_H
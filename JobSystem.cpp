@@ -0,0 +1,178 @@
+#include "JobSystem.h"
+#include <QMutexLocker>
+
+namespace {
+
+// 当前线程是哪个 JobSystem 的第几个队列（工作线程启动时设置）
+thread_local const JobSystem *currentSystem = nullptr;
+thread_local int currentQueueIndex = 0;
+
+const int SpinRounds = 64;   // 偷不到活时先让出 CPU 重试这么多轮再睡，帧内相邻两次 parallelFor() 之间不用睡醒
+
+} // namespace
+
+JobSystem::JobSystem(int workerThreads)
+    : sleeping(0), epoch(0), stopping(false), jobCount(0), stealCount(0)
+{
+    if (workerThreads < 0)
+        workerThreads = qMax(0, QThread::idealThreadCount() - 1);
+
+    for (int i = 0; i <= workerThreads; ++i)
+        queues.push_back(new JobQueue());
+    for (int i = 0; i < workerThreads; ++i) {
+        QThread *thread = QThread::create([this, i] { workerLoop(i + 1); });
+        thread->setObjectName(QStringLiteral("JobWorker%1").arg(i));
+        thread->start();
+        workers.push_back(thread);
+    }
+}
+
+JobSystem::~JobSystem()
+{
+    {
+        QMutexLocker locker(&sleepMutex);
+        stopping.store(true);
+        wakeCondition.wakeAll();
+    }
+    for (QThread *thread : workers) {
+        thread->wait();
+        delete thread;
+    }
+    for (JobQueue *queue : queues)
+        delete queue;
+}
+
+JobSystem::Stats JobSystem::stats() const
+{
+    Stats s;
+    s.jobs = jobCount.load(std::memory_order_relaxed);
+    s.steals = stealCount.load(std::memory_order_relaxed);
+    return s;
+}
+
+void JobSystem::resetStats()
+{
+    jobCount.store(0, std::memory_order_relaxed);
+    stealCount.store(0, std::memory_order_relaxed);
+}
+
+void JobSystem::parallelFor(int count, int grain, const std::function<void(int, int)> &body)
+{
+    if (count <= 0)
+        return;
+    grain = qMax(1, grain);
+    if (workers.empty() || count <= grain) {
+        body(0, count);
+        jobCount.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    // 块数不能超过队列容量：块太多时加大每块的大小
+    if ((count + grain - 1) / grain > QueueCapacity)
+        grain = (count + QueueCapacity - 1) / QueueCapacity;
+    const int jobs = (count + grain - 1) / grain;
+
+    // 非工作线程先拿到 0 号队列；拿到以后在块里嵌套调用时已经是 "本系统的线程"，不再加锁
+    const bool external = currentSystem != this;
+    QMutexLocker locker(external ? &submitMutex : nullptr);
+    const JobSystem *previousSystem = currentSystem;
+    const int previousQueue = currentQueueIndex;
+    if (external) {
+        currentSystem = this;
+        currentQueueIndex = 0;
+    }
+    const int queue = currentQueueIndex;
+
+    // 这次调用的块放在栈上：parallelFor() 要等它们全部完成才返回
+    std::vector<Job> storage(static_cast<size_t>(jobs));
+    std::atomic<int> pending(jobs);
+    JobQueue *own = queues[size_t(queue)];
+    // 倒着放：自己 pop() 从底部取，先做的是第一块，偷的人从顶部取最后几块
+    for (int i = jobs - 1; i >= 0; --i) {
+        Job &job = storage[size_t(i)];
+        job.body = &body;
+        job.begin = i * grain;
+        job.end = qMin(count, job.begin + grain);
+        job.pending = &pending;
+        if (!own->push(&job))
+            execute(&job, false);   // 别的 parallelFor() 的块占满了队列（嵌套调用）：直接做
+    }
+    wakeWorkers();
+
+    // 等待期间帮忙：可能执行到别的 parallelFor() 的块（嵌套时），同样是有用的活
+    int idleRounds = 0;
+    while (pending.load(std::memory_order_acquire) > 0) {
+        bool stolen = false;
+        if (Job *job = findJob(queue, &stolen)) {
+            execute(job, stolen);
+            idleRounds = 0;
+        } else if (++idleRounds > SpinRounds) {
+            QThread::yieldCurrentThread();
+        }
+    }
+    currentSystem = previousSystem;
+    currentQueueIndex = previousQueue;
+}
+
+void JobSystem::execute(Job *job, bool stolen)
+{
+    (*job->body)(job->begin, job->end);
+    jobCount.fetch_add(1, std::memory_order_relaxed);
+    if (stolen)
+        stealCount.fetch_add(1, std::memory_order_relaxed);
+    job->pending->fetch_sub(1, std::memory_order_release);
+}
+
+JobSystem::Job *JobSystem::findJob(int queue, bool *stolen)
+{
+    if (Job *job = queues[size_t(queue)]->pop()) {
+        *stolen = false;
+        return job;
+    }
+    // 从下一个队列开始轮一圈，各线程的起点不同，不会都去抢同一个队列
+    const int n = int(queues.size());
+    for (int k = 1; k < n; ++k) {
+        if (Job *job = queues[size_t((queue + k) % n)]->steal()) {
+            *stolen = true;
+            return job;
+        }
+    }
+    return nullptr;
+}
+
+void JobSystem::workerLoop(int queue)
+{
+    currentSystem = this;
+    currentQueueIndex = queue;
+
+    int idleRounds = 0;
+    while (!stopping.load(std::memory_order_acquire)) {
+        const quint64 seen = epoch.load();
+        bool stolen = false;
+        if (Job *job = findJob(queue, &stolen)) {
+            execute(job, stolen);
+            idleRounds = 0;
+            continue;
+        }
+        if (++idleRounds <= SpinRounds) {
+            QThread::yieldCurrentThread();
+            continue;
+        }
+
+        // 睡之前先登记再检查 epoch：提交方先改 epoch 再看 sleeping，两边总有一方看到对方
+        QMutexLocker locker(&sleepMutex);
+        sleeping.fetch_add(1);
+        if (epoch.load() == seen && !stopping.load())
+            wakeCondition.wait(&sleepMutex);
+        sleeping.fetch_sub(1);
+        idleRounds = 0;
+    }
+}
+
+void JobSystem::wakeWorkers()
+{
+    epoch.fetch_add(1);
+    if (sleeping.load() > 0) {
+        QMutexLocker locker(&sleepMutex);
+        wakeCondition.wakeAll();
+    }
+}
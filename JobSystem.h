@@ -0,0 +1,76 @@
+#ifndef JOBSYSTEM_H
+#define JOBSYSTEM_H
+
+#include <QThread>
+#include <QMutex>
+#include <QWaitCondition>
+#include <atomic>
+#include <functional>
+#include <vector>
+#include "WorkStealingDeque.h"
+
+/* JobSystem：固定数量的工作线程 + 工作窃取，给每帧的 CPU 活（剔除、生成顶点……）分核
+ *
+ * 线程数固定（默认 QThread::idealThreadCount() - 1 个工作线程，加上调用线程自己），创建时启动，
+ * 析构时停止，中间不增减。每个线程一个 WorkStealingDeque：
+ *   - parallelFor() 把范围切成块，全部放进调用线程自己的队列，然后自己也从队列里取块执行
+ *   - 空闲的工作线程轮流从别人的队列顶部偷块；一段时间偷不到就睡在条件变量上，有新任务时再叫醒
+ *   - 调用线程等待期间不闲着：先做自己队列里的，做完了也去偷，直到它提交的块全部完成
+ * 块在工作线程里也可以再调用 parallelFor()（嵌套），内层的块放进那个工作线程自己的队列。
+ *
+ * 不是工作线程的线程（GUI 线程、RenderThread）共用 0 号队列，同一时间只允许一个这样的线程提交，
+ * 用 submitMutex 排队（拿到锁的线程在这次 parallelFor() 期间算作 0 号线程，块里嵌套调用不会再加锁）；
+ * 平时只有一个线程调用 Renderer::render()，这个锁不会有竞争。
+ */
+class JobSystem
+{
+public:
+    struct Stats
+    {
+        quint64 jobs = 0;     // 执行过的块数
+        quint64 steals = 0;   // 其中被别的线程偷去执行的块数
+    };
+
+    explicit JobSystem(int workers = -1);   // -1 = QThread::idealThreadCount() - 1，0 = 全部在调用线程里执行
+    ~JobSystem();
+
+    int workerCount() const { return int(workers.size()); }
+    int threadCount() const { return workerCount() + 1; }   // 包括调用线程
+
+    /* 把 [0, count) 切成每块 grain 个（最后一块可能不足），在各个线程上执行 body(begin, end)，
+     * 全部完成后返回。块之间没有先后顺序，body 要能同时在多个线程里执行 */
+    void parallelFor(int count, int grain, const std::function<void(int, int)> &body);
+
+    Stats stats() const;   // 上次 resetStats() 以来的累计值
+    void resetStats();
+
+private:
+    struct Job
+    {
+        const std::function<void(int, int)> *body;
+        int begin;
+        int end;
+        std::atomic<int> *pending;   // 所属 parallelFor() 还没完成的块数
+    };
+
+    enum { QueueCapacity = 1024 };   // 每个线程的队列长度，一次 parallelFor() 最多切这么多块
+    typedef WorkStealingDeque<Job, QueueCapacity> JobQueue;
+
+    void execute(Job *job, bool stolen);
+    Job *findJob(int queue, bool *stolen);       // 先取自己的，再从别的队列偷
+    void workerLoop(int queue);
+    void wakeWorkers();
+
+    std::vector<QThread *> workers;
+    std::vector<JobQueue *> queues;              // queues[0] 给非工作线程，queues[i + 1] 给 workers[i]
+    QMutex submitMutex;                          // 非工作线程提交时持有
+    QMutex sleepMutex;
+    QWaitCondition wakeCondition;
+    std::atomic<int> sleeping;                   // 睡在 wakeCondition 上的工作线程数
+    std::atomic<quint64> epoch;                  // 每次提交加一，工作线程睡前检查，避免漏掉唤醒
+    std::atomic<bool> stopping;
+    std::atomic<quint64> jobCount;
+    std::atomic<quint64> stealCount;
+};
+
+#endif // JOBSYSTEM_H
@@ -0,0 +1,83 @@
+#include "LodSelector.h"
+#include <QVector4D>
+#include <algorithm>
+
+LodSelector::LodSelector()
+    : levelErrors(1, 0.0f), threshold(1.0f), hysteresis(0.2f), impostorPixels(0.0f), impostorRadius(0.0f)
+{
+}
+
+void LodSelector::setLevels(const std::vector<float> &errors)
+{
+    levelErrors = errors.empty() ? std::vector<float>(1, 0.0f) : errors;
+    std::fill(current.begin(), current.end(), 0);
+}
+
+void LodSelector::setImpostorSize(float pixels, float radius)
+{
+    impostorPixels = pixels;
+    impostorRadius = radius;
+}
+
+void LodSelector::resize(int objects)
+{
+    current.assign(size_t(std::max(0, objects)), 0);
+}
+
+int LodSelector::coarsest(float pixelsPerUnit, float pixels) const
+{
+    for (int level = levelCount() - 1; level > 0; --level) {
+        if (levelErrors[size_t(level)] * pixelsPerUnit <= pixels)
+            return level;
+    }
+    return 0;
+}
+
+int LodSelector::select(int object, float pixelsPerUnit)
+{
+    int &selected = current[size_t(object)];
+    const int previous = selected;
+
+    const bool wasImpostor = previous == Impostor;
+    if (impostorPixels > 0.0f) {
+        // 公告板也带滞后：变成公告板要小于下限，变回网格要大于上限
+        const float diameter = 2.0f * impostorRadius * pixelsPerUnit;
+        const float limit = impostorPixels * (wasImpostor ? 1.0f + hysteresis : 1.0f - hysteresis);
+        if (diameter < limit) {
+            selected = Impostor;
+            ++counters.impostors;
+            if (!wasImpostor)
+                ++counters.switches;
+            return Impostor;
+        }
+    }
+
+    if (threshold <= 0.0f) {
+        selected = 0;
+    } else {
+        // coarse 是可以换过去的最粗的层，fine 是不用换回细层的最粗的层，coarse <= fine
+        const int coarse = coarsest(pixelsPerUnit, threshold * (1.0f - hysteresis));
+        const int fine = coarsest(pixelsPerUnit, threshold * (1.0f + hysteresis));
+        if (wasImpostor)
+            selected = coarse;   // 从公告板回来说明物体在变大，按严格的一边选
+        else
+            selected = std::min(std::max(selected, coarse), fine);
+    }
+    if (selected != previous)
+        ++counters.switches;
+    return selected;
+}
+
+float LodSelector::pixelsPerUnit(const QMatrix4x4 &viewProjection, const QMatrix4x4 &transform,
+                                 const QVector3D &center, float viewportHeight)
+{
+    const QVector4D clip = viewProjection * transform * QVector4D(center, 1.0f);
+    const float w = std::max(clip.w(), 1.0e-6f);   // 在相机后面的物体：当成非常大，用最细的层
+    // transform 各轴的缩放取最大的一个（不等比缩放时偏保守）
+    float scale = 0.0f;
+    for (int column = 0; column < 3; ++column)
+        scale = std::max(scale, transform.column(column).toVector3D().length());
+    // 观察矩阵是旋转 + 平移，投影矩阵第 2 行的前三个数的长度就是它对观察空间 y 的缩放
+    const float projectionScale = QVector3D(viewProjection(1, 0), viewProjection(1, 1), viewProjection(1, 2)).length();
+    return scale * projectionScale * 0.5f * viewportHeight / w;
+}
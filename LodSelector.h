@@ -0,0 +1,67 @@
+#ifndef LODSELECTOR_H
+#define LODSELECTOR_H
+
+#include <QMatrix4x4>
+#include <QVector3D>
+#include <vector>
+
+/* LodSelector：每帧给每个物体选一层 LOD
+ *
+ * 每层有一个模型坐标里的几何误差（Mesh::buildLods()），乘上物体在屏幕上 "每单位长度多少像素"
+ * （pixelsPerUnit()）就是这层画出来和原始网格最多差几个像素。选误差不超过 errorThreshold 像素的最粗的一层。
+ *
+ * 滞后：物体的屏幕大小在两层的分界附近来回变时（相机慢慢移动、物体缓缓缩放），每帧都换层会看得到闪烁。
+ * 所以换粗一层要求误差 <= threshold * (1 - hysteresis)，换回细一层要等误差 > threshold * (1 + hysteresis)，
+ * 中间这一段保持上一帧的选择。每个物体记着自己当前的层。
+ *
+ * 公告板（impostor）：包围球投影的直径小于 impostorSize 像素时连最粗的一层也不画，
+ * 改画一张预先渲染好的模型图片（Renderer 用 SpriteBatch 画成一个四边形），同样带滞后。
+ */
+class LodSelector
+{
+public:
+    enum { Impostor = -1 };   // select() 返回它时画公告板
+
+    struct Stats
+    {
+        int switches = 0;    // 换层的次数（包括换成/换回公告板）
+        int impostors = 0;   // 选了公告板的物体数
+    };
+
+    LodSelector();
+
+    void setLevels(const std::vector<float> &errors);   // 每层的几何误差，第 0 层是 0，逐层不减
+    int levelCount() const { return int(levelErrors.size()); }
+    void setErrorThreshold(float pixels) { threshold = pixels; }   // <= 0 时总是第 0 层
+    float errorThreshold() const { return threshold; }
+    void setHysteresis(float fraction) { hysteresis = fraction; }  // 默认 0.2
+    // 包围球投影直径小于 pixels 时画公告板，radius 是模型坐标里的包围球半径。pixels <= 0（默认）= 不用公告板
+    void setImpostorSize(float pixels, float radius);
+
+    void resize(int objects);   // 所有物体回到第 0 层
+    int size() const { return int(current.size()); }
+    int select(int object, float pixelsPerUnit);   // 返回层号或者 Impostor
+    int level(int object) const { return current[size_t(object)]; }
+
+    const Stats &stats() const { return counters; }
+    void resetStats() { counters = Stats(); }
+
+    /* 物体在屏幕上每单位长度（模型坐标）多少像素，在 center（模型坐标）处计算：
+     * transform 的最大缩放 * 投影矩阵对 y 的缩放 * 视口高度 / 2 / 裁剪空间的 w。
+     * 正交投影 w 是 1，透视投影 w 是到相机的距离，远处的物体自然变小 */
+    static float pixelsPerUnit(const QMatrix4x4 &viewProjection, const QMatrix4x4 &transform, const QVector3D &center,
+                               float viewportHeight);
+
+private:
+    int coarsest(float pixelsPerUnit, float pixels) const;   // 误差不超过 pixels 的最粗的层
+
+    std::vector<float> levelErrors;
+    std::vector<int> current;
+    float threshold;
+    float hysteresis;
+    float impostorPixels;
+    float impostorRadius;
+    Stats counters;
+};
+
+#endif // LODSELECTOR_H
@@ -0,0 +1,722 @@
+#include "Mesh.h"
+#include "MeshSimplifier.h"
+#include <QFile>
+#include <QFileInfo>
+#include <QDir>
+#include <QUrl>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QMatrix4x4>
+#include <QQuaternion>
+#include <QVector2D>
+#include <QtEndian>
+#include <algorithm>
+#include <charconv>
+#include <cstring>
+#include <functional>
+#include <limits>
+#include <unordered_map>
+
+namespace {
+
+const MeshVertex defaultVertex = { {0.0f, 0.0f, 0.0f}, {0.0f, 0.0f, 0.0f}, {0.0f, 0.0f}, {255, 255, 255, 255} };
+
+// ---- OBJ ----
+
+// 数字用 std::from_chars 解析：QCoreApplication 会按系统区域设置 setlocale()，strtof 在德语等区域下不认小数点
+const char *skipSpaces(const char *p, const char *end)
+{
+    while (p < end && (*p == ' ' || *p == '\t'))
+        ++p;
+    return p;
+}
+
+bool parseFloat(const char *&p, const char *end, float *value)
+{
+    p = skipSpaces(p, end);
+    if (p < end && *p == '+')
+        ++p;
+    const std::from_chars_result r = std::from_chars(p, end, *value);
+    if (r.ec != std::errc())
+        return false;
+    p = r.ptr;
+    return true;
+}
+
+bool parseInt(const char *&p, const char *end, int *value)
+{
+    const std::from_chars_result r = std::from_chars(p, end, *value);
+    if (r.ec != std::errc())
+        return false;
+    p = r.ptr;
+    return true;
+}
+
+// OBJ 的索引从 1 开始，负数从当前列表末尾往前数；返回从 0 开始的下标，越界返回 -1
+int resolveIndex(int index, size_t count)
+{
+    const long long i = index > 0 ? index - 1 : (long long)count + index;
+    return i >= 0 && i < (long long)count ? int(i) : -1;
+}
+
+quint8 toByte(float v)
+{
+    return quint8(std::clamp(v, 0.0f, 1.0f) * 255.0f + 0.5f);
+}
+
+// ---- glTF ----
+
+enum GltfComponent
+{
+    GltfByte = 5120,
+    GltfUnsignedByte = 5121,
+    GltfShort = 5122,
+    GltfUnsignedShort = 5123,
+    GltfUnsignedInt = 5125,
+    GltfFloat = 5126
+};
+
+int componentSize(int type)
+{
+    switch (type) {
+    case GltfByte:
+    case GltfUnsignedByte:
+        return 1;
+    case GltfShort:
+    case GltfUnsignedShort:
+        return 2;
+    case GltfUnsignedInt:
+    case GltfFloat:
+        return 4;
+    default:
+        return 0;
+    }
+}
+
+int componentCount(const QString &type)
+{
+    if (type == "SCALAR")
+        return 1;
+    if (type == "VEC2")
+        return 2;
+    if (type == "VEC3")
+        return 3;
+    if (type == "VEC4")
+        return 4;
+    return 0;
+}
+
+// glTF 是小端；归一化整数按规范还原到 [0, 1] / [-1, 1]
+float readComponent(const uchar *p, int type, bool normalized)
+{
+    switch (type) {
+    case GltfByte: {
+        const float c = float(qint8(*p));
+        return normalized ? std::max(c / 127.0f, -1.0f) : c;
+    }
+    case GltfUnsignedByte:
+        return normalized ? *p / 255.0f : float(*p);
+    case GltfShort: {
+        const float c = float(qFromLittleEndian<qint16>(p));
+        return normalized ? std::max(c / 32767.0f, -1.0f) : c;
+    }
+    case GltfUnsignedShort: {
+        const float c = float(qFromLittleEndian<quint16>(p));
+        return normalized ? c / 65535.0f : c;
+    }
+    case GltfUnsignedInt:
+        return float(qFromLittleEndian<quint32>(p));
+    default: {
+        const quint32 bits = qFromLittleEndian<quint32>(p);
+        float f;
+        std::memcpy(&f, &bits, 4);
+        return f;
+    }
+    }
+}
+
+struct GltfDocument
+{
+    // 没有 bufferView 的访问器没有数据可以对照，元素个数单独设个上限
+    static const int MaxUnbackedElements = 1 << 24;
+
+    QJsonObject root;
+    std::vector<QByteArray> buffers;
+    QString error;
+
+    // 检查过范围的访问器：元素 i 从 base + stride * i 开始；base 为空时（没有 bufferView）全是 0
+    struct AccessorData
+    {
+        const uchar *base = nullptr;
+        qint64 stride = 0;
+        int count = 0;
+        int type = 0;
+        int components = 0;
+        bool normalized = false;
+    };
+
+    bool locateAccessor(int index, AccessorData *out)
+    {
+        const QJsonArray accessors = root["accessors"].toArray();
+        if (index < 0 || index >= accessors.size())
+            return fail(QString("accessor %1 out of range").arg(index));
+        const QJsonObject accessor = accessors[index].toObject();
+        if (accessor.contains("sparse"))
+            return fail("sparse accessors are not supported");
+        out->type = accessor["componentType"].toInt();
+        out->count = accessor["count"].toInt();
+        out->components = componentCount(accessor["type"].toString());
+        out->normalized = accessor["normalized"].toBool();
+        const int size = componentSize(out->type);
+        if (size == 0 || out->components == 0 || out->count < 0)
+            return fail(QString("accessor %1 has an unsupported type").arg(index));
+
+        // 文件里的数字都不可信：调用方按 count 分配之前先检查完范围，否则一个很大的 count 就能要几个 GB
+        if (!accessor.contains("bufferView")) {
+            if (out->count > MaxUnbackedElements)
+                return fail(QString("accessor %1 has too many elements").arg(index));
+            return true;
+        }
+        const QJsonArray views = root["bufferViews"].toArray();
+        const int viewIndex = accessor["bufferView"].toInt(-1);
+        if (viewIndex < 0 || viewIndex >= views.size())
+            return fail(QString("bufferView %1 out of range").arg(viewIndex));
+        const QJsonObject view = views[viewIndex].toObject();
+        const int buffer = view["buffer"].toInt(-1);
+        if (buffer < 0 || buffer >= int(buffers.size()))
+            return fail(QString("buffer %1 out of range").arg(buffer));
+        const QByteArray &data = buffers[size_t(buffer)];
+        const int elementSize = size * out->components;
+        // 规范：byteStride 在 [4, 252] 之间；至少要放得下一个元素，否则相邻元素重叠
+        out->stride = view.contains("byteStride") ? view["byteStride"].toInt() : elementSize;
+        if (out->stride < elementSize || out->stride > 252)
+            return fail(QString("bufferView %1 has an invalid byteStride").arg(viewIndex));
+        const double viewOffset = view["byteOffset"].toDouble();
+        const double accessorOffset = accessor["byteOffset"].toDouble();
+        if (viewOffset < 0.0 || accessorOffset < 0.0 || viewOffset + accessorOffset > double(data.size()))
+            return fail(QString("accessor %1 has an invalid byteOffset").arg(index));
+        const qint64 start = qint64(viewOffset) + qint64(accessorOffset);
+        // count <= INT_MAX、stride <= 252，64 位里不会溢出
+        if (out->count > 0 && start + out->stride * (out->count - 1) + elementSize > data.size())
+            return fail(QString("accessor %1 reads past the end of buffer %2").arg(index).arg(buffer));
+        out->base = reinterpret_cast<const uchar *>(data.constData()) + start;
+        return true;
+    }
+
+    // 访问器的数据按 components 个分量一组读成 float（文件里分量更少时补 0，颜色的 alpha 补 1）
+    bool readAccessor(int index, int components, std::vector<float> *out)
+    {
+        AccessorData a;
+        if (!locateAccessor(index, &a))
+            return false;
+        out->assign(size_t(a.count) * components, 0.0f);
+        if (components == 4 && a.components < 4) {
+            for (int i = 0; i < a.count; ++i)
+                (*out)[size_t(i) * 4 + 3] = 1.0f;
+        }
+        if (!a.base)
+            return true;   // 规范：没有 bufferView 的访问器全是 0
+
+        const int size = componentSize(a.type);
+        const int n = std::min(components, a.components);
+        for (int i = 0; i < a.count; ++i) {
+            const uchar *element = a.base + a.stride * i;
+            for (int k = 0; k < n; ++k)
+                (*out)[size_t(i) * components + size_t(k)] = readComponent(element + k * size, a.type, a.normalized);
+        }
+        return true;
+    }
+
+    // 索引不经过 float（超过 2^24 会丢精度）：规范只允许无符号整数的 SCALAR
+    bool readIndices(int index, std::vector<quint32> *out)
+    {
+        AccessorData a;
+        if (!locateAccessor(index, &a))
+            return false;
+        if (a.components != 1
+            || (a.type != GltfUnsignedByte && a.type != GltfUnsignedShort && a.type != GltfUnsignedInt))
+            return fail(QString("accessor %1 is not a valid index accessor").arg(index));
+        out->assign(size_t(a.count), 0);
+        if (!a.base)
+            return true;
+        for (int i = 0; i < a.count; ++i) {
+            const uchar *element = a.base + a.stride * i;
+            if (a.type == GltfUnsignedByte)
+                (*out)[size_t(i)] = *element;
+            else if (a.type == GltfUnsignedShort)
+                (*out)[size_t(i)] = qFromLittleEndian<quint16>(element);
+            else
+                (*out)[size_t(i)] = qFromLittleEndian<quint32>(element);
+        }
+        return true;
+    }
+
+    bool fail(const QString &message)
+    {
+        error = message;
+        return false;
+    }
+};
+
+QMatrix4x4 nodeTransform(const QJsonObject &node)
+{
+    if (node.contains("matrix")) {
+        const QJsonArray m = node["matrix"].toArray();
+        float values[16];
+        for (int i = 0; i < 16; ++i)
+            values[i] = float(m[i].toDouble());
+        return QMatrix4x4(values).transposed();   // glTF 列主序，QMatrix4x4(const float *) 按行读
+    }
+    QMatrix4x4 transform;
+    const QJsonArray t = node["translation"].toArray();
+    if (t.size() == 3)
+        transform.translate(float(t[0].toDouble()), float(t[1].toDouble()), float(t[2].toDouble()));
+    const QJsonArray r = node["rotation"].toArray();
+    if (r.size() == 4)
+        transform.rotate(QQuaternion(float(r[3].toDouble()), float(r[0].toDouble()), float(r[1].toDouble()),
+                                     float(r[2].toDouble())));
+    const QJsonArray s = node["scale"].toArray();
+    if (s.size() == 3)
+        transform.scale(float(s[0].toDouble()), float(s[1].toDouble()), float(s[2].toDouble()));
+    return transform;
+}
+
+// 去重用：按字节比较整个 MeshVertex（36 字节，没有填充）
+struct VertexHash
+{
+    size_t operator()(const MeshVertex &v) const
+    {
+        const uchar *p = reinterpret_cast<const uchar *>(&v);
+        quint64 h = 14695981039346656037ull;   // FNV-1a
+        for (size_t i = 0; i < sizeof(MeshVertex); ++i)
+            h = (h ^ p[i]) * 1099511628211ull;
+        return size_t(h);
+    }
+};
+
+struct VertexEqual
+{
+    bool operator()(const MeshVertex &a, const MeshVertex &b) const
+    {
+        return std::memcmp(&a, &b, sizeof(MeshVertex)) == 0;
+    }
+};
+
+} // namespace
+
+Mesh::Mesh()
+    : sourceVertices(0), hasNormals(false)
+{
+}
+
+bool Mesh::isMeshFile(const QString &path)
+{
+    const QString suffix = QFileInfo(path).suffix().toLower();
+    return suffix == "obj" || suffix == "gltf" || suffix == "glb";
+}
+
+void Mesh::clear()
+{
+    vertexData.clear();
+    indexData.clear();
+    lodData.clear();
+    sourceVertices = 0;
+    hasNormals = false;
+}
+
+bool Mesh::fail(const QString &message)
+{
+    error = message;
+    clear();
+    return false;
+}
+
+bool Mesh::load(const QString &path)
+{
+    clear();
+    error.clear();
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly))
+        return fail(QString("cannot open %1: %2").arg(path, file.errorString()));
+    const QByteArray data = file.readAll();
+    const QString suffix = QFileInfo(path).suffix().toLower();
+    const QString baseDir = QFileInfo(path).absolutePath();
+
+    bool ok = false;
+    if (suffix == "obj") {
+        ok = loadObj(data);
+    } else if (suffix == "gltf") {
+        ok = loadGltf(data, QByteArray(), baseDir);
+    } else if (suffix == "glb") {
+        // 12 字节文件头 + 若干块（长度、类型、数据），第一块是 JSON，第二块（可选）是 BIN
+        const uchar *p = reinterpret_cast<const uchar *>(data.constData());
+        if (data.size() < 20 || qFromLittleEndian<quint32>(p) != 0x46546C67u || qFromLittleEndian<quint32>(p + 4) != 2)
+            return fail(QString("%1 is not a glTF 2.0 binary").arg(path));
+        QByteArray json, binary;
+        qint64 offset = 12;
+        while (offset + 8 <= data.size()) {
+            const qint64 length = qFromLittleEndian<quint32>(p + offset);
+            const quint32 type = qFromLittleEndian<quint32>(p + offset + 4);
+            if (offset + 8 + length > data.size())
+                return fail(QString("%1: truncated chunk").arg(path));
+            if (type == 0x4E4F534Au && json.isEmpty())
+                json = data.mid(offset + 8, length);
+            else if (type == 0x004E4942u && binary.isEmpty())
+                binary = data.mid(offset + 8, length);
+            offset += 8 + length;
+        }
+        ok = loadGltf(json, binary, baseDir);
+    } else {
+        return fail(QString("%1: unknown mesh format").arg(path));
+    }
+    if (!ok)
+        return fail(QString("%1: %2").arg(path, error));
+    if (indexData.empty())
+        return fail(QString("%1: no triangles").arg(path));
+
+    sourceVertices = int(vertexData.size());
+    deduplicate();
+    if (!hasNormals)
+        generateNormals();
+    return true;
+}
+
+bool Mesh::loadObj(const QByteArray &data)
+{
+    std::vector<QVector3D> positions, normals, colors;
+    std::vector<QVector2D> texCoords;
+    bool anyColor = false;
+    hasNormals = true;
+    std::vector<GLuint> polygon;
+
+    const char *p = data.constData();
+    const char *end = p + data.size();
+    int lineNumber = 0;
+    while (p < end) {
+        const char *lineEnd = static_cast<const char *>(std::memchr(p, '\n', size_t(end - p)));
+        if (!lineEnd)
+            lineEnd = end;
+        ++lineNumber;
+        const char *s = skipSpaces(p, lineEnd);
+        const char *next = lineEnd < end ? lineEnd + 1 : end;
+
+        if (lineEnd - s >= 2 && s[0] == 'v' && (s[1] == ' ' || s[1] == '\t')) {
+            s += 2;
+            float v[6];
+            int n = 0;
+            while (n < 6 && parseFloat(s, lineEnd, &v[n]))
+                ++n;
+            if (n < 3)
+                return fail(QString("line %1: bad vertex").arg(lineNumber));
+            positions.emplace_back(v[0], v[1], v[2]);
+            colors.emplace_back(n >= 6 ? QVector3D(v[3], v[4], v[5]) : QVector3D(1.0f, 1.0f, 1.0f));
+            anyColor |= n >= 6;
+        } else if (lineEnd - s >= 3 && s[0] == 'v' && s[1] == 't' && (s[2] == ' ' || s[2] == '\t')) {
+            s += 3;
+            float v[2] = {0.0f, 0.0f};
+            parseFloat(s, lineEnd, &v[0]);
+            parseFloat(s, lineEnd, &v[1]);
+            texCoords.emplace_back(v[0], v[1]);
+        } else if (lineEnd - s >= 3 && s[0] == 'v' && s[1] == 'n' && (s[2] == ' ' || s[2] == '\t')) {
+            s += 3;
+            float v[3];
+            if (!parseFloat(s, lineEnd, &v[0]) || !parseFloat(s, lineEnd, &v[1]) || !parseFloat(s, lineEnd, &v[2]))
+                return fail(QString("line %1: bad normal").arg(lineNumber));
+            normals.push_back(QVector3D(v[0], v[1], v[2]).normalized());
+        } else if (lineEnd - s >= 2 && s[0] == 'f' && (s[1] == ' ' || s[1] == '\t')) {
+            // 每个角 "v"、"v/vt"、"v//vn" 或 "v/vt/vn"，先按角生成顶点，去重放到最后统一做
+            s += 2;
+            polygon.clear();
+            while (true) {
+                s = skipSpaces(s, lineEnd);
+                if (s >= lineEnd || *s == '\r')
+                    break;
+                int vi = 0, ti = 0, ni = 0;
+                if (!parseInt(s, lineEnd, &vi))
+                    return fail(QString("line %1: bad face").arg(lineNumber));
+                if (s < lineEnd && *s == '/') {
+                    ++s;
+                    if (s < lineEnd && *s != '/')
+                        parseInt(s, lineEnd, &ti);
+                    if (s < lineEnd && *s == '/') {
+                        ++s;
+                        parseInt(s, lineEnd, &ni);
+                    }
+                }
+                const int v = resolveIndex(vi, positions.size());
+                if (v < 0)
+                    return fail(QString("line %1: vertex index out of range").arg(lineNumber));
+                const int t = ti ? resolveIndex(ti, texCoords.size()) : -1;
+                const int n = ni ? resolveIndex(ni, normals.size()) : -1;
+                hasNormals &= n >= 0;
+
+                MeshVertex vertex = defaultVertex;
+                std::memcpy(vertex.position, &positions[size_t(v)][0], sizeof(vertex.position));
+                if (n >= 0) {
+                    vertex.normal[0] = normals[size_t(n)].x();
+                    vertex.normal[1] = normals[size_t(n)].y();
+                    vertex.normal[2] = normals[size_t(n)].z();
+                }
+                if (t >= 0) {
+                    vertex.texCoord[0] = texCoords[size_t(t)].x();
+                    vertex.texCoord[1] = texCoords[size_t(t)].y();
+                }
+                if (anyColor) {
+                    const QVector3D &c = colors[size_t(v)];
+                    vertex.color[0] = toByte(c.x());
+                    vertex.color[1] = toByte(c.y());
+                    vertex.color[2] = toByte(c.z());
+                }
+                polygon.push_back(GLuint(vertexData.size()));
+                vertexData.push_back(vertex);
+            }
+            // 扇形：(0, i, i + 1)
+            for (size_t i = 1; i + 1 < polygon.size(); ++i) {
+                indexData.push_back(polygon[0]);
+                indexData.push_back(polygon[i]);
+                indexData.push_back(polygon[i + 1]);
+            }
+        }
+        p = next;
+    }
+    return true;
+}
+
+bool Mesh::loadGltf(const QByteArray &json, const QByteArray &binaryChunk, const QString &baseDir)
+{
+    QJsonParseError parseError;
+    const QJsonDocument document = QJsonDocument::fromJson(json, &parseError);
+    if (!document.isObject())
+        return fail(QString("invalid glTF JSON: %1").arg(parseError.errorString()));
+
+    GltfDocument gltf;
+    gltf.root = document.object();
+    if (!gltf.root["asset"].toObject()["version"].toString().startsWith("2"))
+        return fail("only glTF 2.0 is supported");
+
+    // 缓冲：GLB 里第一个没有 uri 的缓冲是 BIN 块，其余是 data: URI 或相对路径的文件
+    for (const QJsonValue &value : gltf.root["buffers"].toArray()) {
+        const QString uri = value.toObject()["uri"].toString();
+        if (uri.isEmpty()) {
+            gltf.buffers.push_back(binaryChunk);
+        } else if (uri.startsWith("data:")) {
+            const int comma = int(uri.indexOf(','));
+            gltf.buffers.push_back(QByteArray::fromBase64(uri.mid(comma + 1).toLatin1()));
+        } else {
+            QFile file(QDir(baseDir).filePath(QUrl::fromPercentEncoding(uri.toUtf8())));
+            if (!file.open(QIODevice::ReadOnly))
+                return fail(QString("cannot open buffer %1").arg(uri));
+            gltf.buffers.push_back(file.readAll());
+        }
+    }
+
+    const QJsonArray nodes = gltf.root["nodes"].toArray();
+    const QJsonArray meshes = gltf.root["meshes"].toArray();
+    hasNormals = true;
+    std::vector<float> positions, normals, texCoords, colors;
+    std::vector<GLuint> primitiveIndices;
+
+    // 递归走节点树，网格的顶点乘上累计的变换（法线乘逆转置）
+    std::function<bool(int, const QMatrix4x4 &, int)> visit = [&](int nodeIndex, const QMatrix4x4 &parent, int depth) {
+        if (nodeIndex < 0 || nodeIndex >= nodes.size() || depth > 64)
+            return gltf.fail("bad node hierarchy");
+        const QJsonObject node = nodes[nodeIndex].toObject();
+        const QMatrix4x4 transform = parent * nodeTransform(node);
+        const QMatrix4x4 normalTransform = transform.inverted().transposed();
+
+        if (node.contains("mesh")) {
+            const QJsonObject mesh = meshes[node["mesh"].toInt()].toObject();
+            for (const QJsonValue &value : mesh["primitives"].toArray()) {
+                const QJsonObject primitive = value.toObject();
+                if (primitive.contains("mode") && primitive["mode"].toInt() != 4)
+                    continue;   // 只画三角形，点/线/条带跳过
+                const QJsonObject attributes = primitive["attributes"].toObject();
+                if (!attributes.contains("POSITION"))
+                    continue;
+                if (!gltf.readAccessor(attributes["POSITION"].toInt(), 3, &positions))
+                    return false;
+                const size_t count = positions.size() / 3;
+                normals.clear();
+                texCoords.clear();
+                colors.clear();
+                if (attributes.contains("NORMAL") && !gltf.readAccessor(attributes["NORMAL"].toInt(), 3, &normals))
+                    return false;
+                if (attributes.contains("TEXCOORD_0")
+                    && !gltf.readAccessor(attributes["TEXCOORD_0"].toInt(), 2, &texCoords))
+                    return false;
+                if (attributes.contains("COLOR_0") && !gltf.readAccessor(attributes["COLOR_0"].toInt(), 4, &colors))
+                    return false;
+                hasNormals &= normals.size() == count * 3;
+
+                const GLuint base = GLuint(vertexData.size());
+                for (size_t i = 0; i < count; ++i) {
+                    MeshVertex vertex = defaultVertex;
+                    const QVector3D p = transform.map(QVector3D(positions[i * 3], positions[i * 3 + 1],
+                                                                positions[i * 3 + 2]));
+                    vertex.position[0] = p.x();
+                    vertex.position[1] = p.y();
+                    vertex.position[2] = p.z();
+                    if (normals.size() == count * 3) {
+                        const QVector3D n = normalTransform.mapVector(QVector3D(normals[i * 3], normals[i * 3 + 1],
+                                                                                normals[i * 3 + 2])).normalized();
+                        vertex.normal[0] = n.x();
+                        vertex.normal[1] = n.y();
+                        vertex.normal[2] = n.z();
+                    }
+                    if (texCoords.size() == count * 2) {
+                        // glTF 的纹理坐标原点在左上角，OpenGL 在左下角
+                        vertex.texCoord[0] = texCoords[i * 2];
+                        vertex.texCoord[1] = 1.0f - texCoords[i * 2 + 1];
+                    }
+                    if (colors.size() == count * 4) {
+                        for (int k = 0; k < 4; ++k)
+                            vertex.color[k] = toByte(colors[i * 4 + size_t(k)]);
+                    }
+                    vertexData.push_back(vertex);
+                }
+
+                if (primitive.contains("indices")) {
+                    std::vector<quint32> raw;
+                    if (!gltf.readIndices(primitive["indices"].toInt(), &raw))
+                        return false;
+                    for (quint32 index : raw) {
+                        if (index >= count)
+                            return gltf.fail("index out of range");
+                        indexData.push_back(base + GLuint(index));
+                    }
+                } else {
+                    for (size_t i = 0; i + 2 < count; i += 3) {
+                        indexData.push_back(base + GLuint(i));
+                        indexData.push_back(base + GLuint(i + 1));
+                        indexData.push_back(base + GLuint(i + 2));
+                    }
+                }
+            }
+        }
+        for (const QJsonValue &child : node["children"].toArray()) {
+            if (!visit(child.toInt(), transform, depth + 1))
+                return false;
+        }
+        return true;
+    };
+
+    const QJsonArray scenes = gltf.root["scenes"].toArray();
+    if (!scenes.isEmpty()) {
+        const QJsonObject scene = scenes[gltf.root["scene"].toInt()].toObject();
+        for (const QJsonValue &node : scene["nodes"].toArray()) {
+            if (!visit(node.toInt(), QMatrix4x4(), 0))
+                return fail(gltf.error);
+        }
+    } else {
+        // 没有场景：所有没有父节点的节点都当根节点
+        std::vector<bool> isChild(size_t(nodes.size()), false);
+        for (const QJsonValue &node : nodes) {
+            for (const QJsonValue &child : node.toObject()["children"].toArray()) {
+                if (child.toInt() >= 0 && child.toInt() < nodes.size())
+                    isChild[size_t(child.toInt())] = true;
+            }
+        }
+        for (int i = 0; i < nodes.size(); ++i) {
+            if (!isChild[size_t(i)] && !visit(i, QMatrix4x4(), 0))
+                return fail(gltf.error);
+        }
+    }
+    return true;
+}
+
+void Mesh::deduplicate()
+{
+    std::unordered_map<MeshVertex, GLuint, VertexHash, VertexEqual> unique;
+    unique.reserve(vertexData.size());
+    std::vector<GLuint> remap(vertexData.size());
+    std::vector<MeshVertex> result;
+    result.reserve(vertexData.size());
+    for (size_t i = 0; i < vertexData.size(); ++i) {
+        const auto inserted = unique.emplace(vertexData[i], GLuint(result.size()));
+        if (inserted.second)
+            result.push_back(vertexData[i]);
+        remap[i] = inserted.first->second;
+    }
+    for (GLuint &index : indexData)
+        index = remap[index];
+    vertexData.swap(result);
+}
+
+void Mesh::generateNormals()
+{
+    std::vector<QVector3D> accumulated(vertexData.size());
+    for (size_t t = 0; t + 2 < indexData.size(); t += 3) {
+        const GLuint a = indexData[t], b = indexData[t + 1], c = indexData[t + 2];
+        const QVector3D p0(vertexData[a].position[0], vertexData[a].position[1], vertexData[a].position[2]);
+        const QVector3D p1(vertexData[b].position[0], vertexData[b].position[1], vertexData[b].position[2]);
+        const QVector3D p2(vertexData[c].position[0], vertexData[c].position[1], vertexData[c].position[2]);
+        const QVector3D n = QVector3D::crossProduct(p1 - p0, p2 - p0);   // 长度是面积的两倍，正好加权
+        accumulated[a] += n;
+        accumulated[b] += n;
+        accumulated[c] += n;
+    }
+    for (size_t i = 0; i < vertexData.size(); ++i) {
+        const QVector3D n = accumulated[i].isNull() ? QVector3D(0.0f, 0.0f, 1.0f) : accumulated[i].normalized();
+        vertexData[i].normal[0] = n.x();
+        vertexData[i].normal[1] = n.y();
+        vertexData[i].normal[2] = n.z();
+    }
+    hasNormals = true;
+}
+
+Mesh::OptimizeStats Mesh::optimize()
+{
+    OptimizeStats stats;
+    stats.before = MeshOptimizer::analyzeVertexCache(indexData, vertexCount());
+    MeshOptimizer::optimizeVertexCache(indexData, vertexCount());
+    MeshOptimizer::optimizeOverdraw(indexData, vertexData);
+    MeshOptimizer::optimizeVertexFetch(vertexData, indexData);
+    stats.after = MeshOptimizer::analyzeVertexCache(indexData, vertexCount());
+    return stats;
+}
+
+int Mesh::buildLods(int maxLevels, float reduction)
+{
+    // 太小的网格不值得再分层：一次绘制的开销比省下的三角形多
+    const size_t minIndices = 3 * 64;
+    lodData.clear();
+    lodData.push_back({indexData, 0.0f});
+    while (int(lodData.size()) < maxLevels) {
+        const Lod &previous = lodData.back();
+        const size_t target = size_t(double(previous.indices.size()) * reduction) / 3 * 3;
+        if (target < minIndices)
+            break;
+        // 每层从上一层简化，比每次都从原始网格开始快得多；误差按层累加（偏保守）
+        Lod lod;
+        float error = 0.0f;
+        lod.indices = MeshSimplifier::simplify(vertexData, previous.indices, int(target),
+                                               std::numeric_limits<float>::max(), &error);
+        if (lod.indices.size() > previous.indices.size() * 9 / 10)
+            break;   // 几乎减不动了
+        lod.error = previous.error + error;
+        MeshOptimizer::optimizeVertexCache(lod.indices, vertexCount());
+        MeshOptimizer::optimizeOverdraw(lod.indices, vertexData);
+        lodData.push_back(std::move(lod));
+    }
+    return int(lodData.size());
+}
+
+void Mesh::bounds(QVector3D *min, QVector3D *max) const
+{
+    if (vertexData.empty()) {
+        *min = *max = QVector3D();
+        return;
+    }
+    float lo[3], hi[3];
+    for (int k = 0; k < 3; ++k)
+        lo[k] = hi[k] = vertexData[0].position[k];
+    for (const MeshVertex &v : vertexData) {
+        for (int k = 0; k < 3; ++k) {
+            lo[k] = std::min(lo[k], v.position[k]);
+            hi[k] = std::max(hi[k], v.position[k]);
+        }
+    }
+    *min = QVector3D(lo[0], lo[1], lo[2]);
+    *max = QVector3D(hi[0], hi[1], hi[2]);
+}
@@ -0,0 +1,77 @@
+#ifndef MESH_H
+#define MESH_H
+
+#include <QString>
+#include <QVector3D>
+#include <vector>
+#include "VertexFormat.h"
+#include "MeshOptimizer.h"
+
+/* Mesh：从文件导入的索引网格
+ *
+ * load() 支持：
+ *   - Wavefront OBJ：v（可以带 r g b 顶点色）/ vt / vn / f，多边形按扇形拆成三角形，负索引相对于当前位置
+ *   - glTF 2.0：.gltf（外部 .bin 或 data: URI）和 .glb。读场景里所有节点的网格（矩阵或 TRS 变换烘进顶点），
+ *     只取 mode 为 TRIANGLES 的图元的 POSITION / NORMAL / TEXCOORD_0 / COLOR_0 和索引，不支持 sparse 访问器
+ * 读进来以后把内容完全相同的顶点合并成一个（OBJ 每个角一个顶点，合并后通常剩 1/6 左右），
+ * 文件里没有法线时按面积加权的面法线生成。
+ *
+ * optimize() 依次做 MeshOptimizer 的顶点缓存、overdraw、顶点读取三步重排，返回前后的 ACMR/ATVR。
+ * 之后用 InstancedMesh::create(…, vertices().data(), …, format, indices().data(), …) 上传。
+ *
+ * buildLods() 用 MeshSimplifier 生成细节层次：每层的三角形数大约是上一层的一半，所有层共用同一个顶点数组，
+ * 只有索引不同（IndirectBatch::addMeshLevel() 上传）。每层记着和第 0 层比的几何误差，LodSelector 按它选层。
+ */
+class Mesh
+{
+public:
+    struct OptimizeStats
+    {
+        MeshOptimizer::CacheStats before;
+        MeshOptimizer::CacheStats after;
+    };
+
+    // 一层 LOD：索引和这一层相对原始网格的几何误差（模型坐标里的距离，第 0 层是 0）
+    struct Lod
+    {
+        std::vector<GLuint> indices;
+        float error = 0.0f;
+    };
+
+    Mesh();
+
+    static bool isMeshFile(const QString &path);   // 按扩展名（.obj / .gltf / .glb）
+
+    bool load(const QString &path);   // 失败时 errorString() 说明原因，网格是空的
+    void clear();
+    OptimizeStats optimize();
+    // 要在 optimize() 之后调用（optimize() 会重排顶点）。简化不下去（比如大部分顶点在接缝上）时提前停，
+    // 返回实际的层数（包括第 0 层，至少 1）
+    int buildLods(int maxLevels = 6, float reduction = 0.5f);
+    const std::vector<Lod> &lods() const { return lodData; }   // 第 0 层就是 indices()；没调用 buildLods() 时是空的
+
+    bool isEmpty() const { return indexData.empty(); }
+    const std::vector<MeshVertex> &vertices() const { return vertexData; }
+    const std::vector<GLuint> &indices() const { return indexData; }
+    int vertexCount() const { return int(vertexData.size()); }
+    int triangleCount() const { return int(indexData.size() / 3); }
+    int sourceVertexCount() const { return sourceVertices; }   // 合并相同顶点之前的个数
+    void bounds(QVector3D *min, QVector3D *max) const;
+    QString errorString() const { return error; }
+
+private:
+    bool loadObj(const QByteArray &data);
+    bool loadGltf(const QByteArray &json, const QByteArray &binaryChunk, const QString &baseDir);
+    void deduplicate();
+    void generateNormals();
+    bool fail(const QString &message);
+
+    std::vector<MeshVertex> vertexData;
+    std::vector<GLuint> indexData;
+    std::vector<Lod> lodData;
+    int sourceVertices;
+    bool hasNormals;
+    QString error;
+};
+
+#endif // MESH_H
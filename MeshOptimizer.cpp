@@ -0,0 +1,295 @@
+#include "MeshOptimizer.h"
+#include <QVector3D>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace {
+
+// Forsyth 的打分参数（"Linear-Speed Vertex Cache Optimisation"），模拟 32 项的 LRU 缓存
+const int ScoreCacheSize = 32;
+const float CacheDecayPower = 1.5f;
+const float LastTriangleScore = 0.75f;
+const float ValenceBoostScale = 2.0f;
+const float ValenceBoostPower = 0.5f;
+
+float vertexScore(int cachePosition, int remainingTriangles)
+{
+    if (remainingTriangles == 0)
+        return -1.0f;   // 用完的顶点不再给三角形加分
+    float score = 0.0f;
+    if (cachePosition >= 0) {
+        if (cachePosition < 3) {
+            // 刚画完的三角形的三个顶点：故意给一个固定分数，不然总是挑紧挨着的三角形，容易走成长条
+            score = LastTriangleScore;
+        } else {
+            const float scale = 1.0f / (ScoreCacheSize - 3);
+            score = std::pow(1.0f - (cachePosition - 3) * scale, CacheDecayPower);
+        }
+    }
+    // 剩下的三角形越少越优先，免得留下孤零零的三角形最后单独画
+    score += ValenceBoostScale * std::pow(float(remainingTriangles), -ValenceBoostPower);
+    return score;
+}
+
+QVector3D positionOf(const MeshVertex &v)
+{
+    return QVector3D(v.position[0], v.position[1], v.position[2]);
+}
+
+// FIFO 缓存模拟：顶点在最近 cacheSize 次未命中之内进过缓存就算命中
+struct FifoCache
+{
+    std::vector<qint64> insertedAt;   // 顶点进缓存时的未命中计数
+    qint64 misses = 0;
+    int size;
+
+    FifoCache(int vertexCount, int cacheSize)
+        : insertedAt(size_t(vertexCount), std::numeric_limits<qint64>::min() / 2), size(cacheSize)
+    {
+    }
+
+    int access(GLuint v)
+    {
+        if (misses - insertedAt[v] < size)
+            return 0;
+        insertedAt[v] = misses++;
+        return 1;
+    }
+
+    void flush() { misses += size; }   // 所有已缓存的顶点都算过期
+};
+
+} // namespace
+
+MeshOptimizer::CacheStats MeshOptimizer::analyzeVertexCache(const std::vector<GLuint> &indices, int vertexCount,
+                                                            int cacheSize)
+{
+    CacheStats stats;
+    const size_t triangles = indices.size() / 3;
+    if (triangles == 0 || vertexCount == 0)
+        return stats;
+
+    FifoCache cache(vertexCount, cacheSize);
+    std::vector<bool> used(size_t(vertexCount), false);
+    int usedVertices = 0;
+    for (GLuint index : indices) {
+        cache.access(index);
+        if (!used[index]) {
+            used[index] = true;
+            ++usedVertices;
+        }
+    }
+    stats.acmr = double(cache.misses) / triangles;
+    stats.atvr = double(cache.misses) / usedVertices;
+    return stats;
+}
+
+void MeshOptimizer::optimizeVertexCache(std::vector<GLuint> &indices, int vertexCount)
+{
+    const int triangleCount = int(indices.size() / 3);
+    if (triangleCount == 0)
+        return;
+
+    // 每个顶点用到它的三角形（CSR：adjacency[offsets[v] .. offsets[v] + remaining[v]) 是还没画的）
+    std::vector<int> offsets(size_t(vertexCount) + 1, 0);
+    for (GLuint index : indices)
+        ++offsets[index + 1];
+    for (int v = 0; v < vertexCount; ++v)
+        offsets[size_t(v) + 1] += offsets[size_t(v)];
+    std::vector<int> remaining(size_t(vertexCount), 0);
+    std::vector<int> adjacency(indices.size());
+    for (int t = 0; t < triangleCount; ++t) {
+        for (int k = 0; k < 3; ++k) {
+            const GLuint v = indices[size_t(t) * 3 + size_t(k)];
+            adjacency[size_t(offsets[v] + remaining[v]++)] = t;
+        }
+    }
+
+    std::vector<float> scores(static_cast<size_t>(vertexCount));
+    for (int v = 0; v < vertexCount; ++v)
+        scores[size_t(v)] = vertexScore(-1, remaining[size_t(v)]);
+    std::vector<float> triangleScores(static_cast<size_t>(triangleCount));
+    std::vector<bool> emitted(size_t(triangleCount), false);
+    int best = 0;
+    for (int t = 0; t < triangleCount; ++t) {
+        const GLuint *tri = &indices[size_t(t) * 3];
+        triangleScores[size_t(t)] = scores[tri[0]] + scores[tri[1]] + scores[tri[2]];
+        if (triangleScores[size_t(t)] > triangleScores[size_t(best)])
+            best = t;
+    }
+
+    std::vector<GLuint> result;
+    result.reserve(indices.size());
+    std::vector<GLuint> cache, nextCache;
+    cache.reserve(ScoreCacheSize + 3);
+    nextCache.reserve(ScoreCacheSize + 3);
+    int cursor = 0;   // 缓存里的顶点都没有剩下的三角形时，从这里往后找还没画的
+
+    for (int drawn = 0; drawn < triangleCount; ++drawn) {
+        if (best < 0) {
+            while (emitted[size_t(cursor)])
+                ++cursor;
+            best = cursor;
+        }
+        const GLuint *tri = &indices[size_t(best) * 3];
+        result.insert(result.end(), tri, tri + 3);
+        emitted[size_t(best)] = true;
+
+        // 从三个顶点的邻接表里删掉这个三角形（和最后一个交换）
+        for (int k = 0; k < 3; ++k) {
+            const GLuint v = tri[k];
+            int *list = &adjacency[size_t(offsets[v])];
+            int &n = remaining[v];
+            const int at = int(std::find(list, list + n, best) - list);
+            list[at] = list[n - 1];
+            --n;
+        }
+
+        // LRU：这个三角形的顶点移到最前面，其余的往后挪，挤出去的位置变成 -1
+        nextCache.assign(tri, tri + 3);
+        for (GLuint v : cache) {
+            if (v != tri[0] && v != tri[1] && v != tri[2])
+                nextCache.push_back(v);
+        }
+        for (size_t i = 0; i < nextCache.size(); ++i) {
+            const GLuint v = nextCache[i];
+            const int position = i < size_t(ScoreCacheSize) ? int(i) : -1;
+            const float score = vertexScore(position, remaining[v]);
+            const float delta = score - scores[v];
+            scores[v] = score;
+            for (int j = 0; j < remaining[v]; ++j)
+                triangleScores[size_t(adjacency[size_t(offsets[v] + j)])] += delta;
+        }
+        if (nextCache.size() > size_t(ScoreCacheSize))
+            nextCache.resize(ScoreCacheSize);
+        cache.swap(nextCache);
+
+        // 下一个只从缓存里的顶点相邻的三角形里挑
+        best = -1;
+        float bestScore = -1.0f;
+        for (GLuint v : cache) {
+            for (int j = 0; j < remaining[v]; ++j) {
+                const int t = adjacency[size_t(offsets[v] + j)];
+                if (triangleScores[size_t(t)] > bestScore) {
+                    bestScore = triangleScores[size_t(t)];
+                    best = t;
+                }
+            }
+        }
+    }
+    indices.swap(result);
+}
+
+void MeshOptimizer::optimizeOverdraw(std::vector<GLuint> &indices, const std::vector<MeshVertex> &vertices,
+                                     float threshold)
+{
+    const int triangleCount = int(indices.size() / 3);
+    const int vertexCount = int(vertices.size());
+    if (triangleCount < 2)
+        return;
+
+    // 硬断点：三个顶点都没命中的三角形，这里缓存等于清空了，从这里切开不损失命中率
+    std::vector<int> hardBoundaries;
+    {
+        FifoCache cache(vertexCount, CacheSize);
+        for (int t = 0; t < triangleCount; ++t) {
+            const GLuint *tri = &indices[size_t(t) * 3];
+            if (cache.access(tri[0]) + cache.access(tri[1]) + cache.access(tri[2]) == 3)
+                hardBoundaries.push_back(t);
+        }
+    }
+    hardBoundaries.push_back(triangleCount);
+
+    // 软断点：硬断点簇内部，从头开始累计的 ACMR 一旦不超过整簇的 threshold 倍就在这里再切一刀
+    std::vector<int> clusters;
+    {
+        FifoCache cache(vertexCount, CacheSize);
+        for (size_t h = 0; h + 1 < hardBoundaries.size(); ++h) {
+            const int start = hardBoundaries[h], end = hardBoundaries[h + 1];
+            cache.flush();
+            qint64 missesBefore = cache.misses;
+            for (int t = start; t < end; ++t) {
+                const GLuint *tri = &indices[size_t(t) * 3];
+                cache.access(tri[0]);
+                cache.access(tri[1]);
+                cache.access(tri[2]);
+            }
+            const double clusterThreshold = threshold * double(cache.misses - missesBefore) / (end - start);
+
+            clusters.push_back(start);
+            cache.flush();
+            missesBefore = cache.misses;
+            int faces = 0;
+            for (int t = start; t < end; ++t) {
+                const GLuint *tri = &indices[size_t(t) * 3];
+                cache.access(tri[0]);
+                cache.access(tri[1]);
+                cache.access(tri[2]);
+                ++faces;
+                if (double(cache.misses - missesBefore) / faces <= clusterThreshold && t + 1 < end) {
+                    clusters.push_back(t + 1);
+                    cache.flush();
+                    missesBefore = cache.misses;
+                    faces = 0;
+                }
+            }
+        }
+    }
+    clusters.push_back(triangleCount);
+
+    // 每簇按面积加权的中心和法线；排序键是 "簇中心相对整个网格中心的方向" 和簇法线的点积，越朝外越先画
+    QVector3D meshCenter;
+    for (const MeshVertex &v : vertices)
+        meshCenter += positionOf(v);
+    meshCenter /= float(qMax(1, vertexCount));
+
+    const size_t clusterCount = clusters.size() - 1;
+    std::vector<float> keys(clusterCount);
+    for (size_t c = 0; c < clusterCount; ++c) {
+        QVector3D center, normal;
+        float area = 0.0f;
+        for (int t = clusters[c]; t < clusters[c + 1]; ++t) {
+            const GLuint *tri = &indices[size_t(t) * 3];
+            const QVector3D p0 = positionOf(vertices[tri[0]]);
+            const QVector3D p1 = positionOf(vertices[tri[1]]);
+            const QVector3D p2 = positionOf(vertices[tri[2]]);
+            const QVector3D n = QVector3D::crossProduct(p1 - p0, p2 - p0);
+            const float a = n.length();
+            center += (p0 + p1 + p2) * (a / 3.0f);
+            normal += n;
+            area += a;
+        }
+        if (area > 0.0f)
+            center /= area;
+        keys[c] = QVector3D::dotProduct(center - meshCenter, normal.normalized());
+    }
+
+    std::vector<size_t> order(clusterCount);
+    for (size_t c = 0; c < clusterCount; ++c)
+        order[c] = c;
+    std::stable_sort(order.begin(), order.end(), [&keys](size_t a, size_t b) { return keys[a] > keys[b]; });
+
+    std::vector<GLuint> result;
+    result.reserve(indices.size());
+    for (size_t c : order)
+        result.insert(result.end(), indices.begin() + ptrdiff_t(clusters[c]) * 3,
+                      indices.begin() + ptrdiff_t(clusters[c + 1]) * 3);
+    indices.swap(result);
+}
+
+void MeshOptimizer::optimizeVertexFetch(std::vector<MeshVertex> &vertices, std::vector<GLuint> &indices)
+{
+    const GLuint unused = GLuint(-1);
+    std::vector<GLuint> remap(vertices.size(), unused);
+    std::vector<MeshVertex> result;
+    result.reserve(vertices.size());
+    for (GLuint &index : indices) {
+        if (remap[index] == unused) {
+            remap[index] = GLuint(result.size());
+            result.push_back(vertices[index]);
+        }
+        index = remap[index];
+    }
+    vertices.swap(result);
+}
@@ -0,0 +1,42 @@
+#ifndef MESHOPTIMIZER_H
+#define MESHOPTIMIZER_H
+
+#include <qopengl.h>
+#include <vector>
+#include "VertexFormat.h"
+
+/* MeshOptimizer：索引网格的三步重排，只改顺序不改形状
+ *
+ *   1. optimizeVertexCache()：重排三角形，让相邻的三角形共用刚变换过的顶点
+ *      （Forsyth 的线性时间算法，按 LRU 缓存打分，每次挑分数最高的三角形）
+ *   2. optimizeOverdraw()：在 1 的结果上按 "缓存断点" 切成小簇，簇内顺序不动，
+ *      簇之间按 "朝外程度" 排序，外侧朝外的先画，后画的被深度测试挡掉（Sander 等 2007）。
+ *      簇只在缓存本来就会清空的地方切开，ACMR 基本不变
+ *   3. optimizeVertexFetch()：按索引里第一次出现的顺序重排顶点，GPU 取顶点时基本是顺序读
+ *
+ * ACMR（平均每个三角形的缓存未命中数，越小越好，下限约 0.5）和 ATVR（每个顶点被变换的平均次数，
+ * 下限 1.0）用一个 FIFO 缓存模拟，大小 CacheSize 和常见硬件的后变换缓存相当。
+ */
+class MeshOptimizer
+{
+public:
+    enum { CacheSize = 16 };
+
+    struct CacheStats
+    {
+        double acmr = 0.0;
+        double atvr = 0.0;
+    };
+
+    static CacheStats analyzeVertexCache(const std::vector<GLuint> &indices, int vertexCount,
+                                         int cacheSize = CacheSize);
+
+    static void optimizeVertexCache(std::vector<GLuint> &indices, int vertexCount);
+    // threshold：同一个硬断点簇里，ACMR 不超过整体的 threshold 倍时可以再切小一些（软断点）
+    static void optimizeOverdraw(std::vector<GLuint> &indices, const std::vector<MeshVertex> &vertices,
+                                 float threshold = 1.05f);
+    // 重排并删除没被引用的顶点，索引跟着改
+    static void optimizeVertexFetch(std::vector<MeshVertex> &vertices, std::vector<GLuint> &indices);
+};
+
+#endif // MESHOPTIMIZER_H
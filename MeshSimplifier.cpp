@@ -0,0 +1,292 @@
+#include "MeshSimplifier.h"
+#include <QVector3D>
+#include <QtGlobal>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace {
+
+// 边界边的约束平面相对三角形平面的权重：越大边界越不容易变形
+const double BorderWeight = 10.0;
+
+// 折叠后三角形的法线和原来的夹角的余弦小于它就不允许（约 75°）：不只挡住翻面，也挡住折成细长条的三角形
+const float FlipThreshold = 0.25f;
+
+enum VertexKind
+{
+    Manifold,   // 内部顶点，可以折叠到任意相邻顶点
+    Border,     // 开放边界上，只能沿边界边折叠
+    Locked      // 接缝、非流形，不动（别的顶点可以折叠到它上面）
+};
+
+/* 平面距离平方和：v^T A v，v = (x, y, z, 1)，A 是对称 4x4 矩阵，存上三角 10 个数
+ * weight 是加进来的平面权重之和，evaluate() / weight 是加权平均的距离平方 */
+struct Quadric
+{
+    double a[10] = {};
+    double weight = 0.0;
+
+    void addPlane(double nx, double ny, double nz, double d, double w)
+    {
+        a[0] += w * nx * nx; a[1] += w * nx * ny; a[2] += w * nx * nz; a[3] += w * nx * d;
+        a[4] += w * ny * ny; a[5] += w * ny * nz; a[6] += w * ny * d;
+        a[7] += w * nz * nz; a[8] += w * nz * d;
+        a[9] += w * d * d;
+        weight += w;
+    }
+
+    void add(const Quadric &other)
+    {
+        for (int i = 0; i < 10; ++i)
+            a[i] += other.a[i];
+        weight += other.weight;
+    }
+
+    double evaluate(const QVector3D &p) const
+    {
+        const double x = p.x(), y = p.y(), z = p.z();
+        const double e = a[0] * x * x + 2.0 * a[1] * x * y + 2.0 * a[2] * x * z + 2.0 * a[3] * x
+                         + a[4] * y * y + 2.0 * a[5] * y * z + 2.0 * a[6] * y
+                         + a[7] * z * z + 2.0 * a[8] * z + a[9];
+        return std::fabs(e);   // 理论上 >= 0，浮点误差可能略小于 0
+    }
+};
+
+struct Collapse
+{
+    double cost;
+    GLuint from;
+    GLuint to;
+
+    bool operator<(const Collapse &other) const { return cost < other.cost; }
+};
+
+QVector3D positionOf(const MeshVertex &v)
+{
+    return QVector3D(v.position[0], v.position[1], v.position[2]);
+}
+
+quint64 edgeKey(GLuint a, GLuint b)
+{
+    return (quint64(a) << 32) | b;
+}
+
+// 位置完全相同的顶点归成一组，remap[v] 是组里编号最小的顶点
+std::vector<GLuint> positionRemap(const std::vector<MeshVertex> &vertices)
+{
+    std::vector<GLuint> order(vertices.size());
+    for (size_t i = 0; i < order.size(); ++i)
+        order[i] = GLuint(i);
+    auto less = [&vertices](GLuint a, GLuint b) {
+        const int c = std::memcmp(vertices[a].position, vertices[b].position, sizeof(vertices[a].position));
+        return c != 0 ? c < 0 : a < b;
+    };
+    std::sort(order.begin(), order.end(), less);
+
+    std::vector<GLuint> remap(vertices.size());
+    for (size_t i = 0; i < order.size(); ++i) {
+        const GLuint v = order[i];
+        const bool same = i > 0 && std::memcmp(vertices[v].position, vertices[order[i - 1]].position,
+                                               sizeof(vertices[v].position)) == 0;
+        remap[v] = same ? remap[order[i - 1]] : v;
+    }
+    return remap;
+}
+
+} // namespace
+
+std::vector<GLuint> MeshSimplifier::simplify(const std::vector<MeshVertex> &vertices,
+                                             const std::vector<GLuint> &indices, int targetIndexCount,
+                                             float maxError, float *resultError)
+{
+    const size_t vertexCount = vertices.size();
+    const std::vector<GLuint> remap = positionRemap(vertices);
+
+    // 去掉一开始就退化的三角形（两个角在同一个位置）
+    std::vector<GLuint> work;
+    work.reserve(indices.size());
+    for (size_t t = 0; t + 2 < indices.size(); t += 3) {
+        const GLuint r0 = remap[indices[t]], r1 = remap[indices[t + 1]], r2 = remap[indices[t + 2]];
+        if (r0 != r1 && r1 != r2 && r2 != r0)
+            work.insert(work.end(), indices.begin() + qsizetype(t), indices.begin() + qsizetype(t) + 3);
+    }
+
+    // 顶点分类：按位置（而不是顶点编号）数有向边，接缝两边的三角形共用同一条边，不算边界
+    std::vector<VertexKind> kind(vertexCount, Manifold);
+    for (size_t v = 0; v < vertexCount; ++v) {
+        if (remap[v] != v) {
+            kind[v] = Locked;          // 同一个位置有多个顶点：两个都锁住
+            kind[remap[v]] = Locked;
+        }
+    }
+    std::unordered_map<quint64, int> edgeCount;
+    edgeCount.reserve(work.size());
+    for (size_t t = 0; t < work.size(); t += 3) {
+        for (int e = 0; e < 3; ++e)
+            ++edgeCount[edgeKey(remap[work[t + e]], remap[work[t + (e + 1) % 3]])];
+    }
+    std::unordered_set<quint64> borderEdges;   // 无向，小编号在前
+    for (const auto &edge : edgeCount) {
+        const GLuint a = GLuint(edge.first >> 32), b = GLuint(edge.first & 0xffffffffu);
+        const auto reverse = edgeCount.find(edgeKey(b, a));
+        if (edge.second > 1 || (reverse != edgeCount.end() && reverse->second > 1)) {
+            kind[a] = Locked;
+            kind[b] = Locked;
+        } else if (reverse == edgeCount.end()) {
+            borderEdges.insert(edgeKey(std::min(a, b), std::max(a, b)));
+            if (kind[a] == Manifold)
+                kind[a] = Border;
+            if (kind[b] == Manifold)
+                kind[b] = Border;
+        }
+    }
+    // 分类记在每组的代表顶点上，组里的其他顶点跟着它
+    for (size_t v = 0; v < vertexCount; ++v)
+        kind[v] = kind[remap[v]];
+
+    // 每个位置的二次型：周围三角形的平面按面积加权，边界边加一个过这条边、垂直于三角形的平面
+    std::vector<Quadric> quadrics(vertexCount);
+    for (size_t t = 0; t < work.size(); t += 3) {
+        const QVector3D p[3] = {positionOf(vertices[work[t]]), positionOf(vertices[work[t + 1]]),
+                                positionOf(vertices[work[t + 2]])};
+        QVector3D normal = QVector3D::crossProduct(p[1] - p[0], p[2] - p[0]);
+        const float area = 0.5f * normal.length();
+        if (area <= 0.0f)
+            continue;
+        normal /= 2.0f * area;
+        const double d = -QVector3D::dotProduct(normal, p[0]);
+        for (int i = 0; i < 3; ++i)
+            quadrics[remap[work[t + i]]].addPlane(normal.x(), normal.y(), normal.z(), d, area);
+
+        for (int e = 0; e < 3; ++e) {
+            const GLuint a = remap[work[t + e]], b = remap[work[t + (e + 1) % 3]];
+            if (!borderEdges.count(edgeKey(std::min(a, b), std::max(a, b))))
+                continue;
+            const QVector3D edge = p[(e + 1) % 3] - p[e];
+            const QVector3D side = QVector3D::crossProduct(edge, normal).normalized();
+            const double sideD = -QVector3D::dotProduct(side, p[e]);
+            const double weight = BorderWeight * edge.lengthSquared();
+            quadrics[a].addPlane(side.x(), side.y(), side.z(), sideD, weight);
+            quadrics[b].addPlane(side.x(), side.y(), side.z(), sideD, weight);
+        }
+    }
+
+    const size_t target = size_t(std::max(0, targetIndexCount)) / 3 * 3;
+    const double maxCost = double(maxError) * double(maxError);
+    double worstCost = 0.0;
+    std::vector<Collapse> candidates;
+    std::vector<int> adjacencyOffset(vertexCount + 1);
+    std::vector<GLuint> adjacency;   // 每个顶点所在的三角形（work 里的第几个三角形）
+    std::vector<bool> touched(vertexCount);
+    std::vector<GLuint> collapseTo(vertexCount);
+
+    while (work.size() > target) {
+        // 顶点 -> 三角形的邻接表（CSR），按顶点编号；会被移动的顶点都不在接缝上，编号就代表位置
+        std::fill(adjacencyOffset.begin(), adjacencyOffset.end(), 0);
+        for (GLuint v : work)
+            ++adjacencyOffset[v + 1];
+        for (size_t v = 0; v < vertexCount; ++v)
+            adjacencyOffset[v + 1] += adjacencyOffset[v];
+        adjacency.resize(work.size());
+        std::vector<int> fill(adjacencyOffset.begin(), adjacencyOffset.end() - 1);
+        for (size_t i = 0; i < work.size(); ++i)
+            adjacency[size_t(fill[work[i]]++)] = GLuint(i / 3);
+
+        // 候选：每条边两个方向，按代价排序
+        candidates.clear();
+        for (size_t t = 0; t < work.size(); t += 3) {
+            for (int e = 0; e < 3; ++e) {
+                const GLuint v0 = work[t + e], v1 = work[t + (e + 1) % 3];
+                for (int direction = 0; direction < 2; ++direction) {
+                    const GLuint from = direction ? v1 : v0, to = direction ? v0 : v1;
+                    const GLuint rf = remap[from], rt = remap[to];
+                    if (kind[from] == Locked)
+                        continue;
+                    if (kind[from] == Border && !borderEdges.count(edgeKey(std::min(rf, rt), std::max(rf, rt))))
+                        continue;
+                    Quadric q = quadrics[rf];
+                    q.add(quadrics[rt]);
+                    const double cost = q.weight > 0.0 ? q.evaluate(positionOf(vertices[to])) / q.weight : 0.0;
+                    if (cost <= maxCost)
+                        candidates.push_back({cost, from, to});
+                }
+            }
+        }
+        if (candidates.empty())
+            break;
+        std::sort(candidates.begin(), candidates.end());
+
+        // 这一轮最多去掉这么多三角形（内部的边折叠一次去掉 2 个，边界上 1 个）
+        const size_t goal = std::max<size_t>(1, (work.size() - target) / 3);
+        size_t removed = 0;
+        std::fill(touched.begin(), touched.end(), false);
+        for (size_t v = 0; v < vertexCount; ++v)
+            collapseTo[v] = GLuint(v);
+
+        for (const Collapse &c : candidates) {
+            const GLuint rf = remap[c.from], rt = remap[c.to];
+            if (touched[rf] || touched[rt])
+                continue;
+
+            // 翻面检查：from 周围不包含 to 的三角形，把 from 换成 to 之后法线不能反过来
+            const QVector3D destination = positionOf(vertices[c.to]);
+            bool flips = false;
+            int collapsing = 0;
+            for (int i = adjacencyOffset[c.from]; i < adjacencyOffset[c.from + 1] && !flips; ++i) {
+                const size_t t = size_t(adjacency[size_t(i)]) * 3;
+                QVector3D before[3], after[3];
+                bool degenerate = false;
+                for (int k = 0; k < 3; ++k) {
+                    const GLuint v = work[t + k];
+                    degenerate = degenerate || remap[v] == rt;
+                    before[k] = positionOf(vertices[v]);
+                    after[k] = v == c.from ? destination : before[k];
+                }
+                if (degenerate) {
+                    ++collapsing;
+                    continue;
+                }
+                const QVector3D n0 = QVector3D::crossProduct(before[1] - before[0], before[2] - before[0]);
+                const QVector3D n1 = QVector3D::crossProduct(after[1] - after[0], after[2] - after[0]);
+                flips = QVector3D::dotProduct(n0, n1) <= FlipThreshold * n0.length() * n1.length();
+            }
+            if (flips)
+                continue;
+
+            collapseTo[c.from] = c.to;
+            quadrics[rt].add(quadrics[rf]);
+            worstCost = std::max(worstCost, c.cost);
+            // from 的一环邻域这一轮不再动：翻面检查只在邻域不变的前提下成立
+            for (int i = adjacencyOffset[c.from]; i < adjacencyOffset[c.from + 1]; ++i) {
+                const size_t t = size_t(adjacency[size_t(i)]) * 3;
+                for (int k = 0; k < 3; ++k)
+                    touched[remap[work[t + k]]] = true;
+            }
+            removed += size_t(collapsing);
+            if (removed >= goal)
+                break;
+        }
+        if (removed == 0)
+            break;
+
+        // 应用这一轮的折叠，去掉退化的三角形
+        size_t out = 0;
+        for (size_t t = 0; t < work.size(); t += 3) {
+            const GLuint v0 = collapseTo[work[t]], v1 = collapseTo[work[t + 1]], v2 = collapseTo[work[t + 2]];
+            const GLuint r0 = remap[v0], r1 = remap[v1], r2 = remap[v2];
+            if (r0 == r1 || r1 == r2 || r2 == r0)
+                continue;
+            work[out++] = v0;
+            work[out++] = v1;
+            work[out++] = v2;
+        }
+        work.resize(out);
+    }
+
+    if (resultError)
+        *resultError = float(std::sqrt(worstCost));
+    return work;
+}
@@ -0,0 +1,31 @@
+#ifndef MESHSIMPLIFIER_H
+#define MESHSIMPLIFIER_H
+
+#include <qopengl.h>
+#include <vector>
+#include "VertexFormat.h"
+
+/* MeshSimplifier：二次误差度量（QEM，Garland & Heckbert 1997）的边折叠简化，生成 LOD 用
+ *
+ * 每个顶点一个二次型 Q（周围三角形所在平面的距离平方和，按面积加权），把边 (a, b) 折叠成 b 的代价是
+ * (Qa + Qb)(b)，也就是 b 到 a、b 原来周围那些平面的（加权平均）距离平方。每一轮按代价从小到大折叠，
+ * 同一轮里一个顶点的一环邻域只参与一次折叠，折叠完重建邻接关系再来下一轮，直到达到目标三角形数或者误差上限。
+ *
+ * 只折叠到已有的顶点上（半边折叠），不生成新顶点：所有 LOD 共用同一个顶点数组，只是索引不同，
+ * 顶点的法线、纹理坐标、颜色都原样保留。为了不撕开网格：
+ *   - 位置相同、属性不同的顶点（纹理接缝、硬边）锁住不动
+ *   - 开放边界上的顶点只能沿边界折叠，边界边额外加一个垂直于三角形的平面，边界不会往里缩
+ *   - 非流形的边（被两个以上三角形共用）的顶点锁住
+ *   - 折叠后法线翻过来（或者转了 75° 以上）的三角形不允许
+ */
+class MeshSimplifier
+{
+public:
+    /* 返回简化后的索引，顶点数组不变。targetIndexCount 是目标索引个数（3 的倍数），
+     * maxError 是允许的最大误差（和顶点坐标同单位的距离），先达到哪个就停。
+     * resultError 返回实际用到的最大误差（同单位），可以是 nullptr */
+    static std::vector<GLuint> simplify(const std::vector<MeshVertex> &vertices, const std::vector<GLuint> &indices,
+                                        int targetIndexCount, float maxError, float *resultError = nullptr);
+};
+
+#endif // MESHSIMPLIFIER_H
@@ -2,12 +2,15 @@
 #define MYOPENGLWIDGET_H
 
 #include <QOpenGLWidget>
-#include <QOpenGLShaderProgram>
-#include <QOpenGLFunctions>
-#include <QOpenGLBuffer>
-#include <QOpenGLVertexArrayObject>
+#include <QRect>
+#include "Renderer.h"
 
-class MyOpenGLWidget : public QOpenGLWidget, protected QOpenGLFunctions
+class RenderThread;
+class FrameCapture;
+class QOpenGLFramebufferObject;
+class QTimer;
+
+class MyOpenGLWidget : public QOpenGLWidget
 {
     Q_OBJECT
 
@@ -15,6 +18,58 @@ public:
     MyOpenGLWidget(QWidget *parent = nullptr);
     ~MyOpenGLWidget();
 
+    // 帧计时叠加层（F3 切换）：开着时每 250 ms 刷新一次，只重画叠加层；数字只在场景真的重画时才变
+    void setProfilerOverlayVisible(bool visible);
+    bool isProfilerOverlayVisible() const { return overlayVisible; }
+    // 把最近的帧计时写成 Chrome trace-event JSON（F4 写到当前目录），用 chrome://tracing 打开
+    // 渲染线程模式下只是把命令发给渲染线程，返回 true 表示已经发出
+    bool writeFrameTrace(const QString &path);
+
+    /* 渲染线程模式：Renderer 在自己的线程、自己的上下文里按屏幕刷新率画进 FBO，
+     * paintGL() 只把最新画好的一帧贴到窗口上，GUI 线程再忙也不影响帧时间（见 RenderThread）。
+     * 要在窗口第一次显示（initializeGL()）之前设置 */
+    void setThreadedRendering(bool enabled);
+    bool isThreadedRendering() const { return threaded; }
+
+    /* 按需渲染（默认）：场景只在变了以后才重画（Renderer::needsRender()），画好的场景缓存在一个 FBO 里（场景层）。
+     * Qt 要求重绘（窗口重新露出、叠加层刷新……）但场景没变时，只把场景层贴到窗口上再画叠加层，这一帧算跳过。
+     * 窗口外的代码改了 submitPrimitives 里提交的东西以后要调用 invalidate()；只变了一块时传那一块
+     * （窗口坐标），下一帧只重画那一块（渲染线程模式下总是整个重画）。
+     * setContinuousRendering(true) 每帧都重画，测帧率用 */
+    void invalidate(const QRect &region = QRect());
+    void setContinuousRendering(bool enabled);
+    bool isContinuousRendering() const { return continuous; }
+    quint64 renderedFrames() const;
+    quint64 skippedFrames() const;
+
+    // 额外画一个导入的模型（.obj / .gltf / .glb，见 Renderer::setModel），要在 initializeGL() 之前设置
+    void setModelFile(const QString &path) { modelFile = path; }
+    // 模型画几份、LOD 的屏幕误差、换公告板的大小（像素，0 = 不用），见 Renderer::setModelCopies 等。要在 initializeGL() 之前设置
+    void setModelCopies(int copies) { modelCopies = copies; }
+    void setLodErrorThreshold(float pixels) { lodError = pixels; }
+    void setImpostorSize(float pixels) { impostorPixels = pixels; }
+    // 纹理显存预算（字节，见 TextureManager::setMemoryBudget），0 = 不限制。要在 initializeGL() 之前设置
+    void setTextureBudget(qint64 bytes) { textureBudget = bytes; }
+    // 把初始化和之后 frames 帧（0 = 到窗口关闭）的 GL 调用录到 path，见 Renderer::setTraceFile。要在 initializeGL() 之前设置
+    void setGlTraceFile(const QString &path, int frames = 0) { glTraceFile = path; glTraceFrames = frames; }
+
+    /* 录屏 / 截图（F5 开始、停止录制到 capture-时间/ 目录，F6 存一张 screenshot-时间.png）。
+     * 每帧画完场景、画叠加层之前把窗口的帧缓冲异步读回（PBO + fence，不等 GPU），
+     * 后台线程写成 PNG 序列，path 以 .yuv 结尾时写成 I420 原始视频（见 FrameCapture）。
+     * 录制期间窗口每帧都刷新（场景没变时读回的是缓存的场景层，不会多画）。maxFrames > 0 时读够这么多帧自动结束；窗口显示之前调用的话等 initializeGL() 再开始 */
+    bool startCapture(const QString &path, int maxFrames = 0);
+    void stopCapture();   // 等还没读回、没写完的帧都写完
+    bool isCapturing() const;
+    bool saveScreenshot(const QString &path) { return startCapture(path, 1); }
+
+signals:
+    /* 每帧在 paintGL() 里发出，此时上下文是当前上下文，batch 已经 begin()。
+     * 槽函数里用 batch->submitQuad()/submitTriangle() 提交图元，由 SpriteBatch 合批绘制。
+     * 必须用 Qt::DirectConnection 连接（默认的 AutoConnection 在同一线程里也是直接调用）。
+     * 渲染线程模式下这个信号在渲染线程里发出，槽函数也在渲染线程里执行，必须显式指定 Qt::DirectConnection。
+     */
+    void submitPrimitives(SpriteBatch *batch, GLuint defaultTexture);
+
 // protected:这些函数只适配此类，别的类用不来，确保这些函数不会被外部类调用，而只能在类的内部或派生类中使用。
 /*protected 访问修饰符
 访问权限：protected 成员可以被类的内部访问，同时也可以被派生类访问。
@@ -39,6 +94,7 @@ protected:
     void initializeGL() override;  // 它通常用于初始化OpenGL 资源和状态，例如加载着色器、创建 VBO（顶点缓冲对象）或 VAO（顶点数组对象）、设置清除颜色等。这些操作只需要执行一次，在整个绘制过程中不会频繁变化。
     void resizeGL(int w, int h) override;  // 常见用途如：1.调整视口：当窗口大小发生改变时，调用 glViewport() 确保 OpenGL 绘制的图形在整个窗口中正确显示。2.重新计算投影矩阵：如果使用的是透视投影或者其他与窗口尺寸有关的投影矩阵，可以在这里重新设置。
     void paintGL() override;  // 是每次需要重绘窗口时调用的函数。清除缓冲区、绘制图形、交换缓冲区等功能
+    void keyPressEvent(QKeyEvent *event) override;
 
 private:  // 只在此类中会用到的东西
     /*private 访问修饰符
@@ -47,14 +103,30 @@ private:  // 只在此类中会用到的东西
     典型使用场景：private 通常用于隐藏实现细节，保护类的内部状态，不允许外部或派生类直接访问。
                 这样可以强制使用类的接口函数（public 函数）来修改或访问私有成员，从而保证类的封装性。
      */
-    QOpenGLShaderProgram *shaderProgram;  // 声明 shaderProgram 作为类的成员
-    GLuint texture; // 声明纹理变量
-    QOpenGLVertexArrayObject vao;  // VAO 成员变量
-    QOpenGLBuffer vbo;             // VBO 成员变量
-    /*
-     * QOpenGLVertexArrayObject vao：用于存储顶点数组对象的状态。这个对象会记录顶点属性布局，避免在每次绘制时重新设置。
-     * QOpenGLBuffer vbo：用于存储顶点数据的缓冲区对象。顶点数据会上传到显存中，以供 OpenGL 使用。
-     */
+    void drawProfilerOverlay();  // 在 GL 画面上用 QPainter 叠加帧计时
+    void paintScene();           // 场景变了才重画进场景层，然后把场景层贴到窗口的帧缓冲上
+
+    Renderer *renderer;  // 实际的绘制代码（着色器、VAO/VBO、纹理都在 Renderer 里）
+    JobSystem *jobSystem;  // Renderer 每帧剔除、准备顶点用的工作线程，比 renderer 活得长
+    RenderThread *renderThread;  // 渲染线程模式下不为空，renderer 归它管
+    bool threaded;
+    bool overlayVisible;
+    QString modelFile;
+    int modelCopies;
+    float lodError;
+    float impostorPixels;
+    qint64 textureBudget;
+    QString glTraceFile;
+    int glTraceFrames;
+    QOpenGLFramebufferObject *sceneLayer;  // 缓存的场景，和窗口一样大（物理像素）
+    QRect dirtyRegion;                     // invalidate(区域) 累计的要重画的部分（窗口坐标）
+    bool continuous;
+    quint64 framesRendered;
+    quint64 framesSkipped;
+    QTimer *overlayTimer;                  // 叠加层开着时定时刷新
+    FrameCapture *frameCapture;            // 属于窗口的上下文（渲染线程模式下也是）
+    QString pendingCapturePath;            // initializeGL() 之前调用 startCapture() 时先记下来
+    int pendingCaptureFrames;
 };
 
 #endif // MYOPENGLWIDGET_H
@@ -0,0 +1,294 @@
+#include "RenderThread.h"
+#include <QCoreApplication>
+#include <QOpenGLExtraFunctions>
+#include <QMutexLocker>
+#include <QDebug>
+
+RenderThread::RenderThread(Renderer *renderer, QOpenGLContext *shareContext, QObject *parent)
+    : QThread(parent), renderer(renderer), shareContext(shareContext), context(nullptr), surface(nullptr),
+      backIndex(0), frontIndex(2), exchange(1), readFramebuffer(0), frameIntervalNs(0), nextFrameNs(0),
+      stopping(0), snapshotEnabled(0), notifyPending(0), framesRendered(0), framesSkipped(0), continuous(0),
+      wakePending(false)
+{
+}
+
+RenderThread::~RenderThread()
+{
+    stop();
+    delete context;
+    delete surface;
+}
+
+bool RenderThread::startRendering(const QSize &size)
+{
+    // 和 TextureManager 的上传上下文一样：同一个共享组，渲染线程画的纹理窗口上下文可以直接读
+    surface = new QOffscreenSurface();
+    surface->setFormat(shareContext->format());
+    surface->create();
+    context = new QOpenGLContext();
+    context->setFormat(shareContext->format());
+    context->setShareContext(shareContext);
+    if (!context->create() || !context->makeCurrent(surface)) {
+        qWarning("RenderThread: failed to create the shared render context");
+        // 不接管 renderer：还给调用方（它还没初始化），析构时 stop() 也不会去碰这个没建成的上下文
+        renderer = nullptr;
+        delete context;
+        context = nullptr;
+        delete surface;
+        surface = nullptr;
+        return false;
+    }
+
+    // 在 GUI 线程里初始化：TextureManager::initialize() 要创建 QOffscreenSurface
+    initializeOpenGLFunctions();
+    frameSize = size;
+    renderer->initialize();
+    renderer->resize(size.width(), size.height());
+    context->doneCurrent();
+
+    context->moveToThread(this);  // 上下文只能在它所属的线程里 makeCurrent
+    stopping.storeRelease(0);
+    start();
+    return true;
+}
+
+void RenderThread::stop()
+{
+    if (isRunning()) {
+        stopping.storeRelease(1);
+        wake();  // 空闲时线程睡在 waitForWork() 里
+        wait();
+    }
+    if (!renderer)
+        return;
+
+    // run() 结束前已经把上下文移回 GUI 线程
+    context->makeCurrent(surface);
+    destroyFrameBuffers();
+    delete renderer;
+    renderer = nullptr;
+    context->doneCurrent();
+}
+
+void RenderThread::setTargetFrameRate(double fps)
+{
+    frameIntervalNs.storeRelease(fps > 0.0 ? qint64(1.0e9 / fps) : 0);
+}
+
+void RenderThread::resize(const QSize &size)
+{
+    if (!post([this, size](Renderer &r) {
+            frameSize = size;
+            r.resize(size.width(), size.height());
+        }))
+        qWarning("RenderThread: command queue full, resize dropped");
+}
+
+bool RenderThread::post(const std::function<void(Renderer &)> &command)
+{
+    if (!commands.push(command))
+        return false;
+    wake();
+    return true;
+}
+
+void RenderThread::invalidate()
+{
+    post([](Renderer &r) { r.invalidate(); });
+}
+
+void RenderThread::setContinuous(bool enabled)
+{
+    continuous.storeRelease(enabled ? 1 : 0);
+    wake();
+}
+
+void RenderThread::wake()
+{
+    QMutexLocker locker(&wakeMutex);
+    wakePending = true;
+    wakeCondition.wakeOne();
+}
+
+void RenderThread::setProfilerSnapshotEnabled(bool enabled)
+{
+    snapshotEnabled.storeRelease(enabled ? 1 : 0);
+}
+
+void RenderThread::profilerSnapshot(QStringList *lines, std::vector<FrameProfiler::FrameTime> *times) const
+{
+    QMutexLocker locker(&snapshotMutex);
+    *lines = snapshotLines;
+    *times = snapshotTimes;
+}
+
+void RenderThread::run()
+{
+    context->makeCurrent(surface);
+    clock.start();
+    nextFrameNs = clock.nsecsElapsed();
+
+    std::function<void(Renderer &)> command;
+    while (!stopping.loadAcquire()) {
+        while (commands.pop(command))
+            command(*renderer);
+        if (continuous.loadAcquire() || renderer->needsRender()) {
+            renderFrame();
+        } else if (!renderer->hasPendingWork()) {
+            waitForWork();  // 什么都没变、也没有纹理在路上：不按帧率空转，睡到下一个命令
+            continue;
+        } else {
+            framesSkipped.fetchAndAddRelaxed(1);  // 纹理还在路上，下一帧再问
+        }
+        waitForNextFrame();
+    }
+    // 退出前发来的命令（比如最后一次写 trace）也执行掉
+    while (commands.pop(command))
+        command(*renderer);
+
+    context->doneCurrent();
+    context->moveToThread(QCoreApplication::instance()->thread());  // stop() 要在 GUI 线程里释放资源
+}
+
+void RenderThread::renderFrame()
+{
+    FrameBuffer &buffer = buffers[backIndex];
+    // GUI 线程还在读这个缓冲的话让 GPU 先等它读完；画好却没被显示过的帧直接丢掉它的 fence
+    if (buffer.presentedFence) {
+        glWaitSync(buffer.presentedFence, 0, GL_TIMEOUT_IGNORED);
+        glDeleteSync(buffer.presentedFence);
+        buffer.presentedFence = nullptr;
+    }
+    if (buffer.renderedFence) {
+        glDeleteSync(buffer.renderedFence);
+        buffer.renderedFence = nullptr;
+    }
+
+    // 大小变了只重建自己手里的缓冲，GUI 线程手里的那个等轮到时再换
+    if (!buffer.fbo || buffer.size != frameSize) {
+        delete buffer.fbo;
+        QOpenGLFramebufferObjectFormat format;
+        format.setAttachment(QOpenGLFramebufferObject::CombinedDepthStencil);
+        buffer.fbo = new QOpenGLFramebufferObject(frameSize, format);
+        buffer.texture = buffer.fbo->texture();
+        buffer.size = frameSize;
+        renderer->state().invalidate();  // 创建 FBO 时绑定过纹理
+    }
+
+    buffer.fbo->bind();
+    renderer->render();
+
+    if (snapshotEnabled.loadAcquire()) {
+        QStringList lines = renderer->profiler().overlayLines();
+        std::vector<FrameProfiler::FrameTime> times = renderer->profiler().recentFrameTimes(120);
+        QMutexLocker locker(&snapshotMutex);
+        snapshotLines.swap(lines);
+        snapshotTimes.swap(times);
+    }
+
+    buffer.renderedFence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    glFlush();  // fence 提交给 GPU 以后，别的上下文等它才不会死等
+
+    // 画好的缓冲换成 "待取"，拿回上一个待取的（GUI 线程没取走就是那个没显示过的旧帧）
+    backIndex = exchange.fetchAndStoreOrdered(backIndex | FreshFrame) & IndexMask;
+    framesRendered.fetchAndAddRelease(1);
+    if (notifyPending.testAndSetOrdered(0, 1))
+        emit frameReady();
+}
+
+void RenderThread::waitForNextFrame()
+{
+    const qint64 interval = frameIntervalNs.loadAcquire();
+    if (interval <= 0)
+        return;
+
+    nextFrameNs += interval;
+    const qint64 now = clock.nsecsElapsed();
+    if (now > nextFrameNs + interval) {
+        // 落后超过一帧：不追赶（连着画几帧只会让帧时间更不均匀），从现在重新计时
+        nextFrameNs = now;
+        return;
+    }
+    // 先睡到离截止时刻 1 ms（睡眠的精度通常只有 1 ms 左右），剩下的让出 CPU 轮询
+    const qint64 sleepNs = nextFrameNs - now - 1000000;
+    if (sleepNs > 0)
+        QThread::usleep(quint64(sleepNs / 1000));
+    while (clock.nsecsElapsed() < nextFrameNs)
+        QThread::yieldCurrentThread();
+}
+
+void RenderThread::waitForWork()
+{
+    const qint64 idleStart = clock.nsecsElapsed();
+    {
+        QMutexLocker locker(&wakeMutex);
+        while (!wakePending && !stopping.loadAcquire())
+            wakeCondition.wait(&wakeMutex);
+        wakePending = false;
+    }
+    // 睡着的这段时间按帧率折算成跳过的帧；醒来以后从现在重新计时
+    const qint64 now = clock.nsecsElapsed();
+    const qint64 interval = frameIntervalNs.loadAcquire();
+    framesSkipped.fetchAndAddRelaxed(quint64(interval > 0 ? (now - idleStart) / interval + 1 : 1));
+    nextFrameNs = now;
+}
+
+void RenderThread::destroyFrameBuffers()
+{
+    for (FrameBuffer &buffer : buffers) {
+        if (buffer.renderedFence)
+            glDeleteSync(buffer.renderedFence);
+        if (buffer.presentedFence)
+            glDeleteSync(buffer.presentedFence);
+        delete buffer.fbo;
+        buffer = FrameBuffer();
+    }
+}
+
+bool RenderThread::present(GLuint targetFramebuffer, const QSize &targetSize)
+{
+    QOpenGLExtraFunctions *f = QOpenGLContext::currentContext()->extraFunctions();
+    notifyPending.storeRelease(0);
+
+    // 有新帧就把它换到 "前" 缓冲，没有就继续显示上一帧
+    if (exchange.loadAcquire() & FreshFrame)
+        frontIndex = exchange.fetchAndStoreOrdered(frontIndex) & IndexMask;
+    FrameBuffer &buffer = buffers[frontIndex];
+    if (!buffer.texture)
+        return false;
+
+    if (buffer.renderedFence) {
+        f->glWaitSync(buffer.renderedFence, 0, GL_TIMEOUT_IGNORED);
+        f->glDeleteSync(buffer.renderedFence);
+        buffer.renderedFence = nullptr;
+    }
+    if (buffer.presentedFence) {
+        // 同一帧显示了不止一次，只需要等最后一次
+        f->glDeleteSync(buffer.presentedFence);
+        buffer.presentedFence = nullptr;
+    }
+
+    // FBO 对象不在上下文之间共享，纹理共享：在窗口上下文里建一个只用来读的 FBO 挂上这张纹理
+    if (!readFramebuffer)
+        f->glGenFramebuffers(1, &readFramebuffer);
+    f->glBindFramebuffer(GL_READ_FRAMEBUFFER, readFramebuffer);
+    f->glFramebufferTexture2D(GL_READ_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, buffer.texture, 0);
+    f->glBindFramebuffer(GL_DRAW_FRAMEBUFFER, targetFramebuffer);
+    // 窗口刚改过大小、新尺寸的帧还没画出来时拉伸显示
+    const GLenum filter = buffer.size == targetSize ? GL_NEAREST : GL_LINEAR;
+    f->glBlitFramebuffer(0, 0, buffer.size.width(), buffer.size.height(), 0, 0, targetSize.width(),
+                         targetSize.height(), GL_COLOR_BUFFER_BIT, filter);
+    f->glBindFramebuffer(GL_FRAMEBUFFER, targetFramebuffer);
+
+    buffer.presentedFence = f->glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    f->glFlush();
+    return true;
+}
+
+void RenderThread::releasePresentResources()
+{
+    if (readFramebuffer) {
+        QOpenGLContext::currentContext()->extraFunctions()->glDeleteFramebuffers(1, &readFramebuffer);
+        readFramebuffer = 0;
+    }
+}
@@ -0,0 +1,125 @@
+#ifndef RENDERTHREAD_H
+#define RENDERTHREAD_H
+
+#include <QThread>
+#include <QOpenGLContext>
+#include <QOffscreenSurface>
+#include <QOpenGLFramebufferObject>
+#include <QOpenGLFunctions_4_5_Core>
+#include <QAtomicInt>
+#include <QElapsedTimer>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QSize>
+#include <QStringList>
+#include <functional>
+#include <vector>
+#include "Renderer.h"
+#include "SpscQueue.h"
+
+/* RenderThread：在自己的线程、自己的上下文里跑 Renderer，GUI 线程只负责把画好的帧贴到窗口上
+ *
+ * 默认模式下 paintGL() 由 Qt 事件循环调用，GUI 线程卡住（MainWindow 里的重活）渲染就跟着卡，反过来也一样。
+ * 这个模式下：
+ *   - 渲染线程持有一个和窗口上下文共享的 QOpenGLContext + QOffscreenSurface，按自己的节奏
+ *     （setTargetFrameRate()，默认屏幕刷新率）把 Renderer 画进三个 FBO 里的一个
+ *   - 三缓冲交接：渲染线程画 "后" 缓冲，画完和 "待取" 缓冲原子交换；GUI 线程 present() 时
+ *     有新帧就把 "待取" 和 "前" 缓冲原子交换。三个缓冲始终各属一方，两边都不用锁、不用等对方
+ *   - GPU 上的先后用 fence 保证：渲染线程画完插 fence，GUI 线程 glWaitSync 后才读；
+ *     GUI 线程读完插 fence，渲染线程复用这个缓冲前 glWaitSync（都是 GPU 端等待，CPU 不阻塞）
+ *   - GUI 线程发给渲染线程的命令（改大小、写 trace……）走无锁的 SpscQueue，在下一帧开始前执行
+ *   - 按需渲染：Renderer::needsRender() 为 false 时不画，没有纹理在路上的话线程睡到下一个命令到来，
+ *     不按帧率空转；setContinuous(true) 恢复每帧都画
+ *
+ * QOffscreenSurface 和 TextureManager 的上传上下文只能在 GUI 线程创建，所以 startRendering()
+ * 在 GUI 线程里把渲染上下文设为当前、初始化 Renderer，然后再把上下文移到渲染线程；stop() 反过来。
+ */
+class RenderThread : public QThread, protected QOpenGLFunctions_4_5_Core
+{
+    Q_OBJECT
+
+public:
+    // 接管 renderer，stop() 时在渲染上下文里删除它。shareContext 是窗口的上下文
+    RenderThread(Renderer *renderer, QOpenGLContext *shareContext, QObject *parent = nullptr);
+    ~RenderThread();
+
+    // GUI 线程调用，返回后窗口的上下文不再是当前上下文。失败时不接管 renderer，调用方自己初始化或删除它
+    bool startRendering(const QSize &frameSize);
+    void stop();                                   // GUI 线程调用：停线程、释放渲染线程的 GL 资源
+
+    void setTargetFrameRate(double fps);           // 0 = 不限速，画完一帧马上画下一帧
+    void resize(const QSize &frameSize);
+    // 在渲染线程里、下一帧开始前执行；队列满时返回 false
+    bool post(const std::function<void(Renderer &)> &command);
+    void invalidate();                             // 场景变了，下一帧重画（在渲染线程里调用 Renderer::invalidate()）
+    void setContinuous(bool enabled);
+
+    /* GUI 线程、窗口上下文是当前上下文时调用：把最新的一帧 blit 到 targetFramebuffer。
+     * 还没有任何一帧画完时返回 false */
+    bool present(GLuint targetFramebuffer, const QSize &targetSize);
+    void releasePresentResources();                // 窗口上下文是当前上下文时调用，删除 present() 用的 FBO
+
+    // 叠加层：渲染线程每帧把计时拷一份出来，GUI 线程读拷贝（FrameProfiler 本身只能在渲染线程碰）
+    void setProfilerSnapshotEnabled(bool enabled);
+    void profilerSnapshot(QStringList *lines, std::vector<FrameProfiler::FrameTime> *times) const;
+
+    quint64 renderedFrames() const { return quint64(framesRendered.loadAcquire()); }
+    quint64 skippedFrames() const { return quint64(framesSkipped.loadAcquire()); }   // 没东西变、没画的帧
+
+signals:
+    void frameReady();   // 渲染线程每画完一帧发出，连接到窗口的 update()（跨线程，自动排队）
+
+protected:
+    void run() override;
+
+private:
+    // 三缓冲里的一个。texture/size 由渲染线程在交换前写好，GUI 线程交换后才读
+    struct FrameBuffer
+    {
+        QOpenGLFramebufferObject *fbo = nullptr;
+        GLuint texture = 0;
+        QSize size;
+        GLsync renderedFence = nullptr;   // 渲染线程画完时插入，GUI 线程 present() 前等待
+        GLsync presentedFence = nullptr;  // GUI 线程读完时插入，渲染线程复用前等待
+    };
+
+    enum { IndexMask = 3, FreshFrame = 4 };  // exchange 里的值：缓冲下标 | 是否是还没显示过的新帧
+
+    void renderFrame();
+    void waitForNextFrame();
+    void waitForWork();             // 没东西可画时睡到 wake()
+    void wake();
+    void destroyFrameBuffers();
+
+    Renderer *renderer;
+    QOpenGLContext *shareContext;
+    QOpenGLContext *context;
+    QOffscreenSurface *surface;
+    FrameBuffer buffers[3];
+    int backIndex;                  // 只由渲染线程使用
+    int frontIndex;                 // 只由 GUI 线程使用
+    QAtomicInt exchange;            // 待取的缓冲
+    GLuint readFramebuffer;         // present() 用，属于窗口上下文
+
+    SpscQueue<std::function<void(Renderer &)>, 256> commands;
+    QSize frameSize;                // 只由渲染线程使用，GUI 线程通过命令修改
+    QAtomicInteger<qint64> frameIntervalNs;
+    QElapsedTimer clock;
+    qint64 nextFrameNs;             // 下一帧的开始时刻（clock 的纳秒）
+    QAtomicInt stopping;
+    QAtomicInt snapshotEnabled;
+    QAtomicInt notifyPending;       // 已经发出 frameReady、GUI 线程还没 present()：不重复发，免得事件队列堆积
+    QAtomicInteger<quint64> framesRendered;
+    QAtomicInteger<quint64> framesSkipped;
+    QAtomicInt continuous;
+
+    QMutex wakeMutex;               // 只保护 wakePending，配合 wakeCondition 让空闲的渲染线程睡着
+    QWaitCondition wakeCondition;
+    bool wakePending;
+
+    mutable QMutex snapshotMutex;   // 只保护下面两个拷贝，渲染线程每帧持有几微秒
+    QStringList snapshotLines;
+    std::vector<FrameProfiler::FrameTime> snapshotTimes;
+};
+
+#endif // RENDERTHREAD_H
@@ -0,0 +1,764 @@
+#include "Renderer.h"
+#include <algorithm>
+#include <cmath>
+#include <QDebug>
+
+namespace {
+
+// Vertex data for a simple triangle
+const SpriteVertex triangle[3] = {
+    // 位置               // 纹理坐标     // 颜色
+    { {0.0f,  0.5f, 0.0f},  {0.5f, 1.0f}, {255, 255, 255, 255} },   // 顶点 1
+    { {-0.5f, -0.5f, 0.0f}, {0.0f, 0.0f}, {255, 255, 255, 255} },   // 顶点 2
+    { {0.5f, -0.5f, 0.0f},  {1.0f, 0.0f}, {255, 255, 255, 255} }    // 顶点 3
+};
+
+const int ImpostorSize = 256;   // 公告板图片的边长（像素），远处才用得到，不用太大
+
+// 公告板的着色器：和 SpriteBatch 的默认着色器一样，只是透明的地方丢掉（不开混合，靠 alpha 测试抠出轮廓）
+const char *impostorVertexSource = R"(
+    #version 460 core
+    layout(location = 0) in vec3 position;
+    layout(location = 1) in vec2 texCoord;
+    layout(location = 2) in vec4 color;
+
+    uniform mat4 viewProjection;
+
+    out vec2 TexCoord;
+    out vec4 Color;
+
+    void main() {
+        gl_Position = viewProjection * vec4(position, 1.0);
+        TexCoord = texCoord;
+        Color = color;
+    }
+)";
+
+const char *impostorFragmentSource = R"(
+    #version 460 core
+    in vec2 TexCoord;
+    in vec4 Color;
+
+    out vec4 fragColor;
+
+    uniform sampler2D texture1;
+
+    void main() {
+        fragColor = texture(texture1, TexCoord) * Color;
+        if (fragColor.a < 0.5)
+            discard;
+    }
+)";
+
+} // namespace
+
+Renderer::Renderer()
+    : indirectTriangle(-1), triangleCount(1), instanced(false), indirect(false),
+      meshFormat(VertexFormat::full(false)), copies(1), modelSize(0.0f), modelRadius(0.0f), lodThreshold(1.0f),
+      impostorPixels(0.0f), impostorTexture(0), impostorSource(0), impostorProgram(nullptr), visibleCount(0),
+      dirty(true), jobs(nullptr), traceFrames(0)
+{
+}
+
+Renderer::~Renderer()
+{
+    // 析构时调用方必须保证 OpenGL 上下文是当前上下文（见 MyOpenGLWidget::~MyOpenGLWidget）
+    cleanup();
+}
+
+QSurfaceFormat Renderer::surfaceFormat()
+{
+    QSurfaceFormat format;
+    format.setVersion(4, 5);
+    format.setProfile(QSurfaceFormat::CoreProfile);
+    format.setDepthBufferSize(24);
+    return format;
+}
+
+void Renderer::cleanup()
+{
+    stopTrace();
+    texture = TextureHandle();
+    textureManager.cleanup();
+    spriteBatch.cleanup();
+    sceneMesh.destroy();
+    indirectBatch.destroy();
+    indirectTriangle = -1;
+    modelBatch.destroy();
+    modelLods.clear();
+    delete impostorProgram;
+    impostorProgram = nullptr;
+    if (impostorTexture) {
+        glDeleteTextures(1, &impostorTexture);
+        impostorTexture = 0;
+        impostorSource = 0;
+    }
+    frameProfiler.cleanup();
+    stateCache.invalidate();  // 删掉的对象可能还记在缓存里
+}
+
+void Renderer::invalidate()
+{
+    dirty = true;
+}
+
+bool Renderer::needsRender()
+{
+    if (textureManager.processUploads() > 0)
+        dirty = true;  // 占位纹理换成了真正的纹理
+    return dirty;
+}
+
+bool Renderer::hasPendingWork() const
+{
+    return textureManager.pendingCount() > 0;
+}
+
+void Renderer::setClipRect(const QRect &rect)
+{
+    clipRect = rect;
+}
+
+void Renderer::setSceneSize(int triangles)
+{
+    triangleCount = qMax(1, triangles);
+}
+
+int Renderer::sceneSize() const
+{
+    return triangleCount;
+}
+
+void Renderer::setInstancing(bool enabled)
+{
+    instanced = enabled;
+}
+
+bool Renderer::instancing() const
+{
+    return instanced;
+}
+
+void Renderer::setMultiDrawIndirect(bool enabled)
+{
+    indirect = enabled;
+}
+
+bool Renderer::multiDrawIndirect() const
+{
+    return indirect;
+}
+
+bool Renderer::perObjectTransforms() const
+{
+    return instanced || indirect;
+}
+
+void Renderer::setVertexFormat(const VertexFormat &format)
+{
+    meshFormat = format;
+}
+
+const VertexFormat &Renderer::vertexFormat() const
+{
+    return meshFormat;
+}
+
+void Renderer::setModel(const QString &path)
+{
+    modelPath = path;
+}
+
+QString Renderer::model() const
+{
+    return modelPath;
+}
+
+const Mesh::OptimizeStats &Renderer::modelStats() const
+{
+    return modelOptimizeStats;
+}
+
+void Renderer::setModelCopies(int count)
+{
+    copies = qMax(1, count);
+}
+
+int Renderer::modelCopies() const
+{
+    return copies;
+}
+
+void Renderer::setLodErrorThreshold(float pixels)
+{
+    lodThreshold = qMax(0.0f, pixels);
+    lodSelector.setErrorThreshold(lodThreshold);
+    dirty = true;
+}
+
+float Renderer::lodErrorThreshold() const
+{
+    return lodThreshold;
+}
+
+void Renderer::setImpostorSize(float pixels)
+{
+    impostorPixels = qMax(0.0f, pixels);
+    lodSelector.setImpostorSize(impostorPixels, modelRadius);
+    dirty = true;
+}
+
+float Renderer::impostorSize() const
+{
+    return impostorPixels;
+}
+
+void Renderer::setSceneCallback(const std::function<void(SpriteBatch &)> &callback)
+{
+    sceneCallback = callback;
+}
+
+GLuint Renderer::defaultTexture() const
+{
+    return texture.id();
+}
+
+TextureManager &Renderer::textures()
+{
+    return textureManager;
+}
+
+ShaderCache &Renderer::shaders()
+{
+    return shaderCache;
+}
+
+const SpriteBatch::Stats &Renderer::batchStats() const
+{
+    return spriteBatch.stats();
+}
+
+int Renderer::drawCalls() const
+{
+    return spriteBatch.stats().drawCalls + sceneMesh.stats().drawCalls + indirectBatch.stats().drawCalls
+           + modelBatch.stats().drawCalls;
+}
+
+int Renderer::triangles() const
+{
+    // 合批的图元（包括公告板）按索引数算，四边形是 2 个三角形
+    return spriteBatch.stats().indices / 3 + sceneMesh.stats().triangles + indirectBatch.stats().triangles
+           + modelBatch.stats().triangles;
+}
+
+const LodSelector::Stats &Renderer::lodStats() const
+{
+    return lodSelector.stats();
+}
+
+FrameProfiler &Renderer::profiler()
+{
+    return frameProfiler;
+}
+
+GLStateCache &Renderer::state()
+{
+    return stateCache;
+}
+
+Scene &Renderer::scene()
+{
+    return sceneBounds;
+}
+
+int Renderer::visibleObjects() const
+{
+    return visibleCount;
+}
+
+void Renderer::setJobSystem(JobSystem *jobSystem)
+{
+    jobs = jobSystem;
+}
+
+JobSystem *Renderer::jobSystem() const
+{
+    return jobs;
+}
+
+void Renderer::setTraceFile(const QString &path, int frames)
+{
+    tracePath = path;
+    traceFrames = frames;
+}
+
+QString Renderer::traceFile() const
+{
+    return tracePath;
+}
+
+const GLTrace::Stats &Renderer::traceStats() const
+{
+    return traceRecorder.stats();
+}
+
+void Renderer::stopTrace()
+{
+    if (!traceRecorder.isRecording())
+        return;
+    traceRecorder.stop();
+    const GLTrace::Stats &stats = traceRecorder.stats();
+    qInfo("Renderer: GL trace %s: %d frames, %lld records, %lld KB, %d snapshots, %d dropped",
+          qPrintable(tracePath), stats.frames, stats.records, stats.bytes / 1024, stats.snapshots, stats.dropped);
+}
+
+void Renderer::buildScene()
+{
+    sceneVertices.clear();
+    sceneInstances.clear();
+    sceneBounds.clear();
+    sceneBounds.reserve(triangleCount);
+    if (perObjectTransforms()) {
+        // 实例化：网格就是原来那个三角形，每个实例一个 "平移 + 缩放" 矩阵
+        sceneInstances.reserve(size_t(triangleCount));
+    } else {
+        sceneVertices.reserve(size_t(triangleCount) * 3);
+    }
+    if (triangleCount == 1) {
+        // 场景规模为 1 时就是原来那个三角形，保证窗口里看到的画面不变
+        if (perObjectTransforms())
+            sceneInstances.push_back(MeshInstance::make(QMatrix4x4()));
+        else
+            sceneVertices.assign(triangle, triangle + 3);
+        sceneBounds.add(0.0f, 0.0f, 0.0f, 0.5f * std::sqrt(2.0f));  // 三个顶点都在以原点为中心、半径 √2/2 的球里
+        return;
+    }
+
+    /* 场景规模大于 1 时（基准测试用），把三角形缩小后平铺到 cols x rows 的网格里，
+     * 每个三角形单独提交给 SpriteBatch，由它合并成一次绘制；实例化时每个三角形是一个实例。
+     */
+    const int cols = int(std::ceil(std::sqrt(double(triangleCount))));
+    const int rows = (triangleCount + cols - 1) / cols;
+    const GLfloat cellW = 2.0f / cols;
+    const GLfloat cellH = 2.0f / rows;
+    for (int i = 0; i < triangleCount; ++i) {
+        const GLfloat cx = -1.0f + cellW * (i % cols + 0.5f);
+        const GLfloat cy = -1.0f + cellH * (i / cols + 0.5f);
+        sceneBounds.add(cx, cy, 0.0f, 0.5f * std::sqrt(cellW * cellW + cellH * cellH));  // 格子的外接圆
+        if (perObjectTransforms()) {
+            QMatrix4x4 transform;
+            transform.translate(cx, cy);
+            transform.scale(cellW, cellH);
+            sceneInstances.push_back(MeshInstance::make(transform));
+            continue;
+        }
+        for (SpriteVertex v : triangle) {
+            v.position[0] = cx + v.position[0] * cellW;
+            v.position[1] = cy + v.position[1] * cellH;
+            sceneVertices.push_back(v);
+        }
+    }
+}
+
+bool Renderer::chunkFullyVisible(int chunk) const
+{
+    const int first = chunk * PrepareChunk;
+    return chunkVisible[size_t(chunk)] == std::min(first + PrepareChunk, sceneBounds.size()) - first;
+}
+
+void Renderer::prepareScene()
+{
+    const int objects = sceneBounds.paddedSize();
+    const int chunks = (objects + PrepareChunk - 1) / PrepareChunk;
+    chunkVisible.assign(size_t(chunks), 0);
+    if (visible.size() < size_t(objects))
+        visible.resize(size_t(objects));
+    // 大小只在场景变了以后的第一帧变，之后 resize 什么都不做
+    if (perObjectTransforms())
+        preparedInstances.resize(sceneInstances.size());
+    else
+        preparedVertices.resize(sceneVertices.size());
+
+    // 每块只写自己那一段 visible/prepared*/chunkVisible，线程之间不共享可写的数据
+    auto prepareChunks = [this](int firstChunk, int lastChunk) {
+        for (int c = firstChunk; c < lastChunk; ++c) {
+            const int first = c * PrepareChunk;
+            const int last = std::min(first + PrepareChunk, sceneBounds.paddedSize());
+            const int *ids = &visible[size_t(first)];
+            // 场景里的顶点已经是标准化设备坐标，viewProjection 是单位矩阵，视锥就是 [-1, 1]^3
+            const int n = sceneBounds.cull(QMatrix4x4(), first, last, &visible[size_t(first)]);
+            chunkVisible[size_t(c)] = n;
+            if (chunkFullyVisible(c))
+                continue;
+            if (perObjectTransforms()) {
+                for (int i = 0; i < n; ++i)
+                    preparedInstances[size_t(first + i)] = sceneInstances[size_t(ids[i])];
+            } else {
+                for (int i = 0; i < n; ++i) {
+                    const SpriteVertex *v = &sceneVertices[size_t(ids[i]) * 3];
+                    std::copy(v, v + 3, &preparedVertices[size_t(first + i) * 3]);
+                }
+            }
+        }
+    };
+    if (jobs)
+        jobs->parallelFor(chunks, 1, prepareChunks);
+    else
+        prepareChunks(0, chunks);
+
+    visibleCount = 0;
+    for (int n : chunkVisible)
+        visibleCount += n;
+}
+
+void Renderer::loadModel()
+{
+    Mesh mesh;
+    if (!mesh.load(modelPath)) {
+        qWarning() << "Renderer:" << mesh.errorString();
+        return;
+    }
+    modelOptimizeStats = mesh.optimize();
+    qInfo("Renderer: %s: %d triangles, %d -> %d vertices, ACMR %.2f -> %.2f, ATVR %.2f -> %.2f",
+          qPrintable(modelPath), mesh.triangleCount(), mesh.sourceVertexCount(), mesh.vertexCount(),
+          modelOptimizeStats.before.acmr, modelOptimizeStats.after.acmr, modelOptimizeStats.before.atvr,
+          modelOptimizeStats.after.atvr);
+
+    QVector3D lo, hi;
+    mesh.bounds(&lo, &hi);
+    const QVector3D extent = hi - lo;
+    modelCenter = 0.5f * (lo + hi);
+    modelSize = std::max({extent.x(), extent.y(), extent.z()});
+    modelRadius = 0.5f * extent.length();
+
+    // LOD：所有层共用顶点，只多传几份越来越短的索引
+    mesh.buildLods();
+    qsizetype lodIndices = 0;
+    for (const Mesh::Lod &lod : mesh.lods())
+        lodIndices += qsizetype(lod.indices.size());
+    if (!modelBatch.create(shaderCache, stateCache, meshFormat, mesh.vertexCount(), int(lodIndices)))
+        return;
+    const int base = modelBatch.addMesh(mesh.vertices().data(), mesh.vertexCount(), mesh.indices().data(),
+                                        int(mesh.indices().size()));
+    if (base < 0) {
+        modelBatch.destroy();
+        return;
+    }
+    modelLods.assign(1, base);
+    std::vector<float> errors(1, 0.0f);
+    QString levels = QString::number(mesh.triangleCount());
+    for (size_t level = 1; level < mesh.lods().size(); ++level) {
+        const Mesh::Lod &lod = mesh.lods()[level];
+        const int id = modelBatch.addMeshLevel(base, lod.indices.data(), int(lod.indices.size()));
+        if (id < 0)
+            break;
+        modelLods.push_back(id);
+        errors.push_back(lod.error);
+        levels += QString(" / %1").arg(int(lod.indices.size() / 3));
+    }
+    qInfo("Renderer: %s: %d LOD levels, triangles %s", qPrintable(modelPath), int(modelLods.size()),
+          qPrintable(levels));
+    lodSelector.setLevels(errors);
+    lodSelector.setErrorThreshold(lodThreshold);
+    lodSelector.setImpostorSize(impostorPixels, modelRadius);
+    lodSelector.resize(copies);
+
+    /* 视图是单位矩阵（和内置场景一样直接画在 NDC 里）：z 取反，模型坐标里朝 +z（朝向观察者）的一面离得近。
+     * 一份时和原来一样占视口的 80%；多份时平铺到 cols x rows 的格子里，每份再乘一个 0.25 ~ 1 的系数
+     * （黄金比例的小数部分，每次运行都一样），屏幕上大大小小的都有，各层 LOD 都用得到 */
+    const int cols = int(std::ceil(std::sqrt(double(copies))));
+    const int rows = (copies + cols - 1) / cols;
+    const float cellW = 2.0f / cols;
+    const float cellH = 2.0f / rows;
+    modelTransforms.clear();
+    for (int i = 0; i < copies; ++i) {
+        const float variation = copies == 1 ? 1.0f : 0.25f + 0.75f * float(std::fmod(i * 0.6180339887, 1.0));
+        const float scale = modelSize > 0.0f ? 0.8f * std::min(cellW, cellH) / modelSize * variation : 1.0f;
+        QMatrix4x4 transform;
+        transform.translate(-1.0f + cellW * (i % cols + 0.5f), -1.0f + cellH * (i / cols + 0.5f));
+        transform.scale(scale, scale, -scale);
+        transform.translate(-modelCenter);
+        modelTransforms.push_back(transform);
+    }
+}
+
+void Renderer::captureImpostor()
+{
+    if (!impostorProgram) {
+        impostorProgram = shaderCache.program(impostorVertexSource, impostorFragmentSource);
+        if (!impostorProgram) {
+            qWarning("Renderer: impostor shader program failed to build");
+            impostorPixels = 0.0f;
+            lodSelector.setImpostorSize(0.0f, modelRadius);
+            return;
+        }
+    }
+    if (!impostorTexture) {
+        glCreateTextures(GL_TEXTURE_2D, 1, &impostorTexture);
+        glTextureStorage2D(impostorTexture, TextureManager::mipLevels(ImpostorSize, ImpostorSize), GL_RGBA8,
+                           ImpostorSize, ImpostorSize);
+        glTextureParameteri(impostorTexture, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+        glTextureParameteri(impostorTexture, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTextureParameteri(impostorTexture, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTextureParameteri(impostorTexture, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    }
+
+    // 临时的帧缓冲：颜色画进 impostorTexture，深度用一个渲染缓冲。画完换回调用方的帧缓冲和视口
+    GLint drawFramebuffer = 0, readFramebuffer = 0;
+    GLint viewport[4] = {};
+    glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &drawFramebuffer);
+    glGetIntegerv(GL_READ_FRAMEBUFFER_BINDING, &readFramebuffer);
+    glGetIntegerv(GL_VIEWPORT, viewport);
+    GLuint depth = 0, framebuffer = 0;
+    glCreateRenderbuffers(1, &depth);
+    glNamedRenderbufferStorage(depth, GL_DEPTH_COMPONENT24, ImpostorSize, ImpostorSize);
+    glCreateFramebuffers(1, &framebuffer);
+    glNamedFramebufferTexture(framebuffer, GL_COLOR_ATTACHMENT0, impostorTexture, 0);
+    glNamedFramebufferRenderbuffer(framebuffer, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, depth);
+    if (glCheckNamedFramebufferStatus(framebuffer, GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE) {
+        glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+        glViewport(0, 0, ImpostorSize, ImpostorSize);
+        const GLfloat transparent[4] = {0.0f, 0.0f, 0.0f, 0.0f};
+        const GLfloat farDepth = 1.0f;
+        glClearNamedFramebufferfv(framebuffer, GL_COLOR, 0, transparent);
+        glClearNamedFramebufferfv(framebuffer, GL_DEPTH, 0, &farDepth);
+
+        // 和 modelTransforms 一样的朝向，包围盒最长边正好铺满图片；公告板的四边形是同样大小的正方形
+        QMatrix4x4 capture;
+        const float scale = modelSize > 0.0f ? 2.0f / modelSize : 1.0f;
+        capture.scale(scale, scale, -scale);
+        capture.translate(-modelCenter);
+        stateCache.setDepthTest(true);
+        modelBatch.begin();
+        modelBatch.add(modelLods.front(), capture);
+        modelBatch.draw(QMatrix4x4(), texture.id());
+        stateCache.setDepthTest(false);
+
+        glBindFramebuffer(GL_DRAW_FRAMEBUFFER, GLuint(drawFramebuffer));
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, GLuint(readFramebuffer));
+        glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+        glGenerateTextureMipmap(impostorTexture);
+        impostorSource = texture.id();
+    } else {
+        qWarning("Renderer: impostor framebuffer is incomplete, impostors disabled");
+        impostorPixels = 0.0f;
+        lodSelector.setImpostorSize(0.0f, modelRadius);
+    }
+    glDeleteFramebuffers(1, &framebuffer);
+    glDeleteRenderbuffers(1, &depth);
+}
+
+void Renderer::drawModel()
+{
+    // 每份按屏幕上的误差选一层，整个模型（所有份、所有层）还是一次 glMultiDrawElementsIndirect
+    const float viewportHeight = float(viewportSize.height());
+    modelImpostors.clear();
+    lodSelector.resetStats();
+    modelBatch.begin();
+    for (int i = 0; i < copies; ++i) {
+        const QMatrix4x4 &transform = modelTransforms[size_t(i)];
+        const float pixelsPerUnit = LodSelector::pixelsPerUnit(QMatrix4x4(), transform, modelCenter, viewportHeight);
+        const int level = lodSelector.select(i, pixelsPerUnit);
+        if (level == LodSelector::Impostor) {
+            QMatrix4x4 quad = transform;
+            quad.translate(modelCenter);
+            quad.scale(modelSize, modelSize, 1.0f);
+            modelImpostors.push_back(quad);
+            continue;
+        }
+        modelBatch.add(modelLods[size_t(level)], transform);
+    }
+    // 导入的模型自己有前后遮挡，只有它开深度测试；索引已经按顶点缓存和由外向内的顺序排好
+    stateCache.setDepthTest(true);
+    modelBatch.draw(QMatrix4x4(), texture.id());
+    stateCache.setDepthTest(false);
+}
+
+void Renderer::initialize()
+{
+    initializeOpenGLFunctions();
+    if (!tracePath.isEmpty()) {
+        // 从二进制缓存加载的程序没有着色器源码，trace 里只能记驱动的二进制，换台机器就回放不了
+        shaderCache.setEnabled(false);
+        if (traceRecorder.start(tracePath))
+            qInfo("Renderer: recording GL trace to %s", qPrintable(tracePath));
+    }
+    // 设置颜色缓冲区颜色   设置---》缓冲区---》屏幕，如果没有缓冲区而直接往屏幕上写，图像刷新时颜色会闪
+    // 这里将各个颜色设为0，透明度设为1
+    glClearColor(0.0f, 0.0f, 0.0f, 1.0f);  // 红，绿，蓝，透明度
+    frameProfiler.initialize();
+    stateCache.initialize();
+
+    // VAO/VBO 和着色器都在 SpriteBatch 里创建，所有图元都经过它合批绘制
+    shaderCache.initialize();
+    spriteBatch.initialize(shaderCache, stateCache);
+    if (indirect) {
+        if (indirectBatch.create(shaderCache, stateCache, meshFormat))
+            indirectTriangle = indirectBatch.addMesh(triangle, 3);
+    } else if (instanced) {
+        sceneMesh.create(shaderCache, stateCache, triangle, 3, nullptr, 0, meshFormat);
+    }
+    if (!modelPath.isEmpty())
+        loadModel();
+    buildScene();
+
+    // 纹理在后台线程解码、通过 PBO 上传，这里立刻返回句柄；传完之前画的是占位纹理
+    if (!textureManager.initialize(stateCache))
+        qWarning("Renderer: texture loading is unavailable, drawing the placeholder texture");
+    texture = textureManager.load(":/textures/001.png");  // 替换为你的纹理图片路径
+
+    // 上面创建资源时直接绑定过缓冲、VAO、纹理，缓存里的状态作废
+    stateCache.invalidate();
+    dirty = true;
+}
+
+void Renderer::resize(int w, int h)
+{
+    glViewport(0, 0, w, h);
+    viewportSize = QSize(w, h);
+    dirty = true;
+    // QOpenGLWidget 改变大小时会重建它的帧缓冲对象，创建过程中会绑定纹理
+    stateCache.invalidate();
+}
+
+void Renderer::render()
+{
+    traceRecorder.beginFrame();
+    // 每个阶段一个计时作用域；GPU 时间几帧之后才读回来，这里不会等待
+    frameProfiler.beginFrame();
+    if (impostorPixels > 0.0f && modelBatch.isCreated() && impostorSource != texture.id()) {
+        // 模型用的纹理换了（占位纹理 -> 真正的纹理、换了 mip）：重画公告板图片。要在打开剪裁测试之前
+        ProfileScope scope(frameProfiler, "impostor");
+        captureImpostor();
+    }
+    // 只重画一部分：剪裁测试同时限制 glClear 和所有绘制，矩形以外保留上一帧
+    if (!clipRect.isNull()) {
+        glEnable(GL_SCISSOR_TEST);
+        glScissor(clipRect.x(), clipRect.y(), clipRect.width(), clipRect.height());
+    }
+
+    {
+        ProfileScope scope(frameProfiler, "clear");
+        // 批处理的图元不做深度测试、不混合（和原来的默认状态一致）；只有第一帧真的调用到驱动
+        stateCache.setDepthTest(false);
+        stateCache.setBlend(false);
+
+        // 清除当前的绘图缓冲区，以准备进行新的绘制。
+        /*glClear参数的含义
+        GL_COLOR_BUFFER_BIT：表示要清除颜色缓冲区（也就是屏幕上的颜色图像）。
+        当这个标志被设置时，OpenGL 会将颜色缓冲区的内容清除为指定的清除颜色（由 glClearColor 设置）。
+
+        GL_DEPTH_BUFFER_BIT：表示要清除深度缓冲区。深度缓冲区用于记录每个像素的深度信息，
+        确保正确的图形遮挡关系。当这个标志被设置时，OpenGL 会将深度缓冲区的内容清除为
+        默认深度值（通常是最大的深度值，表示最远的可视点）。
+         */
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    }
+
+    {
+        ProfileScope scope(frameProfiler, "textures");
+        // 把后台传完的纹理换到句柄上（只查询 fence，不等待）
+        textureManager.processUploads();
+        // 内置场景和模型在屏幕上都不会比视口大
+        textureManager.requestSize(texture, viewportSize);
+    }
+
+    {
+        // 剔除 + 拷贝可见物体，有 JobSystem 时分到各个核上；下面的提交只是整块拷贝
+        ProfileScope scope(frameProfiler, "prepare");
+        prepareScene();
+    }
+
+    const int chunks = int(chunkVisible.size());
+    if (indirect) {
+        // 每个可见物体一条命令，整个内置场景一次 glMultiDrawElementsIndirect
+        ProfileScope scope(frameProfiler, "indirect");
+        indirectBatch.begin();
+        for (int c = 0; c < chunks; ++c) {
+            const size_t first = size_t(c) * PrepareChunk;
+            const MeshInstance *data = chunkFullyVisible(c) ? &sceneInstances[first] : &preparedInstances[first];
+            if (chunkVisible[size_t(c)] > 0)
+                indirectBatch.addDraws(indirectTriangle, data, chunkVisible[size_t(c)]);
+        }
+        indirectBatch.draw(QMatrix4x4(), texture.id());
+    } else if (instanced) {
+        // 整个内置场景一次 glDrawArraysInstancedBaseInstance
+        ProfileScope scope(frameProfiler, "instances");
+        sceneMesh.begin();
+        for (int c = 0; c < chunks; ++c) {
+            const size_t first = size_t(c) * PrepareChunk;
+            const MeshInstance *data = chunkFullyVisible(c) ? &sceneInstances[first] : &preparedInstances[first];
+            if (chunkVisible[size_t(c)] > 0)
+                sceneMesh.addInstances(data, chunkVisible[size_t(c)]);
+        }
+        sceneMesh.draw(QMatrix4x4(), texture.id());
+    }
+
+    if (modelBatch.isCreated()) {
+        ProfileScope scope(frameProfiler, "model");
+        drawModel();
+    }
+
+    {
+        ProfileScope scope(frameProfiler, "submit");
+        spriteBatch.begin(QMatrix4x4());
+        if (!perObjectTransforms()) {
+            for (int c = 0; c < chunks; ++c) {
+                const size_t first = size_t(c) * PrepareChunk * 3;
+                const SpriteVertex *data = chunkFullyVisible(c) ? &sceneVertices[first] : &preparedVertices[first];
+                if (chunkVisible[size_t(c)] > 0)
+                    spriteBatch.submitTriangles(texture.id(), data, chunkVisible[size_t(c)]);
+            }
+        }
+        for (const QMatrix4x4 &quad : modelImpostors)
+            spriteBatch.submitQuad(impostorTexture, quad, QRectF(0, 0, 1, 1), Qt::white, impostorProgram);
+        if (sceneCallback)
+            sceneCallback(spriteBatch);
+    }
+
+    {
+        ProfileScope scope(frameProfiler, "batch");
+        spriteBatch.end();  // 排序、上传、按 (着色器, 纹理) 合并绘制
+    }
+    if (!clipRect.isNull()) {
+        glDisable(GL_SCISSOR_TEST);
+        clipRect = QRect();
+    }
+    {
+        // 本帧用到的纹理都 requestSize() 过了（包括 sceneCallback 里的）：按需重新加载、超出预算时淘汰
+        ProfileScope scope(frameProfiler, "residency");
+        textureManager.updateResidency();
+    }
+    dirty = false;
+
+    const SpriteBatch::Stats &stats = spriteBatch.stats();
+    frameProfiler.setCounter("drawCalls", drawCalls());
+    frameProfiler.setCounter("primitives", stats.primitives);
+    frameProfiler.setCounter("instances", sceneMesh.stats().instances);
+    frameProfiler.setCounter("indirectDraws", indirectBatch.stats().draws);
+    frameProfiler.setCounter("triangles", triangles());
+    if (modelBatch.isCreated()) {
+        frameProfiler.setCounter("lodSwitches", lodSelector.stats().switches);
+        frameProfiler.setCounter("impostors", lodSelector.stats().impostors);
+    }
+    frameProfiler.setCounter("culled", sceneBounds.size() - visibleCount);
+    frameProfiler.setCounter("streamStalls", stats.streamStalls + sceneMesh.stats().streamStalls
+                                                 + indirectBatch.stats().streamStalls
+                                                 + modelBatch.stats().streamStalls);
+    const TextureManager::ResidencyStats residency = textureManager.residencyStats();
+    frameProfiler.setCounter("textureKB", residency.bytes / 1024);
+    frameProfiler.setCounter("texturesEvicted", residency.evicted);
+    frameProfiler.setCounter("glStateCalls", stateCache.stats().issued);
+    frameProfiler.setCounter("glStateSkipped", stateCache.stats().skipped);
+    stateCache.resetStats();
+    if (jobs) {
+        const JobSystem::Stats jobStats = jobs->stats();
+        frameProfiler.setCounter("jobs", qint64(jobStats.jobs));
+        frameProfiler.setCounter("jobSteals", qint64(jobStats.steals));
+        jobs->resetStats();
+    }
+    frameProfiler.endFrame();
+    traceRecorder.endFrame();
+    if (traceFrames > 0 && traceRecorder.stats().frames >= traceFrames)
+        stopTrace();
+}
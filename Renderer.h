@@ -0,0 +1,166 @@
+#ifndef RENDERER_H
+#define RENDERER_H
+
+#include <QSurfaceFormat>
+#include <QRect>
+#include <functional>
+#include <vector>
+#include "GLTraceFunctions.h"
+#include "SpriteBatch.h"
+#include "TextureManager.h"
+#include "ShaderCache.h"
+#include "FrameProfiler.h"
+#include "GLStateCache.h"
+#include "InstancedMesh.h"
+#include "IndirectBatch.h"
+#include "Scene.h"
+#include "JobSystem.h"
+#include "Mesh.h"
+#include "LodSelector.h"
+#include "GLTrace.h"
+
+/* Renderer：真正的绘制代码
+ * 原来 initializeGL()/paintGL() 里的 OpenGL 代码都搬到了这里，MyOpenGLWidget 只负责把调用转发过来。
+ * 这样同一份绘制代码既能画到窗口里，也能被 benchmark/ 里的离屏基准测试程序直接调用
+ * （QOffscreenSurface + QOpenGLFramebufferObject，不需要窗口）。
+ *
+ * 所有成员函数都要求调用时 OpenGL 上下文已经是当前上下文（makeCurrent）。
+ */
+class Renderer : protected GLTraceFunctions
+{
+public:
+    Renderer();
+    ~Renderer();
+
+    // 绘制代码需要的上下文格式：4.5 核心模式（着色器写的是 #version 460 core）+ 深度缓冲
+    static QSurfaceFormat surfaceFormat();
+
+    void initialize();            // 对应 initializeGL()：创建着色器、VAO/VBO、纹理
+    void resize(int w, int h);    // 对应 resizeGL()
+    void render();                // 对应 paintGL()
+    void cleanup();               // 释放 GL 资源，上下文必须是当前上下文
+
+    /* 按需渲染：画面只在有东西变了以后才需要重画（initialize()、resize() 和 invalidate() 都算变了）。
+     * needsRender() 顺便把后台传完的纹理换到句柄上，换上了也算变了；hasPendingWork() 为 true 时
+     * 还有纹理在路上，调用方过一会儿要再问一次。render() 之后重新算干净 */
+    void invalidate();            // 外部改了场景（比如 setSceneCallback 里提交的东西变了）
+    bool needsRender();
+    bool hasPendingWork() const;
+    // 下一次 render() 只重画 rect（像素，原点在左下角）以内的部分，画完自动清除；空矩形 = 整个视口。
+    // 目标帧缓冲里 rect 以外的内容必须还是上一帧的
+    void setClipRect(const QRect &rect);
+
+    // 场景规模：一次绘制的三角形个数，默认 1（就是原来那个三角形）。要在 initialize() 之前设置
+    void setSceneSize(int triangles);
+    int sceneSize() const;
+    // 内置场景用硬件实例化画：同一个三角形网格 + 每个三角形一个实例，整个场景一次绘制调用。
+    // 默认关闭（经过 SpriteBatch）。要在 initialize() 之前设置
+    void setInstancing(bool enabled);
+    bool instancing() const;
+    // 内置场景每个三角形一条间接绘制命令（IndirectBatch），网格放在共用的顶点/索引仓库里，
+    // 整个场景一次 glMultiDrawElementsIndirect，每个物体的变换从 SSBO 按 gl_DrawID 读。
+    // 和 setInstancing() 同时打开时用这个。默认关闭，要在 initialize() 之前设置
+    void setMultiDrawIndirect(bool enabled);
+    bool multiDrawIndirect() const;
+    // 实例化时网格的顶点格式，默认 VertexFormat::full(false)（和 SpriteVertex 相同）。要在 initialize() 之前设置
+    void setVertexFormat(const VertexFormat &format);
+    const VertexFormat &vertexFormat() const;
+    // 导入的模型（.obj / .gltf / .glb，见 Mesh）：initialize() 时读入、做完三步 MeshOptimizer 重排后按 vertexFormat() 上传，
+    // 每帧缩放到视口中间、开深度测试画一次。空字符串（默认）= 不画。要在 initialize() 之前设置
+    void setModel(const QString &path);
+    QString model() const;
+    const Mesh::OptimizeStats &modelStats() const;   // 读入时重排前后的 ACMR/ATVR，没有模型时都是 0
+    // 模型画几份：大于 1 时平铺到网格里，每份的大小不一样（0.25 ~ 1 倍格子），用来看 LOD 的效果。
+    // 读入时用 QEM 生成 LOD（Mesh::buildLods()），每份每帧按屏幕上的误差选一层（LodSelector）。要在 initialize() 之前设置
+    void setModelCopies(int copies);
+    int modelCopies() const;
+    // LOD 允许的屏幕误差（像素），默认 1；0 = 总是画原始网格
+    void setLodErrorThreshold(float pixels);
+    float lodErrorThreshold() const;
+    // 模型在屏幕上的直径小于 pixels 像素时改画公告板（预先渲染的模型图片），默认 0 = 不用
+    void setImpostorSize(float pixels);
+    float impostorSize() const;
+
+    // 每帧在内置场景之后、SpriteBatch::end() 之前调用，外部在这里提交自己的图元
+    void setSceneCallback(const std::function<void(SpriteBatch &)> &callback);
+    GLuint defaultTexture() const;                  // :/textures/001.png（加载完成前是占位纹理）
+    TextureManager &textures();                     // 异步纹理加载，load() 立刻返回句柄
+    ShaderCache &shaders();                         // 着色器程序的磁盘缓存
+    const SpriteBatch::Stats &batchStats() const;   // 上一帧的合批统计（绘制调用数等）
+    int drawCalls() const;                          // 上一帧的总绘制调用数（合批 + 实例化）
+    int triangles() const;                          // 上一帧提交的总三角形数（四边形算 2 个）
+    const LodSelector::Stats &lodStats() const;     // 上一帧模型的换层次数、公告板个数
+    FrameProfiler &profiler();                      // 每帧的 CPU/GPU 计时（叠加层、Chrome trace）
+    GLStateCache &state();                          // 绕过 Renderer 改了 GL 状态以后要调用 state().invalidate()
+    Scene &scene();                                 // 内置场景每个三角形/实例的包围球，render() 提交前先剔除
+    int visibleObjects() const;                     // 上一帧剔除后剩下的个数
+    // 每帧提交前的 CPU 活（剔除、拷贝可见物体的顶点/实例）分给 jobs 的线程做，GL 线程只提交准备好的数组。
+    // 不接管 jobs；nullptr（默认）= 全部在调用 render() 的线程里做
+    void setJobSystem(JobSystem *jobs);
+    JobSystem *jobSystem() const;
+    // 把 initialize() 和之后 frames 帧 render() 发出的 GL 调用录到 path（GLTrace，用 benchmark/glreplay 回放）。
+    // frames = 0 一直录到 cleanup()。录制时着色器不走二进制缓存，trace 里记的是源码。要在 initialize() 之前设置
+    void setTraceFile(const QString &path, int frames = 0);
+    QString traceFile() const;
+    const GLTrace::Stats &traceStats() const;       // 录完以后看写了多少
+
+private:
+    void buildScene();  // 生成 triangleCount 个三角形的顶点（位置 + 纹理坐标 + 颜色），实例化时生成每个实例的变换，以及它们的包围球
+    void prepareScene();  // 按块剔除，可见物体的顶点/实例拷进 prepared*，块之间互不相关，在 jobs 的各个线程上并行
+    bool chunkFullyVisible(int chunk) const;  // 整块都可见时直接提交原数组，不用拷
+    bool perObjectTransforms() const;  // 内置场景按 "网格 + 每个物体一个变换" 存（实例化和间接绘制）
+    void loadModel();  // 读 modelPath、优化、生成 LOD、上传到 modelBatch 并算出每份的变换
+    void drawModel();  // 每份选一层 LOD 记一条间接绘制命令，选了公告板的记进 modelImpostors
+    void captureImpostor();  // 把模型画进 impostorTexture（纹理换了以后重画）
+    void stopTrace();
+
+    enum { PrepareChunk = 16384 };  // 每块的物体数，Scene::RangeAlignment 的倍数
+
+    FrameProfiler frameProfiler;               // render() 里各阶段的 CPU/GPU 计时
+    GLStateCache stateCache;                   // 跳过重复的绑定/开关
+    ShaderCache shaderCache;                   // 着色器程序二进制的磁盘缓存
+    SpriteBatch spriteBatch;                   // 所有图元都经过它合批绘制
+    TextureManager textureManager;             // 后台解码 + PBO 上传
+    TextureHandle texture;                     // 纹理
+    InstancedMesh sceneMesh;                   // 实例化时内置场景的网格（原来那个三角形）
+    IndirectBatch indirectBatch;               // 间接绘制时的网格仓库和每帧的命令
+    int indirectTriangle;                      // 原来那个三角形在 indirectBatch 里的网格编号
+    int triangleCount;                         // 场景规模
+    bool instanced;                            // 内置场景是否用实例化画
+    bool indirect;                             // 内置场景是否用间接绘制画
+    VertexFormat meshFormat;                   // 实例化时 sceneMesh 的顶点格式，modelBatch 也用它
+    QString modelPath;                         // 导入的模型文件
+    IndirectBatch modelBatch;                  // 导入的模型：各层 LOD 共用顶点，每份一条命令
+    std::vector<int> modelLods;                // 第 i 层 LOD 在 modelBatch 里的网格编号
+    std::vector<QMatrix4x4> modelTransforms;   // 每份的变换：包围盒中心移到格子中间、最长边缩放到格子的 80% 以内
+    std::vector<QMatrix4x4> modelImpostors;    // 本帧画公告板的那几份的四边形变换
+    int copies;                                // 模型画几份
+    QVector3D modelCenter;                     // 模型坐标里的包围盒中心
+    float modelSize;                           // 包围盒最长边
+    float modelRadius;                         // 包围盒对角线的一半（包围球半径）
+    Mesh::OptimizeStats modelOptimizeStats;
+    LodSelector lodSelector;                   // 每份当前的 LOD 层
+    float lodThreshold;
+    float impostorPixels;
+    GLuint impostorTexture;                    // 模型的图片，四周透明
+    GLuint impostorSource;                     // 画 impostorTexture 时用的纹理，纹理换了要重画
+    QOpenGLShaderProgram *impostorProgram;     // SpriteBatch 的着色器加上 alpha 测试
+    std::vector<SpriteVertex> sceneVertices;   // 内置场景，每 3 个顶点一个三角形
+    std::vector<MeshInstance> sceneInstances;  // 实例化/间接绘制时内置场景的每个物体
+    Scene sceneBounds;                         // 第 i 个物体就是第 i 个三角形/实例
+    std::vector<int> visible;                  // 本帧剔除后可见的物体编号，第 c 块的写在 [c * PrepareChunk, + chunkVisible[c])
+    std::vector<int> chunkVisible;             // 每块可见的个数
+    std::vector<SpriteVertex> preparedVertices;   // 第 c 块可见三角形的顶点，从 c * PrepareChunk * 3 开始连续存放
+    std::vector<MeshInstance> preparedInstances;  // 同上，实例化/间接绘制时用
+    int visibleCount;
+    bool dirty;                                // 上一次 render() 之后有没有东西变了
+    QRect clipRect;
+    QSize viewportSize;                        // resize() 的大小，内置场景按它向 TextureManager 要纹理的 mip
+    JobSystem *jobs;
+    std::function<void(SpriteBatch &)> sceneCallback;
+    GLTrace traceRecorder;
+    QString tracePath;
+    int traceFrames;                           // 录几帧，0 = 录到 cleanup()
+};
+
+#endif // RENDERER_H
@@ -0,0 +1,367 @@
+#include "Scene.h"
+#include <cmath>
+#include <limits>
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#define SCENE_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#endif
+
+// GCC/Clang：只给 SIMD 内核打开 AVX2/SSE4.1 指令，其余代码照常按基础指令集编译，运行时再判断能不能调用
+#if defined(SCENE_X86) && (defined(__GNUC__) || defined(__clang__))
+#define SCENE_TARGET(isa) __attribute__((target(isa)))
+#else
+#define SCENE_TARGET(isa)
+#endif
+
+namespace {
+
+const int Lanes = Scene::RangeAlignment;   // 数组补齐的粒度（AVX2 一次 8 个）
+
+#ifdef SCENE_X86
+// 压缩表：mask 的第 k 位为 1 表示第 k 个物体可见，表里按顺序列出这些位的下标，
+// 加上基址一次写出去就是紧凑的可见编号
+struct CompressTables
+{
+    alignas(32) int lanes8[256][8];
+    alignas(16) int lanes4[16][4];
+
+    CompressTables()
+    {
+        for (int mask = 0; mask < 256; ++mask) {
+            int n = 0;
+            for (int bit = 0; bit < 8; ++bit) {
+                if (mask & (1 << bit))
+                    lanes8[mask][n++] = bit;
+            }
+            while (n < 8)
+                lanes8[mask][n++] = 0;
+        }
+        for (int mask = 0; mask < 16; ++mask) {
+            int n = 0;
+            for (int bit = 0; bit < 4; ++bit) {
+                if (mask & (1 << bit))
+                    lanes4[mask][n++] = bit;
+            }
+            while (n < 4)
+                lanes4[mask][n++] = 0;
+        }
+    }
+};
+
+const CompressTables compressTables;
+
+int popcount8(unsigned mask)
+{
+    mask = mask - ((mask >> 1) & 0x55u);
+    mask = (mask & 0x33u) + ((mask >> 2) & 0x33u);
+    return int((mask + (mask >> 4)) & 0x0fu);
+}
+
+bool cpuHas(Scene::Kernel kernel)
+{
+#if defined(__GNUC__) || defined(__clang__)
+    __builtin_cpu_init();
+    if (kernel == Scene::Avx2)
+        return __builtin_cpu_supports("avx2");
+    return __builtin_cpu_supports("sse4.1");
+#elif defined(_MSC_VER)
+    int info[4];
+    __cpuid(info, 1);
+    const bool sse41 = (info[2] & (1 << 19)) != 0;
+    const bool osAvx = (info[2] & (1 << 27)) && (info[2] & (1 << 28)) && (_xgetbv(0) & 6) == 6;  // OS 会保存 YMM 寄存器
+    if (kernel != Scene::Avx2)
+        return sse41;
+    __cpuidex(info, 7, 0);
+    return osAvx && (info[1] & (1 << 5)) != 0;
+#else
+    Q_UNUSED(kernel);
+    return false;
+#endif
+}
+#endif // SCENE_X86
+
+} // namespace
+
+Scene::Scene()
+    : count(0), selected(bestKernel())
+{
+}
+
+int Scene::add(float x, float y, float z, float r)
+{
+    const int id = count++;
+    if (centerX.size() < size_t(count)) {
+        // 一次补齐 8 个，补的物体半径 -inf，任何平面测试都不通过
+        const size_t padded = size_t((count + Lanes - 1) / Lanes * Lanes);
+        centerX.resize(padded, 0.0f);
+        centerY.resize(padded, 0.0f);
+        centerZ.resize(padded, 0.0f);
+        radius.resize(padded, -std::numeric_limits<float>::infinity());
+    }
+    centerX[size_t(id)] = x;
+    centerY[size_t(id)] = y;
+    centerZ[size_t(id)] = z;
+    radius[size_t(id)] = r;
+    return id;
+}
+
+void Scene::setBounds(int id, const QVector3D &center, float r)
+{
+    centerX[size_t(id)] = center.x();
+    centerY[size_t(id)] = center.y();
+    centerZ[size_t(id)] = center.z();
+    radius[size_t(id)] = r;
+}
+
+void Scene::clear()
+{
+    centerX.clear();
+    centerY.clear();
+    centerZ.clear();
+    radius.clear();
+    count = 0;
+}
+
+void Scene::reserve(int objects)
+{
+    const size_t padded = size_t((objects + Lanes - 1) / Lanes * Lanes);
+    centerX.reserve(padded);
+    centerY.reserve(padded);
+    centerZ.reserve(padded);
+    radius.reserve(padded);
+}
+
+bool Scene::isSupported(Kernel kernel)
+{
+    switch (kernel) {
+    case Auto:
+    case Scalar:
+        return true;
+#ifdef SCENE_X86
+    case Sse41:
+    case Avx2: {
+        static const bool sse41 = cpuHas(Sse41);
+        static const bool avx2 = cpuHas(Avx2);
+        return kernel == Avx2 ? avx2 : sse41;
+    }
+#endif
+    default:
+        return false;
+    }
+}
+
+const char *Scene::kernelName(Kernel kernel)
+{
+    switch (kernel) {
+    case Scalar:
+        return "scalar";
+    case Sse41:
+        return "sse4.1";
+    case Avx2:
+        return "avx2";
+    default:
+        return "auto";
+    }
+}
+
+Scene::Kernel Scene::bestKernel()
+{
+    if (isSupported(Avx2))
+        return Avx2;
+    if (isSupported(Sse41))
+        return Sse41;
+    return Scalar;
+}
+
+void Scene::setKernel(Kernel kernel)
+{
+    selected = kernel != Auto && isSupported(kernel) ? kernel : bestKernel();
+}
+
+Scene::CullParams Scene::cullParams(const QMatrix4x4 &viewProjection, float viewportHeight, float minPixelSize)
+{
+    // QMatrix4x4 是列主序：第 i 行是 (m[i], m[4 + i], m[8 + i], m[12 + i])
+    const float *m = viewProjection.constData();
+    auto row = [m](int i, float sign, float out[4]) {
+        for (int k = 0; k < 4; ++k)
+            out[k] = m[4 * k + 3] + sign * m[4 * k + i];
+    };
+
+    CullParams params;
+    // 左右、下上、近远：w ± x、w ± y、w ± z >= 0
+    for (int axis = 0; axis < 3; ++axis) {
+        row(axis, 1.0f, params.planes[2 * axis]);
+        row(axis, -1.0f, params.planes[2 * axis + 1]);
+    }
+    for (float *plane : params.planes) {
+        const float length = std::sqrt(plane[0] * plane[0] + plane[1] * plane[1] + plane[2] * plane[2]);
+        if (length > 0.0f) {
+            for (int k = 0; k < 4; ++k)
+                plane[k] /= length;
+        }
+    }
+
+    for (int k = 0; k < 4; ++k)
+        params.wRow[k] = m[4 * k + 3];
+    if (viewportHeight > 0.0f && minPixelSize > 0.0f) {
+        /* 投影后的直径（像素）≈ 2r * |第 2 行的 xyz| / w * (viewportHeight / 2)：
+         * 视图矩阵的旋转部分是正交的，所以第 2 行 xyz 的长度就是投影矩阵的 y 方向缩放。
+         * 直径 >= minPixelSize  <=>  r * sizeScale >= w；w <= 0（球跨过相机平面）时总是成立 */
+        const float yScale = std::sqrt(m[1] * m[1] + m[5] * m[5] + m[9] * m[9]);
+        params.sizeScale = yScale * viewportHeight / minPixelSize;
+    } else {
+        // 不做屏幕尺寸剔除：w 恒为 -1，r * 0 >= -1 总是成立
+        params.wRow[0] = params.wRow[1] = params.wRow[2] = 0.0f;
+        params.wRow[3] = -1.0f;
+        params.sizeScale = 0.0f;
+    }
+    return params;
+}
+
+int Scene::cull(const QMatrix4x4 &viewProjection, std::vector<int> &visible, float viewportHeight,
+                float minPixelSize) const
+{
+    if (count == 0)
+        return 0;
+    if (visible.size() < centerX.size())
+        visible.resize(centerX.size());  // SIMD 内核每次整组写 4/8 个，要留出补齐的位置
+    return cull(viewProjection, 0, paddedSize(), visible.data(), viewportHeight, minPixelSize);
+}
+
+int Scene::cull(const QMatrix4x4 &viewProjection, int first, int last, int *out, float viewportHeight,
+                float minPixelSize) const
+{
+    Q_ASSERT(first % Lanes == 0 && (last % Lanes == 0 || last == paddedSize()) && last <= paddedSize());
+    if (first >= last)
+        return 0;
+
+    const CullParams params = cullParams(viewProjection, viewportHeight, minPixelSize);
+    switch (selected) {
+    case Avx2:
+        return cullAvx2(params, first, last, out);
+    case Sse41:
+        return cullSse41(params, first, last, out);
+    default:
+        return cullScalar(params, first, last, out);
+    }
+}
+
+int Scene::cullScalar(const CullParams &params, int first, int last, int *out) const
+{
+    last = qMin(last, count);
+    int n = 0;
+    for (int i = first; i < last; ++i) {
+        const float x = centerX[size_t(i)], y = centerY[size_t(i)], z = centerZ[size_t(i)], r = radius[size_t(i)];
+        bool inside = true;
+        for (const float *plane : params.planes)
+            inside &= plane[0] * x + plane[1] * y + plane[2] * z + plane[3] + r >= 0.0f;
+        const float w = params.wRow[0] * x + params.wRow[1] * y + params.wRow[2] * z + params.wRow[3];
+        inside &= r * params.sizeScale >= w;
+        out[n] = i;         // 无条件写，可见时才前进
+        n += inside ? 1 : 0;
+    }
+    return n;
+}
+
+#ifdef SCENE_X86
+
+SCENE_TARGET("sse4.1")
+int Scene::cullSse41(const CullParams &params, int first, int last, int *out) const
+{
+    __m128 plane[6][4];
+    for (int p = 0; p < 6; ++p) {
+        for (int k = 0; k < 4; ++k)
+            plane[p][k] = _mm_set1_ps(params.planes[p][k]);
+    }
+    const __m128 wx = _mm_set1_ps(params.wRow[0]), wy = _mm_set1_ps(params.wRow[1]);
+    const __m128 wz = _mm_set1_ps(params.wRow[2]), ww = _mm_set1_ps(params.wRow[3]);
+    const __m128 sizeScale = _mm_set1_ps(params.sizeScale);
+    const __m128 zero = _mm_setzero_ps();
+
+    int n = 0;
+    for (int i = first; i < last; i += 4) {
+        const __m128 x = _mm_loadu_ps(&centerX[size_t(i)]);
+        const __m128 y = _mm_loadu_ps(&centerY[size_t(i)]);
+        const __m128 z = _mm_loadu_ps(&centerZ[size_t(i)]);
+        const __m128 r = _mm_loadu_ps(&radius[size_t(i)]);
+
+        __m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+        for (int p = 0; p < 6; ++p) {
+            __m128 d = _mm_add_ps(_mm_mul_ps(plane[p][0], x), _mm_mul_ps(plane[p][1], y));
+            d = _mm_add_ps(d, _mm_mul_ps(plane[p][2], z));
+            d = _mm_add_ps(_mm_add_ps(d, plane[p][3]), r);
+            inside = _mm_and_ps(inside, _mm_cmpge_ps(d, zero));
+        }
+        __m128 w = _mm_add_ps(_mm_mul_ps(wx, x), _mm_mul_ps(wy, y));
+        w = _mm_add_ps(_mm_add_ps(w, _mm_mul_ps(wz, z)), ww);
+        inside = _mm_and_ps(inside, _mm_cmpge_ps(_mm_mul_ps(r, sizeScale), w));
+
+        const unsigned mask = unsigned(_mm_movemask_ps(inside));
+        const __m128i lanes = _mm_load_si128(reinterpret_cast<const __m128i *>(compressTables.lanes4[mask]));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(out + n), _mm_add_epi32(lanes, _mm_set1_epi32(i)));
+        n += popcount8(mask);
+    }
+    return n;
+}
+
+// 不打开 fma：否则编译器可能把下面的乘、加合成 FMA，舍入和标量内核不一样
+SCENE_TARGET("avx2")
+int Scene::cullAvx2(const CullParams &params, int first, int last, int *out) const
+{
+    __m256 plane[6][4];
+    for (int p = 0; p < 6; ++p) {
+        for (int k = 0; k < 4; ++k)
+            plane[p][k] = _mm256_set1_ps(params.planes[p][k]);
+    }
+    const __m256 wx = _mm256_set1_ps(params.wRow[0]), wy = _mm256_set1_ps(params.wRow[1]);
+    const __m256 wz = _mm256_set1_ps(params.wRow[2]), ww = _mm256_set1_ps(params.wRow[3]);
+    const __m256 sizeScale = _mm256_set1_ps(params.sizeScale);
+
+    int n = 0;
+    for (int i = first; i < last; i += 8) {
+        const __m256 x = _mm256_loadu_ps(&centerX[size_t(i)]);
+        const __m256 y = _mm256_loadu_ps(&centerY[size_t(i)]);
+        const __m256 z = _mm256_loadu_ps(&centerZ[size_t(i)]);
+        const __m256 r = _mm256_loadu_ps(&radius[size_t(i)]);
+
+        // 距离 + 半径 >= 0，运算顺序和标量内核一样：((ax + by) + cz) + d + r
+        __m256 inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+        for (int p = 0; p < 6; ++p) {
+            __m256 d = _mm256_add_ps(_mm256_mul_ps(plane[p][0], x), _mm256_mul_ps(plane[p][1], y));
+            d = _mm256_add_ps(d, _mm256_mul_ps(plane[p][2], z));
+            d = _mm256_add_ps(_mm256_add_ps(d, plane[p][3]), r);
+            inside = _mm256_and_ps(inside, _mm256_cmp_ps(d, _mm256_setzero_ps(), _CMP_GE_OQ));
+            // 左右两个平面就能剔掉大部分物体：整组都在外面时后面的平面不用算了
+            if (p == 1 && _mm256_testz_ps(inside, inside))
+                break;
+        }
+        __m256 w = _mm256_add_ps(_mm256_mul_ps(wx, x), _mm256_mul_ps(wy, y));
+        w = _mm256_add_ps(_mm256_add_ps(w, _mm256_mul_ps(wz, z)), ww);
+        inside = _mm256_and_ps(inside, _mm256_cmp_ps(_mm256_mul_ps(r, sizeScale), w, _CMP_GE_OQ));
+
+        // 可见的下标查表取出来挤到前面，整组 8 个写出去，只前进可见的个数
+        const unsigned mask = unsigned(_mm256_movemask_ps(inside));
+        const __m256i lanes = _mm256_load_si256(reinterpret_cast<const __m256i *>(compressTables.lanes8[mask]));
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(out + n), _mm256_add_epi32(lanes, _mm256_set1_epi32(i)));
+        n += popcount8(mask);
+    }
+    return n;
+}
+
+#else
+
+int Scene::cullSse41(const CullParams &params, int first, int last, int *out) const
+{
+    return cullScalar(params, first, last, out);
+}
+
+int Scene::cullAvx2(const CullParams &params, int first, int last, int *out) const
+{
+    return cullScalar(params, first, last, out);
+}
+
+#endif // SCENE_X86
@@ -0,0 +1,87 @@
+#ifndef SCENE_H
+#define SCENE_H
+
+#include <QMatrix4x4>
+#include <QVector3D>
+#include <vector>
+
+/* Scene：大量物体的包围球 + 绘制前的剔除
+ *
+ * 包围球按结构数组（SoA）存放：中心的 x、y、z 和半径各一个连续的 float 数组，
+ * SIMD 一次从每个数组各读 4 个（SSE4.1）或 8 个（AVX2）物体，不用转置。
+ * 数组长度补齐到 8 的倍数，补的物体半径是 -inf，一定被剔除，内层循环不需要处理尾巴。
+ *
+ * cull() 对每个物体做两个测试，都通过才可见：
+ *   - 视锥：从 viewProjection 提取 6 个平面（Gribb/Hartmann），球心到每个平面的距离 >= -半径
+ *   - 屏幕尺寸：投影后的直径小于 minPixelSize 像素的物体也剔除（远处的小东西画了也看不见）
+ * 可见物体的编号从小到大压缩写进输出数组（SIMD 用查表 + 置换一次写 4/8 个），逐个物体的判断没有分支；
+ * AVX2 内核只在一组 8 个都被左右两个平面剔掉时跳过剩下的平面。
+ * 各内核的乘加顺序和标量版本完全一样（不用 FMA），刚好压在平面上的物体结果也逐个相同。
+ *
+ * 内核在运行时按 CPU 选择：AVX2 > SSE4.1 > 标量。非 x86 平台只有标量版本。
+ * setKernel() 可以强制指定（基准测试 benchmark/cullbench 用它对比各内核）。
+ */
+class Scene
+{
+public:
+    enum { RangeAlignment = 8 };   // cull() 分段时每段的起止都要是它的倍数
+
+    enum Kernel
+    {
+        Auto,
+        Scalar,
+        Sse41,
+        Avx2
+    };
+
+    Scene();
+
+    int add(const QVector3D &center, float radius) { return add(center.x(), center.y(), center.z(), radius); }
+    int add(float x, float y, float z, float radius);    // 返回物体编号（从 0 开始连续）
+    void setBounds(int id, const QVector3D &center, float radius);
+    void clear();
+    void reserve(int objects);
+    int size() const { return count; }
+    int paddedSize() const { return int(centerX.size()); }   // size() 向上补齐到 RangeAlignment 的倍数
+
+    void setKernel(Kernel kernel);          // 不支持的内核退回 Auto
+    Kernel kernel() const { return selected; }  // 实际使用的内核（不会是 Auto）
+    static bool isSupported(Kernel kernel);
+    static const char *kernelName(Kernel kernel);
+
+    /* 剔除：可见物体的编号写进 visible 的前 n 个元素，返回 n。
+     * visible 不够大时会扩大，但不会缩小（每帧复用同一个数组，不用每次清零）。
+     * viewportHeight 或 minPixelSize <= 0 时只做视锥剔除。 */
+    int cull(const QMatrix4x4 &viewProjection, std::vector<int> &visible, float viewportHeight = 0.0f,
+             float minPixelSize = 0.0f) const;
+    /* 只剔除编号在 [first, last) 里的物体，可见的编号写进 out（至少能放 last - first 个），返回个数。
+     * first/last 是 RangeAlignment 的倍数（last 也可以是 paddedSize()）。
+     * 只读，不同的段可以在不同线程里同时剔除（Renderer 用 JobSystem 分段）。 */
+    int cull(const QMatrix4x4 &viewProjection, int first, int last, int *out, float viewportHeight = 0.0f,
+             float minPixelSize = 0.0f) const;
+
+private:
+    // 剔除用的常量，从 viewProjection 算出来，所有内核共用
+    struct CullParams
+    {
+        float planes[6][4];   // 归一化的平面 (a, b, c, d)，点在内侧时 a*x + b*y + c*z + d >= 0
+        float wRow[4];        // viewProjection 的第 4 行：裁剪空间的 w（到相机的深度）
+        float sizeScale;      // 半径 * sizeScale >= w 时投影直径 >= minPixelSize
+    };
+
+    static CullParams cullParams(const QMatrix4x4 &viewProjection, float viewportHeight, float minPixelSize);
+    static Kernel bestKernel();
+
+    int cullScalar(const CullParams &params, int first, int last, int *out) const;
+    int cullSse41(const CullParams &params, int first, int last, int *out) const;
+    int cullAvx2(const CullParams &params, int first, int last, int *out) const;
+
+    std::vector<float> centerX;   // 长度都是 count 向上补齐到 8 的倍数
+    std::vector<float> centerY;
+    std::vector<float> centerZ;
+    std::vector<float> radius;
+    int count;
+    Kernel selected;
+};
+
+#endif // SCENE_H
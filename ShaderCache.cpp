@@ -0,0 +1,192 @@
+#include "ShaderCache.h"
+#include <QCryptographicHash>
+#include <QStandardPaths>
+#include <QElapsedTimer>
+#include <QSaveFile>
+#include <QFile>
+#include <QDir>
+#include <QDebug>
+#include <cstring>
+
+namespace {
+
+// 缓存文件头：魔数 + 文件格式版本 + 驱动的二进制格式 + 二进制长度，后面紧跟二进制本身
+struct BinaryHeader
+{
+    char magic[4];
+    quint32 version;
+    quint32 binaryFormat;
+    quint32 length;
+};
+
+const char BinaryMagic[4] = {'G', 'L', 'P', 'B'};
+const quint32 BinaryVersion = 1;
+
+} // namespace
+
+ShaderCache::ShaderCache()
+    : binarySupported(false), cacheEnabled(true)
+{
+}
+
+bool ShaderCache::initialize(const QString &directory)
+{
+    initializeOpenGLFunctions();
+
+    GLint formats = 0;
+    glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+    binarySupported = formats > 0;
+
+    // 驱动的身份：任何一项变了，旧的二进制都不能再用
+    driverKey.clear();
+    for (GLenum name : {GLenum(GL_VENDOR), GLenum(GL_RENDERER), GLenum(GL_VERSION), GLenum(GL_SHADING_LANGUAGE_VERSION)}) {
+        driverKey.append(reinterpret_cast<const char *>(glGetString(name)));
+        driverKey.append('\n');
+    }
+
+    cacheDir = directory.isEmpty()
+        ? QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + "/shaders"
+        : directory;
+    if (binarySupported && !QDir().mkpath(cacheDir)) {
+        qWarning() << "ShaderCache: cannot create" << cacheDir << "- compiling from source only";
+        binarySupported = false;
+    }
+    return binarySupported;
+}
+
+QByteArray ShaderCache::cacheKey(const Stages &stages) const
+{
+    QCryptographicHash hash(QCryptographicHash::Sha256);
+    hash.addData(driverKey);
+    for (const auto &stage : stages) {
+        const quint32 type = stage.first;
+        hash.addData(reinterpret_cast<const char *>(&type), sizeof(type));
+        hash.addData(stage.second);
+    }
+    return hash.result().toHex();
+}
+
+QOpenGLShaderProgram *ShaderCache::program(const char *vertexSource, const char *fragmentSource)
+{
+    return program(Stages{{QOpenGLShader::Vertex, QByteArray(vertexSource)},
+                          {QOpenGLShader::Fragment, QByteArray(fragmentSource)}});
+}
+
+QOpenGLShaderProgram *ShaderCache::program(const Stages &stages)
+{
+    const bool useCache = binarySupported && cacheEnabled;
+    const QString path = useCache ? cacheDir + '/' + QString::fromLatin1(cacheKey(stages)) + ".bin" : QString();
+
+    if (useCache && QFile::exists(path)) {
+        if (QOpenGLShaderProgram *cached = loadBinary(path))
+            return cached;
+    }
+
+    // 从源码编译
+    QElapsedTimer timer;
+    timer.start();
+    QOpenGLShaderProgram *program = new QOpenGLShaderProgram();
+    program->create();
+    for (const auto &stage : stages) {
+        if (!program->addShaderFromSourceCode(stage.first, stage.second)) {
+            qWarning() << "ShaderCache: compile failed:" << program->log();
+            delete program;
+            return nullptr;
+        }
+    }
+    // 链接之前声明要取回二进制，否则有的驱动 glGetProgramBinary 拿不到东西
+    if (useCache)
+        glProgramParameteri(program->programId(), GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+    if (!program->link()) {
+        qWarning() << "ShaderCache: link failed:" << program->log();
+        delete program;
+        return nullptr;
+    }
+    counters.compileNs += timer.nsecsElapsed();
+    ++counters.misses;
+
+    if (useCache)
+        storeBinary(path, program);
+    return program;
+}
+
+QOpenGLShaderProgram *ShaderCache::loadBinary(const QString &path)
+{
+    QElapsedTimer timer;
+    timer.start();
+
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly))
+        return nullptr;
+    const QByteArray data = file.readAll();
+    file.close();
+
+    BinaryHeader header;
+    bool valid = data.size() >= qsizetype(sizeof(header));
+    if (valid) {
+        std::memcpy(&header, data.constData(), sizeof(header));
+        valid = std::memcmp(header.magic, BinaryMagic, sizeof(BinaryMagic)) == 0
+                && header.version == BinaryVersion
+                && qsizetype(sizeof(header) + header.length) == data.size();
+    }
+
+    QOpenGLShaderProgram *program = nullptr;
+    if (valid) {
+        program = new QOpenGLShaderProgram();
+        program->create();
+        glProgramBinary(program->programId(), header.binaryFormat, data.constData() + sizeof(header), GLsizei(header.length));
+        // QOpenGLShaderProgram 没有添加任何着色器时，link() 只检查 GL_LINK_STATUS，
+        // 正好用来确认驱动是否接受了这份二进制，同时把 Qt 内部的 "已链接" 状态设好
+        if (!program->link()) {
+            delete program;
+            program = nullptr;
+        }
+    }
+
+    if (!program) {
+        // 文件损坏或驱动不认（驱动升级后常见），删掉重来
+        ++counters.rejected;
+        QFile::remove(path);
+        return nullptr;
+    }
+    counters.loadNs += timer.nsecsElapsed();
+    ++counters.hits;
+    return program;
+}
+
+void ShaderCache::storeBinary(const QString &path, QOpenGLShaderProgram *program)
+{
+    GLint length = 0;
+    glGetProgramiv(program->programId(), GL_PROGRAM_BINARY_LENGTH, &length);
+    if (length <= 0)
+        return;
+
+    QByteArray data(qsizetype(sizeof(BinaryHeader)) + length, Qt::Uninitialized);
+    GLenum format = 0;
+    GLsizei written = 0;
+    glGetProgramBinary(program->programId(), length, &written, &format, data.data() + sizeof(BinaryHeader));
+    if (written <= 0)
+        return;
+
+    BinaryHeader header;
+    std::memcpy(header.magic, BinaryMagic, sizeof(BinaryMagic));
+    header.version = BinaryVersion;
+    header.binaryFormat = format;
+    header.length = quint32(written);
+    std::memcpy(data.data(), &header, sizeof(header));
+    data.resize(qsizetype(sizeof(header)) + written);
+
+    // QSaveFile 先写临时文件再改名，多个进程同时启动也不会读到写了一半的文件
+    QSaveFile file(path);
+    if (file.open(QIODevice::WriteOnly)) {
+        file.write(data);
+        file.commit();
+    }
+}
+
+void ShaderCache::clear()
+{
+    QDir dir(cacheDir);
+    for (const QString &name : dir.entryList({"*.bin"}, QDir::Files))
+        dir.remove(name);
+}
@@ -0,0 +1,60 @@
+#ifndef SHADERCACHE_H
+#define SHADERCACHE_H
+
+#include <QOpenGLFunctions_4_5_Core>
+#include <QOpenGLShaderProgram>
+#include <QByteArray>
+#include <QString>
+#include <QList>
+#include <QPair>
+
+/* ShaderCache：着色器程序的磁盘缓存
+ *
+ * 第一次遇到一组源码时照常编译、链接，然后用 glGetProgramBinary 取出驱动编译好的二进制存到磁盘；
+ * 以后同样的源码直接 glProgramBinary 载入，省掉编译和链接。
+ *
+ * 缓存文件名是 SHA-256(源码 + GL_VENDOR/GL_RENDERER/GL_VERSION/GLSL 版本)，
+ * 换显卡或升级驱动后自然对不上号。驱动也可能拒绝旧的二进制（链接状态为假），
+ * 这时删掉那个文件，退回到从源码编译并重新写缓存。
+ */
+class ShaderCache : protected QOpenGLFunctions_4_5_Core
+{
+public:
+    typedef QList<QPair<QOpenGLShader::ShaderTypeBit, QByteArray>> Stages;
+
+    struct Stats
+    {
+        int hits = 0;          // 从二进制载入成功
+        int misses = 0;        // 从源码编译
+        int rejected = 0;      // 有缓存文件但驱动不认，已删除
+        qint64 loadNs = 0;     // 载入二进制花的总时间
+        qint64 compileNs = 0;  // 编译 + 链接花的总时间
+    };
+
+    ShaderCache();
+
+    // directory 为空时用 QStandardPaths::CacheLocation/shaders。上下文必须是当前上下文
+    bool initialize(const QString &directory = QString());
+    void setEnabled(bool enabled) { cacheEnabled = enabled; }  // 关掉后总是从源码编译（对比冷启动用）
+
+    // 返回已链接的程序（调用方负责 delete），失败返回 nullptr 并打印编译日志
+    QOpenGLShaderProgram *program(const char *vertexSource, const char *fragmentSource);
+    QOpenGLShaderProgram *program(const Stages &stages);
+
+    void clear();  // 删除缓存目录里的所有二进制
+    const Stats &stats() const { return counters; }
+    QString directory() const { return cacheDir; }
+
+private:
+    QByteArray cacheKey(const Stages &stages) const;
+    QOpenGLShaderProgram *loadBinary(const QString &path);
+    void storeBinary(const QString &path, QOpenGLShaderProgram *program);
+
+    QString cacheDir;
+    QByteArray driverKey;   // 驱动相关的那部分 key
+    bool binarySupported;   // GL_NUM_PROGRAM_BINARY_FORMATS > 0
+    bool cacheEnabled;
+    Stats counters;
+};
+
+#endif // SHADERCACHE_H
@@ -0,0 +1,533 @@
+#include "SpriteBatch.h"
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <QDebug>
+
+SpriteBatch::SpriteBatch()
+    : defaultProgram(nullptr), state(nullptr), indexStream(QOpenGLBuffer::IndexBuffer), vertexCapacity(16384), indexCapacity(24576)
+{
+}
+
+SpriteBatch::~SpriteBatch()
+{
+    cleanup();
+}
+
+void SpriteBatch::cleanup()
+{
+    if (defaultProgram) {
+        delete defaultProgram;  // 释放着色器资源
+        defaultProgram = nullptr;
+    }
+    programs.clear();
+    destroyBuffers();
+}
+
+void SpriteBatch::destroyBuffers()
+{
+    indexStream.destroy();
+    vertexStream.destroy();
+    vao.destroy();
+}
+
+void SpriteBatch::initialize(ShaderCache &shaderCache, GLStateCache &stateCache)
+{
+    initializeOpenGLFunctions();
+    state = &stateCache;
+
+    createBuffers();
+
+    /*着色器工作流程概述：
+        1.顶点着色器：处理图形的几何形状，确定每个顶点的最终位置，并将一些信息传递给片段着色器（比如颜色、纹理坐标等）。
+        2.光栅化：OpenGL 将顶点信息转换为片段（像素）。在这一阶段，生成的片段会被送入片段着色器。
+        3.片段着色器：每个片段（像素）都会通过片段着色器计算出最终的颜色，out vec4 fragColor; 就是用来输出这个颜色的变量。
+        4.写入帧缓冲：片段着色器的输出会被写入帧缓冲区（Frame Buffer），OpenGL 决定如何将这些颜色显示到屏幕上。
+     */
+
+    /*顶点着色器（Vertex Shader）：
+    用于计算每个顶点的位置。代码中 gl_Position 用于将顶点坐标传递给 OpenGL。
+
+    #字符串中这些代码语法是 GLSL（OpenGL Shading Language）独有的
+    GLSL 是一种专门为 OpenGL 编写的着色器语言，它有自己独特的语法和结构，适用于 GPU 计算。
+
+代码解析：
+    #version 330 core 是 GLSL（OpenGL Shading Language）中的一个指令，用于指定着色器代码的版本和上下文。具体含义如下：
+    1. 版本号
+        330 表示 GLSL 的版本号是 3.30。这一版本是与 OpenGL 3.3 相对应的，意味着你可以使用这个版本的特性和语法。
+        版本号的前两位表示主版本号，后两位表示次版本号。3.30 是第三个主要版本的第 30 个小版本。
+    2. 上下文
+        core 表示使用的是 OpenGL 的核心上下文。在 OpenGL 中，有两种上下文：核心模式（Core Profile）和兼容模式（Compatibility Profile）。
+        核心模式只包含现代 OpenGL 的特性，删除了一些旧版功能（如固定功能管线）。
+        兼容模式则支持旧版 OpenGL 的所有特性，允许使用过时的功能。
+
+    layout(location = 0) in vec3 position;
+    在 layout(location = 0) in vec3 position; 这行 GLSL 代码中，以下是各部分的解释：
+    固定语句部分：
+        layout(location = x):
+            这是 GLSL 的 布局限定符，用于指定变量在着色器中绑定的位置。location = x 表示这个变量将在位置索引 x 处使用。
+            注意:
+                glVertexAttribPointer(0, ...) 中的 index 参数和 GLSL 中的 layout(location = 0) 是一一对应的。
+                x 值必须与 index 一致，这样着色器中的变量才能正确接收从 VBO 传递来的数据。
+                同一个着色器，在不同vao对象下，会读取到不同的属性：
+                    layout(location = 0) 会从当前绑定的 VAO 的 0 号属性读取数据。
+                    假设你先绑定 VAO1，然后调用渲染函数，着色器会从 VAO1 的 0 号属性（顶点位置）中读取数据：
+                    glBindVertexArray(VAO1);  // glBindVertexArray(VAO1) 和 VAO1.bind() 在功能上是等价的
+                    shaderProgram->bind();
+                    glDrawArrays(GL_TRIANGLES, 0, 3);  // 从 VAO1 的 0 号属性（顶点位置）读取数据
+                    如果你接下来绑定 VAO2 再进行渲染，着色器会从 VAO2 的 0 号属性（顶点颜色）中读取数据：
+                    glBindVertexArray(VAO2);
+                    shaderProgram->bind();
+                    glDrawArrays(GL_TRIANGLES, 0, 3);  // 从 VAO2 的 0 号属性（顶点颜色）读取数据
+            layout 和 location 都是 GLSL 的关键字，用来指定着色器变量的属性。
+        in:
+            这是 GLSL 的关键字，表示该变量是从外部输入到着色器的（通常是顶点着色器中的输入数据）。
+            在顶点着色器中，in 表示该变量从 CPU 端的顶点缓冲区传递进来。
+        vec3:
+            这是 GLSL 中的数据类型，表示一个包含 3 个浮点数（x, y, z）的向量，通常用于表示顶点的 3D 位置或颜色等属性。
+    变量部分：
+        position:
+            这是用户定义的变量名称（自定义变量）。它在这里是一个三维向量类型的输入变量，接收传递进来的顶点数据。
+            position 可以是任意有效的变量名，用于接收从应用程序中传递过来的顶点坐标信息。
+    总结：
+        固定语句: layout(location = 0), in, vec3（它们是 GLSL 的关键字和数据类型）。
+        变量: position（这是用户定义的变量，用于接收顶点位置数据）。
+
+    void main() {
+        gl_Position = vec4(position, 1.0);  // 设置顶点位置
+    }
+    在 GLSL（OpenGL 着色语言）中，void main() 是片段或顶点着色器的入口点，它表示着色器的主执行逻辑。
+    所有在这个函数体内的代码都会在绘制时被执行，而在 main() 函数外的部分则是对输入、输出、全局变量、常量等的声明。
+    gl_Position 是 OpenGL 内置的一个顶点着色器变量，用来表示每个顶点的坐标位置。你必须在顶点着色器中给它赋值，来指定当前顶点的坐标。
+    position 是通过 layout(location = 0) in vec3 position; 从外部传入的顶点位置数据，它通常从你的顶点缓冲对象（VBO）中获取。
+    vec4(position, 1.0) 将 position 这个三维向量（vec3）扩展为一个四维向量（vec4），其中第四个分量设置为 1.0，这是齐次坐标的标准形式，用来表示三维空间的点。
+    */
+
+    /* 注意:
+        glVertexAttribPointer(index, ...) 中的 index 参数和 GLSL 中的 layout(location = x) 是一一对应的。
+        x 值必须与 index 一致，这样着色器中的变量才能正确接收从 VBO 传递来的数据。
+        同一个着色器（x不变），在不同vao对象的上下文中，会读取到不同的属性
+     */
+    // 顶点着色器（传递纹理坐标
+    // 批处理时顶点已经在 CPU 上乘过各自的变换矩阵，着色器里只剩下整批共用的 viewProjection
+    static const char *vertexShaderSource = R"(
+    #version 460 core
+    layout(location = 0) in vec3 position;  // 顶点位置
+    layout(location = 1) in vec2 texCoord;  // 纹理坐标
+    layout(location = 2) in vec4 color;     // 顶点颜色（色调）
+
+    uniform mat4 viewProjection;  // 整批共用的观察投影矩阵
+
+    out vec2 TexCoord;  // 向片段着色器传递纹理坐标
+    out vec4 Color;
+
+    void main() {
+        gl_Position = viewProjection * vec4(position, 1.0);  // 设置顶点位置
+        TexCoord = texCoord;  // 传递纹理坐标
+        Color = color;
+    }
+)";
+
+
+    /*片段着色器（Fragment Shader）：
+    用于计算每个片段（像素）的颜色。在这个示例中，输出为红色 (vec4(1.0, 0.0, 0.0, 1.0))。
+    out vec4 fragColor;指定fragColor作为片段着色器的输出，fragColor的具体值在main()中获得
+     */
+    // 从纹理中采样颜色
+    /*uniform sampler2D texture1;
+     是一个常用的 GLSL（OpenGL Shading Language）声明，
+     用于在着色器中定义一个二维纹理采样器。它不是固定语句，但在实际使用中非常普遍。以下是这个声明的详细说明：
+    uniform：表示这个变量的值在顶点着色器和片段着色器之间是共享的，并且在每次绘制调用中不会改变。这意味着它的值在整个渲染过程中是固定的。
+    sampler2D：这是 GLSL 中的一种特定类型，用于表示二维纹理采样器。它可以用来从绑定到纹理单元的纹理中读取颜色值。
+    texture1：这是变量的名称，你可以根据需要自定义这个名字。在 GLSL 中，变量名可以是任意有效的标识符，但为了可读性，通常会根据用途进行命名。
+     */
+    static const char *fragmentShaderSource = R"(
+    #version 460 core
+    in vec2 TexCoord;  // 从顶点着色器接收纹理坐标
+    in vec4 Color;
+
+    out vec4 fragColor;  // 片段颜色输出
+
+    uniform sampler2D texture1;  // 纹理采样器
+
+    void main() {
+        fragColor = texture(texture1, TexCoord) * Color;  // 从纹理中采样颜色，再乘上色调
+    }
+)";
+
+    // 编译和链接着色器程序（ShaderCache 先查磁盘上的程序二进制，查不到才真正编译、链接）
+    defaultProgram = shaderCache.program(vertexShaderSource, fragmentShaderSource);
+    if (!defaultProgram)
+        qFatal("SpriteBatch: default shader program failed to build");
+
+    programs.insert(defaultProgram->programId(), defaultProgram);
+}
+
+void SpriteBatch::createBuffers()
+{
+    /* VAO对象是什么情况：
+     * vao.create() 和 vbo.create() 这两个函数创建了VAO对象vao以及VBO对象vbo
+     * 它们实际上是在 GPU 上为 VAO 和 VBO 分配资源
+     *
+     * 可以在创建了一个 VAO 后再次创建其他 VAO 对象。
+     * 例如，在执行 vao.create() 之后，可以再调用 vao2.create() 来创建一个新的 VAO 对象
+     * 每个 VAO 都有自己独立的状态，它们不会相互影响
+     */
+
+    /* VAO是用来干什么的：
+     * 在vao中存储的是很多不同的属性（存在方式/存储格式），
+     * 这些属性可以是一个点集的位置的存在方式/存储格式（属性）也可以是点集的颜色的存在方式/存储格式（属性）。
+     * 这些属性由glVertexAttribPointer函数来创建/管理，
+     * 创建新属性时要给新属性设置一个唯一的index来标识它。
+     */
+
+    /* VAO的使用方法/注意事项
+     * ######也就是说每个vao对象都是一个属性库######
+     * 只能同时生效一个 VAO对象
+     *
+     * 在代码中使用vao.bind()表示现在使用vao中的属性，vao.release()表示现在不用这个属性库了
+     * vao.bind()之后，后面的代码就不用显式的调用vao了（不用往参数里面写）
+     * 如：
+        // 绑定 vao
+        vao.bind();  // OpenGL 现在将使用 vao 记录的顶点属性
+        glDrawArrays(GL_TRIANGLES, 0, numVertices);  // 使用 vao1 中的数据进行绘制
+        vao.release();  // 解绑 vao
+        // 绑定 vao2
+        vao2.bind();  // OpenGL 现在将使用 vao2 记录的顶点属性
+        glDrawArrays(GL_TRIANGLES, 0, numVertices);  // 使用 vao2 中的数据进行绘制
+        vao2.release();  // 解绑 vao2
+        // 其中glDrawArrays就不用指出用vao还是vao2。
+     *
+     * 注意切换VAO对象时要先release再bind，
+     * 不过当你调用 vao1.bind() 时，即使没有先执行 vao.release() 来解绑先前的 VAO，
+     * OpenGL也会自动替换当前的 VAO。
+     *
+     * 那么 vao.release() 什么时候有用？
+     * 1.有时你可能希望在某些操作之后不绑定任何 VAO。
+     * 这时调用 vao.release() （等效于 glBindVertexArray(0)) 会使当前 VAO 解绑，
+     * 使得接下来的操作不再影响当前的顶点数组配置。
+     * 2.防止意外修改：在某些场景中，解除 VAO 绑定可以防止后续代码意外修改当前 VAO 的状态。
+     */
+
+    /* VAO中属性的创建和管理
+     * glVertexAttribPointer()在当前vao中创建属性，创建时还要给属性一个唯一标号index（不同vao间可以重复）
+     * 通过glEnableVertexAttribArray(index)来使属性生效
+     * 一个vao中可以同时生效多个属性，这样程序到时候就会加载这些生效的属性
+     *
+     * 属性创建了就不能删除了，但可以用glDisableVertexAttribArray(index)禁用属性，
+     * 禁用后，尽管属性仍然存储在 VAO 中，但 OpenGL 不会使用该属性进行绘制。
+     * 禁用属性后可以避免不必要的数据处理：
+     * 如果某些顶点属性（如颜色、法线或纹理坐标）在特定的绘制操作中不需要使用，
+     * 那么禁用它们可以避免 GPU 对这些不必要的属性进行处理，节省处理时间和内存带宽。
+     *
+        示例：1.设置属性
+        // 设置顶点位置属性
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)0);  // 第一个参数为index
+        glEnableVertexAttribArray(0);  // 启用位置属性
+
+        // 设置顶点颜色属性
+        glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)(3 * sizeof(float)));
+        glEnableVertexAttribArray(1);  // 启用颜色属性
+        2.禁用属性
+        // 绘制阶段1：只启用位置属性
+        glEnableVertexAttribArray(0);  // 启用位置属性
+        glDisableVertexAttribArray(1); // 禁用颜色属性
+        glDisableVertexAttribArray(2); // 禁用法线属性
+        glDrawArrays(GL_TRIANGLES, 0, numVertices);  // 绘制
+
+        // 绘制阶段2：启用位置和颜色属性
+        glEnableVertexAttribArray(1);  // 启用颜色属性
+        glDrawArrays(GL_TRIANGLES, 0, numVertices);  // 绘制
+     */
+
+    /* vao和vbo的联动
+    在vao1.bind()，vbo1.bind()下，
+    在执行glVertexAttribPointer(index3,....)时，系统会自动将自动将vao1中的index3属性与vbo1关联起来，
+    不需要人为将vbo2写在glVertexAttribPointer的参数里。
+    画图的时候只需要在vao1.bind()下使用index3属性,就知道使用的时vbo1，不需要写vbo1.bind()。
+    而且在不同的vbo下，同一个vao的不同属性可以关联到不同的vbo。
+     */
+
+    // 顶点和索引每帧都要重写，放在持久映射的环形缓冲（StreamBuffer）里，每个区域能装下一帧的容量。
+    // 要在绑定 VAO 之前创建：create() 内部的 bind()/release() 不能影响 VAO 记录的索引缓冲
+    vertexStream.create(qsizetype(vertexCapacity) * qsizetype(sizeof(SpriteVertex)));
+    indexStream.create(qsizetype(indexCapacity) * qsizetype(sizeof(GLuint)));
+
+    // Create VAO (Vertex Array Object)
+    vao.create();
+    vao.bind();  // 绑定 VAO，所有后续顶点属性配置都会记录在这个 VAO 中
+    // glBindVertexArray(vao)与vao.bind()在功能上是等价的，
+    //glBindVertexArray(vao)是opengl的原生库
+    //vao.bind()是qt中对opengl封装过的高级库
+
+    // VBO (Vertex Buffer Object)
+    vertexStream.bind();  // 绑定 VBO
+
+    // 索引缓冲（EBO）要在 VAO 绑定的状态下绑定，这样 VAO 会记住它，画的时候不用再绑
+    indexStream.bind();
+
+    /* vbo.allocate()函数注意事项
+    每次调用 vbo.allocate() 都会分配新的内存空间并将数据复制到 VBO 中。
+    如果 VBO 已经有数据，新的 allocate() 会覆盖之前的数据。
+
+    如果新的数据大小不同于之前的数据大小，vbo.allocate() 会重新分配缓冲区，并将新的数据复制到缓冲区中。
+    如果新的大小小于之前分配的大小，旧数据可能会被截断。
+    例子：
+
+        // 第一次分配顶点数据
+        GLfloat vertices1[] = {
+            0.0f,  0.5f, 0.0f,
+            -0.5f, -0.5f, 0.0f,
+            0.5f, -0.5f, 0.0f
+        };
+        vbo.allocate(vertices1, sizeof(vertices1));  // 分配第一个顶点数据
+
+        // 第二次分配不同的顶点数据
+        GLfloat vertices2[] = {
+            -0.2f,  0.4f, 0.0f,
+            -0.6f, -0.6f, 0.0f,
+            0.4f, -0.4f, 0.0f
+        };
+        vbo.allocate(vertices2, sizeof(vertices2));  // 会覆盖之前的数据
+    */
+
+    /* vbo如何存储多组数据
+        // 定义顶点位置和颜色（每个顶点有3个坐标，和3个颜色分量）
+        GLfloat vertices[] = {
+            // 位置         // 颜色
+            0.0f,  0.5f, 0.0f,  1.0f, 0.0f, 0.0f,   // 顶点1：位置(x, y, z)，颜色(r, g, b)
+            -0.5f, -0.5f, 0.0f,  0.0f, 1.0f, 0.0f,   // 顶点2
+            0.5f, -0.5f, 0.0f,  0.0f, 0.0f, 1.0f,   // 顶点3
+            // 第二个三角形
+            0.5f,  0.5f, 0.0f,  1.0f, 1.0f, 0.0f,   // 顶点4
+            0.5f, -0.5f, 0.0f,  1.0f, 0.0f, 1.0f,   // 顶点5
+            0.0f, -1.0f, 0.0f,  0.0f, 1.0f, 1.0f    // 顶点6
+        };
+
+        vbo.allocate(vertices, sizeof(vertices));  // 将所有顶点和颜色数据都存储到同一个VBO中
+
+        // 设置顶点属性指针 (位置属性)
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)0);  // 位置属性从第一个分量开始
+        glEnableVertexAttribArray(0);
+
+        // 设置颜色属性指针 (颜色属性)
+        glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)(3 * sizeof(float)));  // 颜色属性从第4个分量开始
+        glEnableVertexAttribArray(1);
+     */
+
+    // 设置顶点属性指针
+    /*glVertexAttribPointer()的各个参数的含义：
+     *
+     *index: 顶点属性的索引（这里是0）
+     *
+     *size:n维向量（这里是3）1: 表示一个标量，如 float。2: 表示二维向量，
+     *如 vec2（x, y）。3: 表示三维向量，如 vec3（x, y, z）
+     *
+     *type：每个分量的类型（GL_FLOAT 表示每个顶点的 x, y, z 坐标是 float 类型)
+     *此外常见的还有GL_INT、GL_UNSIGNED_BYTE分别表示int和unsigned byte无符号字节类型
+     *
+     *normalized：是否需要将数据归一化，即如果数据类型是整数类型，
+     *是否需要将其映射到 [0, 1] 或 [-1, 1] 的范围。GL_TRUE，整数数据会被归一化；
+     *如果是 GL_FALSE，则不归一化，直接使用原始数据，这里是浮点数通常不需要归一化
+     *
+     *stride：步长，即每个顶点属性之间的字节偏移量。简单来说，
+     *它表示从一个顶点到下一个顶点在缓冲区中的距离（单位是字节），这里用的是3维的点，
+     *所以距离是 3 * sizeof(float) 字节
+     *
+     *pointer：这个参数是指向顶点缓冲区中数据的 偏移量。
+     *它指定顶点数据在缓冲区中的起始位置。(void*)0 表示数据从缓冲区的第一个字节开始存储，也就是偏移量为 0。
+     *当缓冲区内有多个顶点属性时（如位置和颜色），这个偏移量可以用来指定某个属性在顶点数据中的相对位置。
+     */
+    // 步长是 SpriteVertex 的大小，偏移量用 offsetof 取，结构体改了这里不用跟着改数字
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(SpriteVertex), (void*)offsetof(SpriteVertex, position));  // 顶点位置
+    glEnableVertexAttribArray(0);
+
+    glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, sizeof(SpriteVertex), (void*)offsetof(SpriteVertex, texCoord));  // 纹理坐标
+    glEnableVertexAttribArray(1);
+
+    // 颜色是 4 个无符号字节，normalized = GL_TRUE 让着色器里读到的是 [0, 1] 的 vec4
+    glVertexAttribPointer(2, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(SpriteVertex), (void*)offsetof(SpriteVertex, color));  // 颜色
+    glEnableVertexAttribArray(2);
+
+    // 解绑 VAO 和 VBO（先解绑 VAO，否则解绑索引缓冲会把 VAO 里记录的也清掉）
+    vao.release();
+    vertexStream.release();
+}
+
+quint64 SpriteBatch::sortKey(GLuint texture, QOpenGLShaderProgram *program)
+{
+    if (!program)
+        program = defaultProgram;
+    else if (program != defaultProgram)
+        programs.insert(program->programId(), program);
+    return (quint64(program->programId()) << 32) | texture;
+}
+
+void SpriteBatch::begin(const QMatrix4x4 &matrix)
+{
+    viewProjection = matrix;
+    vertices.clear();
+    commands.clear();
+}
+
+void SpriteBatch::submitTriangle(GLuint texture, const SpriteVertex triangle[3], QOpenGLShaderProgram *program)
+{
+    commands.push_back({sortKey(texture, program), quint32(vertices.size()), 3});
+    vertices.insert(vertices.end(), triangle, triangle + 3);
+}
+
+void SpriteBatch::submitTriangle(GLuint texture, const QMatrix4x4 &transform, const SpriteVertex triangle[3],
+                                 QOpenGLShaderProgram *program)
+{
+    commands.push_back({sortKey(texture, program), quint32(vertices.size()), 3});
+    for (int i = 0; i < 3; ++i) {
+        SpriteVertex v = triangle[i];
+        const QVector3D p = transform.map(QVector3D(v.position[0], v.position[1], v.position[2]));
+        v.position[0] = p.x();
+        v.position[1] = p.y();
+        v.position[2] = p.z();
+        vertices.push_back(v);
+    }
+}
+
+void SpriteBatch::submitTriangles(GLuint texture, const SpriteVertex *triangles, int count,
+                                  QOpenGLShaderProgram *program)
+{
+    const quint64 key = sortKey(texture, program);
+    const quint32 firstVertex = quint32(vertices.size());
+    commands.reserve(commands.size() + size_t(count));
+    for (int i = 0; i < count; ++i)
+        commands.push_back({key, firstVertex + quint32(i) * 3, 3});
+    vertices.insert(vertices.end(), triangles, triangles + size_t(count) * 3);
+}
+
+void SpriteBatch::submitQuad(GLuint texture, const QMatrix4x4 &transform, const QRectF &uvRect, const QColor &tint,
+                             QOpenGLShaderProgram *program)
+{
+    // 单位正方形的四个角，逆时针：左下、右下、右上、左上
+    static const GLfloat corners[4][2] = { {-0.5f, -0.5f}, {0.5f, -0.5f}, {0.5f, 0.5f}, {-0.5f, 0.5f} };
+
+    commands.push_back({sortKey(texture, program), quint32(vertices.size()), 4});
+    const GLubyte r = GLubyte(tint.red()), g = GLubyte(tint.green()), b = GLubyte(tint.blue()), a = GLubyte(tint.alpha());
+    for (const auto &corner : corners) {
+        const QVector3D p = transform.map(QVector3D(corner[0], corner[1], 0.0f));
+        SpriteVertex v;
+        v.position[0] = p.x();
+        v.position[1] = p.y();
+        v.position[2] = p.z();
+        v.texCoord[0] = GLfloat(uvRect.left() + (corner[0] + 0.5f) * uvRect.width());
+        v.texCoord[1] = GLfloat(uvRect.top() + (corner[1] + 0.5f) * uvRect.height());
+        v.color[0] = r;
+        v.color[1] = g;
+        v.color[2] = b;
+        v.color[3] = a;
+        vertices.push_back(v);
+    }
+}
+
+qsizetype SpriteBatch::indexCountOf(const std::vector<Command> &commands)
+{
+    qsizetype count = 0;
+    for (const Command &c : commands)
+        count += c.vertexCount == 3 ? 3 : 6;
+    return count;
+}
+
+void SpriteBatch::end()
+{
+    frameStats = Stats();
+    frameStats.primitives = int(commands.size());
+    frameStats.vertices = int(vertices.size());
+    if (commands.empty())
+        return;
+
+    // 1. 按 (着色器, 纹理) 排序。stable_sort 保证同一状态内的图元还是提交顺序；
+    //    只用一种纹理的场景本来就是有序的，直接跳过排序
+    const auto byKey = [](const Command &a, const Command &b) { return a.key < b.key; };
+    if (!std::is_sorted(commands.begin(), commands.end(), byKey))
+        std::stable_sort(commands.begin(), commands.end(), byKey);
+
+    // 2. 容量不够时（只会在场景变大后的头几帧出现）等 GPU 空闲，把环形缓冲换成 2 倍大的
+    const qsizetype indexCount = indexCountOf(commands);
+    if (qsizetype(vertices.size()) > vertexCapacity || indexCount > indexCapacity) {
+        while (vertexCapacity < qsizetype(vertices.size()))
+            vertexCapacity *= 2;
+        while (indexCapacity < indexCount)
+            indexCapacity *= 2;
+        glFinish();
+        destroyBuffers();
+        createBuffers();
+        state->invalidate();  // 删掉了旧的 VAO/缓冲，createBuffers() 又直接绑定过新的
+    }
+
+    // 3. 顶点整块拷进当前区域；索引按排序后的顺序直接生成到映射内存里（不经过 CPU 端的中间数组），
+    //    同时把状态相同的连续图元合并成一次绘制
+    vertexStream.beginFrame();
+    indexStream.beginFrame();
+    qsizetype vertexOffset = 0;
+    qsizetype indexOffset = 0;
+    void *vertexDst = vertexStream.allocate(qsizetype(vertices.size() * sizeof(SpriteVertex)), sizeof(SpriteVertex), &vertexOffset);
+    GLuint *indexDst = static_cast<GLuint *>(indexStream.allocate(indexCount * qsizetype(sizeof(GLuint)), sizeof(GLuint), &indexOffset));
+    if (!vertexDst || !indexDst) {
+        qWarning("SpriteBatch: stream buffer unavailable, dropping %d primitives", frameStats.primitives);
+        return;
+    }
+    std::memcpy(vertexDst, vertices.data(), vertices.size() * sizeof(SpriteVertex));
+
+    struct DrawRun
+    {
+        quint64 key;
+        GLsizei firstIndex;
+        GLsizei count;
+    };
+    std::vector<DrawRun> runs;
+    GLsizei written = 0;
+    for (const Command &c : commands) {
+        if (runs.empty() || runs.back().key != c.key)
+            runs.push_back({c.key, written, 0});
+        const GLuint v = c.firstVertex;
+        GLuint *dst = indexDst + written;
+        dst[0] = v;
+        dst[1] = v + 1;
+        dst[2] = v + 2;
+        if (c.vertexCount == 3) {
+            written += 3;
+        } else {
+            dst[3] = v;
+            dst[4] = v + 2;
+            dst[5] = v + 3;
+            written += 6;
+        }
+        runs.back().count = written - runs.back().firstIndex;
+    }
+    frameStats.indices = int(written);
+    frameStats.streamStalls = vertexStream.stats().stalls + indexStream.stats().stalls;
+
+    // 顶点写在当前区域的 vertexOffset 处，用 baseVertex 偏移过去，VAO 里的属性指针不用每帧重设
+    const GLint baseVertex = GLint(vertexOffset / qsizetype(sizeof(SpriteVertex)));
+    state->bindVertexArray(vao.objectId());
+
+    // 4. 绘制：只有状态真的变了才重新绑定着色器/纹理（GLStateCache 跳过和上一帧相同的绑定）
+    QOpenGLShaderProgram *boundProgram = nullptr;
+    for (const DrawRun &run : runs) {
+        QOpenGLShaderProgram *program = programs.value(GLuint(run.key >> 32), defaultProgram);
+        const GLuint texture = GLuint(run.key & 0xffffffffu);
+        if (program != boundProgram) {
+            state->useProgram(program->programId());
+            program->setUniformValue("viewProjection", viewProjection);  // 作用在当前使用的程序上
+            boundProgram = program;
+        }
+        state->bindTexture(0, texture);
+        glDrawElementsBaseVertex(GL_TRIANGLES, run.count, GL_UNSIGNED_INT,
+                                 reinterpret_cast<const void *>(quintptr(indexOffset) + quintptr(run.firstIndex) * sizeof(GLuint)),
+                                 baseVertex);
+        ++frameStats.drawCalls;
+    }
+
+    // 当前区域的绘制都发出去了，插 fence，下次轮到这个区域时据此判断 GPU 是否读完
+    vertexStream.endFrame();
+    indexStream.endFrame();
+
+    // 不再解绑 VAO/纹理/着色器：下一帧绑的多半还是它们，留着让 GLStateCache 跳过。
+    // 之后要直接改 GL 状态的代码（QPainter 等）改完要调用 GLStateCache::invalidate()
+}
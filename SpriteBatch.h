@@ -0,0 +1,104 @@
+#ifndef SPRITEBATCH_H
+#define SPRITEBATCH_H
+
+#include <QOpenGLShaderProgram>
+#include <QOpenGLVertexArrayObject>
+#include <QMatrix4x4>
+#include <QRectF>
+#include <QColor>
+#include <QHash>
+#include <vector>
+#include "GLTraceFunctions.h"
+#include "StreamBuffer.h"
+#include "ShaderCache.h"
+#include "GLStateCache.h"
+
+// 批处理用的顶点格式：位置 + 纹理坐标 + RGBA8 颜色，共 24 字节
+struct SpriteVertex
+{
+    GLfloat position[3];
+    GLfloat texCoord[2];
+    GLubyte color[4];
+};
+
+/* SpriteBatch：三角形/四边形批处理
+ *
+ * 一帧内所有 submit*() 提交的图元先在 CPU 上变换好、攒进同一个顶点数组，end() 时：
+ *   1. 按 (着色器, 纹理) 排序（同一状态内保持提交顺序）
+ *   2. 顶点整块拷进、索引按排序后的顺序直接生成进持久映射的环形缓冲（StreamBuffer）
+ *   3. 连续相同状态的图元合成一次 glDrawElements
+ * 所以几万个图元只要 "不同的 (着色器, 纹理) 组合数" 次绘制调用。
+ * 绑定都经过 GLStateCache，end() 结束时不再解绑，下一帧状态没变的绑定会被跳过。
+ *
+ * 注意排序会打乱不同纹理之间的先后顺序：不透明物体靠深度测试，半透明物体需要严格顺序时
+ * 应该放到不同的 begin()/end() 里。
+ *
+ * 自定义着色器要使用和默认着色器相同的属性位置（0 位置，1 纹理坐标，2 颜色）
+ * 和名为 viewProjection 的 mat4 uniform。
+ */
+class SpriteBatch : protected GLTraceFunctions
+{
+public:
+    struct Stats
+    {
+        int primitives = 0;   // 提交的三角形 + 四边形个数
+        int vertices = 0;
+        int indices = 0;
+        int drawCalls = 0;
+        int streamStalls = 0; // 环形缓冲等 GPU 的累计次数，一直涨说明 GPU 落后超过两帧
+    };
+
+    SpriteBatch();
+    ~SpriteBatch();
+
+    // 创建默认着色器、VAO/VBO/EBO，上下文必须是当前上下文。绘制时的绑定都经过 state
+    void initialize(ShaderCache &shaderCache, GLStateCache &state);
+    void cleanup();
+
+    void begin(const QMatrix4x4 &viewProjection);
+    // 三角形：顶点坐标已经是世界坐标
+    void submitTriangle(GLuint texture, const SpriteVertex vertices[3], QOpenGLShaderProgram *program = nullptr);
+    // 三角形：顶点先乘 transform
+    void submitTriangle(GLuint texture, const QMatrix4x4 &transform, const SpriteVertex vertices[3],
+                        QOpenGLShaderProgram *program = nullptr);
+    // 连续的 count 个三角形（每 3 个顶点一个，已经是世界坐标），整块拷进来：别的线程事先准备好的顶点用这个提交
+    void submitTriangles(GLuint texture, const SpriteVertex *triangles, int count,
+                         QOpenGLShaderProgram *program = nullptr);
+    // 四边形：以原点为中心的单位正方形 [-0.5, 0.5]^2 乘 transform，uvRect 是纹理坐标范围
+    void submitQuad(GLuint texture, const QMatrix4x4 &transform, const QRectF &uvRect = QRectF(0, 0, 1, 1),
+                    const QColor &tint = Qt::white, QOpenGLShaderProgram *program = nullptr);
+    void end();  // 排序、上传、绘制
+
+    const Stats &stats() const { return frameStats; }  // 上一次 end() 的统计
+    QOpenGLShaderProgram *program() const { return defaultProgram; }
+
+private:
+    // 一个图元在 CPU 顶点数组里的位置，key = (着色器 id << 32) | 纹理 id
+    struct Command
+    {
+        quint64 key;
+        quint32 firstVertex;
+        quint32 vertexCount;  // 3 = 三角形，4 = 四边形
+    };
+
+    quint64 sortKey(GLuint texture, QOpenGLShaderProgram *program);
+    void createBuffers();   // 按当前容量创建环形缓冲和 VAO
+    void destroyBuffers();
+    static qsizetype indexCountOf(const std::vector<Command> &commands);
+
+    QOpenGLShaderProgram *defaultProgram;
+    GLStateCache *state;
+    QOpenGLVertexArrayObject vao;
+    StreamBuffer vertexStream;   // VBO
+    StreamBuffer indexStream;    // EBO
+    qsizetype vertexCapacity;    // 环形缓冲每个区域能装下的顶点/索引个数
+    qsizetype indexCapacity;
+
+    QMatrix4x4 viewProjection;
+    std::vector<SpriteVertex> vertices;     // 本帧的顶点，按提交顺序
+    std::vector<Command> commands;          // 本帧的图元
+    QHash<GLuint, QOpenGLShaderProgram *> programs;  // 着色器 id -> 着色器，end() 绑定时用
+    Stats frameStats;
+};
+
+#endif // SPRITEBATCH_H
@@ -0,0 +1,56 @@
+#ifndef SPSCQUEUE_H
+#define SPSCQUEUE_H
+
+#include <atomic>
+#include <cstddef>
+#include <utility>
+
+/* SpscQueue：单生产者、单消费者的无锁环形队列
+ *
+ * 只能有一个线程 push()、一个线程 pop()（比如 GUI 线程发命令给渲染线程），两边都不加锁、不阻塞：
+ *   - head 只由消费者写，tail 只由生产者写，对方只读
+ *   - 生产者先写元素再 release 写 tail，消费者 acquire 读 tail 后才读元素（pop 方向对称）
+ * head/tail 各占一条缓存行，避免两个线程来回抢同一条缓存行（false sharing）。
+ *
+ * Capacity 必须是 2 的幂；满了 push() 返回 false，由调用方决定丢弃还是稍后重试。
+ */
+template <typename T, size_t Capacity>
+class SpscQueue
+{
+    static_assert(Capacity >= 2 && (Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two");
+
+public:
+    bool push(T value)
+    {
+        const size_t tail = tailIndex.load(std::memory_order_relaxed);
+        if (tail - headIndex.load(std::memory_order_acquire) == Capacity)
+            return false;
+        items[tail & (Capacity - 1)] = std::move(value);
+        tailIndex.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool pop(T &value)
+    {
+        const size_t head = headIndex.load(std::memory_order_relaxed);
+        if (head == tailIndex.load(std::memory_order_acquire))
+            return false;
+        T &item = items[head & (Capacity - 1)];
+        value = std::move(item);
+        item = T();   // 立刻释放元素持有的资源（比如 std::function 捕获的对象）
+        headIndex.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool isEmpty() const
+    {
+        return headIndex.load(std::memory_order_acquire) == tailIndex.load(std::memory_order_acquire);
+    }
+
+private:
+    alignas(64) std::atomic<size_t> headIndex{0};   // 下一个要读的位置，消费者写
+    alignas(64) std::atomic<size_t> tailIndex{0};   // 下一个要写的位置，生产者写
+    T items[Capacity];
+};
+
+#endif // SPSCQUEUE_H
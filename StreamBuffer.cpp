@@ -0,0 +1,108 @@
+#include "StreamBuffer.h"
+#include <QElapsedTimer>
+
+StreamBuffer::StreamBuffer(QOpenGLBuffer::Type type)
+    : buffer(type),
+      target(type == QOpenGLBuffer::IndexBuffer ? GL_ELEMENT_ARRAY_BUFFER
+             : type == QOpenGLBuffer::PixelUnpackBuffer ? GL_PIXEL_UNPACK_BUFFER : GL_ARRAY_BUFFER),
+      mapped(nullptr), regionBytes(0), regions(0), current(0), used(0), fences{}
+{
+}
+
+StreamBuffer::~StreamBuffer()
+{
+    destroy();
+}
+
+bool StreamBuffer::create(qsizetype regionSize, int regionCount)
+{
+    destroy();
+    initializeOpenGLFunctions();
+
+    regions = qBound(1, regionCount, int(MaxRegions));
+    regionBytes = regionSize;
+    const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+
+    // QOpenGLBuffer 只负责对象的创建/绑定/销毁，存储用 glBufferStorage 分配（allocate() 做不到持久映射）
+    if (!buffer.create())
+        return false;
+    buffer.bind();
+    glBufferStorage(target, GLsizeiptr(regionBytes * regions), nullptr, flags);
+    mapped = static_cast<char *>(glMapBufferRange(target, 0, GLsizeiptr(regionBytes * regions), flags));
+    buffer.release();
+    if (!mapped) {
+        buffer.destroy();
+        return false;
+    }
+
+    current = regions - 1;  // 第一次 beginFrame() 切到区域 0
+    used = 0;
+    return true;
+}
+
+void StreamBuffer::destroy()
+{
+    if (!buffer.isCreated())
+        return;
+    for (GLsync &fence : fences) {
+        if (fence) {
+            glDeleteSync(fence);
+            fence = nullptr;
+        }
+    }
+    if (mapped) {
+        buffer.bind();
+        glUnmapBuffer(target);
+        buffer.release();
+        mapped = nullptr;
+    }
+    buffer.destroy();
+}
+
+void StreamBuffer::waitForRegion(int region)
+{
+    GLsync &fence = fences[region];
+    if (!fence)
+        return;
+
+    // 先不等待地查一次：GPU 没落后的话 fence 早就触发了
+    GLenum status = glClientWaitSync(fence, 0, 0);
+    if (status == GL_TIMEOUT_EXPIRED) {
+        QElapsedTimer timer;
+        timer.start();
+        ++counters.stalls;
+        // GL_SYNC_FLUSH_COMMANDS_BIT 保证 fence 已经提交给 GPU，否则可能永远等不到
+        do {
+            status = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000);  // 1 秒
+        } while (status == GL_TIMEOUT_EXPIRED);
+        counters.waitNs += timer.nsecsElapsed();
+    }
+    glDeleteSync(fence);
+    fence = nullptr;
+}
+
+void StreamBuffer::beginFrame()
+{
+    current = (current + 1) % regions;
+    used = 0;
+    waitForRegion(current);
+}
+
+void *StreamBuffer::allocate(qsizetype size, qsizetype alignment, qsizetype *offset)
+{
+    const qsizetype start = alignment > 1 ? (used + alignment - 1) / alignment * alignment : used;
+    if (!mapped || start + size > regionBytes)
+        return nullptr;
+    used = start + size;
+    *offset = qsizetype(current) * regionBytes + start;
+    return mapped + *offset;
+}
+
+void StreamBuffer::endFrame()
+{
+    if (!mapped)
+        return;
+    if (fences[current])
+        glDeleteSync(fences[current]);
+    fences[current] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
@@ -0,0 +1,65 @@
+#ifndef STREAMBUFFER_H
+#define STREAMBUFFER_H
+
+#include <QOpenGLBuffer>
+#include "GLTraceFunctions.h"
+
+/* StreamBuffer：每帧都要重写的动态数据（顶点、索引、要上传的像素）用的环形缓冲
+ *
+ * 用 glBufferStorage 分配一块不可变的存储，并以 GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT
+ * 一直映射着：CPU 直接往显卡能看到的内存里写，不再需要每帧 allocate()（驱动重新分配 + 拷贝）。
+ *
+ * 缓冲被分成 regionCount（默认 3）个区域轮流使用：第 N 帧写区域 N % 3，
+ * 每个区域用完后插入一个 fence；再次轮到这个区域时先等它的 fence，
+ * 保证 GPU 已经读完，CPU 才去覆盖。正常情况下 GPU 最多落后两帧，等待会立刻返回。
+ *
+ * 用法（每帧）：
+ *   stream.beginFrame();
+ *   void *p = stream.allocate(bytes, alignment, &offset);  // 写入 p，绘制时用 offset
+ *   ...绘制...
+ *   stream.endFrame();
+ */
+class StreamBuffer : protected GLTraceFunctions
+{
+public:
+    struct Stats
+    {
+        int stalls = 0;        // beginFrame() 真正阻塞等 GPU 的次数（累计）
+        qint64 waitNs = 0;     // 阻塞的总时间
+    };
+
+    explicit StreamBuffer(QOpenGLBuffer::Type type = QOpenGLBuffer::VertexBuffer);
+    ~StreamBuffer();
+
+    bool create(qsizetype regionSize, int regionCount = 3);  // 上下文必须是当前上下文
+    void destroy();
+    bool isCreated() const { return mapped != nullptr; }
+
+    void beginFrame();   // 切到下一个区域，必要时等待它上一次的 fence
+    // 在当前区域里分配 size 字节，offset 返回在整个缓冲里的字节偏移；区域剩余空间不够时返回 nullptr
+    void *allocate(qsizetype size, qsizetype alignment, qsizetype *offset);
+    void endFrame();     // 当前区域的绘制调用都发出之后调用，插入 fence
+
+    bool bind() { return buffer.bind(); }
+    void release() { buffer.release(); }
+    GLuint bufferId() const { return buffer.bufferId(); }
+    qsizetype regionSize() const { return regionBytes; }
+    const Stats &stats() const { return counters; }
+
+private:
+    static const int MaxRegions = 4;
+
+    void waitForRegion(int region);
+
+    QOpenGLBuffer buffer;
+    GLenum target;
+    char *mapped;              // 持久映射的起始地址
+    qsizetype regionBytes;
+    int regions;
+    int current;               // 当前写入的区域
+    qsizetype used;            // 当前区域已经分配出去的字节数
+    GLsync fences[MaxRegions];
+    Stats counters;
+};
+
+#endif // STREAMBUFFER_H
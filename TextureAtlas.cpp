@@ -0,0 +1,268 @@
+#include "TextureAtlas.h"
+#include <QDebug>
+#include <algorithm>
+#include <climits>
+#include <cstring>
+#include <numeric>
+
+AtlasPacker::AtlasPacker(const QSize &size)
+{
+    reset(size);
+}
+
+void AtlasPacker::reset(const QSize &size)
+{
+    area = size;
+    skyline.clear();
+    if (!size.isEmpty())
+        skyline.push_back({0, 0, size.width()});
+    usedArea = 0;
+}
+
+double AtlasPacker::occupancy() const
+{
+    const qint64 total = qint64(area.width()) * area.height();
+    return total > 0 ? double(usedArea) / double(total) : 0.0;
+}
+
+int AtlasPacker::fit(size_t index, int width, int height) const
+{
+    const int x = skyline[index].x;
+    if (x + width > area.width())
+        return -1;
+    // 矩形盖住的所有线段里最高的那个就是它的底边
+    int y = skyline[index].y;
+    int widthLeft = width;
+    for (size_t i = index; widthLeft > 0; ++i) {
+        y = qMax(y, skyline[i].y);
+        if (y + height > area.height())
+            return -1;
+        widthLeft -= skyline[i].width;
+    }
+    return y;
+}
+
+bool AtlasPacker::insert(const QSize &size, QPoint *position)
+{
+    int bestTop = INT_MAX;
+    int bestWidth = INT_MAX;
+    size_t bestIndex = skyline.size();
+    int bestY = 0;
+    for (size_t i = 0; i < skyline.size(); ++i) {
+        const int y = fit(i, size.width(), size.height());
+        if (y < 0)
+            continue;
+        const int top = y + size.height();
+        if (top < bestTop || (top == bestTop && skyline[i].width < bestWidth)) {
+            bestTop = top;
+            bestWidth = skyline[i].width;
+            bestIndex = i;
+            bestY = y;
+        }
+    }
+    if (bestIndex == skyline.size())
+        return false;
+
+    const int x = skyline[bestIndex].x;
+    place(bestIndex, x, bestY, size.width(), size.height());
+    usedArea += qint64(size.width()) * size.height();
+    if (position)
+        *position = QPoint(x, bestY);
+    return true;
+}
+
+void AtlasPacker::place(size_t index, int x, int y, int width, int height)
+{
+    skyline.insert(skyline.begin() + qsizetype(index), {x, y + height, width});
+
+    // 新线段右边被盖住的部分截掉，整段被盖住的删掉
+    for (size_t i = index + 1; i < skyline.size();) {
+        const int previousRight = skyline[i - 1].x + skyline[i - 1].width;
+        SkylineNode &node = skyline[i];
+        if (node.x >= previousRight)
+            break;
+        const int shrink = previousRight - node.x;
+        node.x += shrink;
+        node.width -= shrink;
+        if (node.width > 0)
+            break;
+        skyline.erase(skyline.begin() + qsizetype(i));
+    }
+
+    // 相邻且一样高的线段合并
+    for (size_t i = 0; i + 1 < skyline.size();) {
+        if (skyline[i].y == skyline[i + 1].y) {
+            skyline[i].width += skyline[i + 1].width;
+            skyline.erase(skyline.begin() + qsizetype(i + 1));
+        } else {
+            ++i;
+        }
+    }
+}
+
+TextureAtlas::TextureAtlas(int pageSize, int padding)
+    : pageSize(pageSize), padding(qMax(0, padding)), alignment(1), mipLevels(1), state(nullptr)
+{
+    while (alignment * 2 <= this->padding) {
+        alignment *= 2;
+        ++mipLevels;
+    }
+}
+
+TextureAtlas::~TextureAtlas()
+{
+    // 和 Renderer 一样，析构时调用方要保证上下文是当前上下文；没上传过就什么都不用做
+    if (!pages.empty())
+        destroy();
+}
+
+int TextureAtlas::add(const QImage &image)
+{
+    if (image.isNull())
+        return -1;
+    images.push_back(image.convertToFormat(QImage::Format_RGBA8888));
+    regions.push_back(AtlasRegion());
+    return int(regions.size()) - 1;
+}
+
+int TextureAtlas::addFile(const QString &path)
+{
+    QImage image(path);
+    if (image.isNull()) {
+        qWarning() << "TextureAtlas: cannot read" << path;
+        return -1;
+    }
+    return add(image);
+}
+
+void TextureAtlas::destroy()
+{
+    if (!pages.empty()) {
+        glDeleteTextures(GLsizei(pages.size()), pages.data());
+        pages.clear();
+        if (state)
+            state->invalidate();  // 删掉的页可能还记在缓存里，新纹理又可能拿到同一个名字
+    }
+    pageOccupancy.clear();
+    for (AtlasRegion &region : regions)
+        region.texture = 0;
+}
+
+double TextureAtlas::occupancy() const
+{
+    if (pageOccupancy.empty())
+        return 0.0;
+    return std::accumulate(pageOccupancy.begin(), pageOccupancy.end(), 0.0) / double(pageOccupancy.size());
+}
+
+bool TextureAtlas::build(GLStateCache &stateCache)
+{
+    initializeOpenGLFunctions();
+    state = &stateCache;
+    if (!pages.empty()) {
+        qWarning("TextureAtlas::build: already built, images are released after build()");
+        return false;
+    }
+
+    // 先放高的：天际线装箱按高度从大到小插入时轮廓最平，浪费最少
+    std::vector<int> order(images.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [this](int a, int b) {
+        const QImage &ia = images[size_t(a)], &ib = images[size_t(b)];
+        return ia.height() > ib.height() || (ia.height() == ib.height() && ia.width() > ib.width());
+    });
+
+    auto alignUp = [this](int value) { return (value + alignment - 1) / alignment * alignment; };
+    std::vector<AtlasPacker> packers;
+    std::vector<QImage> pageImages;
+    int placed = 0;
+    for (int id : order) {
+        const QImage &image = images[size_t(id)];
+        const QSize cell(alignUp(image.width() + 2 * padding), alignUp(image.height() + 2 * padding));
+        if (cell.width() > pageSize || cell.height() > pageSize) {
+            qWarning("TextureAtlas: %dx%d image does not fit in a %dx%d page", image.width(), image.height(),
+                     pageSize, pageSize);
+            continue;
+        }
+
+        // 依次试已有的页，都放不下才开新页
+        QPoint position;
+        size_t page = 0;
+        while (page < packers.size() && !packers[page].insert(cell, &position))
+            ++page;
+        if (page == packers.size()) {
+            packers.emplace_back(QSize(pageSize, pageSize));
+            packers.back().insert(cell, &position);
+            pageImages.emplace_back(pageSize, pageSize, QImage::Format_RGBA8888);
+            pageImages.back().fill(Qt::transparent);
+        }
+        blit(pageImages[page], image, position, padding);
+
+        AtlasRegion &region = regions[size_t(id)];
+        region.page = int(page);
+        region.size = image.size();
+        region.uvRect = QRectF(double(position.x() + padding) / pageSize, double(position.y() + padding) / pageSize,
+                               double(image.width()) / pageSize, double(image.height()) / pageSize);
+        ++placed;
+    }
+    images.clear();
+    images.shrink_to_fit();
+
+    for (size_t page = 0; page < pageImages.size(); ++page) {
+        pages.push_back(upload(pageImages[page]));
+        pageOccupancy.push_back(packers[page].occupancy());
+    }
+    for (AtlasRegion &region : regions) {
+        if (!region.isNull())
+            region.texture = pages[size_t(region.page)];
+    }
+    return placed > 0;
+}
+
+void TextureAtlas::blit(QImage &page, const QImage &image, const QPoint &position, int padding)
+{
+    // 小图连同四周的 padding 一起写：左右的 padding 复制每行的边缘像素，上下的 padding 复制第一行/最后一行
+    const int w = image.width();
+    const int h = image.height();
+    for (int y = -padding; y < h + padding; ++y) {
+        const quint32 *src = reinterpret_cast<const quint32 *>(image.constScanLine(qBound(0, y, h - 1)));
+        quint32 *dst = reinterpret_cast<quint32 *>(page.scanLine(position.y() + padding + y)) + position.x();
+        for (int x = 0; x < padding; ++x) {
+            dst[x] = src[0];
+            dst[padding + w + x] = src[w - 1];
+        }
+        std::memcpy(dst + padding, src, size_t(w) * 4);
+    }
+}
+
+GLuint TextureAtlas::upload(const QImage &page)
+{
+    GLuint texture = 0;
+    glCreateTextures(GL_TEXTURE_2D, 1, &texture);
+    glTextureStorage2D(texture, mipLevels, GL_RGBA8, page.width(), page.height());
+    glTextureSubImage2D(texture, 0, 0, 0, page.width(), page.height(), GL_RGBA, GL_UNSIGNED_BYTE, page.constBits());
+    glTextureParameteri(texture, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTextureParameteri(texture, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTextureParameteri(texture, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    if (mipLevels > 1) {
+        // 只到 padding 还能隔开相邻小图的那一层（见类说明）
+        glTextureParameteri(texture, GL_TEXTURE_MAX_LEVEL, mipLevels - 1);
+        glTextureParameteri(texture, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+        glGenerateTextureMipmap(texture);
+    } else {
+        glTextureParameteri(texture, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    }
+    return texture;
+}
+
+void TextureAtlas::remapTexCoords(const AtlasRegion &region, SpriteVertex *vertices, int count)
+{
+    const GLfloat x = GLfloat(region.uvRect.x());
+    const GLfloat y = GLfloat(region.uvRect.y());
+    const GLfloat w = GLfloat(region.uvRect.width());
+    const GLfloat h = GLfloat(region.uvRect.height());
+    for (int i = 0; i < count; ++i) {
+        vertices[i].texCoord[0] = x + vertices[i].texCoord[0] * w;
+        vertices[i].texCoord[1] = y + vertices[i].texCoord[1] * h;
+    }
+}
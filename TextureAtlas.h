@@ -0,0 +1,111 @@
+#ifndef TEXTUREATLAS_H
+#define TEXTUREATLAS_H
+
+#include <QImage>
+#include <QPoint>
+#include <QRectF>
+#include <QSize>
+#include <QString>
+#include <vector>
+#include "GLTraceFunctions.h"
+#include "GLStateCache.h"
+#include "SpriteBatch.h"
+
+/* AtlasPacker：天际线（skyline）装箱
+ *
+ * 记录已放矩形的上轮廓（一串水平线段），新矩形放在能让它顶边最低的线段上（bottom-left），
+ * 顶边一样高时选浪费宽度最少的。比 MaxRects 稍差一点，但插入是 O(线段数)，几千个图标也是毫秒级。
+ */
+class AtlasPacker
+{
+public:
+    explicit AtlasPacker(const QSize &size = QSize());
+
+    void reset(const QSize &size);
+    bool insert(const QSize &size, QPoint *position);  // 放不下返回 false
+    QSize size() const { return area; }
+    double occupancy() const;                           // 已用面积 / 总面积
+
+private:
+    struct SkylineNode
+    {
+        int x;
+        int y;
+        int width;
+    };
+
+    int fit(size_t index, int width, int height) const;  // 左端对齐第 index 段时矩形底边的 y，放不下返回 -1
+    void place(size_t index, int x, int y, int width, int height);
+
+    QSize area;
+    std::vector<SkylineNode> skyline;
+    qint64 usedArea;
+};
+
+// 图集里的一张小图：画的时候用 texture + uvRect 代替原来的整张纹理
+struct AtlasRegion
+{
+    GLuint texture = 0;     // 所在页的纹理
+    int page = -1;
+    QRectF uvRect;          // 在页里的纹理坐标范围，可以直接传给 SpriteBatch::submitQuad / MeshInstance::make
+    QSize size;             // 原图的像素大小
+
+    bool isNull() const { return page < 0; }
+};
+
+/* TextureAtlas：把很多小图拼进少数几张大纹理，减少纹理切换
+ *
+ * SpriteBatch 按 (着色器, 纹理) 合批，每张不同的纹理至少一次绘制调用；2000 个图标各用一张纹理
+ * 就是 2000 次绑定 + 2000 次绘制。拼进图集以后同一页上的图标共用一张纹理，只剩 "页数" 次。
+ *
+ * 防止 mip 渗色：
+ *   - 每张小图四周留 padding 像素，用边缘像素向外复制填满（extrude），双线性过滤采到的还是自己的颜色
+ *   - 每张小图的格子按 2^k 对齐（2^k <= padding），mip 只生成到第 k 层：
+ *     第 k 层每个格子仍然对齐到整像素，留白至少还有 1 像素，不会和邻居混在一起
+ *
+ * 用法（上下文必须是当前上下文）：
+ *   int id = atlas.add(image);        // 或 addFile(path)
+ *   atlas.build(renderer.state());    // 打包、拼页、上传
+ *   const AtlasRegion &r = atlas.region(id);
+ *   batch.submitQuad(r.texture, transform, r.uvRect);
+ * 顶点里已经写好 [0, 1] 纹理坐标的网格用 remapTexCoords() 换到图集里。
+ *
+ * 上传用的是 DSA（glCreateTextures/glTextureStorage2D…），不改变任何绑定；
+ * 但 destroy() 删掉的页可能还绑在某个纹理单元上，删完会让 build() 时传入的 GLStateCache 失效。
+ */
+class TextureAtlas : protected GLTraceFunctions
+{
+public:
+    explicit TextureAtlas(int pageSize = 2048, int padding = 4);
+    ~TextureAtlas();
+
+    int add(const QImage &image);          // 返回区域编号，build() 之后用 region() 查
+    int addFile(const QString &path);      // 读取失败返回 -1
+    bool build(GLStateCache &state);       // 没有一张小图能放进去时返回 false
+    void destroy();                        // 删除所有页，上下文必须是当前上下文
+
+    const AtlasRegion &region(int id) const { return regions[size_t(id)]; }
+    int regionCount() const { return int(regions.size()); }
+    int pageCount() const { return int(pages.size()); }
+    GLuint pageTexture(int page) const { return pages[size_t(page)]; }
+    double occupancy() const;              // 所有页的平均填充率
+
+    // 把顶点的纹理坐标从 [0, 1] 映射到 region 在页里的范围
+    static void remapTexCoords(const AtlasRegion &region, SpriteVertex *vertices, int count);
+
+private:
+    static void blit(QImage &page, const QImage &image, const QPoint &position, int padding);
+    GLuint upload(const QImage &page);
+
+    int pageSize;
+    int padding;
+    int alignment;          // 格子对齐，<= padding 的最大的 2 的幂
+    int mipLevels;          // log2(alignment) + 1
+    std::vector<QImage> images;          // build() 之前攒着，build() 后释放
+    std::vector<AtlasRegion> regions;
+    std::vector<GLuint> pages;
+    std::vector<double> pageOccupancy;
+    GLStateCache *state;
+};
+
+#endif // TEXTUREATLAS_H
@@ -0,0 +1,366 @@
+#include "TextureContainer.h"
+#include <QFileInfo>
+#include <QtEndian>
+#include <cstring>
+
+// S3TC 不在核心规范里（GL_EXT_texture_compression_s3tc），桌面驱动都支持，有的头文件没定义
+#ifndef GL_COMPRESSED_RGB_S3TC_DXT1_EXT
+#define GL_COMPRESSED_RGB_S3TC_DXT1_EXT 0x83F0
+#define GL_COMPRESSED_RGBA_S3TC_DXT1_EXT 0x83F1
+#define GL_COMPRESSED_RGBA_S3TC_DXT3_EXT 0x83F2
+#define GL_COMPRESSED_RGBA_S3TC_DXT5_EXT 0x83F3
+#endif
+#ifndef GL_COMPRESSED_SRGB_S3TC_DXT1_EXT
+#define GL_COMPRESSED_SRGB_S3TC_DXT1_EXT 0x8C4C
+#define GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT1_EXT 0x8C4D
+#define GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT3_EXT 0x8C4E
+#define GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT 0x8C4F
+#endif
+
+namespace {
+
+quint32 u32(const uchar *p) { return qFromLittleEndian<quint32>(p); }
+quint64 u64(const uchar *p) { return qFromLittleEndian<quint64>(p); }
+
+// KTX2 文件头：12 字节标识 + 9 个 uint32 + 4 个 uint32 的索引 + 2 个 uint64，共 80 字节，后面是每层 24 字节的层级索引
+const uchar Ktx2Identifier[12] = {0xAB, 'K', 'T', 'X', ' ', '2', '0', 0xBB, '\r', '\n', 0x1A, '\n'};
+const qsizetype Ktx2HeaderSize = 80;
+const qsizetype Ktx2LevelIndexSize = 24;
+
+// DDS：4 字节 "DDS " + 124 字节 DDS_HEADER（+ 可选的 20 字节 DDS_HEADER_DXT10）
+const qsizetype DdsHeaderEnd = 4 + 124;
+const qsizetype DdsDx10HeaderSize = 20;
+const quint32 DdsFlagMipMapCount = 0x20000;   // DDSD_MIPMAPCOUNT
+const quint32 DdsPixelFourCC = 0x4;           // DDPF_FOURCC
+const quint32 DdsPixelRgb = 0x40;             // DDPF_RGB
+const quint32 DdsCaps2Cubemap = 0x200;
+const quint32 DdsCaps2Volume = 0x200000;
+
+// 比任何 GL 实现的 GL_MAX_TEXTURE_SIZE 都大；限制住以后 levelSize() 的乘法不会溢出
+const int MaxDimension = 1 << 16;
+
+// 完整 mip 链的层数（和 TextureManager::mipLevels 一样），文件里写的层数不能比它多，否则 width >> i 的移位超出范围
+int fullMipLevels(int width, int height)
+{
+    int levels = 1;
+    for (int size = qMax(width, height); size > 1; size >>= 1)
+        ++levels;
+    return levels;
+}
+
+constexpr quint32 fourCC(char a, char b, char c, char d)
+{
+    return quint32(uchar(a)) | (quint32(uchar(b)) << 8) | (quint32(uchar(c)) << 16) | (quint32(uchar(d)) << 24);
+}
+
+struct FormatMapping
+{
+    quint32 code;
+    TextureContainer::Format format;
+    bool srgb;
+};
+
+// KTX2 的 vkFormat（VkFormat 枚举值）
+const FormatMapping vkFormats[] = {
+    {37, TextureContainer::RGBA8, false},   // VK_FORMAT_R8G8B8A8_UNORM
+    {43, TextureContainer::RGBA8, true},    // VK_FORMAT_R8G8B8A8_SRGB
+    {44, TextureContainer::BGRA8, false},   // VK_FORMAT_B8G8R8A8_UNORM
+    {50, TextureContainer::BGRA8, true},    // VK_FORMAT_B8G8R8A8_SRGB
+    {131, TextureContainer::BC1, false},    // VK_FORMAT_BC1_RGB_UNORM_BLOCK
+    {132, TextureContainer::BC1, true},
+    {133, TextureContainer::BC1A, false},   // VK_FORMAT_BC1_RGBA_UNORM_BLOCK
+    {134, TextureContainer::BC1A, true},
+    {135, TextureContainer::BC2, false},
+    {136, TextureContainer::BC2, true},
+    {137, TextureContainer::BC3, false},
+    {138, TextureContainer::BC3, true},
+    {139, TextureContainer::BC4, false},    // VK_FORMAT_BC4_UNORM_BLOCK
+    {141, TextureContainer::BC5, false},    // VK_FORMAT_BC5_UNORM_BLOCK
+    {145, TextureContainer::BC7, false},    // VK_FORMAT_BC7_UNORM_BLOCK
+    {146, TextureContainer::BC7, true},
+};
+
+// DDS 扩展头里的 DXGI_FORMAT
+const FormatMapping dxgiFormats[] = {
+    {28, TextureContainer::RGBA8, false},   // DXGI_FORMAT_R8G8B8A8_UNORM
+    {29, TextureContainer::RGBA8, true},    // DXGI_FORMAT_R8G8B8A8_UNORM_SRGB
+    {87, TextureContainer::BGRA8, false},   // DXGI_FORMAT_B8G8R8A8_UNORM
+    {91, TextureContainer::BGRA8, true},
+    {71, TextureContainer::BC1A, false},    // DXGI_FORMAT_BC1_UNORM
+    {72, TextureContainer::BC1A, true},
+    {74, TextureContainer::BC2, false},
+    {75, TextureContainer::BC2, true},
+    {77, TextureContainer::BC3, false},
+    {78, TextureContainer::BC3, true},
+    {80, TextureContainer::BC4, false},     // DXGI_FORMAT_BC4_UNORM
+    {83, TextureContainer::BC5, false},     // DXGI_FORMAT_BC5_UNORM
+    {98, TextureContainer::BC7, false},     // DXGI_FORMAT_BC7_UNORM
+    {99, TextureContainer::BC7, true},
+};
+
+template <size_t N>
+bool lookup(const FormatMapping (&table)[N], quint32 code, TextureContainer::Format *format, bool *srgb)
+{
+    for (const FormatMapping &m : table) {
+        if (m.code == code) {
+            *format = m.format;
+            *srgb = m.srgb;
+            return true;
+        }
+    }
+    return false;
+}
+
+} // namespace
+
+TextureContainer::TextureContainer()
+    : mapped(nullptr), data(nullptr), dataSize(0), format(Invalid), srgb(false), generateMipmaps(false)
+{
+}
+
+TextureContainer::~TextureContainer()
+{
+    close();
+}
+
+bool TextureContainer::isContainerFile(const QString &path)
+{
+    const QString suffix = QFileInfo(path).suffix().toLower();
+    return suffix == "ktx2" || suffix == "dds";
+}
+
+QString TextureContainer::precompiledPath(const QString &path)
+{
+    if (isContainerFile(path))
+        return QString();
+    const QFileInfo info(path);
+    const QString base = info.path() + '/' + info.completeBaseName();
+    for (const char *suffix : {".ktx2", ".dds"}) {
+        if (QFile::exists(base + suffix))
+            return base + suffix;
+    }
+    return QString();
+}
+
+int TextureContainer::blockBytes(Format format)
+{
+    switch (format) {
+    case BC1:
+    case BC1A:
+    case BC4:
+        return 8;
+    case BC2:
+    case BC3:
+    case BC5:
+    case BC7:
+        return 16;
+    default:
+        return 0;
+    }
+}
+
+qsizetype TextureContainer::levelSize(Format format, int width, int height)
+{
+    const int block = blockBytes(format);
+    if (block > 0)
+        return qsizetype(qMax(1, (width + 3) / 4)) * qMax(1, (height + 3) / 4) * block;
+    return format == Invalid ? 0 : qsizetype(width) * height * 4;
+}
+
+GLenum TextureContainer::internalFormat() const
+{
+    switch (format) {
+    case RGBA8:
+    case BGRA8: return srgb ? GL_SRGB8_ALPHA8 : GL_RGBA8;
+    case BC1: return srgb ? GL_COMPRESSED_SRGB_S3TC_DXT1_EXT : GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+    case BC1A: return srgb ? GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT1_EXT : GL_COMPRESSED_RGBA_S3TC_DXT1_EXT;
+    case BC2: return srgb ? GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT3_EXT : GL_COMPRESSED_RGBA_S3TC_DXT3_EXT;
+    case BC3: return srgb ? GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT : GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+    case BC4: return GL_COMPRESSED_RED_RGTC1;
+    case BC5: return GL_COMPRESSED_RG_RGTC2;
+    case BC7: return srgb ? GL_COMPRESSED_SRGB_ALPHA_BPTC_UNORM : GL_COMPRESSED_RGBA_BPTC_UNORM;
+    default: return 0;
+    }
+}
+
+GLenum TextureContainer::uploadFormat() const
+{
+    return format == BGRA8 ? GL_BGRA : GL_RGBA;
+}
+
+void TextureContainer::close()
+{
+    if (mapped) {
+        file.unmap(mapped);
+        mapped = nullptr;
+    }
+    file.close();
+    fallback.clear();
+    data = nullptr;
+    dataSize = 0;
+    format = Invalid;
+    srgb = false;
+    generateMipmaps = false;
+    levels.clear();
+}
+
+bool TextureContainer::fail(const QString &message)
+{
+    error = message;
+    format = Invalid;
+    levels.clear();
+    return false;
+}
+
+bool TextureContainer::open(const QString &path)
+{
+    close();
+    file.setFileName(path);
+    if (!file.open(QIODevice::ReadOnly))
+        return fail(QString("cannot open %1: %2").arg(path, file.errorString()));
+
+    // 映射失败（资源文件里被 rcc 压缩过的条目）时退回到整个读进内存
+    mapped = file.map(0, file.size());
+    if (mapped)
+        return parse(mapped, file.size());
+    fallback = file.readAll();
+    return parse(reinterpret_cast<const uchar *>(fallback.constData()), fallback.size());
+}
+
+bool TextureContainer::parse(const uchar *bytes, qsizetype size)
+{
+    data = bytes;
+    dataSize = size;
+    levels.clear();
+    generateMipmaps = false;
+    if (size >= qsizetype(sizeof(Ktx2Identifier)) && std::memcmp(bytes, Ktx2Identifier, sizeof(Ktx2Identifier)) == 0)
+        return parseKtx2();
+    if (size >= 4 && u32(bytes) == fourCC('D', 'D', 'S', ' '))
+        return parseDds();
+    return fail("unknown container (expected KTX2 or DDS)");
+}
+
+bool TextureContainer::parseKtx2()
+{
+    if (dataSize < Ktx2HeaderSize)
+        return fail("truncated KTX2 header");
+
+    const quint32 vkFormat = u32(data + 12);
+    const int pixelWidth = int(u32(data + 20));
+    const int pixelHeight = int(u32(data + 24));
+    const quint32 pixelDepth = u32(data + 28);
+    const quint32 layerCount = u32(data + 32);
+    const quint32 faceCount = u32(data + 36);
+    const quint32 levelCount = u32(data + 40);
+    const quint32 supercompression = u32(data + 44);
+
+    if (!lookup(vkFormats, vkFormat, &format, &srgb))
+        return fail(QString("unsupported KTX2 vkFormat %1").arg(vkFormat));
+    if (pixelWidth <= 0 || pixelHeight <= 0 || pixelDepth > 0 || layerCount > 1 || faceCount != 1)
+        return fail("only single-layer 2D KTX2 textures are supported");
+    if (pixelWidth > MaxDimension || pixelHeight > MaxDimension)
+        return fail("KTX2 texture is too large");
+    if (supercompression != 0)
+        return fail("supercompressed KTX2 (BasisLZ/Zstd) is not supported");
+
+    // levelCount = 0 表示文件里只有第 0 层，要求加载方自己生成 mipmap（压缩格式 glGenerateMipmap 做不了，只用第 0 层）
+    const int count = int(qBound<quint32>(1, levelCount, quint32(fullMipLevels(pixelWidth, pixelHeight))));
+    generateMipmaps = levelCount == 0 && !isCompressed();
+    if (dataSize < Ktx2HeaderSize + count * Ktx2LevelIndexSize)
+        return fail("truncated KTX2 level index");
+
+    for (int i = 0; i < count; ++i) {
+        const uchar *entry = data + Ktx2HeaderSize + i * Ktx2LevelIndexSize;
+        const quint64 offset = u64(entry);
+        const quint64 length = u64(entry + 8);
+        Level level;
+        level.width = qMax(1, pixelWidth >> i);
+        level.height = qMax(1, pixelHeight >> i);
+        level.offset = qsizetype(offset);
+        level.size = levelSize(format, level.width, level.height);
+        // offset + length 可能回绕，分开比较
+        if (length < quint64(level.size) || offset > quint64(dataSize) || length > quint64(dataSize) - offset)
+            return fail(QString("KTX2 level %1 is out of range").arg(i));
+        levels.push_back(level);
+    }
+    return true;
+}
+
+bool TextureContainer::parseDds()
+{
+    if (dataSize < DdsHeaderEnd)
+        return fail("truncated DDS header");
+
+    const uchar *header = data + 4;
+    const quint32 flags = u32(header + 4);
+    const int height = int(u32(header + 8));
+    const int width = int(u32(header + 12));
+    const quint32 mipMapCount = u32(header + 24);
+    const quint32 pixelFlags = u32(header + 76);
+    const quint32 pixelFourCC = u32(header + 80);
+    const quint32 rgbBitCount = u32(header + 84);
+    const quint32 redMask = u32(header + 88);
+    const quint32 caps2 = u32(header + 108);
+
+    if (width <= 0 || height <= 0 || (caps2 & (DdsCaps2Cubemap | DdsCaps2Volume)))
+        return fail("only 2D DDS textures are supported");
+    if (width > MaxDimension || height > MaxDimension)
+        return fail("DDS texture is too large");
+
+    qsizetype offset = DdsHeaderEnd;
+    srgb = false;
+    if ((pixelFlags & DdsPixelFourCC) && pixelFourCC == fourCC('D', 'X', '1', '0')) {
+        if (dataSize < DdsHeaderEnd + DdsDx10HeaderSize)
+            return fail("truncated DDS DX10 header");
+        const quint32 dxgiFormat = u32(data + DdsHeaderEnd);
+        const quint32 dimension = u32(data + DdsHeaderEnd + 4);
+        const quint32 arraySize = u32(data + DdsHeaderEnd + 12);
+        if (!lookup(dxgiFormats, dxgiFormat, &format, &srgb))
+            return fail(QString("unsupported DXGI format %1").arg(dxgiFormat));
+        if (dimension != 3 || arraySize > 1)   // D3D10_RESOURCE_DIMENSION_TEXTURE2D
+            return fail("only single 2D DDS textures are supported");
+        offset += DdsDx10HeaderSize;
+    } else if (pixelFlags & DdsPixelFourCC) {
+        switch (pixelFourCC) {
+        case fourCC('D', 'X', 'T', '1'): format = BC1A; break;
+        case fourCC('D', 'X', 'T', '3'): format = BC2; break;
+        case fourCC('D', 'X', 'T', '5'): format = BC3; break;
+        case fourCC('A', 'T', 'I', '1'):
+        case fourCC('B', 'C', '4', 'U'): format = BC4; break;
+        case fourCC('A', 'T', 'I', '2'):
+        case fourCC('B', 'C', '5', 'U'): format = BC5; break;
+        default: return fail("unsupported DDS FourCC");
+        }
+    } else if ((pixelFlags & DdsPixelRgb) && rgbBitCount == 32) {
+        // 非压缩的 32 位像素：红色通道在最低字节是 RGBA，在第三个字节是 BGRA
+        if (redMask == 0x000000ffu)
+            format = RGBA8;
+        else if (redMask == 0x00ff0000u)
+            format = BGRA8;
+        else
+            return fail("unsupported DDS channel layout");
+    } else {
+        return fail("unsupported DDS pixel format");
+    }
+
+    const int count = (flags & DdsFlagMipMapCount)
+        ? int(qBound<quint32>(1, mipMapCount, quint32(fullMipLevels(width, height)))) : 1;
+    generateMipmaps = count == 1 && !isCompressed();
+    return addLevels(offset, width, height, count);
+}
+
+bool TextureContainer::addLevels(qsizetype offset, int width, int height, int count)
+{
+    for (int i = 0; i < count; ++i) {
+        Level level;
+        level.width = qMax(1, width >> i);
+        level.height = qMax(1, height >> i);
+        level.offset = offset;
+        level.size = levelSize(format, level.width, level.height);
+        if (level.size > dataSize - offset)
+            return fail(QString("DDS level %1 is out of range").arg(i));
+        levels.push_back(level);
+        offset += level.size;
+    }
+    return true;
+}
@@ -0,0 +1,91 @@
+#ifndef TEXTURECONTAINER_H
+#define TEXTURECONTAINER_H
+
+#include <qopengl.h>
+#include <QFile>
+#include <QByteArray>
+#include <QString>
+#include <vector>
+
+/* TextureContainer：KTX2 / DDS 纹理文件（预先算好所有 mip 层级，可以是 BCn 压缩格式）
+ *
+ * open() 把文件内存映射（QFile::map，资源文件里未压缩的条目也能映射），只解析文件头，
+ * levelData() 直接指向映射的内存：上传时 glCompressedTexSubImage2D/glTexSubImage2D 从这里读，
+ * 中间没有解码、格式转换和拷贝，也不用 glGenerateMipmap。
+ *
+ * 支持的格式（只支持单层、非立方体贴图、无超压缩的 2D 纹理）：
+ *   RGBA8 / BGRA8（含 sRGB）、BC1（DXT1）、BC2（DXT3）、BC3（DXT5）、BC4、BC5、BC7（含 sRGB）
+ */
+class TextureContainer
+{
+public:
+    enum Format
+    {
+        Invalid,
+        RGBA8,
+        BGRA8,
+        BC1,     // 不透明（RGB）
+        BC1A,    // 1 位透明
+        BC2,
+        BC3,
+        BC4,
+        BC5,
+        BC7
+    };
+
+    struct Level
+    {
+        qsizetype offset;   // 在文件里的字节偏移
+        qsizetype size;
+        int width;
+        int height;
+    };
+
+    TextureContainer();
+    ~TextureContainer();
+
+    static bool isContainerFile(const QString &path);     // 按扩展名（.ktx2 / .dds）
+    static QString precompiledPath(const QString &path);  // foo.png 旁边有 foo.ktx2 或 foo.dds 时返回它，否则返回空
+    static qsizetype levelSize(Format format, int width, int height);  // 一个 mip 层级的字节数
+    static int blockBytes(Format format);                 // 压缩格式一个 4x4 块的字节数，非压缩格式返回 0
+
+    bool open(const QString &path);                // 映射并解析，失败时 errorString() 说明原因
+    bool parse(const uchar *data, qsizetype size); // 解析一段已经在内存里的数据（调用方保证它一直有效）
+    void close();
+
+    bool isValid() const { return format != Invalid; }
+    bool isMapped() const { return mapped != nullptr; }
+    bool isCompressed() const { return blockBytes(format) > 0; }
+    bool needsS3tc() const { return format == BC1 || format == BC1A || format == BC2 || format == BC3; }  // 不在核心规范里的扩展
+    bool isSrgb() const { return srgb; }
+    Format pixelFormat() const { return format; }
+    int width() const { return levels.empty() ? 0 : levels[0].width; }
+    int height() const { return levels.empty() ? 0 : levels[0].height; }
+    int levelCount() const { return int(levels.size()); }
+    const Level &level(int i) const { return levels[size_t(i)]; }
+    const uchar *levelData(int i) const { return data + levels[size_t(i)].offset; }
+    bool needsMipmaps() const { return generateMipmaps; }  // 文件里只有第 0 层（KTX2 levelCount = 0）
+
+    GLenum internalFormat() const;      // glTexStorage2D / glCompressedTexSubImage2D 用
+    GLenum uploadFormat() const;        // 非压缩格式 glTexSubImage2D 的 format：GL_RGBA 或 GL_BGRA
+    QString errorString() const { return error; }
+
+private:
+    bool parseKtx2();
+    bool parseDds();
+    bool fail(const QString &message);
+    bool addLevels(qsizetype offset, int width, int height, int count);  // DDS：各层级从 offset 开始依次紧挨着存放
+
+    QFile file;
+    uchar *mapped;            // QFile::map 的结果，映射失败时为空，数据在 fallback 里
+    QByteArray fallback;      // 压缩过的资源条目等不能映射的情况，只好整个读进来
+    const uchar *data;
+    qsizetype dataSize;
+    Format format;
+    bool srgb;
+    bool generateMipmaps;
+    std::vector<Level> levels;
+    QString error;
+};
+
+#endif // TEXTURECONTAINER_H
@@ -0,0 +1,580 @@
+#include "TextureManager.h"
+#include <QElapsedTimer>
+#include <QMutexLocker>
+#include <QDebug>
+#include <cstring>
+#include <cmath>
+#include <algorithm>
+#include <vector>
+
+TextureManager::TextureManager()
+    : state(nullptr), uploadContext(nullptr), uploadSurface(nullptr), uploadThread(nullptr), placeholder(0), pending(0), budget(0),
+      residentBytes(0), streamingLoads(0), frame(1), evictionCount(0), streamInCount(0), stopping(false)
+{
+}
+
+TextureManager::~TextureManager()
+{
+    cleanup();
+}
+
+bool TextureManager::initialize(GLStateCache &stateCache, int decodeThreads)
+{
+    initializeOpenGLFunctions();
+    state = &stateCache;
+
+    QOpenGLContext *renderContext = QOpenGLContext::currentContext();
+    if (!renderContext) {
+        qWarning("TextureManager::initialize: no current OpenGL context");
+        return false;
+    }
+
+    // 占位纹理：真正的纹理传完之前，句柄的 id() 返回它
+    const GLubyte grey[4] = {128, 128, 128, 255};
+    glGenTextures(1, &placeholder);
+    glBindTexture(GL_TEXTURE_2D, placeholder);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, grey);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    // 上传线程用的共享上下文：和渲染上下文在同一个共享组里，它创建的纹理渲染上下文可以直接用
+    uploadSurface = new QOffscreenSurface();
+    uploadSurface->setFormat(renderContext->format());
+    uploadSurface->create();
+    uploadContext = new QOpenGLContext();
+    uploadContext->setFormat(renderContext->format());
+    uploadContext->setShareContext(renderContext);
+    if (!uploadContext->create()) {
+        qWarning("TextureManager::initialize: failed to create the shared upload context");
+        delete uploadContext;
+        uploadContext = nullptr;
+        return false;
+    }
+
+    stopping = false;
+    uploadThread = new TextureUploadThread(this);
+    uploadContext->moveToThread(uploadThread);  // 上下文只能在它所属的线程里 makeCurrent
+    uploadThread->start();
+
+    decodePool.setMaxThreadCount(decodeThreads > 0 ? decodeThreads : QThread::idealThreadCount());
+    return true;
+}
+
+void TextureManager::cleanup()
+{
+    if (!uploadThread && !placeholder)
+        return;
+
+    {
+        QMutexLocker locker(&queueMutex);
+        stopping = true;
+        queueNotEmpty.wakeAll();
+    }
+    decodePool.clear();        // 还没开始的解码任务直接丢掉
+    decodePool.waitForDone();
+    if (uploadThread) {
+        uploadThread->wait();
+        delete uploadThread;
+        uploadThread = nullptr;
+    }
+
+    // 传完但还没交接的纹理
+    for (const UploadedTexture &u : uploaded) {
+        if (u.fence)
+            glDeleteSync(u.fence);
+        if (u.texture)
+            glDeleteTextures(1, &u.texture);
+    }
+    uploaded.clear();
+    decoded.clear();
+
+    for (const QSharedPointer<TextureEntry> &entry : entries) {
+        if (entry->texture)
+            glDeleteTextures(1, &entry->texture);
+        entry->texture = 0;
+        entry->ready = false;
+    }
+    entries.clear();
+    pending = 0;
+    residentBytes = 0;
+    streamingLoads = 0;
+
+    if (placeholder) {
+        glDeleteTextures(1, &placeholder);
+        placeholder = 0;
+    }
+    delete uploadContext;  // 上传线程退出前已经把它移回了本线程
+    uploadContext = nullptr;
+    delete uploadSurface;
+    uploadSurface = nullptr;
+}
+
+TextureHandle TextureManager::load(const QString &path)
+{
+    TextureHandle handle;
+    handle.placeholder = placeholder;
+
+    QSharedPointer<TextureEntry> entry = entries.value(path);
+    if (!entry) {
+        entry.reset(new TextureEntry);
+        entry->path = path;
+        entries.insert(path, entry);
+        if (!uploadThread) {
+            // initialize() 失败（或者没调用）：没有上传线程，不能算进 pending，否则 waitForIdle() 永远等不到
+            entry->failed = true;
+            handle.d = entry;
+            return handle;
+        }
+        ++pending;
+        // 有预算时先只传小 mip，用到时再按屏幕大小补上
+        const int topLevel = budget > 0 ? int(LowResLevels) : 0;
+        decodePool.start([this, entry, topLevel] { decode(entry, topLevel); });
+    }
+    handle.d = entry;
+    return handle;
+}
+
+void TextureManager::decode(const QSharedPointer<TextureEntry> &entry, int topLevel)
+{
+    // 预先转换好的 KTX2/DDS：只映射文件、解析文件头，像素留在映射的内存里由上传线程直接读
+    const QString containerPath = TextureContainer::isContainerFile(entry->path)
+        ? entry->path : TextureContainer::precompiledPath(entry->path);
+    if (!containerPath.isEmpty()) {
+        QSharedPointer<TextureContainer> container(new TextureContainer);
+        if (container->open(containerPath)) {
+            const QSize size(container->width(), container->height());
+            if (topLevel == LowResLevels) {
+                TextureEntry probe;
+                probe.size = size;
+                probe.levels = container->needsMipmaps() ? mipLevels(size.width(), size.height()) : container->levelCount();
+                topLevel = lowResLevel(probe);
+            }
+            QMutexLocker locker(&queueMutex);
+            decoded.append({entry, QImage(), container, size, topLevel});
+            queueNotEmpty.wakeOne();
+            return;
+        }
+        qWarning() << "TextureManager:" << container->errorString();  // 容器文件不能用时退回到解码原图
+    }
+
+    // 加载纹理图像，并转换为 RGBA 格式（解码和格式转换都在工作线程里做，不占 GUI 线程）
+    QImage image(entry->path);
+    const QSize size = image.size();
+    if (!image.isNull()) {
+        image = image.convertToFormat(QImage::Format_RGBA8888);
+        if (topLevel == LowResLevels) {
+            TextureEntry probe;
+            probe.size = size;
+            probe.levels = mipLevels(size.width(), size.height());
+            topLevel = lowResLevel(probe);
+        }
+        // 只要 topLevel 以下的几层：在这里缩小成那一层的大小，上传线程照常生成更小的几层
+        if (topLevel > 0)
+            image = image.scaled(qMax(1, size.width() >> topLevel), qMax(1, size.height() >> topLevel),
+                                 Qt::IgnoreAspectRatio, Qt::SmoothTransformation);
+    } else {
+        qWarning() << "TextureManager: cannot decode" << entry->path;
+        topLevel = 0;
+    }
+
+    QMutexLocker locker(&queueMutex);
+    decoded.append({entry, image, QSharedPointer<TextureContainer>(), size, qMax(0, topLevel)});
+    queueNotEmpty.wakeOne();
+}
+
+int TextureManager::processUploads()
+{
+    QList<UploadedTexture> done;
+    {
+        QMutexLocker locker(&queueMutex);
+        done.swap(uploaded);
+    }
+    if (done.isEmpty())
+        return 0;
+
+    int readyCount = 0;
+    bool deleted = false;
+    QList<UploadedTexture> notYet;
+    for (const UploadedTexture &u : done) {
+        if (u.fence) {
+            // 只查询不等待：GPU 还没执行完上传就留到下一帧，渲染线程永远不会卡在这里
+            if (glClientWaitSync(u.fence, 0, 0) == GL_TIMEOUT_EXPIRED) {
+                notYet.append(u);
+                continue;
+            }
+            glDeleteSync(u.fence);
+        }
+        TextureEntry &entry = *u.entry;
+        if (entry.streaming) {
+            // 重新加载的更大 mip：换掉旧纹理（已经提交、还没执行的绘制里引用的旧纹理，驱动会等它们画完再删）
+            entry.streaming = false;
+            --streamingLoads;
+            if (u.texture) {
+                glDeleteTextures(1, &entry.texture);
+                residentBytes -= entry.bytes;
+                deleted = true;
+            } else {
+                entry.minLevel = entry.topLevel;  // 文件读不了了：留着现在的几层，以后不再请求更大的
+            }
+        }
+        if (u.texture || !entry.ready) {
+            entry.texture = u.texture;
+            entry.size = u.size;
+            entry.ready = u.texture != 0;
+            entry.failed = u.texture == 0;
+            entry.levels = u.levels;
+            entry.topLevel = u.topLevel;
+            entry.bytes = u.bytes;
+            entry.internalFormat = u.internalFormat;
+            entry.blockBytes = u.blockBytes;
+            residentBytes += u.bytes;
+        }
+        --pending;
+        ++readyCount;
+    }
+    if (deleted)
+        state->invalidate();  // 旧纹理可能还记在缓存里，新纹理又可能拿到同一个名字
+
+    if (!notYet.isEmpty()) {
+        QMutexLocker locker(&queueMutex);
+        notYet.append(uploaded);
+        uploaded.swap(notYet);
+    }
+    return readyCount;
+}
+
+bool TextureManager::waitForIdle(int timeoutMs)
+{
+    QElapsedTimer timer;
+    timer.start();
+    for (;;) {
+        processUploads();
+        if (pending == 0)
+            return true;
+        if (timeoutMs >= 0 && timer.elapsed() >= timeoutMs)
+            return false;
+        QThread::msleep(1);
+    }
+}
+
+void TextureManager::setMemoryBudget(qint64 bytes)
+{
+    budget = qMax<qint64>(0, bytes);
+}
+
+void TextureManager::requestSize(const TextureHandle &handle, const QSize &onScreen)
+{
+    if (!handle.d || onScreen.isEmpty())
+        return;
+    TextureEntry &entry = *handle.d;
+    // 第 L 层是原始大小的 1/2^L：两个方向都不小于屏幕上的像素数的最小一层
+    int level = 0;
+    if (entry.size.width() > 0 && entry.size.height() > 0) {
+        const double ratio = qMin(double(entry.size.width()) / onScreen.width(),
+                                  double(entry.size.height()) / onScreen.height());
+        if (ratio > 1.0)
+            level = qMin(int(std::floor(std::log2(ratio))), qMax(0, entry.levels - 1));
+    }
+    level = qMax(level, entry.minLevel);
+    if (entry.lastUsed != frame) {
+        entry.lastUsed = frame;
+        entry.wantedLevel = level;
+    } else {
+        entry.wantedLevel = qMin(entry.wantedLevel, level);  // 同一帧画了好几次，取最大的
+    }
+}
+
+int TextureManager::lowResLevel(const TextureEntry &entry)
+{
+    int level = 0;
+    while (level + 1 < entry.levels
+           && qMax(entry.size.width() >> level, entry.size.height() >> level) > int(LowResSize))
+        ++level;
+    return level;
+}
+
+void TextureManager::updateResidency()
+{
+    // 本帧用到的、显存里的 mip 不够大的：重新加载需要的那几层
+    for (const QSharedPointer<TextureEntry> &entry : entries) {
+        if (streamingLoads >= MaxStreamingLoads)
+            break;
+        if (entry->lastUsed != frame || !entry->ready || entry->streaming || entry->wantedLevel >= entry->topLevel)
+            continue;
+        int level = entry->wantedLevel;
+        if (budget > 0) {
+            // 先给它腾地方；腾不出来就退而求其次，传能放得下的最大一层
+            const int fullLevels = entry->levels;
+            auto chainBytes = [&](int top) {
+                qint64 bytes = 0;
+                for (int i = top; i < fullLevels; ++i)
+                    bytes += levelBytes(qMax(1, entry->size.width() >> i), qMax(1, entry->size.height() >> i),
+                                        entry->blockBytes);
+                return bytes;
+            };
+            if (residentBytes - entry->bytes + chainBytes(level) > budget)
+                enforceBudget(entry.data());
+            while (level < entry->topLevel && residentBytes - entry->bytes + chainBytes(level) > budget)
+                ++level;
+            if (level >= entry->topLevel)
+                continue;
+        }
+        stream(entry, level);
+    }
+
+    if (budget > 0 && residentBytes > budget)
+        enforceBudget(nullptr);
+    ++frame;
+}
+
+void TextureManager::stream(const QSharedPointer<TextureEntry> &entry, int topLevel)
+{
+    entry->streaming = true;
+    ++streamingLoads;
+    ++streamInCount;
+    ++pending;
+    decodePool.start([this, entry, topLevel] { decode(entry, topLevel); });
+}
+
+void TextureManager::enforceBudget(const TextureEntry *keep)
+{
+    // 最久没用过的排在前面。本帧用到的排在最后，只砍到屏幕上需要的那层
+    std::vector<TextureEntry *> candidates;
+    for (const QSharedPointer<TextureEntry> &entry : entries) {
+        if (entry.data() != keep && entry->ready && !entry->streaming)
+            candidates.push_back(entry.data());
+    }
+    std::sort(candidates.begin(), candidates.end(),
+              [](const TextureEntry *a, const TextureEntry *b) { return a->lastUsed < b->lastUsed; });
+
+    for (TextureEntry *entry : candidates) {
+        if (residentBytes <= budget)
+            break;
+        const int level = entry->lastUsed == frame ? entry->wantedLevel : lowResLevel(*entry);
+        if (level > entry->topLevel)
+            evict(*entry, level);
+    }
+}
+
+void TextureManager::evict(TextureEntry &entry, int topLevel)
+{
+    // 纹理是不可变存储（glTexStorage2D），不能只删掉大的几层：建一个小的新纹理，把要留的几层在 GPU 上拷过去。
+    // 用 DSA 创建和设置，不动任何绑定；但删掉的旧纹理可能还记在状态缓存里，最后要让它失效
+    const int levels = entry.levels - topLevel;
+    const int skip = topLevel - entry.topLevel;  // 旧纹理里要丢掉的层数
+    GLint width = 0, height = 0;
+    glGetTextureLevelParameteriv(entry.texture, skip, GL_TEXTURE_WIDTH, &width);
+    glGetTextureLevelParameteriv(entry.texture, skip, GL_TEXTURE_HEIGHT, &height);
+    if (levels <= 0 || width <= 0 || height <= 0)
+        return;
+
+    GLuint texture = 0;
+    glCreateTextures(GL_TEXTURE_2D, 1, &texture);
+    glTextureParameteri(texture, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTextureParameteri(texture, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    glTextureParameteri(texture, GL_TEXTURE_MIN_FILTER, levels > 1 ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+    glTextureParameteri(texture, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTextureStorage2D(texture, levels, entry.internalFormat, width, height);
+
+    qint64 bytes = 0;
+    for (int i = 0; i < levels; ++i) {
+        const int w = qMax(1, width >> i);
+        const int h = qMax(1, height >> i);
+        glCopyImageSubData(entry.texture, GL_TEXTURE_2D, skip + i, 0, 0, 0,
+                           texture, GL_TEXTURE_2D, i, 0, 0, 0, w, h, 1);
+        bytes += levelBytes(w, h, entry.blockBytes);
+    }
+    glDeleteTextures(1, &entry.texture);
+    state->invalidate();
+
+    residentBytes += bytes - entry.bytes;
+    entry.texture = texture;
+    entry.topLevel = topLevel;
+    entry.bytes = bytes;
+    ++evictionCount;
+}
+
+TextureManager::ResidencyStats TextureManager::residencyStats() const
+{
+    ResidencyStats stats;
+    for (const QSharedPointer<TextureEntry> &entry : entries) {
+        if (!entry->ready)
+            continue;
+        if (entry->topLevel == 0)
+            ++stats.resident;
+        else
+            ++stats.evicted;
+        if (entry->streaming)
+            ++stats.streaming;
+    }
+    stats.bytes = residentBytes;
+    stats.budget = budget;
+    stats.evictions = evictionCount;
+    stats.streamIns = streamInCount;
+    return stats;
+}
+
+qint64 TextureManager::levelBytes(int width, int height, int blockBytes)
+{
+    if (blockBytes > 0)
+        return qint64((width + 3) / 4) * ((height + 3) / 4) * blockBytes;
+    return qint64(width) * height * 4;
+}
+
+int TextureManager::mipLevels(int width, int height)
+{
+    return int(std::floor(std::log2(qMax(1, qMax(width, height))))) + 1;
+}
+
+TextureUploadThread::TextureUploadThread(TextureManager *manager)
+    : manager(manager), pbos{0, 0}, pboSize{0, 0}, nextPbo(0)
+{
+}
+
+void TextureUploadThread::run()
+{
+    QThread *ownerThread = manager->uploadSurface->thread();
+    manager->uploadContext->makeCurrent(manager->uploadSurface);
+    QOpenGLFunctions_4_5_Core f;
+    f.initializeOpenGLFunctions();
+    f.glGenBuffers(2, pbos);
+
+    for (;;) {
+        TextureManager::DecodedImage job;
+        {
+            QMutexLocker locker(&manager->queueMutex);
+            while (manager->decoded.isEmpty() && !manager->stopping)
+                manager->queueNotEmpty.wait(&manager->queueMutex);
+            if (manager->stopping)
+                break;
+            job = manager->decoded.takeFirst();
+        }
+
+        TextureManager::UploadedTexture result = {job.entry, 0, job.size, nullptr, 0, job.topLevel, 0, GL_RGBA8, 0};
+        if (job.container) {
+            result.texture = upload(&f, *job.container, job.topLevel, result);
+            job.container.reset();  // 上传调用返回时驱动已经把数据拷走了，可以解除映射
+        } else if (!job.image.isNull()) {
+            result.levels = TextureManager::mipLevels(job.size.width(), job.size.height());
+            result.texture = upload(&f, job.image, result);
+        }
+        if (result.texture) {
+            // fence 要先 glFlush 才能保证被提交，渲染上下文才有可能等到它
+            result.fence = f.glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+            f.glFlush();
+        }
+
+        QMutexLocker locker(&manager->queueMutex);
+        manager->uploaded.append(result);
+    }
+
+    f.glDeleteBuffers(2, pbos);
+    manager->uploadContext->doneCurrent();
+    manager->uploadContext->moveToThread(ownerThread);  // 交还给创建它的线程，由那边删除
+}
+
+GLuint TextureUploadThread::upload(QOpenGLFunctions_4_5_Core *f, const QImage &image,
+                                   TextureManager::UploadedTexture &result)
+{
+    const int width = image.width();
+    const int height = image.height();
+    const GLsizeiptr bytes = GLsizeiptr(image.sizeInBytes());  // RGBA8888 每行 4 字节对齐，没有填充
+
+    // 1. 像素拷进 PBO。GL_MAP_INVALIDATE_BUFFER_BIT 告诉驱动旧内容不要了，不必等上一次 DMA 读完
+    const int slot = nextPbo;
+    nextPbo = (nextPbo + 1) % 2;
+    f->glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pbos[slot]);
+    if (pboSize[slot] < bytes) {
+        f->glBufferData(GL_PIXEL_UNPACK_BUFFER, bytes, nullptr, GL_STREAM_DRAW);
+        pboSize[slot] = bytes;
+    }
+    void *dst = f->glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, bytes, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+    if (!dst) {
+        f->glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        return 0;
+    }
+    std::memcpy(dst, image.constBits(), size_t(bytes));
+    f->glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+
+    // 2. 创建纹理对象
+    // 核心模式下没有 glEnable(GL_TEXTURE_2D)（那是固定管线的开关，会产生 GL_INVALID_ENUM），纹理只靠绑定生效
+    GLuint texture = 0;
+    f->glGenTextures(1, &texture);
+    f->glBindTexture(GL_TEXTURE_2D, texture);  // GL_TEXTURE_2D表示正在使用二维纹理
+
+    // 设置纹理参数
+    f->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    f->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    // 缩小时在相邻两层 mip 之间三线性过滤；只用 GL_LINEAR 的话下面生成的 mip 根本不会被采样
+    const GLsizei levels = GLsizei(TextureManager::mipLevels(width, height));
+    f->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, levels > 1 ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+    f->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+    // 3. 将图像数据传递给纹理对象：PBO 绑定在 GL_PIXEL_UNPACK_BUFFER 上时，最后一个参数是 PBO 内的偏移而不是内存地址
+    // image 可能已经缩小成了第 topLevel 层，它下面的几层照样生成
+    f->glTexStorage2D(GL_TEXTURE_2D, levels, GL_RGBA8, width, height);
+    for (int i = 0; i < levels; ++i)
+        result.bytes += TextureManager::levelBytes(qMax(1, width >> i), qMax(1, height >> i), 0);
+    f->glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    f->glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    f->glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    f->glGenerateMipmap(GL_TEXTURE_2D);
+    f->glBindTexture(GL_TEXTURE_2D, 0);  // 解绑纹理
+    return texture;
+}
+
+GLuint TextureUploadThread::upload(QOpenGLFunctions_4_5_Core *f, const TextureContainer &container, int topLevel,
+                                   TextureManager::UploadedTexture &result)
+{
+    const GLenum internalFormat = container.internalFormat();
+    if (container.needsS3tc() && !QOpenGLContext::currentContext()->hasExtension("GL_EXT_texture_compression_s3tc")) {
+        qWarning("TextureManager: BC1-BC3 textures need GL_EXT_texture_compression_s3tc");
+        return 0;
+    }
+
+    // 数据指针指向映射的文件，不能有 PBO 绑定在 GL_PIXEL_UNPACK_BUFFER 上（否则会被当成 PBO 内的偏移）
+    f->glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+    GLuint texture = 0;
+    f->glGenTextures(1, &texture);
+    f->glBindTexture(GL_TEXTURE_2D, texture);
+    f->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    f->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+
+    // 文件里有几层就分配几层；只有第 0 层、又是非压缩格式时照旧分配完整的 mip 链再生成（这时没法只传小的几层）。
+    // topLevel > 0 时只分配、上传从 topLevel 开始的几层：直接从映射的文件里读，不用的大 mip 根本不碰
+    if (container.needsMipmaps())
+        topLevel = 0;
+    topLevel = qBound(0, topLevel, container.levelCount() - 1);
+    const TextureContainer::Level &top = container.level(topLevel);
+    const int fullLevels = container.needsMipmaps()
+        ? TextureManager::mipLevels(container.width(), container.height()) : container.levelCount();
+    const GLsizei levels = GLsizei(fullLevels - topLevel);
+    f->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, levels > 1 ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+    f->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    f->glTexStorage2D(GL_TEXTURE_2D, levels, internalFormat, top.width, top.height);
+    result.levels = fullLevels;
+    result.topLevel = topLevel;
+    result.internalFormat = internalFormat;
+    result.blockBytes = container.isCompressed() ? TextureContainer::blockBytes(container.pixelFormat()) : 0;
+    for (int i = 0; i < levels; ++i)
+        result.bytes += TextureManager::levelBytes(qMax(1, top.width >> i), qMax(1, top.height >> i), result.blockBytes);
+
+    f->glPixelStorei(GL_UNPACK_ALIGNMENT, 1);  // KTX2/DDS 的行是紧挨着的，没有 4 字节对齐的填充
+    for (int i = topLevel; i < container.levelCount(); ++i) {
+        const TextureContainer::Level &level = container.level(i);
+        if (container.isCompressed())
+            f->glCompressedTexSubImage2D(GL_TEXTURE_2D, i - topLevel, 0, 0, level.width, level.height, internalFormat,
+                                         GLsizei(level.size), container.levelData(i));
+        else
+            f->glTexSubImage2D(GL_TEXTURE_2D, i - topLevel, 0, 0, level.width, level.height, container.uploadFormat(),
+                               GL_UNSIGNED_BYTE, container.levelData(i));
+    }
+    f->glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+    if (container.needsMipmaps())
+        f->glGenerateMipmap(GL_TEXTURE_2D);
+    f->glBindTexture(GL_TEXTURE_2D, 0);
+    return texture;
+}
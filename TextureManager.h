@@ -0,0 +1,200 @@
+#ifndef TEXTUREMANAGER_H
+#define TEXTUREMANAGER_H
+
+#include <QOpenGLContext>
+#include <QOffscreenSurface>
+#include <QSharedPointer>
+#include <QThread>
+#include <QThreadPool>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QImage>
+#include <QHash>
+#include <QList>
+#include <QSize>
+#include "GLTraceFunctions.h"
+#include "GLStateCache.h"
+#include "TextureContainer.h"
+
+// 一张纹理的状态，只在渲染线程（processUploads()）里从 "未就绪" 变成 "就绪"，下面的驻留信息也只在渲染线程里改
+struct TextureEntry
+{
+    QString path;
+    GLuint texture = 0;
+    QSize size;              // 原始大小（完整 mip 链第 0 层），和显存里实际留了几层无关
+    bool ready = false;
+    bool failed = false;
+
+    int levels = 0;          // 完整 mip 链的层数
+    int topLevel = 0;        // 显存里最大的那层是完整 mip 链的第几层（0 = 原始大小），下面各层都在
+    qint64 bytes = 0;        // 显存里这几层的字节数
+    GLenum internalFormat = GL_RGBA8;
+    int blockBytes = 0;      // 压缩格式一个 4x4 块的字节数，非压缩（RGBA8/BGRA8）为 0
+    quint64 lastUsed = 0;    // 最近一次 requestSize() 的帧号
+    int wantedLevel = 0;     // 那一帧屏幕上需要的最大一层
+    bool streaming = false;  // 正在后台重新加载（换成更大的 mip）
+    int minLevel = 0;        // 重新加载失败过：不再要比这层更大的 mip，免得每帧重试
+};
+
+/* TextureHandle：load() 立刻返回的句柄
+ * 纹理还没传完时 id() 返回占位纹理（1x1 灰色），传完以后返回真正的纹理，
+ * 所以调用方每帧直接用 handle.id() 提交绘制即可，不需要关心加载进度。
+ */
+class TextureHandle
+{
+public:
+    TextureHandle() = default;
+
+    GLuint id() const { return d && d->ready ? d->texture : placeholder; }
+    bool isReady() const { return d && d->ready; }
+    bool isFailed() const { return d && d->failed; }
+    bool isNull() const { return !d; }
+    QSize size() const { return d ? d->size : QSize(); }
+
+private:
+    friend class TextureManager;
+    QSharedPointer<TextureEntry> d;
+    GLuint placeholder = 0;
+};
+
+class TextureUploadThread;
+
+/* TextureManager：异步、多线程的纹理加载
+ *
+ * 流水线分三段，GUI/渲染线程全程不阻塞：
+ *   1. 解码：QThreadPool 的工作线程里 QImage 读文件并转成 RGBA8888。
+ *      KTX2/DDS 文件（或者 foo.png 旁边有 texconv 生成的 foo.ktx2/foo.dds）不解码，
+ *      只内存映射并解析文件头（TextureContainer）
+ *   2. 上传：专门的上传线程持有一个和渲染上下文共享的 QOpenGLContext，
+ *      把像素写进像素缓冲对象（PBO），再从 PBO 执行 glTexSubImage2D（DMA 拷贝，不占 CPU），
+ *      生成 mipmap 后插入 fence。KTX2/DDS 直接从映射的内存逐层上传预先算好的 mip（BCn 用 glCompressedTexSubImage2D）
+ *   3. 交接：渲染线程每帧调用 processUploads()，fence 已经触发的纹理才换到句柄上
+ *
+ * initialize() 要在渲染上下文是当前上下文、并且在 GUI 线程里调用（QOffscreenSurface 只能在 GUI 线程创建）。
+ * 换掉、淘汰纹理时删掉的旧纹理可能还绑在某个单元上，之后都会让 state 失效。
+ */
+class TextureManager : protected GLTraceFunctions
+{
+public:
+    TextureManager();
+    ~TextureManager();
+
+    bool initialize(GLStateCache &state, int decodeThreads = 0);  // 0 = QThread::idealThreadCount()
+    void cleanup();                          // 停止线程并删除所有纹理，渲染上下文必须是当前上下文
+
+    TextureHandle load(const QString &path); // 同一路径只加载一次；initialize() 失败时句柄直接是 failed
+    int processUploads();                    // 每帧在渲染线程调用，返回本次就绪的纹理个数
+    bool waitForIdle(int timeoutMs = -1);    // 阻塞到所有请求都就绪（基准测试、截图用）
+    int pendingCount() const { return pending; }
+    GLuint placeholderTexture() const { return placeholder; }
+
+    /* 驻留管理：所有纹理合计的显存不超过预算
+     *
+     * 每帧画纹理时用 requestSize() 告诉它这张纹理在屏幕上最大有多少像素，updateResidency() 每帧最后调用一次：
+     *   - 屏幕上需要的 mip 比显存里的大：按需要的那层在后台重新加载（KTX2/DDS 只读那几层，PNG 等要重新解码、缩小），
+     *     传完以后句柄自动换成新纹理。同时最多 MaxStreamingLoads 张在路上
+     *   - 超出预算：最久没用过的先淘汰，只留不超过 LowResSize 的几层小 mip（GPU 上拷贝到新纹理，不经过 CPU）；
+     *     还不够时本帧用到的纹理也砍到屏幕需要的那层
+     * 有预算时新加载的纹理先只传小 mip，第一次用到时再按屏幕大小补上。
+     * 预算为 0（默认）时不限制：纹理照旧整个传上去、不淘汰。句柄的 size() 一直是原始大小 */
+    struct ResidencyStats
+    {
+        int resident = 0;          // 整个 mip 链都在显存里的纹理
+        int evicted = 0;           // 只留了较小几层的纹理（淘汰了，或者屏幕上用不到原始大小）
+        int streaming = 0;         // 正在重新加载的
+        qint64 bytes = 0;          // 所有就绪纹理占的显存
+        qint64 budget = 0;
+        quint64 evictions = 0;     // 累计淘汰次数
+        quint64 streamIns = 0;     // 累计重新加载次数
+    };
+
+    enum { LowResSize = 64, MaxStreamingLoads = 4 };
+
+    void setMemoryBudget(qint64 bytes);       // 0 = 不限制
+    qint64 memoryBudget() const { return budget; }
+    void requestSize(const TextureHandle &handle, const QSize &onScreen);  // 本帧要画它，最大 onScreen 像素
+    void updateResidency();                   // 每帧最后在渲染线程调用：按需重新加载、超出预算时淘汰
+    ResidencyStats residencyStats() const;
+
+    static qint64 levelBytes(int width, int height, int blockBytes);
+    static int mipLevels(int width, int height);   // 完整 mip 链的层数
+
+private:
+    friend class TextureUploadThread;
+
+    // 解码完成、等待上传的图像；container 不为空时是映射好的 KTX2/DDS，image 为空
+    // topLevel > 0 时只传完整 mip 链从 topLevel 开始的几层，image 已经缩小成那一层的大小
+    struct DecodedImage
+    {
+        QSharedPointer<TextureEntry> entry;
+        QImage image;
+        QSharedPointer<TextureContainer> container;
+        QSize size;          // 原始大小
+        int topLevel;
+    };
+    // 上传完成、等待 fence 的纹理
+    struct UploadedTexture
+    {
+        QSharedPointer<TextureEntry> entry;
+        GLuint texture;
+        QSize size;
+        GLsync fence;
+        int levels;          // 完整 mip 链的层数
+        int topLevel;
+        qint64 bytes;
+        GLenum internalFormat;
+        int blockBytes;
+    };
+
+    enum { LowResLevels = -1 };   // decode() 的 topLevel：读到大小以后再定，只留不超过 LowResSize 的几层
+
+    void decode(const QSharedPointer<TextureEntry> &entry, int topLevel);  // 工作线程里执行
+    static int lowResLevel(const TextureEntry &entry);   // 只留不超过 LowResSize 的几层时的 topLevel
+    void stream(const QSharedPointer<TextureEntry> &entry, int topLevel);  // 按 topLevel 重新加载
+    void evict(TextureEntry &entry, int topLevel);   // 只留 topLevel 以下的几层
+    void enforceBudget(const TextureEntry *keep);     // 淘汰到不超过预算，keep 不动
+
+    GLStateCache *state;
+    QOpenGLContext *uploadContext;
+    QOffscreenSurface *uploadSurface;
+    TextureUploadThread *uploadThread;
+    QThreadPool decodePool;
+    GLuint placeholder;
+    QHash<QString, QSharedPointer<TextureEntry>> entries;
+    int pending;  // 已请求但还没就绪的个数（包括重新加载），只在渲染线程读写
+    qint64 budget;
+    qint64 residentBytes;
+    int streamingLoads;
+    quint64 frame;
+    quint64 evictionCount;
+    quint64 streamInCount;
+
+    QMutex queueMutex;                 // 保护 decoded/uploaded 两个队列和 stopping
+    QWaitCondition queueNotEmpty;
+    QList<DecodedImage> decoded;
+    QList<UploadedTexture> uploaded;
+    bool stopping;
+};
+
+/* 上传线程：在共享上下文里把解码好的图像通过 PBO 传成纹理 */
+class TextureUploadThread : public QThread
+{
+public:
+    explicit TextureUploadThread(TextureManager *manager);
+
+protected:
+    void run() override;
+
+private:
+    // 都把实际传上去的层数、字节数和格式填进 result
+    GLuint upload(QOpenGLFunctions_4_5_Core *f, const QImage &image, TextureManager::UploadedTexture &result);
+    GLuint upload(QOpenGLFunctions_4_5_Core *f, const TextureContainer &container, int topLevel,
+                  TextureManager::UploadedTexture &result);
+
+    TextureManager *manager;
+    GLuint pbos[2];         // 两个 PBO 轮流用：一个在做 DMA 时往另一个里拷下一张图
+    GLsizeiptr pboSize[2];
+    int nextPbo;
+};
+
+#endif // TEXTUREMANAGER_H
@@ -0,0 +1,335 @@
+#include "VertexFormat.h"
+#include <QFloat16>
+#include <QStringList>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace {
+
+// 一种 (语义, 编码) 在 GL 里的样子
+struct GLLayout
+{
+    GLint components;
+    GLenum type;
+    GLboolean normalized;
+    int size;   // 字节数
+};
+
+bool glLayout(VertexFormat::Semantic semantic, VertexFormat::Encoding encoding, GLLayout *layout)
+{
+    switch (semantic) {
+    case VertexFormat::Position:
+        // 16 位的位置补成 4 个分量：3 个分量是 6 字节，GPU 取不对齐 4 字节的属性会慢
+        if (encoding == VertexFormat::Float32)
+            *layout = {3, GL_FLOAT, GL_FALSE, 12};
+        else if (encoding == VertexFormat::Float16)
+            *layout = {4, GL_HALF_FLOAT, GL_FALSE, 8};
+        else if (encoding == VertexFormat::Snorm16)
+            *layout = {4, GL_SHORT, GL_TRUE, 8};
+        else
+            return false;
+        return true;
+    case VertexFormat::Normal:
+        if (encoding == VertexFormat::Float32)
+            *layout = {3, GL_FLOAT, GL_FALSE, 12};
+        else if (encoding == VertexFormat::Snorm10_10_10_2)
+            *layout = {4, GL_INT_2_10_10_10_REV, GL_TRUE, 4};
+        else
+            return false;
+        return true;
+    case VertexFormat::TexCoord:
+        if (encoding == VertexFormat::Float32)
+            *layout = {2, GL_FLOAT, GL_FALSE, 8};
+        else if (encoding == VertexFormat::Float16)
+            *layout = {2, GL_HALF_FLOAT, GL_FALSE, 4};
+        else if (encoding == VertexFormat::Unorm16)
+            *layout = {2, GL_UNSIGNED_SHORT, GL_TRUE, 4};
+        else
+            return false;
+        return true;
+    case VertexFormat::Color:
+        if (encoding != VertexFormat::Unorm8)
+            return false;
+        *layout = {4, GL_UNSIGNED_BYTE, GL_TRUE, 4};
+        return true;
+    }
+    return false;
+}
+
+const char *semanticName(VertexFormat::Semantic semantic)
+{
+    switch (semantic) {
+    case VertexFormat::Position:
+        return "pos";
+    case VertexFormat::Normal:
+        return "normal";
+    case VertexFormat::TexCoord:
+        return "uv";
+    default:
+        return "color";
+    }
+}
+
+const char *encodingName(VertexFormat::Encoding encoding)
+{
+    switch (encoding) {
+    case VertexFormat::Float32:
+        return "f32";
+    case VertexFormat::Float16:
+        return "f16";
+    case VertexFormat::Snorm16:
+        return "snorm16";
+    case VertexFormat::Unorm16:
+        return "unorm16";
+    case VertexFormat::Unorm8:
+        return "unorm8";
+    default:
+        return "snorm10_10_10_2";
+    }
+}
+
+// GL 4.2 起有符号归一化整数还原成 max(c / (2^(b-1) - 1), -1)，编码用同一个比例，0 和 ±1 都是精确的
+qint16 toSnorm16(float v)
+{
+    return qint16(std::lround(std::clamp(v, -1.0f, 1.0f) * 32767.0f));
+}
+
+quint16 toUnorm16(float v)
+{
+    return quint16(std::lround(std::clamp(v, 0.0f, 1.0f) * 65535.0f));
+}
+
+quint32 toSnorm10(float v)
+{
+    return quint32(std::lround(std::clamp(v, -1.0f, 1.0f) * 511.0f)) & 0x3ffu;
+}
+
+void put(char *dst, const void *src, size_t size)
+{
+    std::memcpy(dst, src, size);
+}
+
+} // namespace
+
+VertexFormat::VertexFormat()
+    : vertexSize(0), scale(1.0f, 1.0f, 1.0f), offset(0.0f, 0.0f, 0.0f)
+{
+}
+
+bool VertexFormat::add(Semantic semantic, Encoding encoding)
+{
+    GLLayout layout;
+    if (find(semantic) || !glLayout(semantic, encoding, &layout))
+        return false;
+    attributeList.push_back({semantic, encoding, vertexSize, layout.size});
+    vertexSize += layout.size;
+    return true;
+}
+
+VertexFormat VertexFormat::full(bool normals)
+{
+    VertexFormat format;
+    format.add(Position, Float32);
+    if (normals)
+        format.add(Normal, Float32);
+    format.add(TexCoord, Float32);
+    format.add(Color, Unorm8);
+    return format;
+}
+
+VertexFormat VertexFormat::compact(Encoding positionEncoding, bool normals)
+{
+    VertexFormat format;
+    if (!format.add(Position, positionEncoding))
+        format.add(Position, Snorm16);
+    if (normals)
+        format.add(Normal, Snorm10_10_10_2);
+    format.add(TexCoord, Unorm16);
+    format.add(Color, Unorm8);
+    return format;
+}
+
+bool VertexFormat::fromName(const QString &name, VertexFormat *format, bool normals)
+{
+    if (name == "full")
+        *format = full(normals);
+    else if (name == "half")
+        *format = compact(Float16, normals);
+    else if (name == "snorm16")
+        *format = compact(Snorm16, normals);
+    else
+        return false;
+    return true;
+}
+
+const VertexFormat::Attribute *VertexFormat::find(Semantic semantic) const
+{
+    for (const Attribute &attribute : attributeList) {
+        if (attribute.semantic == semantic)
+            return &attribute;
+    }
+    return nullptr;
+}
+
+QString VertexFormat::description() const
+{
+    QStringList parts;
+    for (const Attribute &attribute : attributeList)
+        parts << QString("%1:%2").arg(semanticName(attribute.semantic), encodingName(attribute.encoding));
+    return QString("%1 (%2 B)").arg(parts.join(' ')).arg(vertexSize);
+}
+
+GLuint VertexFormat::location(Semantic semantic)
+{
+    switch (semantic) {
+    case Position:
+        return 0;
+    case TexCoord:
+        return 1;
+    case Color:
+        return 2;
+    default:
+        return 9;
+    }
+}
+
+QByteArray VertexFormat::encode(const MeshVertex *vertices, int count)
+{
+    scale = QVector3D(1.0f, 1.0f, 1.0f);
+    offset = QVector3D(0.0f, 0.0f, 0.0f);
+    const Attribute *position = find(Position);
+    if (position && position->encoding == Snorm16 && count > 0) {
+        // 包围盒的中心和半边长：存的是 (p - 中心) / 半边长，正好落在 [-1, 1]
+        float lo[3], hi[3];
+        for (int k = 0; k < 3; ++k)
+            lo[k] = hi[k] = vertices[0].position[k];
+        for (int i = 1; i < count; ++i) {
+            for (int k = 0; k < 3; ++k) {
+                lo[k] = std::min(lo[k], vertices[i].position[k]);
+                hi[k] = std::max(hi[k], vertices[i].position[k]);
+            }
+        }
+        for (int k = 0; k < 3; ++k) {
+            const float half = 0.5f * (hi[k] - lo[k]);
+            scale[k] = half > 0.0f ? half : 1.0f;   // 这个方向是平的（比如 z 全是 0）：存 0，还原也是 0
+            offset[k] = 0.5f * (hi[k] + lo[k]);
+        }
+    }
+
+    QByteArray data(qsizetype(count) * vertexSize, Qt::Uninitialized);
+    char *out = data.data();
+    for (int i = 0; i < count; ++i) {
+        const MeshVertex &v = vertices[i];
+        for (const Attribute &attribute : attributeList) {
+            char *dst = out + attribute.offset;
+            switch (attribute.semantic) {
+            case Position:
+                if (attribute.encoding == Float32) {
+                    put(dst, v.position, 12);
+                } else if (attribute.encoding == Float16) {
+                    const qfloat16 h[4] = {qfloat16(v.position[0]), qfloat16(v.position[1]), qfloat16(v.position[2]),
+                                           qfloat16(1.0f)};
+                    put(dst, h, 8);
+                } else {
+                    qint16 s[4];
+                    for (int k = 0; k < 3; ++k)
+                        s[k] = toSnorm16((v.position[k] - offset[k]) / scale[k]);
+                    s[3] = 32767;
+                    put(dst, s, 8);
+                }
+                break;
+            case Normal:
+                if (attribute.encoding == Float32) {
+                    put(dst, v.normal, 12);
+                } else {
+                    // GL_INT_2_10_10_10_REV：x 在最低 10 位，依次往上是 y、z，最高 2 位是 w
+                    const quint32 packed = toSnorm10(v.normal[0]) | (toSnorm10(v.normal[1]) << 10)
+                                           | (toSnorm10(v.normal[2]) << 20) | (1u << 30);
+                    put(dst, &packed, 4);
+                }
+                break;
+            case TexCoord:
+                if (attribute.encoding == Float32) {
+                    put(dst, v.texCoord, 8);
+                } else if (attribute.encoding == Float16) {
+                    const qfloat16 h[2] = {qfloat16(v.texCoord[0]), qfloat16(v.texCoord[1])};
+                    put(dst, h, 4);
+                } else {
+                    const quint16 u[2] = {toUnorm16(v.texCoord[0]), toUnorm16(v.texCoord[1])};
+                    put(dst, u, 4);
+                }
+                break;
+            case Color:
+                put(dst, v.color, 4);
+                break;
+            }
+        }
+        out += vertexSize;
+    }
+    return data;
+}
+
+void VertexFormat::setupAttributes(GLTraceFunctions *gl, GLintptr bufferOffset) const
+{
+    for (const Attribute &attribute : attributeList) {
+        GLLayout layout;
+        glLayout(attribute.semantic, attribute.encoding, &layout);
+        const GLuint index = location(attribute.semantic);
+        gl->glVertexAttribPointer(index, layout.components, layout.type, layout.normalized, vertexSize,
+                                  reinterpret_cast<const void *>(bufferOffset + attribute.offset));
+        gl->glEnableVertexAttribArray(index);
+    }
+}
+
+QByteArray VertexFormat::shaderInputs() const
+{
+    // 属性都声明成 vec4/vec2：分量不够时 GL 补 (0, 0, 0, 1)，归一化整数 GL 已经转成浮点，着色器里不用区分
+    QByteArray declarations, body;
+    for (const Attribute &attribute : attributeList) {
+        const QByteArray location = QByteArray::number(VertexFormat::location(attribute.semantic));
+        switch (attribute.semantic) {
+        case Position:
+            declarations += "layout(location = " + location + ") in vec4 vertexPosition;\n";
+            if (attribute.encoding == Snorm16) {
+                declarations += "uniform vec3 positionScale;\nuniform vec3 positionOffset;\n";
+                body += "    position = vertexPosition.xyz * positionScale + positionOffset;\n";
+            } else {
+                body += "    position = vertexPosition.xyz;\n";
+            }
+            break;
+        case Normal:
+            declarations += "layout(location = " + location + ") in vec4 vertexNormal;\n";
+            body += "    normal = vertexNormal.xyz;\n";
+            break;
+        case TexCoord:
+            declarations += "layout(location = " + location + ") in vec2 vertexTexCoord;\n";
+            body += "    texCoord = vertexTexCoord;\n";
+            break;
+        case Color:
+            declarations += "layout(location = " + location + ") in vec4 vertexColor;\n";
+            body += "    color = vertexColor;\n";
+            break;
+        }
+    }
+    if (!find(Position))
+        body += "    position = vec3(0.0);\n";
+    if (!find(Normal))
+        body += "    normal = vec3(0.0, 0.0, 1.0);\n";
+    if (!find(TexCoord))
+        body += "    texCoord = vec2(0.0);\n";
+    if (!find(Color))
+        body += "    color = vec4(1.0);\n";
+
+    return declarations + "vec3 position;\nvec3 normal;\nvec2 texCoord;\nvec4 color;\n\nvoid loadVertex() {\n"
+           + body + "}\n";
+}
+
+void VertexFormat::setUniforms(QOpenGLShaderProgram *program) const
+{
+    const Attribute *position = find(Position);
+    if (position && position->encoding == Snorm16) {
+        program->setUniformValue("positionScale", scale);
+        program->setUniformValue("positionOffset", offset);
+    }
+}
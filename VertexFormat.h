@@ -0,0 +1,103 @@
+#ifndef VERTEXFORMAT_H
+#define VERTEXFORMAT_H
+
+#include <QOpenGLShaderProgram>
+#include <QByteArray>
+#include <QVector3D>
+#include <vector>
+#include "GLTraceFunctions.h"
+
+// 网格顶点的全精度数据（导入、生成网格时用），上传前由 VertexFormat::encode() 编码成紧凑格式
+struct MeshVertex
+{
+    GLfloat position[3];
+    GLfloat normal[3];      // 单位向量
+    GLfloat texCoord[2];
+    GLubyte color[4];       // RGBA8
+};
+
+/* VertexFormat：声明式的顶点格式
+ *
+ * 每个属性写明 "是什么"（语义）和 "怎么存"（编码），其余的都由它生成，三处始终一致：
+ *   - encode()：把 MeshVertex 数组按格式打包成上传用的字节
+ *   - setupAttributes()：给当前绑定的 VAO + VBO 设置 glVertexAttribPointer（类型、是否归一化、偏移、步长）
+ *   - shaderInputs()：顶点着色器的 in 声明 + loadVertex()，着色器里调用 loadVertex() 以后
+ *     直接用全局变量 position/normal/texCoord/color，不用管它们在缓冲里是怎么存的
+ *
+ * 可选的编码：
+ *   - 位置：Float32（12 字节）、Float16（8 字节，补一个分量对齐 4 字节）、
+ *          Snorm16（8 字节，按网格包围盒量化到 [-1, 1]，着色器里用 positionScale/positionOffset 还原）
+ *   - 法线：Float32（12 字节）、Snorm10_10_10_2（4 字节，GL_INT_2_10_10_10_REV）
+ *   - 纹理坐标：Float32（8 字节）、Unorm16（4 字节，只能表示 [0, 1]，超出的会被截断，重复贴图的网格不要用）
+ *   - 颜色：Unorm8（4 字节）
+ * 带法线的网格 full() 是 36 字节，compact() 是 20 字节；不带法线 24 -> 16 字节。
+ *
+ * 属性位置：0 位置、1 纹理坐标、2 颜色（和 SpriteBatch 相同），法线是 9（3-8 是 InstancedMesh 的实例数据）。
+ * 格式里没有的属性 loadVertex() 给默认值：法线 (0, 0, 1)，纹理坐标 (0, 0)，颜色白色。
+ */
+class VertexFormat
+{
+public:
+    enum Semantic
+    {
+        Position,
+        Normal,
+        TexCoord,
+        Color
+    };
+
+    enum Encoding
+    {
+        Float32,
+        Float16,
+        Snorm16,
+        Unorm16,
+        Unorm8,
+        Snorm10_10_10_2
+    };
+
+    struct Attribute
+    {
+        Semantic semantic;
+        Encoding encoding;
+        int offset;     // 在一个顶点里的字节偏移
+        int size;       // 字节数（已经对齐到 4）
+    };
+
+    VertexFormat();
+
+    // 按添加顺序排在顶点里；同一语义只能出现一次，编码不适用于这个语义时返回 false
+    bool add(Semantic semantic, Encoding encoding);
+
+    static VertexFormat full(bool normals = true);   // 全部 Float32（颜色 Unorm8），和原来的 SpriteVertex 一致
+    // 紧凑格式：位置 Float16 或 Snorm16、法线 10_10_10_2、纹理坐标 Unorm16、颜色 Unorm8
+    static VertexFormat compact(Encoding positionEncoding = Snorm16, bool normals = true);
+    // "full"、"half"、"snorm16"（命令行用），不认识的返回 false
+    static bool fromName(const QString &name, VertexFormat *format, bool normals = true);
+
+    int stride() const { return vertexSize; }
+    const std::vector<Attribute> &attributes() const { return attributeList; }
+    const Attribute *find(Semantic semantic) const;
+    QString description() const;   // 比如 "pos:snorm16 uv:unorm16 color:unorm8 (16 B)"
+
+    static GLuint location(Semantic semantic);
+
+    /* 按格式打包 count 个顶点。位置是 Snorm16 时先用这批顶点的包围盒确定量化范围
+     * （之后 setUniforms() 传给着色器），所以同一个 VertexFormat 对象只对应一个网格 */
+    QByteArray encode(const MeshVertex *vertices, int count);
+    QVector3D positionScale() const { return scale; }
+    QVector3D positionOffset() const { return offset; }
+
+    // VAO 和存这种格式顶点的 VBO 必须都已经绑定；bufferOffset 是第一个顶点在 VBO 里的字节偏移
+    void setupAttributes(GLTraceFunctions *gl, GLintptr bufferOffset = 0) const;
+    QByteArray shaderInputs() const;                           // 插在 #version 后面
+    void setUniforms(QOpenGLShaderProgram *program) const;     // 程序必须已经绑定
+
+private:
+    std::vector<Attribute> attributeList;
+    int vertexSize;
+    QVector3D scale;    // 位置还原：position = stored * scale + offset（Snorm16 时才不是 (1,1,1)/(0,0,0)）
+    QVector3D offset;
+};
+
+#endif // VERTEXFORMAT_H
@@ -0,0 +1,81 @@
+#ifndef WORKSTEALINGDEQUE_H
+#define WORKSTEALINGDEQUE_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+/* WorkStealingDeque：Chase-Lev 工作窃取双端队列（固定容量，存指针）
+ *
+ * 每个线程一个：自己在底部 push()/pop()（后进先出，刚拆出来的任务数据还在缓存里），
+ * 别的线程没活干时从顶部 steal()（先进先出，偷走的是最早、通常也是最大的那块）。
+ *   - 只有 "拥有者" 一个线程能 push()/pop()，steal() 任何线程都能调
+ *   - 拥有者和窃取者只在抢最后一个元素时才需要 CAS，平时 push()/pop() 都没有原子读改写
+ * 内存序按 Lê、Pop、Cohen、Zappa Nardelli 的 "Correct and Efficient Work-Stealing for Weak Memory Models"。
+ *
+ * Capacity 必须是 2 的幂；满了 push() 返回 false，调用方自己直接执行这个任务。
+ */
+template <typename T, size_t Capacity>
+class WorkStealingDeque
+{
+    static_assert(Capacity >= 2 && (Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two");
+
+public:
+    bool push(T *item)
+    {
+        const int64_t bottom = bottomIndex.load(std::memory_order_relaxed);
+        const int64_t top = topIndex.load(std::memory_order_acquire);
+        if (bottom - top >= int64_t(Capacity))
+            return false;
+        items[bottom & (Capacity - 1)].store(item, std::memory_order_relaxed);
+        bottomIndex.store(bottom + 1, std::memory_order_release);   // 窃取者 acquire 读到新的 bottom 后，元素指向的数据也可见
+        return true;
+    }
+
+    T *pop()
+    {
+        const int64_t bottom = bottomIndex.load(std::memory_order_relaxed) - 1;
+        bottomIndex.store(bottom, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        int64_t top = topIndex.load(std::memory_order_relaxed);
+        if (top > bottom) {
+            // 空的
+            bottomIndex.store(bottom + 1, std::memory_order_relaxed);
+            return nullptr;
+        }
+        T *item = items[bottom & (Capacity - 1)].load(std::memory_order_relaxed);
+        if (top == bottom) {
+            // 最后一个：和窃取者抢，谁把 top 加上去就归谁
+            if (!topIndex.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+                item = nullptr;
+            bottomIndex.store(bottom + 1, std::memory_order_relaxed);
+        }
+        return item;
+    }
+
+    T *steal()
+    {
+        int64_t top = topIndex.load(std::memory_order_acquire);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        const int64_t bottom = bottomIndex.load(std::memory_order_acquire);
+        if (top >= bottom)
+            return nullptr;
+        T *item = items[top & (Capacity - 1)].load(std::memory_order_relaxed);
+        // 失败说明被拥有者或别的窃取者抢先了，调用方换一个队列再试
+        if (!topIndex.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+            return nullptr;
+        return item;
+    }
+
+    bool isEmpty() const
+    {
+        return topIndex.load(std::memory_order_acquire) >= bottomIndex.load(std::memory_order_acquire);
+    }
+
+private:
+    alignas(64) std::atomic<int64_t> topIndex{0};      // 窃取者从这里取
+    alignas(64) std::atomic<int64_t> bottomIndex{0};   // 拥有者在这里放、取
+    std::atomic<T *> items[Capacity] = {};
+};
+
+#endif // WORKSTEALINGDEQUE_H
@@ -0,0 +1,17 @@
+# 离屏基准测试：不开窗口，用 QOffscreenSurface + QOpenGLFramebufferObject 跑 Renderer 的绘制代码
+QT       += core gui opengl
+
+CONFIG += c++17 console
+CONFIG -= app_bundle
+
+TARGET = glbench
+
+win32: LIBS += -lpsapi   # GetProcessMemoryInfo
+
+include(../renderer.pri)
+
+SOURCES += \
+    main.cpp
+
+RESOURCES += \
+    ../resources.qrc
@@ -0,0 +1,16 @@
+# 剔除基准测试：Scene::cull() 的标量 / SSE4.1 / AVX2 内核对比，不需要 OpenGL
+QT       += core gui
+
+CONFIG += c++17 console
+CONFIG -= app_bundle
+
+TARGET = cullbench
+
+INCLUDEPATH += $$PWD/../..
+
+SOURCES += \
+    main.cpp \
+    $$PWD/../../Scene.cpp
+
+HEADERS += \
+    $$PWD/../../Scene.h
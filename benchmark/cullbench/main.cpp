@@ -0,0 +1,154 @@
+/* cullbench：Scene::cull() 各内核的基准测试
+ *
+ * 在 [-extent, extent]^3 里随机撒 --objects 个包围球（种子固定，每次运行都一样），相机在原点看向 -z，
+ * 60° 视角、16:9，分别用标量、SSE4.1、AVX2 内核剔除 --iterations 次，输出每次的最短 / 中位 / 平均时间
+ * 和每秒处理的物体数。每个 SIMD 内核的结果都和标量内核逐个比较，不一致时返回 1。
+ *
+ *   ./cullbench --objects 1000000 --min-pixels 2 --json cull.json
+ *
+ * 1M 个物体的包围球是 16 MB，内核快到一定程度以后瓶颈是内存带宽，不再是计算。
+ */
+#include "Scene.h"
+
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QElapsedTimer>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QFile>
+#include <QTextStream>
+#include <algorithm>
+#include <random>
+#include <vector>
+
+namespace {
+
+struct KernelResult
+{
+    Scene::Kernel kernel;
+    int visible = 0;
+    double minMs = 0.0;
+    double medianMs = 0.0;
+    double meanMs = 0.0;
+    bool matches = true;   // 可见列表和标量内核完全一致
+};
+
+KernelResult run(Scene &scene, Scene::Kernel kernel, const QMatrix4x4 &viewProjection, float minPixels,
+                 int iterations, std::vector<int> &visible)
+{
+    KernelResult result;
+    result.kernel = kernel;
+    scene.setKernel(kernel);
+
+    // 先跑几次把数据读进缓存、让 CPU 升频
+    for (int i = 0; i < 3; ++i)
+        scene.cull(viewProjection, visible, 1080.0f, minPixels);
+
+    std::vector<double> samples;
+    samples.reserve(size_t(iterations));
+    QElapsedTimer timer;
+    for (int i = 0; i < iterations; ++i) {
+        timer.start();
+        result.visible = scene.cull(viewProjection, visible, 1080.0f, minPixels);
+        samples.push_back(timer.nsecsElapsed() / 1.0e6);
+    }
+    std::sort(samples.begin(), samples.end());
+    result.minMs = samples.front();
+    result.medianMs = samples[samples.size() / 2];
+    double sum = 0.0;
+    for (double ms : samples)
+        sum += ms;
+    result.meanMs = sum / samples.size();
+    return result;
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Benchmark the scalar and SIMD frustum culling kernels of Scene");
+    parser.addHelpOption();
+    QCommandLineOption objectsOption("objects", "Number of bounding spheres.", "n", "1000000");
+    QCommandLineOption iterationsOption("iterations", "Timed cull() calls per kernel.", "n", "100");
+    QCommandLineOption extentOption("extent", "Objects are scattered in [-extent, extent]^3.", "units", "500");
+    QCommandLineOption minPixelsOption("min-pixels", "Screen-size culling threshold (0 = frustum only).", "px", "2");
+    QCommandLineOption jsonOption("json", "Also write results as JSON to <file>.", "file");
+    parser.addOptions({objectsOption, iterationsOption, extentOption, minPixelsOption, jsonOption});
+    parser.process(app);
+
+    const int objects = qMax(1, parser.value(objectsOption).toInt());
+    const int iterations = qMax(1, parser.value(iterationsOption).toInt());
+    const float extent = qMax(1.0f, parser.value(extentOption).toFloat());
+    const float minPixels = qMax(0.0f, parser.value(minPixelsOption).toFloat());
+
+    Scene scene;
+    scene.reserve(objects);
+    std::mt19937 rng(12345);
+    std::uniform_real_distribution<float> position(-extent, extent);
+    std::uniform_real_distribution<float> radius(0.1f, 2.0f);
+    for (int i = 0; i < objects; ++i)
+        scene.add(position(rng), position(rng), position(rng), radius(rng));
+
+    QMatrix4x4 viewProjection;
+    viewProjection.perspective(60.0f, 16.0f / 9.0f, 0.1f, extent * 2.0f);
+    viewProjection.lookAt(QVector3D(0, 0, 0), QVector3D(0, 0, -1), QVector3D(0, 1, 0));
+
+    QTextStream out(stdout);
+    out << objects << " objects, " << iterations << " iterations, min-pixels " << minPixels << Qt::endl << Qt::endl;
+    out << qSetFieldWidth(10) << Qt::right << "kernel" << "visible" << "min ms" << "median ms" << "mean ms"
+        << "Mobj/s" << "speedup" << qSetFieldWidth(0) << Qt::endl;
+
+    std::vector<int> reference, visible;
+    std::vector<KernelResult> results;
+    bool allMatch = true;
+    for (Scene::Kernel kernel : {Scene::Scalar, Scene::Sse41, Scene::Avx2}) {
+        if (!Scene::isSupported(kernel)) {
+            out << qSetFieldWidth(10) << Scene::kernelName(kernel) << "unsupported" << qSetFieldWidth(0) << Qt::endl;
+            continue;
+        }
+        KernelResult r = run(scene, kernel, viewProjection, minPixels, iterations, visible);
+        if (kernel == Scene::Scalar) {
+            reference.assign(visible.begin(), visible.begin() + r.visible);
+        } else {
+            r.matches = r.visible == int(reference.size())
+                        && std::equal(reference.begin(), reference.end(), visible.begin());
+            allMatch = allMatch && r.matches;
+        }
+        results.push_back(r);
+
+        const double speedup = results.front().medianMs / r.medianMs;
+        out << qSetFieldWidth(10) << Qt::fixed << qSetRealNumberPrecision(3) << Scene::kernelName(kernel) << r.visible
+            << r.minMs << r.medianMs << r.meanMs << qSetRealNumberPrecision(1) << objects / r.medianMs / 1000.0
+            << speedup << qSetFieldWidth(0) << (r.matches ? "" : "  MISMATCH") << Qt::endl;
+    }
+
+    if (parser.isSet(jsonOption)) {
+        QJsonArray array;
+        for (const KernelResult &r : results) {
+            QJsonObject o;
+            o["kernel"] = Scene::kernelName(r.kernel);
+            o["visible"] = r.visible;
+            o["minMs"] = r.minMs;
+            o["medianMs"] = r.medianMs;
+            o["meanMs"] = r.meanMs;
+            o["matchesScalar"] = r.matches;
+            array.append(o);
+        }
+        QJsonObject root;
+        root["objects"] = objects;
+        root["iterations"] = iterations;
+        root["minPixels"] = minPixels;
+        root["results"] = array;
+        QFile file(parser.value(jsonOption));
+        if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+            QTextStream(stderr) << "cullbench: cannot write " << file.fileName() << Qt::endl;
+            return 1;
+        }
+        file.write(QJsonDocument(root).toJson());
+    }
+    return allMatch ? 0 : 1;
+}
@@ -0,0 +1,18 @@
+# GL 调用重放：离屏重放 GLTrace 录的 .gltrace 文件，输出每种调用的次数、上传的数据量和总时间
+QT       += core gui opengl
+
+CONFIG += c++17 console
+CONFIG -= app_bundle
+
+TARGET = glreplay
+
+INCLUDEPATH += $$PWD/../..
+
+SOURCES += \
+    main.cpp \
+    $$PWD/../../GLReplay.cpp \
+    $$PWD/../../GLTrace.cpp
+
+HEADERS += \
+    $$PWD/../../GLReplay.h \
+    $$PWD/../../GLTrace.h
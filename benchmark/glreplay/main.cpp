@@ -0,0 +1,208 @@
+/* glreplay：离屏重放 GLTrace 录的 GL 调用（性能回归测试用）
+ *
+ * 录制：窗口程序加 --gl-trace <文件>，或者 glbench --record <prefix>。trace 里是 initializeGL()/paintGL()
+ * 发出的 GL 调用和它们上传的缓冲/纹理数据，重放时不需要场景、模型和 Renderer，只把这串调用原样再发一遍。
+ * 同一个 trace 在不同驱动/GPU 上、或者改动前后各录一份在同一台机器上重放，比的就是 GL 调用本身的开销。
+ *
+ * 输出：
+ *   - 每一轮（--loops）的初始化时间（第一帧之前：建对象、上传快照）、总时间、帧时间的平均/p50/p99 和帧率
+ *   - 每种调用的次数，--call-times 时还有每种调用的 CPU 时间（逐条计时，会让总时间变长）
+ *   - 上传的数据量、重放时找不到的对象、链接失败的程序和 GL 错误数
+ * 默认不 glFinish，测的是 CPU 提交最快能多快；--finish 每帧 glFinish，和 glbench 一样是完整的帧时间。
+ *
+ *   QT_QPA_PLATFORM=offscreen ./glreplay scene-1000.gltrace --loops 5 --finish --json replay.json
+ */
+#include "GLReplay.h"
+
+#include <QGuiApplication>
+#include <QCommandLineParser>
+#include <QOpenGLContext>
+#include <QOffscreenSurface>
+#include <QSurfaceFormat>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QFile>
+#include <QTextStream>
+#include <algorithm>
+#include <vector>
+
+namespace {
+
+struct LoopResult
+{
+    double initMs = 0.0;
+    double totalMs = 0.0;
+    double averageMs = 0.0;
+    double p50Ms = 0.0;
+    double p99Ms = 0.0;
+    double fps = 0.0;
+};
+
+LoopResult summarize(const GLReplay::Stats &stats)
+{
+    LoopResult r;
+    r.initMs = stats.initMs;
+    r.totalMs = stats.totalMs;
+    std::vector<double> frames = stats.frameMs;
+    if (frames.empty())
+        return r;
+    double sum = 0.0;
+    for (double ms : frames)
+        sum += ms;
+    std::sort(frames.begin(), frames.end());
+    r.averageMs = sum / frames.size();
+    r.p50Ms = frames[frames.size() / 2];
+    r.p99Ms = frames[std::min(frames.size() - 1, size_t(frames.size() * 0.99))];
+    r.fps = sum > 0.0 ? frames.size() * 1000.0 / sum : 0.0;
+    return r;
+}
+
+QJsonObject toJson(const LoopResult &r)
+{
+    QJsonObject o;
+    o["initMs"] = r.initMs;
+    o["totalMs"] = r.totalMs;
+    o["averageMs"] = r.averageMs;
+    o["p50Ms"] = r.p50Ms;
+    o["p99Ms"] = r.p99Ms;
+    o["fps"] = r.fps;
+    return o;
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    QGuiApplication app(argc, argv);
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Replay a GL trace recorded by GLTrace offscreen and time it");
+    parser.addHelpOption();
+    parser.addPositionalArgument("trace", "The .gltrace file to replay.");
+    QCommandLineOption loopsOption("loops", "Replay the whole trace <n> times.", "n", "3");
+    QCommandLineOption finishOption("finish", "Call glFinish() at the end of every frame.");
+    QCommandLineOption callTimesOption("call-times", "Time every call and report the CPU time per call type.");
+    QCommandLineOption jsonOption("json", "Also write results as JSON to <file>.", "file");
+    parser.addOptions({loopsOption, finishOption, callTimesOption, jsonOption});
+    parser.process(app);
+
+    QTextStream out(stdout);
+    QTextStream err(stderr);
+    if (parser.positionalArguments().size() != 1) {
+        err << "glreplay: expected one trace file" << Qt::endl;
+        return 1;
+    }
+    const QString path = parser.positionalArguments().first();
+    const int loops = qMax(1, parser.value(loopsOption).toInt());
+    const bool finish = parser.isSet(finishOption);
+    const bool callTimes = parser.isSet(callTimesOption);
+
+    GLReplay replay;
+    if (!replay.load(path)) {
+        err << "glreplay: " << replay.errorString() << Qt::endl;
+        return 1;
+    }
+
+    // 和 Renderer::surfaceFormat() 一样；默认帧缓冲不用，重放画在 GLReplay 自己的帧缓冲上
+    QSurfaceFormat format;
+    format.setVersion(4, 5);
+    format.setProfile(QSurfaceFormat::CoreProfile);
+    QOpenGLContext context;
+    context.setFormat(format);
+    if (!context.create()) {
+        err << "glreplay: failed to create an OpenGL 4.5 core context" << Qt::endl;
+        return 1;
+    }
+    QOffscreenSurface surface;
+    surface.setFormat(context.format());
+    surface.create();
+    if (!context.makeCurrent(&surface)) {
+        err << "glreplay: failed to make the context current on the offscreen surface" << Qt::endl;
+        return 1;
+    }
+
+    QOpenGLFunctions *f = context.functions();
+    out << "GL_RENDERER: " << reinterpret_cast<const char *>(f->glGetString(GL_RENDERER)) << Qt::endl;
+    out << "GL_VERSION:  " << reinterpret_cast<const char *>(f->glGetString(GL_VERSION)) << Qt::endl;
+    out << path << ": " << Qt::fixed << qSetRealNumberPrecision(2) << replay.size() / (1024.0 * 1024.0) << " MB, "
+        << loops << " loops" << (finish ? ", glFinish per frame" : "") << (callTimes ? ", per-call timing" : "")
+        << Qt::endl << Qt::endl;
+    out << qSetFieldWidth(10) << Qt::right << "loop" << "init ms" << "total ms" << "frames" << "avg ms"
+        << "p50 ms" << "p99 ms" << "fps" << qSetFieldWidth(0) << Qt::endl;
+
+    // 每种调用的统计取总时间最短的一轮（次数每轮都一样）
+    QJsonArray loopResults;
+    GLReplay::Stats best;
+    bool haveBest = false;
+    for (int loop = 0; loop < loops; ++loop) {
+        GLReplay::Stats stats;
+        if (!replay.run(finish, callTimes, &stats)) {
+            err << "glreplay: " << replay.errorString() << Qt::endl;
+            context.doneCurrent();
+            return 1;
+        }
+        const LoopResult r = summarize(stats);
+        out << qSetFieldWidth(10) << Qt::fixed << qSetRealNumberPrecision(2) << loop + 1 << r.initMs << r.totalMs
+            << stats.frames << r.averageMs << r.p50Ms << r.p99Ms << r.fps << qSetFieldWidth(0) << Qt::endl;
+        loopResults.append(toJson(r));
+        if (!haveBest || stats.totalMs < best.totalMs)
+            best = stats;
+        haveBest = true;
+    }
+
+    out << Qt::endl << qSetFieldWidth(36) << Qt::left << "call" << qSetFieldWidth(12) << Qt::right << "count";
+    if (callTimes)
+        out << "total ms" << "avg us";
+    out << qSetFieldWidth(0) << Qt::endl;
+    QJsonArray calls;
+    qint64 records = 0;
+    for (int op = 0; op < GLTrace::OpCount; ++op) {
+        const qint64 count = best.calls[op];
+        if (!count)
+            continue;
+        records += count;
+        out << qSetFieldWidth(36) << Qt::left << GLTrace::opName(op) << qSetFieldWidth(12) << Qt::right << count;
+        if (callTimes) {
+            out << Qt::fixed << qSetRealNumberPrecision(3) << best.nsecs[op] / 1.0e6
+                << best.nsecs[op] / 1.0e3 / count;
+        }
+        out << qSetFieldWidth(0) << Qt::endl;
+        QJsonObject c;
+        c["name"] = QString::fromLatin1(GLTrace::opName(op));
+        c["count"] = count;
+        if (callTimes)
+            c["totalMs"] = best.nsecs[op] / 1.0e6;
+        calls.append(c);
+    }
+    out << Qt::endl << records << " records, " << Qt::fixed << qSetRealNumberPrecision(2)
+        << best.uploadedBytes / (1024.0 * 1024.0) << " MB uploaded, " << best.snapshotBytes / (1024.0 * 1024.0)
+        << " MB in snapshots" << Qt::endl;
+    out << best.unresolved << " unresolved objects, " << best.failedPrograms << " failed programs, "
+        << best.glErrors << " GL errors" << Qt::endl;
+
+    if (parser.isSet(jsonOption)) {
+        QFile file(parser.value(jsonOption));
+        if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+            err << "glreplay: cannot write " << file.fileName() << Qt::endl;
+            return 1;
+        }
+        QJsonObject root;
+        root["renderer"] = QString::fromLatin1(reinterpret_cast<const char *>(f->glGetString(GL_RENDERER)));
+        root["trace"] = path;
+        root["finish"] = finish;
+        root["frames"] = best.frames;
+        root["uploadedBytes"] = best.uploadedBytes;
+        root["snapshotBytes"] = best.snapshotBytes;
+        root["unresolved"] = best.unresolved;
+        root["failedPrograms"] = best.failedPrograms;
+        root["glErrors"] = best.glErrors;
+        root["loops"] = loopResults;
+        root["calls"] = calls;
+        file.write(QJsonDocument(root).toJson());
+    }
+
+    context.doneCurrent();
+    // 有错误时返回 2，CI 里可以区分 "变慢了" 和 "重放不对"
+    return best.failedPrograms || best.glErrors ? 2 : 0;
+}
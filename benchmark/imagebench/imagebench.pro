@@ -0,0 +1,26 @@
+# 图像内核基准测试：ImageKernels 的标量 / SSE2 / AVX2 / NEON 内核和 QImage 转换、缩放对比；
+# --gl 时还测 DynamicTexture 的上传并把各层读回来检查（要 OpenGL 4.5）
+QT       += core gui opengl
+
+CONFIG += c++17 console
+CONFIG -= app_bundle
+
+TARGET = imagebench
+
+INCLUDEPATH += $$PWD/../..
+
+SOURCES += \
+    main.cpp \
+    $$PWD/../../DynamicTexture.cpp \
+    $$PWD/../../GLStateCache.cpp \
+    $$PWD/../../GLTrace.cpp \
+    $$PWD/../../ImageKernels.cpp \
+    $$PWD/../../StreamBuffer.cpp
+
+HEADERS += \
+    $$PWD/../../DynamicTexture.h \
+    $$PWD/../../GLStateCache.h \
+    $$PWD/../../GLTrace.h \
+    $$PWD/../../GLTraceFunctions.h \
+    $$PWD/../../ImageKernels.h \
+    $$PWD/../../StreamBuffer.h
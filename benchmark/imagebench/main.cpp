@@ -0,0 +1,435 @@
+/* imagebench：ImageKernels 各内核和 QImage 的基准测试
+ *
+ * 用固定种子生成一张 --width x --height 的随机图（ARGB32、RGB888、RGBA8888、I420 四份），比较：
+ *   - bgra / rgb：QImage::convertToFormat(Format_RGBA8888) 和各内核的 bgraToRgba / rgbToRgba
+ *   - yuv420：各内核的 yuv420ToRgba（QImage 没有对应的路径）
+ *   - box / kaiser：QImage::scaled(w/2, h/2, Qt::SmoothTransformation) 和各内核的 downsample
+ *   - update：动态纹理一次更新的 CPU 部分（BGRA 转换 + 整条 Box mip 链）。QImage 是整张转换 + 逐层 scaled()，
+ *     内核分整张和 --rect 见方的子矩形两种
+ *   - texture（--gl，要 OpenGL 4.5）：DynamicTexture 一帧的整张更新和子矩形更新（Box、Kaiser 两种 mip），
+ *     不 glFinish，测的是 CPU 这边（转换、mip、拷进环形缓冲、提交）。之后把几个子矩形（一个和整张更新在同一帧、
+ *     超出环形缓冲的区域，一个贴着纹理边缘被裁掉）更新进去，每层读回来和整张上传同样内容的纹理逐字节比较
+ * 每项输出 --iterations 次里的最短 / 中位时间和相对 QImage（没有时相对标量）的加速比。
+ * 每个 SIMD 内核的输出都和标量内核逐字节比较（Kaiser 允许差 1），不一致时返回 1。
+ *
+ *   ./imagebench --width 1920 --height 1080 --json image.json
+ *   QT_QPA_PLATFORM=offscreen ./imagebench --gl
+ */
+#include "DynamicTexture.h"
+#include "GLStateCache.h"
+#include "ImageKernels.h"
+
+#include <QCoreApplication>
+#include <QGuiApplication>
+#include <QCommandLineParser>
+#include <QElapsedTimer>
+#include <QImage>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QFile>
+#include <QOffscreenSurface>
+#include <QOpenGLContext>
+#include <QOpenGLFunctions_4_5_Core>
+#include <QSurfaceFormat>
+#include <QTextStream>
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <random>
+#include <vector>
+
+namespace {
+
+struct Result
+{
+    QString test;
+    QString path;        // "qimage" 或内核名
+    double minMs = 0.0;
+    double medianMs = 0.0;
+    double speedup = 1.0;
+    bool matches = true;
+};
+
+void measure(Result &result, int iterations, const std::function<void()> &body)
+{
+    // 先跑几次把数据读进缓存、让 CPU 升频
+    for (int i = 0; i < 3; ++i)
+        body();
+
+    std::vector<double> samples;
+    samples.reserve(size_t(iterations));
+    QElapsedTimer timer;
+    for (int i = 0; i < iterations; ++i) {
+        timer.start();
+        body();
+        samples.push_back(timer.nsecsElapsed() / 1.0e6);
+    }
+    std::sort(samples.begin(), samples.end());
+    result.minMs = samples.front();
+    result.medianMs = samples[samples.size() / 2];
+}
+
+bool same(const std::vector<uchar> &a, const std::vector<uchar> &b, int tolerance)
+{
+    if (a.size() != b.size())
+        return false;
+    for (size_t i = 0; i < a.size(); ++i) {
+        if (std::abs(int(a[i]) - int(b[i])) > tolerance)
+            return false;
+    }
+    return true;
+}
+
+// 整条 mip 链的 RGBA8 副本，和 DynamicTexture 的布局一样
+struct MipChain
+{
+    std::vector<QSize> sizes;
+    std::vector<std::vector<uchar>> levels;
+
+    explicit MipChain(const QSize &size)
+    {
+        QSize s = size;
+        for (;;) {
+            sizes.push_back(s);
+            levels.emplace_back(size_t(s.width()) * s.height() * 4);
+            if (s.width() == 1 && s.height() == 1)
+                break;
+            s = ImageKernels::mipSize(s);
+        }
+    }
+
+    // 第 0 层的 rect 变了以后重算各层
+    void update(const QRect &rect)
+    {
+        QRect r = rect;
+        for (size_t level = 1; level < levels.size(); ++level) {
+            const QSize &parent = sizes[level - 1];
+            r = ImageKernels::mipRect(r, parent, ImageKernels::Box);
+            ImageKernels::downsample(levels[level - 1].data(), parent.width(), parent.height(), parent.width() * 4,
+                                     levels[level].data(), sizes[level].width() * 4, ImageKernels::Box, r);
+        }
+    }
+};
+
+// 读回纹理的每一层，依次拼在一起
+std::vector<uchar> readBack(QOpenGLFunctions_4_5_Core &gl, const DynamicTexture &texture)
+{
+    std::vector<uchar> data;
+    QSize size = texture.size();
+    for (int level = 0; level < texture.levelCount(); ++level) {
+        const size_t offset = data.size();
+        const size_t bytes = size_t(size.width()) * size.height() * 4;
+        data.resize(offset + bytes);
+        gl.glGetTextureImage(texture.textureId(), level, GL_RGBA, GL_UNSIGNED_BYTE, GLsizei(bytes),
+                             data.data() + offset);
+        size = ImageKernels::mipSize(size);
+    }
+    return data;
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    // --gl 要 QGuiApplication（离屏表面），其他测试在没有显示的机器上也能跑
+    const bool useGl = std::any_of(argv + 1, argv + argc,
+                                   [](const char *arg) { return std::strcmp(arg, "--gl") == 0; });
+    std::unique_ptr<QCoreApplication> app(useGl ? new QGuiApplication(argc, argv) : new QCoreApplication(argc, argv));
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Benchmark the scalar and SIMD image kernels against QImage");
+    parser.addHelpOption();
+    QCommandLineOption widthOption("width", "Image width.", "px", "1920");
+    QCommandLineOption heightOption("height", "Image height.", "px", "1080");
+    QCommandLineOption iterationsOption("iterations", "Timed runs per test and path.", "n", "50");
+    QCommandLineOption rectOption("rect", "Side of the dirty rectangle in the update test.", "px", "256");
+    QCommandLineOption glOption("gl", "Also time DynamicTexture updates in an OpenGL 4.5 context and check that "
+                                      "sub-rectangle updates read back the same as a full upload.");
+    QCommandLineOption jsonOption("json", "Also write results as JSON to <file>.", "file");
+    parser.addOptions({widthOption, heightOption, iterationsOption, rectOption, glOption, jsonOption});
+    parser.process(*app);
+
+    // 宽高取偶数，I420 的色度平面正好是一半
+    const int width = qMax(2, parser.value(widthOption).toInt()) & ~1;
+    const int height = qMax(2, parser.value(heightOption).toInt()) & ~1;
+    const int iterations = qMax(1, parser.value(iterationsOption).toInt());
+    const int rectSide = qBound(1, parser.value(rectOption).toInt(), qMin(width, height));
+    const int pixels = width * height;
+    const QSize half = ImageKernels::mipSize(QSize(width, height));
+
+    std::mt19937 rng(12345);
+    std::uniform_int_distribution<int> byte(0, 255);
+    QImage argb(width, height, QImage::Format_ARGB32);
+    QImage rgb(width, height, QImage::Format_RGB888);
+    QImage rgba(width, height, QImage::Format_RGBA8888);
+    for (int y = 0; y < height; ++y) {
+        for (int x = 0; x < width * 4; ++x) {
+            argb.scanLine(y)[x] = uchar(byte(rng));
+            rgba.scanLine(y)[x] = uchar(byte(rng));
+        }
+        for (int x = 0; x < width * 3; ++x)
+            rgb.scanLine(y)[x] = uchar(byte(rng));
+    }
+    std::vector<uchar> yPlane(static_cast<size_t>(pixels));
+    std::vector<uchar> uPlane(static_cast<size_t>(pixels / 4)), vPlane(static_cast<size_t>(pixels / 4));
+    for (uchar &b : yPlane)
+        b = uchar(byte(rng));
+    for (uchar &b : uPlane)
+        b = uchar(byte(rng));
+    for (uchar &b : vPlane)
+        b = uchar(byte(rng));
+
+    // 子矩形放在中间，不和边缘对齐
+    const QRect dirty = QRect(((width - rectSide) / 2) | 1, ((height - rectSide) / 2) | 1, rectSide, rectSide)
+                            .intersected(QRect(0, 0, width, height));
+
+    QTextStream out(stdout);
+    out << width << "x" << height << ", " << iterations << " iterations, update rect " << rectSide << "x" << rectSide
+        << Qt::endl << Qt::endl;
+    out << qSetFieldWidth(12) << Qt::right << "test" << "path" << "min ms" << "median ms" << "speedup"
+        << qSetFieldWidth(0) << Qt::endl;
+
+    std::vector<Result> results;
+    bool allMatch = true;
+    auto report = [&](Result &r, double baselineMs) {
+        r.speedup = baselineMs / r.medianMs;
+        out << qSetFieldWidth(12) << Qt::fixed << qSetRealNumberPrecision(3) << r.test << r.path << r.minMs
+            << r.medianMs << qSetRealNumberPrecision(1) << r.speedup << qSetFieldWidth(0)
+            << (r.matches ? "" : "  MISMATCH") << Qt::endl;
+        allMatch = allMatch && r.matches;
+        results.push_back(r);
+    };
+
+    const ImageKernels::Kernel kernels[] = {ImageKernels::Scalar, ImageKernels::Sse2, ImageKernels::Avx2,
+                                            ImageKernels::Neon};
+    for (const char *test : {"bgra", "rgb", "yuv420", "box", "kaiser", "update"}) {
+        const QString name = QString::fromLatin1(test);
+        const bool mip = name == "box" || name == "kaiser";
+        const ImageKernels::Filter filter = name == "kaiser" ? ImageKernels::Kaiser : ImageKernels::Box;
+
+        // QImage 路径
+        double baselineMs = 0.0;
+        if (name != "yuv420") {
+            Result r;
+            r.test = name;
+            r.path = "qimage";
+            QImage sink;
+            if (name == "bgra") {
+                measure(r, iterations, [&] { sink = argb.convertToFormat(QImage::Format_RGBA8888); });
+            } else if (name == "rgb") {
+                measure(r, iterations, [&] { sink = rgb.convertToFormat(QImage::Format_RGBA8888); });
+            } else if (mip) {
+                measure(r, iterations,
+                        [&] { sink = rgba.scaled(half, Qt::IgnoreAspectRatio, Qt::SmoothTransformation); });
+            } else {
+                measure(r, iterations, [&] {
+                    QImage level = argb.convertToFormat(QImage::Format_RGBA8888);
+                    while (level.width() > 1 || level.height() > 1)
+                        level = level.scaled(ImageKernels::mipSize(level.size()), Qt::IgnoreAspectRatio,
+                                             Qt::SmoothTransformation);
+                });
+            }
+            baselineMs = r.medianMs;
+            report(r, baselineMs);
+        }
+
+        std::vector<uchar> reference;
+        for (ImageKernels::Kernel kernel : kernels) {
+            if (!ImageKernels::isSupported(kernel)) {
+                out << qSetFieldWidth(12) << name << ImageKernels::kernelName(kernel) << "unsupported"
+                    << qSetFieldWidth(0) << Qt::endl;
+                continue;
+            }
+            ImageKernels::setKernel(kernel);
+            Result r;
+            r.test = name;
+            r.path = ImageKernels::kernelName(kernel);
+            std::vector<uchar> output;
+
+            if (name == "bgra" || name == "rgb") {
+                output.resize(size_t(pixels) * 4);
+                const QImage &src = name == "bgra" ? argb : rgb;
+                measure(r, iterations, [&] {
+                    for (int y = 0; y < height; ++y) {
+                        uchar *dst = output.data() + size_t(y) * width * 4;
+                        if (name == "bgra")
+                            ImageKernels::bgraToRgba(src.constScanLine(y), dst, width);
+                        else
+                            ImageKernels::rgbToRgba(src.constScanLine(y), dst, width);
+                    }
+                });
+            } else if (name == "yuv420") {
+                output.resize(size_t(pixels) * 4);
+                measure(r, iterations, [&] {
+                    ImageKernels::yuv420ToRgba(yPlane.data(), width, uPlane.data(), vPlane.data(), width / 2,
+                                               output.data(), width * 4, width, height);
+                });
+            } else if (mip) {
+                output.resize(size_t(half.width()) * half.height() * 4);
+                measure(r, iterations, [&] {
+                    ImageKernels::downsample(rgba.constBits(), width, height, int(rgba.bytesPerLine()),
+                                             output.data(), half.width() * 4, filter);
+                });
+            } else {
+                // 整张：转换 + 整条 mip 链
+                MipChain chain(QSize(width, height));
+                const QRect full(0, 0, width, height);
+                measure(r, iterations, [&] {
+                    for (int y = 0; y < height; ++y)
+                        ImageKernels::bgraToRgba(argb.constScanLine(y), chain.levels[0].data() + size_t(y) * width * 4,
+                                                 width);
+                    chain.update(full);
+                });
+                r.path += " full";
+                report(r, baselineMs);
+
+                // 子矩形：只转换 dirty，只重算受影响的 mip 块
+                Result sub;
+                sub.test = name;
+                sub.path = QString::fromLatin1(ImageKernels::kernelName(kernel)) + " rect";
+                measure(sub, iterations, [&] {
+                    for (int y = dirty.top(); y <= dirty.bottom(); ++y)
+                        ImageKernels::bgraToRgba(argb.constScanLine(y) + dirty.x() * 4,
+                                                 chain.levels[0].data() + (size_t(y) * width + dirty.x()) * 4,
+                                                 dirty.width());
+                    chain.update(dirty);
+                });
+                report(sub, baselineMs);
+                continue;
+            }
+
+            if (kernel == ImageKernels::Scalar)
+                reference = output;
+            else
+                r.matches = same(reference, output, filter == ImageKernels::Kaiser && mip ? 1 : 0);
+            if (baselineMs == 0.0)
+                baselineMs = r.medianMs;   // 没有 QImage 路径时相对标量内核
+            report(r, baselineMs);
+        }
+        ImageKernels::setKernel(ImageKernels::Auto);
+    }
+
+    if (useGl) {
+        QTextStream err(stderr);
+        // 和 Renderer::surfaceFormat() 一样
+        QSurfaceFormat format;
+        format.setVersion(4, 5);
+        format.setProfile(QSurfaceFormat::CoreProfile);
+        QOpenGLContext context;
+        context.setFormat(format);
+        if (!context.create()) {
+            err << "imagebench: failed to create an OpenGL 4.5 core context" << Qt::endl;
+            return 1;
+        }
+        QOffscreenSurface surface;
+        surface.setFormat(context.format());
+        surface.create();
+        if (!context.makeCurrent(&surface)) {
+            err << "imagebench: failed to make the context current on the offscreen surface" << Qt::endl;
+            return 1;
+        }
+        QOpenGLFunctions_4_5_Core gl;
+        gl.initializeOpenGLFunctions();
+        GLStateCache state;
+        state.initialize();
+
+        // 子矩形的内容从第二张随机图里取；expected 是所有子矩形都贴上以后的整张图
+        QImage next(width, height, QImage::Format_ARGB32);
+        for (int y = 0; y < height; ++y) {
+            for (int x = 0; x < width * 4; ++x)
+                next.scanLine(y)[x] = uchar(byte(rng));
+        }
+        const QRect corner(0, 0, rectSide, rectSide);
+        const QRect edge(width - (rectSide + 1) / 2, height - (rectSide + 1) / 2, rectSide, rectSide);
+        QImage expected = argb.copy();
+        for (const QRect &rect : {dirty, corner, edge}) {
+            const QRect r = rect.intersected(expected.rect());
+            for (int y = r.top(); y <= r.bottom(); ++y)
+                std::memcpy(expected.scanLine(y) + r.x() * 4, next.constScanLine(y) + r.x() * 4, size_t(r.width()) * 4);
+        }
+        // rect 可以超出纹理，左上角总在图里面
+        auto updateRect = [](DynamicTexture &texture, const QImage &image, const QRect &rect) {
+            texture.update(rect, image.constScanLine(rect.y()) + rect.x() * 4, int(image.bytesPerLine()),
+                           DynamicTexture::Bgra8);
+        };
+
+        for (ImageKernels::Filter filter : {ImageKernels::Box, ImageKernels::Kaiser}) {
+            const QString filterName = filter == ImageKernels::Kaiser ? "kaiser" : "box";
+            DynamicTexture partial, full;
+            if (!partial.create(state, QSize(width, height), true, filter)
+                || !full.create(state, QSize(width, height), true, filter)) {
+                err << "imagebench: cannot create the dynamic textures" << Qt::endl;
+                return 1;
+            }
+
+            Result r;
+            r.test = "texture";
+            r.path = filterName + " full";
+            measure(r, iterations, [&] {
+                full.beginFrame();
+                full.update(argb);
+                full.endFrame();
+            });
+            Result sub;
+            sub.test = "texture";
+            sub.path = filterName + " rect";
+            measure(sub, iterations, [&] {
+                partial.beginFrame();
+                updateRect(partial, argb, dirty);
+                partial.endFrame();
+            });
+
+            // 第 1 帧：整张更新占满了区域，同一帧的子矩形逐层直接上传；第 2 帧：两个子矩形走环形缓冲
+            const int direct = partial.stats().directUploads;
+            partial.beginFrame();
+            partial.update(argb);
+            updateRect(partial, next, dirty);
+            partial.endFrame();
+            partial.beginFrame();
+            updateRect(partial, next, corner);
+            updateRect(partial, next, edge);
+            partial.endFrame();
+            full.beginFrame();
+            full.update(expected);
+            full.endFrame();
+            sub.matches = readBack(gl, partial) == readBack(gl, full);
+
+            report(r, r.medianMs);
+            report(sub, r.medianMs);
+            out << qSetFieldWidth(12) << "" << "" << qSetFieldWidth(0) << partial.levelCount() << " levels read back, "
+                << partial.stats().directUploads - direct << " uploaded directly" << Qt::endl;
+        }
+        state.invalidate();
+        context.doneCurrent();
+    }
+
+    if (parser.isSet(jsonOption)) {
+        QJsonArray array;
+        for (const Result &r : results) {
+            QJsonObject o;
+            o["test"] = r.test;
+            o["path"] = r.path;
+            o["minMs"] = r.minMs;
+            o["medianMs"] = r.medianMs;
+            o["speedup"] = r.speedup;
+            o["matchesScalar"] = r.matches;
+            array.append(o);
+        }
+        QJsonObject root;
+        root["width"] = width;
+        root["height"] = height;
+        root["iterations"] = iterations;
+        root["rect"] = rectSide;
+        root["results"] = array;
+        QFile file(parser.value(jsonOption));
+        if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+            QTextStream(stderr) << "imagebench: cannot write " << file.fileName() << Qt::endl;
+            return 1;
+        }
+        file.write(QJsonDocument(root).toJson());
+    }
+    return allMatch ? 0 : 1;
+}
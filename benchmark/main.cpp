@@ -0,0 +1,451 @@
+/* glbench：Renderer 的离屏基准测试
+ *
+ * 不开窗口，用 QOffscreenSurface + QOpenGLFramebufferObject 运行和 MyOpenGLWidget 完全相同的
+ * Renderer::initialize()/render() 代码，输出每种场景规模下的：
+ *   - 启动时间：从创建 Renderer 到第一帧画完（glFinish）的时间（--no-shader-cache 测不用着色器缓存的冷启动）
+ *   - 帧率、帧时间的 p50/p99
+ *   - 进程的峰值内存（peak RSS）
+ *   - 每帧的绘制调用数（SpriteBatch 合批之后）
+ * --trace 另外把每种规模最后几百帧的 CPU/GPU 分阶段计时写成 Chrome trace（FrameProfiler）。
+ *
+ * 没有 GPU 的机器（CI）可以用 Mesa 的 llvmpipe 软件渲染：
+ *   QT_QPA_PLATFORM=offscreen LIBGL_ALWAYS_SOFTWARE=1 ./glbench --sizes 1,1000,100000 --json result.json
+ * --instanced 把场景换成一个网格的硬件实例化（InstancedMesh），对比合批和实例化；
+ * --indirect 每个三角形一条间接绘制命令（IndirectBatch），整个场景一次 glMultiDrawElementsIndirect；
+ * --vertex-format full|half|snorm16 选实例化/间接绘制网格的顶点格式（VertexFormat）。
+ * --icons N 在场景上面再画 N 个各不相同的小图标（模拟 UI），每个图标一张纹理；
+ * 加上 --atlas 时先拼进 TextureAtlas，对比 draws 一列：N 次 -> 图集页数次。
+ * --model <文件> 在场景上面再画一个导入的模型（OBJ / glTF，开深度测试），结果里带读入时顶点缓存优化前后的 ACMR/ATVR。
+ * --model-copies N 把模型平铺画 N 份（大小不一），每份按屏幕误差选 LOD；--lod-error 0 关掉 LOD 对比 tris 一列，
+ * --impostor <像素> 屏幕上更小的改画公告板。
+ * --jobs N 用 N 个工作线程（JobSystem）做每帧的剔除和顶点准备，默认和窗口一样是核数 - 1，0 = 全部在 GL 线程里做。
+ * --record <prefix> 把每种规模的初始化和所有帧的 GL 调用录成 <prefix>-<scene>.gltrace（GLTrace），
+ * 用 glreplay 在别的机器/驱动上原样重放对比；录制时每个调用都有额外开销，这次的帧率没有参考价值。
+ *
+ * 每一帧都调用 glFinish()，测到的是 CPU 提交 + GPU 执行的完整帧时间，而不是只把命令塞进驱动队列的时间。
+ */
+#include "Renderer.h"
+#include "TextureAtlas.h"
+
+#include <QGuiApplication>
+#include <QCommandLineParser>
+#include <QOpenGLContext>
+#include <QOpenGLFunctions>
+#include <QOffscreenSurface>
+#include <QOpenGLFramebufferObject>
+#include <QElapsedTimer>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QFile>
+#include <QTextStream>
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#if defined(Q_OS_WIN)
+#include <windows.h>
+#include <psapi.h>
+#elif defined(Q_OS_UNIX)
+#include <sys/resource.h>
+#endif
+
+namespace {
+
+struct BenchResult
+{
+    int sceneSize = 0;
+    double startupMs = 0.0;   // 创建 Renderer 到第一帧完成
+    double fps = 0.0;
+    double p50Ms = 0.0;
+    double p99Ms = 0.0;
+    double peakRssMb = 0.0;   // 进程级的峰值，所以场景规模按从小到大的顺序测
+    int drawCalls = 0;        // 每帧的绘制调用数（SpriteBatch 合批 / 实例化之后）
+    int triangles = 0;        // 每帧提交的三角形数（LOD 之后）
+    Mesh::OptimizeStats model;  // --model 的模型重排前后的 ACMR/ATVR
+};
+
+// 命令行选项，每种场景规模都一样
+struct BenchOptions
+{
+    QSize size;
+    int warmupFrames = 0;
+    int frames = 0;
+    bool shaderCache = true;
+    bool instancing = false;
+    bool indirect = false;
+    QString tracePrefix;      // 非空时每种规模写一个 <prefix>-<scene>.json
+    QString recordPrefix;     // 非空时每种规模录一个 <prefix>-<scene>.gltrace
+    int icons = 0;            // 额外画的图标个数
+    bool atlas = false;       // 图标拼进 TextureAtlas
+    JobSystem *jobs = nullptr;  // 每帧剔除、准备顶点的工作线程，所有场景规模共用
+    VertexFormat vertexFormat = VertexFormat::full(false);  // 实例化网格的顶点格式
+    QString model;            // 额外画的模型文件
+    int modelCopies = 1;
+    float lodError = 1.0f;    // LOD 的屏幕误差（像素），0 = 总是原始网格
+    float impostor = 0.0f;    // 比这还小（像素）的模型画公告板，0 = 不用
+};
+
+// --icons 的图标：不用图集时每个一张纹理，用图集时都指向图集的页
+struct IconSet
+{
+    std::vector<GLuint> textures;
+    TextureAtlas atlas;
+    std::vector<AtlasRegion> regions;
+    std::vector<QMatrix4x4> transforms;
+};
+
+// 16..64 像素的纯色图标，大小和颜色只由编号决定，每次运行都一样
+QImage makeIcon(int index)
+{
+    QImage image(16 + (index * 7) % 49, 16 + (index * 13) % 49, QImage::Format_RGBA8888);
+    image.fill(QColor::fromHsv((index * 37) % 360, 200, 230));
+    return image;
+}
+
+void createIcons(QOpenGLFunctions *f, Renderer &renderer, const BenchOptions &options, IconSet &icons)
+{
+    std::vector<int> ids;
+    for (int i = 0; i < options.icons; ++i) {
+        const QImage image = makeIcon(i);
+        if (options.atlas) {
+            ids.push_back(icons.atlas.add(image));
+            continue;
+        }
+        GLuint texture = 0;
+        f->glGenTextures(1, &texture);
+        f->glBindTexture(GL_TEXTURE_2D, texture);
+        f->glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, image.width(), image.height(), 0, GL_RGBA, GL_UNSIGNED_BYTE,
+                        image.constBits());
+        f->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        f->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        icons.textures.push_back(texture);
+        AtlasRegion region;
+        region.texture = texture;
+        region.page = 0;   // 自己就是一整页
+        region.uvRect = QRectF(0, 0, 1, 1);
+        region.size = image.size();
+        icons.regions.push_back(region);
+    }
+    if (options.atlas) {
+        icons.atlas.build(renderer.state());
+        for (int id : ids)
+            icons.regions.push_back(icons.atlas.region(id));
+    }
+    renderer.state().invalidate();  // 上面直接绑定过纹理
+
+    // 铺满整个画面的网格，每格一个图标
+    const int cols = int(std::ceil(std::sqrt(double(options.icons))));
+    const float cell = 2.0f / cols;
+    for (int i = 0; i < options.icons; ++i) {
+        QMatrix4x4 transform;
+        transform.translate(-1.0f + cell * (i % cols + 0.5f), 1.0f - cell * (i / cols + 0.5f));
+        transform.scale(cell * 0.9f);
+        icons.transforms.push_back(transform);
+    }
+}
+
+// 进程的峰值常驻内存（MB）
+double peakRssMb()
+{
+#if defined(Q_OS_WIN)
+    PROCESS_MEMORY_COUNTERS counters;
+    if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+        return counters.PeakWorkingSetSize / (1024.0 * 1024.0);
+    return 0.0;
+#elif defined(Q_OS_UNIX)
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0)
+        return 0.0;
+#if defined(Q_OS_MACOS)
+    return usage.ru_maxrss / (1024.0 * 1024.0);  // macOS 上单位是字节
+#else
+    return usage.ru_maxrss / 1024.0;             // Linux 上单位是 KB
+#endif
+#else
+    return 0.0;
+#endif
+}
+
+// 已排好序的样本取百分位（最近秩法）
+double percentile(const std::vector<double> &sorted, double p)
+{
+    if (sorted.empty())
+        return 0.0;
+    const size_t rank = size_t(p / 100.0 * (sorted.size() - 1) + 0.5);
+    return sorted[std::min(rank, sorted.size() - 1)];
+}
+
+BenchResult runScene(QOpenGLContext &context, int sceneSize, const BenchOptions &options)
+{
+    QOpenGLFunctions *f = context.functions();
+    BenchResult result;
+    result.sceneSize = sceneSize;
+
+    QOpenGLFramebufferObjectFormat fboFormat;
+    fboFormat.setAttachment(QOpenGLFramebufferObject::CombinedDepthStencil);
+    QOpenGLFramebufferObject fbo(options.size, fboFormat);
+    fbo.bind();
+
+    // 启动时间：和窗口里 initializeGL() -> resizeGL() -> 第一次 paintGL() 的顺序一致
+    QElapsedTimer timer;
+    timer.start();
+    Renderer renderer;
+    renderer.setSceneSize(sceneSize);
+    renderer.setInstancing(options.instancing);
+    renderer.setMultiDrawIndirect(options.indirect);
+    renderer.setJobSystem(options.jobs);
+    renderer.setVertexFormat(options.vertexFormat);
+    renderer.setModel(options.model);
+    renderer.setModelCopies(options.modelCopies);
+    renderer.setLodErrorThreshold(options.lodError);
+    renderer.setImpostorSize(options.impostor);
+    renderer.shaders().setEnabled(options.shaderCache);
+    if (!options.recordPrefix.isEmpty()) {
+        // 录到计时的最后一帧，后面给 Chrome trace 补的几帧不录
+        renderer.setTraceFile(QString("%1-%2.gltrace").arg(options.recordPrefix).arg(sceneSize),
+                              1 + options.warmupFrames + options.frames);
+    }
+    renderer.initialize();
+    renderer.resize(options.size.width(), options.size.height());
+    renderer.render();
+    f->glFinish();
+    result.startupMs = timer.nsecsElapsed() / 1.0e6;
+
+    IconSet icons;
+    if (options.icons > 0) {
+        createIcons(f, renderer, options, icons);
+        renderer.setSceneCallback([&icons](SpriteBatch &batch) {
+            for (size_t i = 0; i < icons.regions.size(); ++i)
+                batch.submitQuad(icons.regions[i].texture, icons.transforms[i], icons.regions[i].uvRect);
+        });
+    }
+
+    // 第一帧画的是占位纹理（纹理在后台加载），计时的帧要等真正的纹理都就绪以后再跑
+    renderer.textures().waitForIdle(10000);
+
+    for (int i = 0; i < options.warmupFrames; ++i) {
+        renderer.render();
+        f->glFinish();
+    }
+
+    std::vector<double> frameMs;
+    frameMs.reserve(options.frames);
+    QElapsedTimer total;
+    total.start();
+    for (int i = 0; i < options.frames; ++i) {
+        timer.restart();
+        renderer.render();
+        f->glFinish();
+        frameMs.push_back(timer.nsecsElapsed() / 1.0e6);
+    }
+    const double totalMs = total.nsecsElapsed() / 1.0e6;
+
+    std::sort(frameMs.begin(), frameMs.end());
+    result.fps = totalMs > 0.0 ? options.frames * 1000.0 / totalMs : 0.0;
+    result.p50Ms = percentile(frameMs, 50.0);
+    result.p99Ms = percentile(frameMs, 99.0);
+    result.drawCalls = renderer.drawCalls();
+    result.triangles = renderer.triangles();
+    result.model = renderer.modelStats();
+
+    // GPU 计时要晚 FramesInFlight 帧才读回来，多画几帧把最后的计时帧也读完
+    if (!options.tracePrefix.isEmpty()) {
+        for (int i = 0; i < FrameProfiler::FramesInFlight; ++i)
+            renderer.render();
+        f->glFinish();
+        renderer.render();
+        renderer.profiler().writeChromeTrace(QString("%1-%2.json").arg(options.tracePrefix).arg(sceneSize));
+    }
+
+    if (!icons.textures.empty())
+        f->glDeleteTextures(GLsizei(icons.textures.size()), icons.textures.data());
+    icons.atlas.destroy();
+    renderer.cleanup();
+    fbo.release();
+    result.peakRssMb = peakRssMb();
+    return result;
+}
+
+QJsonObject toJson(const BenchResult &r)
+{
+    QJsonObject o;
+    o["sceneSize"] = r.sceneSize;
+    o["startupMs"] = r.startupMs;
+    o["fps"] = r.fps;
+    o["p50Ms"] = r.p50Ms;
+    o["p99Ms"] = r.p99Ms;
+    o["peakRssMb"] = r.peakRssMb;
+    o["drawCalls"] = r.drawCalls;
+    o["triangles"] = r.triangles;
+    return o;
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    QSurfaceFormat::setDefaultFormat(Renderer::surfaceFormat());
+    QGuiApplication app(argc, argv);
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Offscreen benchmark for the Renderer used by MyOpenGLWidget");
+    parser.addHelpOption();
+    QCommandLineOption sizesOption("sizes", "Comma separated scene sizes (triangles).", "list", "1,1000,10000,100000");
+    QCommandLineOption framesOption("frames", "Measured frames per scene.", "n", "300");
+    QCommandLineOption warmupOption("warmup", "Warm-up frames per scene.", "n", "30");
+    QCommandLineOption widthOption("width", "Framebuffer width.", "px", "800");
+    QCommandLineOption heightOption("height", "Framebuffer height.", "px", "600");
+    QCommandLineOption jsonOption("json", "Also write results as JSON to <file>.", "file");
+    QCommandLineOption noShaderCacheOption("no-shader-cache", "Always compile shaders from source (cold start).");
+    QCommandLineOption traceOption("trace", "Write a Chrome trace per scene to <prefix>-<scene>.json.", "prefix");
+    QCommandLineOption recordOption("record", "Record the GL calls per scene to <prefix>-<scene>.gltrace for glreplay.",
+                                    "prefix");
+    QCommandLineOption instancedOption("instanced", "Draw the scene as one instanced mesh instead of batched triangles.");
+    QCommandLineOption indirectOption("indirect", "Draw the scene with one multi-draw-indirect call, "
+                                                  "one command per triangle.");
+    QCommandLineOption iconsOption("icons", "Also draw <n> distinct icon quads on top of the scene.", "n", "0");
+    QCommandLineOption atlasOption("atlas", "Pack the icons into a texture atlas instead of one texture each.");
+    QCommandLineOption jobsOption("jobs", "Worker threads for per-frame culling and vertex preparation "
+                                          "(-1 = cores - 1, 0 = everything on the GL thread).", "n", "-1");
+    QCommandLineOption vertexFormatOption("vertex-format", "Vertex format of the instanced mesh: full, half or snorm16.",
+                                          "format", "full");
+    QCommandLineOption modelOption("model", "Also draw the mesh in <file> (.obj, .gltf or .glb).", "file");
+    QCommandLineOption modelCopiesOption("model-copies", "Draw <n> copies of the model, tiled and differently sized.",
+                                         "n", "1");
+    QCommandLineOption lodErrorOption("lod-error", "Screen-space error allowed by the model LOD (0 = always full "
+                                                   "detail).", "px", "1");
+    QCommandLineOption impostorOption("impostor", "Draw model copies smaller than <px> as billboard impostors.", "px",
+                                      "0");
+    parser.addOptions({sizesOption, framesOption, warmupOption, widthOption, heightOption, jsonOption,
+                       noShaderCacheOption, traceOption, recordOption, instancedOption, indirectOption, iconsOption,
+                       atlasOption, jobsOption, vertexFormatOption, modelOption, modelCopiesOption, lodErrorOption,
+                       impostorOption});
+    parser.process(app);
+
+    QList<int> sizes;
+    for (const QString &s : parser.value(sizesOption).split(',', Qt::SkipEmptyParts)) {
+        bool ok = false;
+        const int n = s.trimmed().toInt(&ok);
+        if (ok && n > 0)
+            sizes.append(n);
+    }
+    std::sort(sizes.begin(), sizes.end());
+    BenchOptions options;
+    options.frames = qMax(1, parser.value(framesOption).toInt());
+    options.warmupFrames = qMax(0, parser.value(warmupOption).toInt());
+    options.size = QSize(qMax(1, parser.value(widthOption).toInt()), qMax(1, parser.value(heightOption).toInt()));
+    options.shaderCache = !parser.isSet(noShaderCacheOption);
+    options.instancing = parser.isSet(instancedOption);
+    options.indirect = parser.isSet(indirectOption);
+    options.tracePrefix = parser.value(traceOption);
+    options.recordPrefix = parser.value(recordOption);
+    options.icons = qMax(0, parser.value(iconsOption).toInt());
+    options.atlas = parser.isSet(atlasOption);
+    if (!VertexFormat::fromName(parser.value(vertexFormatOption), &options.vertexFormat, false)) {
+        QTextStream(stderr) << "glbench: unknown vertex format " << parser.value(vertexFormatOption) << Qt::endl;
+        return 1;
+    }
+    options.model = parser.value(modelOption);
+    if (!options.model.isEmpty() && !Mesh::isMeshFile(options.model)) {
+        QTextStream(stderr) << "glbench: " << options.model << " is not an .obj, .gltf or .glb file" << Qt::endl;
+        return 1;
+    }
+    options.modelCopies = qMax(1, parser.value(modelCopiesOption).toInt());
+    options.lodError = qMax(0.0f, parser.value(lodErrorOption).toFloat());
+    options.impostor = qMax(0.0f, parser.value(impostorOption).toFloat());
+    JobSystem jobs(qMax(-1, parser.value(jobsOption).toInt()));
+    options.jobs = &jobs;
+    const QSize &size = options.size;
+    const int frames = options.frames;
+
+    QTextStream out(stdout);
+    QTextStream err(stderr);
+
+    QOpenGLContext context;
+    context.setFormat(Renderer::surfaceFormat());
+    if (!context.create()) {
+        err << "glbench: failed to create an OpenGL " << Renderer::surfaceFormat().majorVersion() << '.'
+            << Renderer::surfaceFormat().minorVersion() << " core context" << Qt::endl;
+        return 1;
+    }
+    QOffscreenSurface surface;
+    surface.setFormat(context.format());
+    surface.create();
+    if (!context.makeCurrent(&surface)) {
+        err << "glbench: failed to make the context current on the offscreen surface" << Qt::endl;
+        return 1;
+    }
+
+    QOpenGLFunctions *f = context.functions();
+    out << "GL_RENDERER: " << reinterpret_cast<const char *>(f->glGetString(GL_RENDERER)) << Qt::endl;
+    out << "GL_VERSION:  " << reinterpret_cast<const char *>(f->glGetString(GL_VERSION)) << Qt::endl;
+    out << "framebuffer " << size.width() << 'x' << size.height() << ", " << frames << " frames, "
+        << options.warmupFrames << " warm-up";
+    if (options.indirect)
+        out << ", multi-draw indirect, vertices " << options.vertexFormat.description();
+    else if (options.instancing)
+        out << ", instanced, vertices " << options.vertexFormat.description();
+    if (options.icons > 0)
+        out << ", " << options.icons << " icons" << (options.atlas ? " (atlas)" : "");
+    if (!options.model.isEmpty()) {
+        out << ", model " << options.model << " x" << options.modelCopies << ", LOD error " << options.lodError
+            << " px";
+        if (options.impostor > 0.0f)
+            out << ", impostors below " << options.impostor << " px";
+    }
+    out << ", " << jobs.workerCount() << " job workers" << Qt::endl << Qt::endl;
+    out << qSetFieldWidth(10) << Qt::right << "scene" << "startup ms" << "fps" << "p50 ms" << "p99 ms"
+        << "peak MB" << "draws" << "tris" << qSetFieldWidth(0) << Qt::endl;
+
+    QJsonArray results;
+    Mesh::OptimizeStats model;
+    for (int sceneSize : sizes) {
+        const BenchResult r = runScene(context, sceneSize, options);
+        out << qSetFieldWidth(10) << Qt::fixed << qSetRealNumberPrecision(2) << r.sceneSize << r.startupMs
+            << r.fps << r.p50Ms << r.p99Ms << r.peakRssMb << r.drawCalls << r.triangles << qSetFieldWidth(0)
+            << Qt::endl;
+        results.append(toJson(r));
+        model = r.model;
+    }
+    if (!options.model.isEmpty()) {
+        out << Qt::endl << "model ACMR " << model.before.acmr << " -> " << model.after.acmr << ", ATVR "
+            << model.before.atvr << " -> " << model.after.atvr << Qt::endl;
+    }
+
+    if (parser.isSet(jsonOption)) {
+        QFile file(parser.value(jsonOption));
+        if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+            err << "glbench: cannot write " << file.fileName() << Qt::endl;
+            return 1;
+        }
+        QJsonObject root;
+        root["renderer"] = QString::fromLatin1(reinterpret_cast<const char *>(f->glGetString(GL_RENDERER)));
+        root["width"] = size.width();
+        root["height"] = size.height();
+        root["frames"] = frames;
+        root["instanced"] = options.instancing;
+        root["indirect"] = options.indirect;
+        root["icons"] = options.icons;
+        root["atlas"] = options.atlas;
+        root["jobWorkers"] = jobs.workerCount();
+        root["vertexFormat"] = options.vertexFormat.description();
+        if (!options.model.isEmpty()) {
+            QJsonObject m;
+            m["file"] = options.model;
+            m["acmrBefore"] = model.before.acmr;
+            m["acmrAfter"] = model.after.acmr;
+            m["atvrBefore"] = model.before.atvr;
+            m["atvrAfter"] = model.after.atvr;
+            m["copies"] = options.modelCopies;
+            m["lodError"] = options.lodError;
+            m["impostor"] = options.impostor;
+            root["model"] = m;
+        }
+        root["results"] = results;
+        file.write(QJsonDocument(root).toJson());
+    }
+
+    context.doneCurrent();
+    return 0;
+}
@@ -1,11 +1,53 @@
 #include "mainwindow.h"
 
 #include <QApplication>
+#include <QSurfaceFormat>
 
 int main(int argc, char *argv[])
 {
+    // 默认格式要在创建 QApplication 之前设置，QOpenGLWidget 创建上下文时会用它
+    QSurfaceFormat::setDefaultFormat(Renderer::surfaceFormat());
+
     QApplication a(argc, argv);
     MainWindow w;
+    // --render-thread：Renderer 在单独的线程里画，GUI 线程忙的时候也不掉帧（见 RenderThread）
+    if (a.arguments().contains("--render-thread"))
+        w.glWidget()->setThreadedRendering(true);
+    // --continuous：每帧都重画（默认按需渲染，场景没变时不画）
+    if (a.arguments().contains("--continuous"))
+        w.glWidget()->setContinuousRendering(true);
+    // --model <文件>：额外画一个导入的模型（OBJ / glTF），读入时做顶点缓存和 overdraw 优化
+    const int model = a.arguments().indexOf("--model");
+    if (model >= 0 && model + 1 < a.arguments().size())
+        w.glWidget()->setModelFile(a.arguments().at(model + 1));
+    // --model-copies <N>：模型平铺画 N 份（大小不一），--lod-error <像素>：LOD 允许的屏幕误差（默认 1，0 = 不用 LOD），
+    // --impostor <像素>：屏幕上比这还小的模型画成公告板（默认不用）
+    const int copies = a.arguments().indexOf("--model-copies");
+    if (copies >= 0 && copies + 1 < a.arguments().size())
+        w.glWidget()->setModelCopies(a.arguments().at(copies + 1).toInt());
+    const int lodError = a.arguments().indexOf("--lod-error");
+    if (lodError >= 0 && lodError + 1 < a.arguments().size())
+        w.glWidget()->setLodErrorThreshold(a.arguments().at(lodError + 1).toFloat());
+    const int impostor = a.arguments().indexOf("--impostor");
+    if (impostor >= 0 && impostor + 1 < a.arguments().size())
+        w.glWidget()->setImpostorSize(a.arguments().at(impostor + 1).toFloat());
+    // --texture-budget <MB>：纹理显存预算，超出时淘汰最久没用的纹理的大 mip（默认不限制）
+    const int budget = a.arguments().indexOf("--texture-budget");
+    if (budget >= 0 && budget + 1 < a.arguments().size())
+        w.glWidget()->setTextureBudget(qint64(a.arguments().at(budget + 1).toDouble() * 1024 * 1024));
+    // --gl-trace <文件>：把 GL 调用录下来，用 benchmark/glreplay 离线重放；--gl-trace-frames <N>：只录前 N 帧
+    const int trace = a.arguments().indexOf("--gl-trace");
+    if (trace >= 0 && trace + 1 < a.arguments().size()) {
+        const int traceFrames = a.arguments().indexOf("--gl-trace-frames");
+        int frames = 0;
+        if (traceFrames >= 0 && traceFrames + 1 < a.arguments().size())
+            frames = a.arguments().at(traceFrames + 1).toInt();
+        w.glWidget()->setGlTraceFile(a.arguments().at(trace + 1), frames);
+    }
+    // --capture <目录|文件.png|文件.yuv>：一开始就录制（见 MyOpenGLWidget::startCapture）
+    const int capture = a.arguments().indexOf("--capture");
+    if (capture >= 0 && capture + 1 < a.arguments().size())
+        w.glWidget()->startCapture(a.arguments().at(capture + 1));
     w.show();
     return a.exec();
 }
@@ -16,6 +16,8 @@ public:
     MainWindow(QWidget *parent = nullptr);
     ~MainWindow();
 
+    MyOpenGLWidget *glWidget() const { return openGLWidget; }
+
 private:
     Ui::MainWindow *ui;
     MyOpenGLWidget *openGLWidget;
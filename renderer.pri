@@ -0,0 +1,51 @@
+# 绘制代码（Renderer 及其依赖），窗口程序 testOpenGL.pro 和 benchmark/benchmark.pro 共用
+INCLUDEPATH += $$PWD
+DEPENDPATH += $$PWD
+
+SOURCES += \
+    $$PWD/DynamicTexture.cpp \
+    $$PWD/FrameProfiler.cpp \
+    $$PWD/GLStateCache.cpp \
+    $$PWD/GLTrace.cpp \
+    $$PWD/ImageKernels.cpp \
+    $$PWD/IndirectBatch.cpp \
+    $$PWD/InstancedMesh.cpp \
+    $$PWD/JobSystem.cpp \
+    $$PWD/LodSelector.cpp \
+    $$PWD/Mesh.cpp \
+    $$PWD/MeshOptimizer.cpp \
+    $$PWD/MeshSimplifier.cpp \
+    $$PWD/Renderer.cpp \
+    $$PWD/Scene.cpp \
+    $$PWD/ShaderCache.cpp \
+    $$PWD/SpriteBatch.cpp \
+    $$PWD/StreamBuffer.cpp \
+    $$PWD/TextureAtlas.cpp \
+    $$PWD/TextureContainer.cpp \
+    $$PWD/TextureManager.cpp \
+    $$PWD/VertexFormat.cpp
+
+HEADERS += \
+    $$PWD/DynamicTexture.h \
+    $$PWD/FrameProfiler.h \
+    $$PWD/GLStateCache.h \
+    $$PWD/GLTrace.h \
+    $$PWD/GLTraceFunctions.h \
+    $$PWD/ImageKernels.h \
+    $$PWD/IndirectBatch.h \
+    $$PWD/InstancedMesh.h \
+    $$PWD/JobSystem.h \
+    $$PWD/LodSelector.h \
+    $$PWD/Mesh.h \
+    $$PWD/MeshOptimizer.h \
+    $$PWD/MeshSimplifier.h \
+    $$PWD/Renderer.h \
+    $$PWD/Scene.h \
+    $$PWD/ShaderCache.h \
+    $$PWD/SpriteBatch.h \
+    $$PWD/StreamBuffer.h \
+    $$PWD/TextureAtlas.h \
+    $$PWD/TextureContainer.h \
+    $$PWD/TextureManager.h \
+    $$PWD/VertexFormat.h \
+    $$PWD/WorkStealingDeque.h
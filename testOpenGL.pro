@@ -1,4 +1,4 @@
-QT       += core gui openglwidgets
+QT       += core gui opengl openglwidgets
 
 greaterThan(QT_MAJOR_VERSION, 4): QT += widgets
 
@@ -9,14 +9,21 @@ CONFIG += c++17
 #DEFINES += QT_DISABLE_DEPRECATED_BEFORE=0x060000    # disables all the APIs deprecated before Qt 6.0.0
 
 SOURCES += \
+    FrameCapture.cpp \
     MyOpenGLWidget.cpp \
+    RenderThread.cpp \
     main.cpp \
     mainwindow.cpp
 
 HEADERS += \
+    FrameCapture.h \
     MyOpenGLWidget.h \
+    RenderThread.h \
+    SpscQueue.h \
     mainwindow.h
 
+include(renderer.pri)
+
 FORMS += \
     mainwindow.ui
 
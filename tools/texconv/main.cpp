@@ -0,0 +1,463 @@
+/* texconv：把 .qrc 里引用的图片转成 KTX2，运行时由 TextureManager 直接内存映射上传
+ *
+ *   texconv ../../resources.qrc --update-qrc            # 默认 --format auto
+ *
+ * 每个 foo.png 在旁边生成 foo.ktx2：
+ *   - 离线算好完整的 mip 链（2x2 盒式滤波），运行时不再 glGenerateMipmap
+ *   - --format auto：不透明的图用 BC1（每像素 4 位），有透明度的用 BC3（每像素 8 位）；
+ *     rgba8 不压缩（无损），bc1/bc3 强制指定
+ * TextureManager::load(":/textures/foo.png") 发现旁边有 foo.ktx2 时自动改用它。
+ *
+ * --update-qrc 把生成的 .ktx2 加进 .qrc，并标记 compression-algorithm="none"：
+ * rcc 压缩过的条目不能内存映射，只能整个读出来。
+ * 输出比输入新时跳过（--force 强制重新生成）。
+ */
+#include "TextureContainer.h"
+
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QXmlStreamReader>
+#include <QFile>
+#include <QFileInfo>
+#include <QDir>
+#include <QSaveFile>
+#include <QImage>
+#include <QtEndian>
+#include <QTextStream>
+#include <climits>
+#include <cstring>
+#include <vector>
+
+namespace {
+
+struct Rgba
+{
+    uchar r, g, b, a;
+};
+
+// VkFormat 枚举值，和 TextureContainer.cpp 里的表对应
+const quint32 VkFormatRgba8 = 37;   // VK_FORMAT_R8G8B8A8_UNORM
+const quint32 VkFormatBc1 = 131;    // VK_FORMAT_BC1_RGB_UNORM_BLOCK
+const quint32 VkFormatBc3 = 137;    // VK_FORMAT_BC3_UNORM_BLOCK
+
+// ---- mip 链 ----
+
+// 2x2 盒式滤波缩小一半；奇数尺寸时最后一列/行和自己平均
+QImage downsample(const QImage &src)
+{
+    const int w = qMax(1, src.width() / 2);
+    const int h = qMax(1, src.height() / 2);
+    QImage dst(w, h, QImage::Format_RGBA8888);
+    for (int y = 0; y < h; ++y) {
+        const int y0 = qMin(2 * y, src.height() - 1);
+        const int y1 = qMin(2 * y + 1, src.height() - 1);
+        const uchar *row0 = src.constScanLine(y0);
+        const uchar *row1 = src.constScanLine(y1);
+        uchar *out = dst.scanLine(y);
+        for (int x = 0; x < w; ++x) {
+            const int x0 = qMin(2 * x, src.width() - 1) * 4;
+            const int x1 = qMin(2 * x + 1, src.width() - 1) * 4;
+            for (int c = 0; c < 4; ++c)
+                out[x * 4 + c] = uchar((row0[x0 + c] + row0[x1 + c] + row1[x0 + c] + row1[x1 + c] + 2) / 4);
+        }
+    }
+    return dst;
+}
+
+// 有没有不是完全不透明的像素（PNG 带透明通道但全是 255 的也按不透明处理，用 BC1）
+bool hasTransparency(const QImage &image)
+{
+    for (int y = 0; y < image.height(); ++y) {
+        const uchar *row = image.constScanLine(y);
+        for (int x = 0; x < image.width(); ++x) {
+            if (row[x * 4 + 3] != 255)
+                return true;
+        }
+    }
+    return false;
+}
+
+// ---- BC1 / BC3 编码（包围盒取端点，质量够用、速度快） ----
+
+quint16 to565(const int rgb[3])
+{
+    return quint16(((rgb[0] * 31 + 127) / 255) << 11 | ((rgb[1] * 63 + 127) / 255) << 5 | ((rgb[2] * 31 + 127) / 255));
+}
+
+void from565(quint16 c, int rgb[3])
+{
+    const int r = (c >> 11) & 31, g = (c >> 5) & 63, b = c & 31;
+    rgb[0] = (r << 3) | (r >> 2);
+    rgb[1] = (g << 2) | (g >> 4);
+    rgb[2] = (b << 3) | (b >> 2);
+}
+
+// 8 字节颜色块：两个 565 端点 + 16 个 2 位索引。c0 > c1 时是 4 色模式
+void encodeColorBlock(const Rgba px[16], uchar out[8])
+{
+    int lo[3] = {255, 255, 255}, hi[3] = {0, 0, 0};
+    for (int i = 0; i < 16; ++i) {
+        const int c[3] = {px[i].r, px[i].g, px[i].b};
+        for (int k = 0; k < 3; ++k) {
+            lo[k] = qMin(lo[k], c[k]);
+            hi[k] = qMax(hi[k], c[k]);
+        }
+    }
+    // 端点往里收 1/16，插值出来的两个中间色更贴近实际分布
+    for (int k = 0; k < 3; ++k) {
+        const int inset = (hi[k] - lo[k]) / 16;
+        lo[k] += inset;
+        hi[k] -= inset;
+    }
+
+    quint16 c0 = to565(hi), c1 = to565(lo);
+    if (c0 < c1)
+        std::swap(c0, c1);
+    quint32 indices = 0;
+    if (c0 != c1) {
+        int palette[4][3];
+        from565(c0, palette[0]);
+        from565(c1, palette[1]);
+        for (int k = 0; k < 3; ++k) {
+            palette[2][k] = (2 * palette[0][k] + palette[1][k]) / 3;
+            palette[3][k] = (palette[0][k] + 2 * palette[1][k]) / 3;
+        }
+        for (int i = 0; i < 16; ++i) {
+            int best = 0, bestError = INT_MAX;
+            for (int p = 0; p < 4; ++p) {
+                const int dr = px[i].r - palette[p][0], dg = px[i].g - palette[p][1], db = px[i].b - palette[p][2];
+                const int error = dr * dr + dg * dg + db * db;
+                if (error < bestError) {
+                    bestError = error;
+                    best = p;
+                }
+            }
+            indices |= quint32(best) << (2 * i);
+        }
+    }
+    qToLittleEndian<quint16>(c0, out);
+    qToLittleEndian<quint16>(c1, out + 2);
+    qToLittleEndian<quint32>(indices, out + 4);
+}
+
+// 8 字节透明度块：两个端点 + 16 个 3 位索引。a0 > a1 时是 8 级插值模式
+void encodeAlphaBlock(const Rgba px[16], uchar out[8])
+{
+    int lo = 255, hi = 0;
+    for (int i = 0; i < 16; ++i) {
+        lo = qMin(lo, int(px[i].a));
+        hi = qMax(hi, int(px[i].a));
+    }
+    quint64 bits = 0;
+    if (hi != lo) {
+        int palette[8] = {hi, lo};
+        for (int i = 1; i <= 6; ++i)
+            palette[i + 1] = ((7 - i) * hi + i * lo) / 7;
+        for (int i = 0; i < 16; ++i) {
+            int best = 0, bestError = INT_MAX;
+            for (int p = 0; p < 8; ++p) {
+                const int error = qAbs(px[i].a - palette[p]);
+                if (error < bestError) {
+                    bestError = error;
+                    best = p;
+                }
+            }
+            bits |= quint64(best) << (3 * i);
+        }
+    }
+    out[0] = uchar(hi);
+    out[1] = uchar(lo);
+    for (int i = 0; i < 6; ++i)
+        out[2 + i] = uchar(bits >> (8 * i));
+}
+
+QByteArray encodeBlocks(const QImage &image, TextureContainer::Format format)
+{
+    const int blocksX = (image.width() + 3) / 4;
+    const int blocksY = (image.height() + 3) / 4;
+    const int blockBytes = TextureContainer::blockBytes(format);
+    QByteArray out(qsizetype(blocksX) * blocksY * blockBytes, Qt::Uninitialized);
+    uchar *dst = reinterpret_cast<uchar *>(out.data());
+    Rgba px[16];
+    for (int by = 0; by < blocksY; ++by) {
+        for (int bx = 0; bx < blocksX; ++bx) {
+            // 边上不满 4x4 的块重复最后一行/列
+            for (int i = 0; i < 16; ++i) {
+                const int x = qMin(bx * 4 + i % 4, image.width() - 1);
+                const int y = qMin(by * 4 + i / 4, image.height() - 1);
+                std::memcpy(&px[i], image.constScanLine(y) + x * 4, 4);
+            }
+            if (format == TextureContainer::BC3) {
+                encodeAlphaBlock(px, dst);
+                encodeColorBlock(px, dst + 8);
+            } else {
+                encodeColorBlock(px, dst);
+            }
+            dst += blockBytes;
+        }
+    }
+    return out;
+}
+
+QByteArray encodeLevel(const QImage &image, TextureContainer::Format format)
+{
+    if (format == TextureContainer::RGBA8) {
+        QByteArray out(qsizetype(image.width()) * image.height() * 4, Qt::Uninitialized);
+        for (int y = 0; y < image.height(); ++y)   // 去掉 QImage 每行的对齐填充
+            std::memcpy(out.data() + qsizetype(y) * image.width() * 4, image.constScanLine(y), size_t(image.width()) * 4);
+        return out;
+    }
+    return encodeBlocks(image, format);
+}
+
+// ---- KTX2 ----
+
+// 基本数据格式描述符（Khronos Data Format 规范）：KTX2 要求必须有，TextureManager 自己只看 vkFormat
+QByteArray dataFormatDescriptor(TextureContainer::Format format)
+{
+    struct Sample
+    {
+        quint16 bitOffset;
+        quint8 bitLength;   // 位数 - 1
+        quint8 channel;
+        quint32 upper;
+    };
+    quint8 colorModel = 1;          // KHR_DF_MODEL_RGBSDA
+    quint8 blockDimension = 0;      // 块宽高 - 1
+    quint8 bytesPlane0 = 4;
+    std::vector<Sample> samples;
+    if (format == TextureContainer::BC1) {
+        colorModel = 128;           // KHR_DF_MODEL_BC1A
+        blockDimension = 3;
+        bytesPlane0 = 8;
+        samples = {{0, 63, 0, 0xffffffffu}};
+    } else if (format == TextureContainer::BC3) {
+        colorModel = 130;           // KHR_DF_MODEL_BC3
+        blockDimension = 3;
+        bytesPlane0 = 16;
+        samples = {{0, 63, 15, 0xffffffffu}, {64, 63, 0, 0xffffffffu}};   // 先透明度块，后颜色块
+    } else {
+        samples = {{0, 7, 0, 255}, {8, 7, 1, 255}, {16, 7, 2, 255}, {24, 7, 15, 255}};   // R G B A
+    }
+
+    const quint16 blockSize = quint16(24 + 16 * samples.size());
+    QByteArray dfd(4 + blockSize, '\0');
+    uchar *p = reinterpret_cast<uchar *>(dfd.data());
+    qToLittleEndian<quint32>(quint32(dfd.size()), p);   // dfdTotalSize
+    // vendorId = 0 (Khronos), descriptorType = 0 (basic)：4 个字节都是 0
+    qToLittleEndian<quint16>(2, p + 8);                  // versionNumber（KDF 1.3）
+    qToLittleEndian<quint16>(blockSize, p + 10);
+    p[12] = colorModel;
+    p[13] = 1;                                           // 原色：BT.709
+    p[14] = 1;                                           // 传递函数：线性（和 UNORM 格式一致）
+    p[15] = 0;                                           // 非预乘透明度
+    p[16] = p[17] = blockDimension;
+    p[20] = bytesPlane0;
+    for (size_t i = 0; i < samples.size(); ++i) {
+        uchar *s = p + 28 + 16 * i;
+        qToLittleEndian<quint16>(samples[i].bitOffset, s);
+        s[2] = samples[i].bitLength;
+        s[3] = samples[i].channel;
+        // samplePosition 0..3 和 sampleLower 都是 0
+        qToLittleEndian<quint32>(samples[i].upper, s + 12);
+    }
+    return dfd;
+}
+
+QByteArray writeKtx2(quint32 vkFormat, TextureContainer::Format format, int width, int height,
+                     const std::vector<QByteArray> &levels)
+{
+    static const uchar identifier[12] = {0xAB, 'K', 'T', 'X', ' ', '2', '0', 0xBB, '\r', '\n', 0x1A, '\n'};
+    const int count = int(levels.size());
+    const QByteArray dfd = dataFormatDescriptor(format);
+    const qsizetype dfdOffset = 80 + 24 * count;
+
+    // 规范要求数据从最小的层级开始存放，每层的起点按 lcm(块字节数, 4) 对齐
+    const qsizetype alignment = qMax(4, TextureContainer::blockBytes(format));
+    std::vector<qsizetype> offsets(levels.size());
+    qsizetype end = dfdOffset + dfd.size();
+    for (int i = count - 1; i >= 0; --i) {
+        end = (end + alignment - 1) / alignment * alignment;
+        offsets[size_t(i)] = end;
+        end += levels[size_t(i)].size();
+    }
+
+    QByteArray file(end, '\0');
+    uchar *p = reinterpret_cast<uchar *>(file.data());
+    std::memcpy(p, identifier, sizeof(identifier));
+    const quint32 header[] = {vkFormat, 1 /* typeSize */, quint32(width), quint32(height), 0 /* depth */,
+                              0 /* layers */, 1 /* faces */, quint32(count), 0 /* supercompression */,
+                              quint32(dfdOffset), quint32(dfd.size()), 0 /* kvd */, 0};
+    for (size_t i = 0; i < sizeof(header) / sizeof(header[0]); ++i)
+        qToLittleEndian<quint32>(header[i], p + 12 + 4 * i);
+    // sgdByteOffset / sgdByteLength（两个 uint64）保持 0
+    for (int i = 0; i < count; ++i) {
+        uchar *entry = p + 80 + 24 * i;
+        const quint64 size = quint64(levels[size_t(i)].size());
+        qToLittleEndian<quint64>(quint64(offsets[size_t(i)]), entry);
+        qToLittleEndian<quint64>(size, entry + 8);
+        qToLittleEndian<quint64>(size, entry + 16);   // uncompressedByteLength：没有超压缩，和 byteLength 一样
+        std::memcpy(p + offsets[size_t(i)], levels[size_t(i)].constData(), size_t(size));
+    }
+    std::memcpy(p + dfdOffset, dfd.constData(), size_t(dfd.size()));
+    return file;
+}
+
+// ---- .qrc ----
+
+QStringList qrcFiles(const QString &qrcPath)
+{
+    QFile file(qrcPath);
+    QStringList files;
+    if (!file.open(QIODevice::ReadOnly))
+        return files;
+    QXmlStreamReader xml(&file);
+    while (!xml.atEnd()) {
+        if (xml.readNext() == QXmlStreamReader::StartElement && xml.name() == QLatin1String("file"))
+            files << xml.readElementText().trimmed();
+    }
+    return files;
+}
+
+// 在 <file>foo.png</file> 这一行后面加一行 foo.ktx2，已经有了就不动
+bool addToQrc(const QString &qrcPath, const QStringList &sources, const QStringList &outputs)
+{
+    QFile in(qrcPath);
+    if (!in.open(QIODevice::ReadOnly | QIODevice::Text))
+        return false;
+    QStringList lines = QString::fromUtf8(in.readAll()).split('\n');
+    in.close();
+
+    bool changed = false;
+    for (int i = 0; i < sources.size(); ++i) {
+        const QString entry = QString(">%1</file>").arg(outputs[i]);
+        bool present = false;
+        for (const QString &line : lines)
+            present = present || line.contains(entry);
+        if (present)
+            continue;
+        for (int l = 0; l < lines.size(); ++l) {
+            if (lines[l].contains(QString(">%1</file>").arg(sources[i]))) {
+                const QString indent = lines[l].left(lines[l].indexOf('<'));
+                lines.insert(l + 1, QString("%1<file compression-algorithm=\"none\">%2</file>").arg(indent, outputs[i]));
+                changed = true;
+                break;
+            }
+        }
+    }
+    if (!changed)
+        return true;
+    QSaveFile out(qrcPath);
+    if (!out.open(QIODevice::WriteOnly | QIODevice::Text))
+        return false;
+    out.write(lines.join('\n').toUtf8());
+    return out.commit();
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Convert the images referenced by a .qrc into KTX2 with precomputed mipmaps");
+    parser.addHelpOption();
+    parser.addPositionalArgument("qrc", "Resource file whose images are converted.");
+    QCommandLineOption formatOption("format", "auto (BC1 opaque / BC3 alpha), rgba8, bc1 or bc3.", "format", "auto");
+    QCommandLineOption updateQrcOption("update-qrc", "Add the generated .ktx2 files to the .qrc (uncompressed).");
+    QCommandLineOption forceOption("force", "Regenerate even if the output is newer than the input.");
+    parser.addOptions({formatOption, updateQrcOption, forceOption});
+    parser.process(app);
+
+    QTextStream out(stdout);
+    QTextStream err(stderr);
+    const QString formatName = parser.value(formatOption).toLower();
+    if (!QStringList({"auto", "rgba8", "bc1", "bc3"}).contains(formatName)) {
+        err << "texconv: unknown format " << formatName << Qt::endl;
+        return 1;
+    }
+    if (parser.positionalArguments().isEmpty())
+        parser.showHelp(1);
+
+    int failures = 0;
+    for (const QString &qrcPath : parser.positionalArguments()) {
+        const QDir qrcDir = QFileInfo(qrcPath).absoluteDir();
+        QStringList sources, outputs;
+        for (const QString &name : qrcFiles(qrcPath)) {
+            const QString suffix = QFileInfo(name).suffix().toLower();
+            if (suffix != "png" && suffix != "jpg" && suffix != "jpeg" && suffix != "bmp")
+                continue;
+            const QString outputName = name.left(name.size() - suffix.size()) + "ktx2";
+            const QString input = qrcDir.filePath(name);
+            const QString output = qrcDir.filePath(outputName);
+            sources << name;
+            outputs << outputName;
+
+            if (!parser.isSet(forceOption) && QFileInfo(output).exists()
+                && QFileInfo(output).lastModified() >= QFileInfo(input).lastModified()) {
+                out << "up to date  " << outputName << Qt::endl;
+                continue;
+            }
+
+            QImage image(input);
+            if (image.isNull()) {
+                err << "texconv: cannot read " << input << Qt::endl;
+                ++failures;
+                continue;
+            }
+            image = image.convertToFormat(QImage::Format_RGBA8888);
+
+            TextureContainer::Format format = TextureContainer::RGBA8;
+            quint32 vkFormat = VkFormatRgba8;
+            const bool bc3 = formatName == "bc3" || (formatName == "auto" && hasTransparency(image));
+            if (formatName == "bc1" || (formatName == "auto" && !bc3)) {
+                format = TextureContainer::BC1;
+                vkFormat = VkFormatBc1;
+            } else if (bc3) {
+                format = TextureContainer::BC3;
+                vkFormat = VkFormatBc3;
+            }
+
+            std::vector<QByteArray> levels;
+            QImage level = image;
+            for (;;) {
+                levels.push_back(encodeLevel(level, format));
+                if (level.width() == 1 && level.height() == 1)
+                    break;
+                level = downsample(level);
+            }
+
+            QSaveFile file(output);
+            if (!file.open(QIODevice::WriteOnly)) {
+                err << "texconv: cannot write " << output << Qt::endl;
+                ++failures;
+                continue;
+            }
+            file.write(writeKtx2(vkFormat, format, image.width(), image.height(), levels));
+            if (!file.commit()) {
+                err << "texconv: cannot write " << output << Qt::endl;
+                ++failures;
+                continue;
+            }
+
+            // 用运行时的解析代码读一遍，确认写出来的文件能被加载
+            TextureContainer check;
+            if (!check.open(output) || check.levelCount() != int(levels.size())) {
+                err << "texconv: verification failed for " << output << ": " << check.errorString() << Qt::endl;
+                ++failures;
+                continue;
+            }
+            out << "converted   " << name << " -> " << outputName << " (" << image.width() << 'x' << image.height()
+                << ", " << levels.size() << " levels, " << (format == TextureContainer::BC1 ? "BC1"
+                                                            : format == TextureContainer::BC3 ? "BC3" : "RGBA8")
+                << ", " << QFileInfo(output).size() / 1024 << " KiB)" << Qt::endl;
+        }
+
+        if (parser.isSet(updateQrcOption) && !addToQrc(qrcPath, sources, outputs)) {
+            err << "texconv: cannot update " << qrcPath << Qt::endl;
+            ++failures;
+        }
+    }
+    return failures == 0 ? 0 : 1;
+}
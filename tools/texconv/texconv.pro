@@ -0,0 +1,16 @@
+# 离线纹理转换：把 resources.qrc 里的 PNG 转成带完整 mip 链的 KTX2（可选 BC1/BC3 压缩）
+QT       += core gui
+
+CONFIG += c++17 console
+CONFIG -= app_bundle
+
+TARGET = texconv
+
+INCLUDEPATH += $$PWD/../..
+
+SOURCES += \
+    main.cpp \
+    $$PWD/../../TextureContainer.cpp
+
+HEADERS += \
+    $$PWD/../../TextureContainer.h